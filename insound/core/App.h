@@ -8,15 +8,27 @@
  */
 #pragma once
 #include <insound/core/env.h>
+#include <insound/core/HttpClient.h>
+#include <insound/core/Lifecycle.h>
 #include <insound/core/mongo.h>
 #include <insound/core/Router.h>
+#include <insound/core/Workers.h>
+#include <insound/core/middleware/BodyLimit.h>
+#include <insound/core/middleware/DrainGuard.h>
 #include <insound/core/middleware/Helmet.h>
+#include <insound/core/middleware/RateLimiter.h>
 #include <insound/core/middleware/UserAuth.h>
 
 #include <insound/core/thirdparty/crow.hpp>
 #include <crow/middlewares/cookie_parser.h>
 
+#include <chrono>
+#include <csignal>
+#include <future>
+#include <map>
 #include <memory>
+#include <string>
+#include <thread>
 #include <type_traits>
 #include <vector>
 
@@ -35,6 +47,47 @@ namespace Insound
         // Log level of the application. E.g. `LogLevel::Warning` will only log
         // warnings and anything more severe.
         LogLevel logLevel = LogLevel::Warning;
+
+        // Default max request body size in bytes for routes that do not
+        // declare their own via `Router::limit`. 0 for no limit.
+        // Env override: "MAX_BODY_SIZE"
+        size_t maxBodySize = 1024 * 1024;
+
+        // Total bytes of request bodies that may be processed at once. 0 for
+        // no limit. Env override: "UPLOAD_BUDGET"
+        size_t uploadBudget = 512 * 1024 * 1024;
+
+        // How long a request may wait for upload budget to free up before it
+        // is turned away with 503 Service Unavailable.
+        std::chrono::milliseconds uploadWait{5000};
+
+        // Whether the app runs behind a reverse proxy, so that rate limits
+        // identify clients by the X-Forwarded-For header.
+        // Env override: "TRUST_PROXY" set to "true" or "false"
+        bool trustProxy = false;
+
+        // Number of http worker threads, 0 uses the number of hardware
+        // threads. Env override: "HTTP_WORKERS"
+        unsigned httpWorkers = 0;
+
+        // Whether to pin worker pool threads to cpus (Linux only).
+        // Env override: "PIN_THREADS" set to "true" or "false"
+        bool pinThreads = false;
+
+        // Named pools for blocking work, mapped to their thread count, where
+        // 0 uses the number of hardware threads. Each count can be overridden
+        // via env var "POOL_<NAME>_THREADS", e.g. "POOL_BANK_THREADS".
+        // See Workers.h for pool names used by the app.
+        std::map<std::string, unsigned> pools = {
+            {std::string(Workers::Bank), 2},
+            {std::string(Workers::Crypto), 0},
+            {std::string(Workers::S3), 8},
+            {std::string(Workers::Mongo), 8},
+        };
+
+        // Max time in-flight requests get to finish on shutdown before the
+        // server stops. Env override: "DRAIN_TIMEOUT_MS"
+        std::chrono::milliseconds drainTimeout{30000};
     };
 
     /**
@@ -45,11 +98,11 @@ namespace Insound
     {
         inline static std::shared_ptr<App<Middlewares...>> s_instance = nullptr;
     public:
-        using Server = crow::App<Helmet, crow::CookieParser, UserAuth,
-            Middlewares...>;
+        using Server = crow::App<DrainGuard, BodyLimit, Helmet,
+            crow::CookieParser, UserAuth, RateLimiter, Middlewares...>;
 
         App(const AppOpts &opts = {}): m_app(), m_routers(), m_wasInit(),
-            m_opts(opts)
+            m_opts(opts), m_running(), m_wasShutdown()
         { }
 
         /**
@@ -109,6 +162,12 @@ namespace Insound
 
             try
             {
+                // Block shutdown signals before any threads are spawned, so
+                // every thread inherits the mask and only
+                // `waitForShutdown` receives them.
+                auto signals = shutdownSignals();
+                pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
                 // Run child class init function
                 if (!init()) return false;
 
@@ -117,12 +176,39 @@ namespace Insound
 
                 auto PORT = getEnv<int>("PORT", m_opts.defaultPort);
 
-                m_app
+                m_app.template get_middleware<BodyLimit>().configure(
+                    getEnv<size_t>("MAX_BODY_SIZE", m_opts.maxBodySize),
+                    getEnv<size_t>("UPLOAD_BUDGET", m_opts.uploadBudget),
+                    m_opts.uploadWait);
+
+                auto proxyEnv = getEnv("TRUST_PROXY");
+                m_app.template get_middleware<RateLimiter>().configure(
+                    proxyEnv.empty() ? m_opts.trustProxy :
+                    proxyEnv == "true");
+
+                auto pinEnv = getEnv("PIN_THREADS");
+                Workers::configure(m_opts.pools, pinEnv.empty() ?
+                    m_opts.pinThreads : pinEnv == "true");
+
+                auto workers = getEnv<int>("HTTP_WORKERS",
+                    (int)m_opts.httpWorkers);
+                if (workers <= 0)
+                    workers = (int)std::max(
+                        std::thread::hardware_concurrency(), 1u);
+
+                // Signals are handled by `waitForShutdown` instead of crow,
+                // which would stop immediately, cutting off requests
+                m_running = m_app
                     .server_name("insound")
                     .loglevel(m_opts.logLevel)
                     .port(PORT)
-                    .multithreaded()
+                    .concurrency((std::uint16_t)workers)
+                    .signal_clear()
                     .run_async();
+                m_app.wait_for_server_start();
+
+                IN_LOG("App running on port {} with {} http workers", PORT,
+                    workers);
 
                 return m_wasInit = true;
             }
@@ -139,6 +225,61 @@ namespace Insound
             }
         }
 
+        /**
+         * Block the calling thread until SIGINT or SIGTERM is received, then
+         * gracefully shut down the app via `App::shutdown`.
+         */
+        void waitForShutdown()
+        {
+            if (!m_wasInit) return;
+
+            auto signals = shutdownSignals();
+            int signal = 0;
+            sigwait(&signals, &signal);
+
+            IN_LOG("Received signal {}, shutting down", signal);
+            shutdown();
+        }
+
+        /**
+         * Gracefully shut down the app:
+         * 1. Stop accepting requests (new ones receive 503)
+         * 2. Wait for in-flight requests to finish, up to the drain timeout
+         * 3. Finish queued jobs on the worker pools
+         * 4. Stop the http server
+         * 5. Release services via `close`, then disconnect from MongoDB
+         *
+         * Safe to call more than once.
+         */
+        void shutdown()
+        {
+            if (!m_wasInit || m_wasShutdown) return;
+            m_wasShutdown = true;
+
+            Lifecycle::beginDrain();
+
+            auto timeout = std::chrono::milliseconds(getEnv<int>(
+                "DRAIN_TIMEOUT_MS", (int)m_opts.drainTimeout.count()));
+            if (!Lifecycle::waitIdle(timeout))
+            {
+                IN_WARN("Drain timed out with {} requests in flight",
+                    Lifecycle::inFlight());
+            }
+
+            Workers::shutdown(true);
+
+            // Joins the http workers, so no handlers are running afterward
+            m_app.stop();
+            if (m_running.valid())
+                m_running.wait();
+
+            close();
+            HttpClient::instance().shutdown();
+            Mongo::disconnect();
+
+            IN_LOG("App shut down");
+        }
+
         /**
          * Mount a router onto the App
          *
@@ -191,10 +332,30 @@ namespace Insound
          */
         virtual bool init() { return true; };
 
+        /**
+         * Releases services acquired in `init`. Called by `App::shutdown`
+         * once the http server has stopped and the worker pools have been
+         * drained, so no handlers can be using them anymore.
+         */
+        virtual void close() { }
+
+        static sigset_t shutdownSignals()
+        {
+            sigset_t signals;
+            sigemptyset(&signals);
+            sigaddset(&signals, SIGINT);
+            sigaddset(&signals, SIGTERM);
+            return signals;
+        }
+
         bool m_wasInit;
 
         Server m_app;
         std::vector<std::unique_ptr<Router>> m_routers;
         AppOpts m_opts;
+
+        // Result of crow's run_async, valid while the server is running
+        std::future<void> m_running;
+        bool m_wasShutdown;
     };
 }
@@ -0,0 +1,558 @@
+#include "AudioProbe.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace Insound::AudioProbe {
+
+    // Formats outside these limits are assumed corrupt
+    static constexpr uint32_t MaxChannels = 32;
+    static constexpr uint32_t MinSampleRate = 1000;
+    static constexpr uint32_t MaxSampleRate = 384000;
+
+    template <typename T>
+    static T readLE(std::string_view data, size_t offset)
+    {
+        T value;
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    static T readBE(std::string_view data, size_t offset)
+    {
+        T value = 0;
+        for (size_t i = 0; i < sizeof(T); ++i)
+            value = (T)((value << 8) | (uint8_t)data[offset + i]);
+        return value;
+    }
+
+    static bool validFormat(uint32_t channels, uint32_t sampleRate)
+    {
+        return channels > 0 && channels <= MaxChannels &&
+            sampleRate >= MinSampleRate && sampleRate <= MaxSampleRate;
+    }
+
+    /**
+     * Get the size of an ID3v2 tag at the start of a file, or 0 if there is
+     * none
+     */
+    static size_t id3Size(std::string_view file)
+    {
+        if (file.size() < 10 || file.substr(0, 3) != "ID3")
+            return 0;
+
+        // Sizes are syncsafe, 7 bits per byte
+        size_t size = 0;
+        for (size_t i = 6; i < 10; ++i)
+            size = (size << 7) | ((uint8_t)file[i] & 0x7f);
+
+        bool hasFooter = (uint8_t)file[5] & 0x10;
+        return 10 + size + (hasFooter ? 10 : 0);
+    }
+
+    // ===== WAV ==============================================================
+
+    static const char *readWav(std::string_view file, Probe &probe)
+    {
+        bool hasFormat = false;
+        uint16_t encoding = 0, blockAlign = 0;
+        uint32_t factFrames = 0;
+        bool hasFact = false;
+
+        size_t pos = 12;
+        while (pos + 8 <= file.size())
+        {
+            auto id = file.substr(pos, 4);
+            uint64_t size = readLE<uint32_t>(file, pos + 4);
+            pos += 8;
+
+            if (id == "fmt ")
+            {
+                if (size < 16 || pos + 16 > file.size())
+                    return "WAV format chunk is truncated";
+
+                encoding = readLE<uint16_t>(file, pos);
+                probe.channels = readLE<uint16_t>(file, pos + 2);
+                probe.sampleRate = readLE<uint32_t>(file, pos + 4);
+                blockAlign = readLE<uint16_t>(file, pos + 12);
+                hasFormat = true;
+            }
+            else if (id == "fact" && size >= 4 && pos + 4 <= file.size())
+            {
+                factFrames = readLE<uint32_t>(file, pos);
+                hasFact = true;
+            }
+            else if (id == "data")
+            {
+                if (!hasFormat)
+                    return "WAV data comes before its format";
+                if (pos + size > file.size())
+                    return "WAV data is truncated";
+                if (!validFormat(probe.channels, probe.sampleRate))
+                    return "WAV has an invalid channel count or sample rate";
+
+                switch (encoding)
+                {
+                case 0x0001: // PCM
+                case 0x0003: // IEEE float
+                case 0xfffe: // Extensible
+                    if (blockAlign == 0)
+                        return "WAV has an invalid block size";
+                    probe.frames = size / blockAlign;
+                    break;
+                default:
+                    // Compressed encodings store their length separately
+                    if (!hasFact)
+                        return "WAV encoding is not supported";
+                    probe.frames = factFrames;
+                    break;
+                }
+
+                probe.container = Container::Wav;
+                return nullptr;
+            }
+
+            // Chunks are padded to an even size
+            pos += size + (size & 1);
+        }
+
+        return "WAV has no data";
+    }
+
+    // ===== AIFF =============================================================
+
+    /**
+     * Convert an 80-bit extended float, as AIFF stores its sample rate
+     */
+    static double readExtended(std::string_view data, size_t offset)
+    {
+        auto exponent = readBE<uint16_t>(data, offset) & 0x7fff;
+        auto mantissa = readBE<uint64_t>(data, offset + 2);
+        if (exponent == 0 && mantissa == 0)
+            return 0;
+
+        return std::ldexp((double)mantissa, exponent - 16383 - 63);
+    }
+
+    static const char *readAiff(std::string_view file, Probe &probe)
+    {
+        bool hasCommon = false, hasData = false;
+
+        size_t pos = 12;
+        while (pos + 8 <= file.size() && !(hasCommon && hasData))
+        {
+            auto id = file.substr(pos, 4);
+            uint64_t size = readBE<uint32_t>(file, pos + 4);
+            pos += 8;
+
+            if (id == "COMM")
+            {
+                if (size < 18 || pos + 18 > file.size())
+                    return "AIFF common chunk is truncated";
+
+                probe.channels = readBE<uint16_t>(file, pos);
+                probe.frames = readBE<uint32_t>(file, pos + 2);
+                probe.sampleRate = (uint32_t)std::lround(
+                    readExtended(file, pos + 8));
+                hasCommon = true;
+            }
+            else if (id == "SSND")
+            {
+                if (pos + size > file.size())
+                    return "AIFF sound data is truncated";
+                hasData = true;
+            }
+
+            pos += size + (size & 1);
+        }
+
+        if (!hasCommon)
+            return "AIFF has no common chunk";
+        if (!hasData && probe.frames > 0)
+            return "AIFF has no sound data";
+        if (!validFormat(probe.channels, probe.sampleRate))
+            return "AIFF has an invalid channel count or sample rate";
+
+        probe.container = Container::Aiff;
+        return nullptr;
+    }
+
+    // ===== FLAC =============================================================
+
+    static const char *readFlac(std::string_view file, size_t start,
+        Probe &probe)
+    {
+        // STREAMINFO is always the first metadata block
+        auto pos = start + 4;
+        if (pos + 4 + 34 > file.size())
+            return "FLAC stream info is truncated";
+        if (((uint8_t)file[pos] & 0x7f) != 0 ||
+            (readBE<uint32_t>(file, pos) & 0xffffff) < 34)
+            return "FLAC has no stream info";
+        pos += 4;
+
+        // 20 bits sample rate, 3 bits channels - 1, 5 bits bits per sample - 1,
+        // 36 bits total samples
+        auto packed = readBE<uint64_t>(file, pos + 10);
+        probe.sampleRate = (uint32_t)(packed >> 44);
+        probe.channels = (uint32_t)((packed >> 41) & 0x7) + 1;
+        probe.frames = packed & 0xfffffffffull;
+
+        if (!validFormat(probe.channels, probe.sampleRate))
+            return "FLAC has an invalid channel count or sample rate";
+
+        // An unknown length is allowed by the format, but not by us
+        if (probe.frames == 0)
+            return "FLAC stream length is unknown";
+
+        probe.container = Container::Flac;
+        return nullptr;
+    }
+
+    // ===== Ogg ==============================================================
+
+    static constexpr size_t OggHeaderSize = 27;
+
+    static const char *readOgg(std::string_view file, Probe &probe)
+    {
+        if (file.size() < OggHeaderSize)
+            return "Ogg page is truncated";
+
+        // The first page holds only the identification header
+        auto serial = readLE<uint32_t>(file, 14);
+        auto segments = (uint8_t)file[26];
+        auto packet = OggHeaderSize + segments;
+        if (packet + 16 > file.size())
+            return "Ogg page is truncated";
+
+        if (file.substr(packet, 7) == std::string_view("\x01vorbis", 7))
+        {
+            probe.channels = (uint8_t)file[packet + 11];
+            probe.sampleRate = readLE<uint32_t>(file, packet + 12);
+        }
+        else if (file.substr(packet, 8) == "OpusHead")
+        {
+            return "Ogg Opus is not supported";
+        }
+        else
+        {
+            return "Ogg codec is not supported";
+        }
+
+        if (!validFormat(probe.channels, probe.sampleRate))
+            return "Vorbis has an invalid channel count or sample rate";
+
+        // The granule position of the stream's last page is its length
+        auto pos = file.rfind("OggS");
+        for (; pos != std::string_view::npos && pos > 0;
+            pos = file.rfind("OggS", pos - 1))
+        {
+            if (pos + OggHeaderSize > file.size() ||
+                readLE<uint32_t>(file, pos + 14) != serial)
+                continue;
+
+            auto pageSegments = (uint8_t)file[pos + 26];
+            auto body = pos + OggHeaderSize + pageSegments;
+            if (body > file.size())
+                return "Ogg stream is truncated";
+
+            size_t bodySize = 0;
+            for (size_t i = 0; i < pageSegments; ++i)
+                bodySize += (uint8_t)file[pos + OggHeaderSize + i];
+            if (body + bodySize > file.size())
+                return "Ogg stream is truncated";
+
+            auto granule = readLE<int64_t>(file, pos + 6);
+            if (granule <= 0)
+                break;
+
+            probe.frames = (uint64_t)granule;
+            probe.container = Container::Ogg;
+            return nullptr;
+        }
+
+        return "Ogg stream has no audio pages";
+    }
+
+    // ===== MPEG =============================================================
+
+    struct MpegFrame
+    {
+        // 0: MPEG 1, 1: MPEG 2, 2: MPEG 2.5
+        int version;
+        int layer;
+        uint32_t bitrate;
+        uint32_t sampleRate;
+        uint32_t channels;
+        uint32_t samples;
+        uint32_t size;
+    };
+
+    /**
+     * Parse an MPEG audio frame header
+     *
+     * @return whether the header is valid.
+     */
+    static bool readMpegFrame(std::string_view file, size_t pos,
+        MpegFrame &frame)
+    {
+        // Kilobits per second by version, layer and 4-bit index
+        static constexpr uint16_t Bitrates[2][3][15] = {
+            {
+                {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384,
+                    416, 448},
+                {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320,
+                    384},
+                {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256,
+                    320},
+            },
+            {
+                {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224,
+                    256},
+                {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144,
+                    160},
+                {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144,
+                    160},
+            },
+        };
+        static constexpr uint32_t Rates[3][3] = {
+            {44100, 48000, 32000},
+            {22050, 24000, 16000},
+            {11025, 12000, 8000},
+        };
+
+        if (pos + 4 > file.size())
+            return false;
+
+        auto header = readBE<uint32_t>(file, pos);
+        if ((header >> 21) != 0x7ff)
+            return false;
+
+        auto versionBits = (header >> 19) & 0x3;
+        auto layerBits = (header >> 17) & 0x3;
+        auto bitrateIndex = (header >> 12) & 0xf;
+        auto rateIndex = (header >> 10) & 0x3;
+        auto padding = (header >> 9) & 0x1;
+        auto mode = (header >> 6) & 0x3;
+
+        // Reserved values, and free format, which we can't size
+        if (versionBits == 1 || layerBits == 0 || bitrateIndex == 0 ||
+            bitrateIndex == 15 || rateIndex == 3)
+            return false;
+
+        frame.version = versionBits == 3 ? 0 : versionBits == 2 ? 1 : 2;
+        frame.layer = 4 - (int)layerBits;
+        frame.bitrate = Bitrates[frame.version > 0][frame.layer - 1]
+            [bitrateIndex] * 1000;
+        frame.sampleRate = Rates[frame.version][rateIndex];
+        frame.channels = mode == 3 ? 1 : 2;
+
+        if (frame.layer == 1)
+        {
+            frame.samples = 384;
+            frame.size = (12 * frame.bitrate / frame.sampleRate + padding) * 4;
+        }
+        else if (frame.layer == 3 && frame.version > 0)
+        {
+            frame.samples = 576;
+            frame.size = 72 * frame.bitrate / frame.sampleRate + padding;
+        }
+        else
+        {
+            frame.samples = 1152;
+            frame.size = 144 * frame.bitrate / frame.sampleRate + padding;
+        }
+
+        return frame.size > 4;
+    }
+
+    /**
+     * Get the frame count of a Xing/Info or VBRI header in the first frame
+     *
+     * @return the count, or 0 if there is no such header.
+     */
+    static uint64_t readVbrFrames(std::string_view file, size_t pos,
+        const MpegFrame &frame, uint64_t &bytes)
+    {
+        bytes = 0;
+        if (frame.layer != 3) return 0;
+
+        // Xing follows the side info, whose size depends on the format
+        size_t sideInfo = frame.version == 0 ?
+            (frame.channels == 1 ? 17 : 32) :
+            (frame.channels == 1 ? 9 : 17);
+        auto xing = pos + 4 + sideInfo;
+        if (xing + 12 <= file.size())
+        {
+            auto tag = file.substr(xing, 4);
+            auto flags = readBE<uint32_t>(file, xing + 4);
+            if ((tag == "Xing" || tag == "Info") && (flags & 0x1))
+            {
+                // The byte count follows the frame count
+                if ((flags & 0x2) && xing + 16 <= file.size())
+                    bytes = readBE<uint32_t>(file, xing + 12);
+                return readBE<uint32_t>(file, xing + 8);
+            }
+        }
+
+        // VBRI is at a fixed offset
+        auto vbri = pos + 4 + 32;
+        if (vbri + 18 <= file.size() && file.substr(vbri, 4) == "VBRI")
+        {
+            bytes = readBE<uint32_t>(file, vbri + 10);
+            return readBE<uint32_t>(file, vbri + 14);
+        }
+
+        return 0;
+    }
+
+    static const char *readMpeg(std::string_view file, size_t start,
+        Probe &probe)
+    {
+        // Skip any junk before the first frame, but not much, so that
+        // arbitrary data isn't taken for audio
+        static constexpr size_t MaxJunk = 4096;
+
+        auto end = file.size();
+        if (end >= 128 && file.substr(end - 128, 3) == "TAG")
+            end -= 128; // ID3v1
+
+        for (auto pos = start; pos < std::min(start + MaxJunk, end); ++pos)
+        {
+            MpegFrame frame;
+            if (!readMpegFrame(file, pos, frame))
+                continue;
+
+            // A real frame is followed by another like it, or the end
+            auto next = pos + frame.size;
+            MpegFrame nextFrame;
+            if (next < end && (!readMpegFrame(file, next, nextFrame) ||
+                nextFrame.version != frame.version ||
+                nextFrame.layer != frame.layer ||
+                nextFrame.sampleRate != frame.sampleRate))
+                continue;
+            if (next > end)
+                return "MPEG audio is truncated";
+
+            probe.container = Container::Mpeg;
+            probe.channels = frame.channels;
+            probe.sampleRate = frame.sampleRate;
+
+            uint64_t bytes;
+            if (auto frames = readVbrFrames(file, pos, frame, bytes))
+            {
+                if (bytes > file.size())
+                    return "MPEG audio is truncated";
+                probe.frames = frames * frame.samples;
+            }
+            else
+            {
+                // Constant bitrate
+                probe.frames = (uint64_t)((double)(end - pos) * 8 *
+                    frame.sampleRate / frame.bitrate);
+            }
+
+            return nullptr;
+        }
+
+        return "file is not a supported audio format";
+    }
+
+    // ===== Public ===========================================================
+
+    static const char *readProbe(std::string_view file, Probe &probe)
+    {
+        if (file.size() < 12)
+            return "file is too small to be audio";
+
+        if (file.substr(0, 4) == "RIFF" && file.substr(8, 4) == "WAVE")
+            return readWav(file, probe);
+        if (file.substr(0, 4) == "RF64")
+            return "RF64 files are not supported";
+        if (file.substr(0, 4) == "FORM" && (file.substr(8, 4) == "AIFF" ||
+            file.substr(8, 4) == "AIFC"))
+            return readAiff(file, probe);
+        if (file.substr(0, 4) == "OggS")
+            return readOgg(file, probe);
+
+        // FLAC and MPEG may both start with an ID3v2 tag
+        auto start = id3Size(file);
+        if (start >= file.size())
+            return "file has no audio after its ID3 tag";
+
+        if (file.substr(start, 4) == "fLaC")
+            return readFlac(file, start, probe);
+        return readMpeg(file, start, probe);
+    }
+
+    const char *read(std::string_view file, Probe &probe) noexcept
+    {
+        try {
+            Probe result{};
+            if (auto error = readProbe(file, result))
+                return error;
+
+            probe = result;
+            return nullptr;
+        }
+        catch (...)
+        {
+            return "an unknown error occurred";
+        }
+    }
+
+    Probe probe(std::string_view file)
+    {
+        Probe result;
+        if (auto error = read(file, result))
+            throw std::runtime_error(error);
+        return result;
+    }
+
+    double cost(const Probe &probe, const EncodeProfile &profile)
+    {
+        // Rough nanoseconds per sample to decode each container, and to
+        // encode each format, measured relative to each other
+        static constexpr double DecodeCost[] = {
+            1.0,  // Wav
+            1.0,  // Aiff
+            6.0,  // Flac
+            20.0, // Ogg
+            15.0, // Mpeg
+        };
+        static constexpr double ResampleCost = 8.0;
+
+        double encode;
+        switch (profile.format)
+        {
+        case BankFormat::Vorbis:
+            // Higher qualities search harder
+            encode = 40.0 + 0.4 * profile.quality;
+            break;
+        case BankFormat::FAdpcm:
+            encode = 10.0;
+            break;
+        default:
+            encode = 1.0;
+            break;
+        }
+
+        auto decoded = (double)probe.frames * probe.channels;
+
+        // Encoding happens after a mono downmix, at the profile's rate
+        auto encoded = profile.mono ? (double)probe.frames : decoded;
+        auto resampled = encoded;
+        if (profile.sampleRate && profile.sampleRate != probe.sampleRate)
+            resampled = encoded * profile.sampleRate / probe.sampleRate;
+
+        auto total = decoded * DecodeCost[(int)probe.container] +
+            resampled * encode;
+        if (resampled != encoded)
+            total += encoded * ResampleCost;
+
+        return total * 1e-9;
+    }
+}
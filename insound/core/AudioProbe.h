@@ -0,0 +1,84 @@
+/**
+ * @file AudioProbe.h
+ *
+ * Contains functions to read the format of uploaded audio files from their
+ * headers, without decoding them. Probing is cheap enough to run on a request
+ * thread, so corrupt or unsupported files are rejected before they reach a
+ * bank build, and the cost of a build is known before it is scheduled.
+ *
+ * Supported containers: WAV, AIFF/AIFC, FLAC, Ogg Vorbis and MPEG audio
+ * (MP3, MP2).
+ */
+#pragma once
+#include <insound/core/EncodeProfile.h>
+
+#include <cstdint>
+#include <string_view>
+
+namespace Insound::AudioProbe {
+
+    enum class Container
+    {
+        Wav,
+        Aiff,
+        Flac,
+        Ogg,
+        Mpeg,
+    };
+
+    struct Probe
+    {
+        Container container;
+        uint32_t channels;
+        uint32_t sampleRate;
+
+        // Samples per channel. Estimated from the bitrate for MPEG files
+        // without a Xing or VBRI header.
+        uint64_t frames;
+
+        /**
+         * Get the duration in seconds
+         */
+        [[nodiscard]]
+        double duration() const
+        {
+            return sampleRate ? (double)frames / sampleRate : 0;
+        }
+    };
+
+    /**
+     * Read an audio file's format from its headers
+     *
+     * @param file  - audio file data
+     * @param probe - receives the format
+     *
+     * @return nullptr on success, or a description of why the file can't be
+     *         built into a bank.
+     */
+    [[nodiscard]]
+    const char *read(std::string_view file, Probe &probe) noexcept;
+
+    /**
+     * Read an audio file's format from its headers
+     *
+     * @param file - audio file data
+     *
+     * @return the format.
+     *
+     * @throws std::runtime_error if the file can't be built into a bank.
+     */
+    [[nodiscard]]
+    Probe probe(std::string_view file);
+
+    /**
+     * Estimate the CPU time it takes to decode a file and encode it with a
+     * profile. Meant for comparing and budgeting builds, not for display.
+     *
+     * @param probe   - format of the file
+     * @param profile - profile the file is encoded with
+     *
+     * @return the estimate in seconds.
+     */
+    [[nodiscard]]
+    double cost(const Probe &probe, const EncodeProfile &profile);
+}
@@ -1,27 +1,54 @@
 #include "BankBuilder.h"
 #include "fsbank.h"
 
+#include <insound/core/AudioProbe.h>
+#include <insound/core/base64.h>
 #include <insound/core/definitions.h>
+#include <insound/core/Fsb5.h>
+#include <insound/core/Mixdown.h>
 #include <insound/core/platform.h>
 #include <insound/core/thirdparty/fsbank.hpp>
 #include <insound/core/util.h>
 
+#include <openssl/sha.h>
+
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <mutex>
 #include <thread>
 
 static const char *CacheDirectory = ".fscache";
 
 namespace Insound
 {
-    // Build Vorbis when available. (Not available on ARM64 Macs)
-    #if defined(INSOUND_PLATFORM_MAC) && defined (INSOUND_CPU_ARM64)
-        static const FSBANK_FORMAT BankFormat = FSBANK_FORMAT_FADPCM;
-    #else
-        static const FSBANK_FORMAT BankFormat = FSBANK_FORMAT_VORBIS;
-    #endif
+    /**
+     * Get the FSBank format of a bank format
+     */
+    static FSBANK_FORMAT toFsbFormat(BankFormat format)
+    {
+        switch (format)
+        {
+        case BankFormat::Vorbis:
+        // Vorbis is not available on ARM64 Macs, FADPCM is the closest
+        #if defined(INSOUND_PLATFORM_MAC) && defined (INSOUND_CPU_ARM64)
+            return FSBANK_FORMAT_FADPCM;
+        #else
+            return FSBANK_FORMAT_VORBIS;
+        #endif
+        case BankFormat::FAdpcm:
+            return FSBANK_FORMAT_FADPCM;
+        case BankFormat::Pcm:
+            return FSBANK_FORMAT_PCM;
+        }
+
+        return FSBANK_FORMAT_VORBIS;
+    }
 
     static bool wasInit;
 
@@ -29,6 +56,137 @@ namespace Insound
 
     static std::mutex build_lock;
 
+    // How often progress items are fetched while a build runs
+    static constexpr auto ProgressInterval = std::chrono::milliseconds(50);
+
+    /**
+     * Consume queued progress items, keeping the furthest state reached by
+     * each subsound.
+     *
+     * @param states - state per subsound, -1 where none was reported yet
+     *
+     * @return whether any subsound advanced.
+     */
+    static bool fetchProgress(std::vector<int> &states)
+    {
+        bool advanced = false;
+        const FSBANK_PROGRESSITEM *item = nullptr;
+        while (FSBank_FetchNextProgressItem(&item) == FSBANK_OK && item)
+        {
+            auto index = item->subSoundIndex;
+            if (item->state == FSBANK_STATE_FAILED)
+            {
+                auto data = (const FSBANK_STATEDATA_FAILED *)item->stateData;
+                IN_ERR("FSBank subsound {} failed: {}", index,
+                    data ? data->errorString : "unknown error");
+            }
+            else if (item->state <= FSBANK_STATE_FINISHED &&
+                index >= 0 && index < (int)states.size() &&
+                item->state > states[index])
+            {
+                states[index] = item->state;
+                advanced = true;
+            }
+
+            FSBank_ReleaseProgressItem(item);
+        }
+
+        return advanced;
+    }
+
+    /**
+     * Fraction of all subsound states that were passed through
+     */
+    static float fraction(const std::vector<int> &states)
+    {
+        if (states.empty()) return 0;
+
+        float total = 0;
+        for (auto state : states)
+            total += state + 1;
+
+        return total / (states.size() * (FSBANK_STATE_FINISHED + 1));
+    }
+
+    /**
+     * Polls progress items and checks for cancellation on its own thread
+     * while `FSBank_Build` blocks the building thread. Stops when destroyed.
+     */
+    class BuildWatcher
+    {
+    public:
+        BuildWatcher(size_t subsounds, const BankBuilder::Progress &onProgress,
+            const std::atomic<bool> *cancel) :
+            m_states(subsounds, -1), m_onProgress(onProgress),
+            m_cancel(cancel), m_mutex(), m_cond(), m_done(), m_thread()
+        {
+            if (m_onProgress || m_cancel)
+                m_thread = std::thread(&BuildWatcher::run, this);
+        }
+
+        ~BuildWatcher()
+        {
+            {
+                std::lock_guard lock(m_mutex);
+                m_done = true;
+            }
+
+            m_cond.notify_one();
+            if (m_thread.joinable())
+                m_thread.join();
+
+            // Release leftover items, so they don't carry into the next build
+            if (fetchProgress(m_states))
+                report();
+        }
+
+    private:
+        void run()
+        {
+            bool cancelled = false;
+
+            std::unique_lock lock(m_mutex);
+            while (!m_cond.wait_for(lock, ProgressInterval,
+                [this]() { return m_done; }))
+            {
+                if (!cancelled && m_cancel && m_cancel->load())
+                {
+                    FSBank_BuildCancel();
+                    cancelled = true;
+                }
+
+                if (fetchProgress(m_states))
+                    report();
+            }
+        }
+
+        void report()
+        {
+            if (!m_onProgress) return;
+
+            try {
+                m_onProgress(fraction(m_states));
+            }
+            catch (const std::exception &e)
+            {
+                IN_ERR("Bank progress callback threw: {}", e.what());
+            }
+            catch (...)
+            {
+                IN_ERR("Bank progress callback threw an unknown error");
+            }
+        }
+
+        std::vector<int> m_states;
+        const BankBuilder::Progress &m_onProgress;
+        const std::atomic<bool> *m_cancel;
+
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        bool m_done;
+        std::thread m_thread;
+    };
+
 
     BankBuilder::BankBuilder()
     {
@@ -47,7 +205,8 @@ namespace Insound
             FSB_CHECK(
                 FSBank_Init(
                     FSBANK_FSBVERSION_FSB5,
-                    FSBANK_INIT_DONTLOADCACHEFILES,
+                    FSBANK_INIT_DONTLOADCACHEFILES |
+                        FSBANK_INIT_GENERATEPROGRESSITEMS,
                     NumCores,
                     CacheDirectory)
             );
@@ -78,8 +237,16 @@ namespace Insound
             if (byteLength == 0)
                 return "byteLength must not be 0";
 
+            // Reject files FSBank would fail on, before a build takes the lock
+            AudioProbe::Probe probe;
+            if (auto result = AudioProbe::read(
+                std::string_view((const char *)file, byteLength), probe);
+                result != OK)
+                return result;
+
             files.emplace_back(file);
             fileSizes.emplace_back(byteLength);
+            probes.emplace_back(probe);
 
             return OK;
         } catch (const std::exception &e) {
@@ -89,62 +256,361 @@ namespace Insound
         }
     }
 
-    BankBuilder::Result BankBuilder::build(float samplerate) noexcept
+    /**
+     * Run FSBank on the subsounds. Must be called with build_lock locked.
+     *
+     * @param subsounds  - subsounds to build
+     * @param format     - encoding format
+     * @param quality    - encoding quality, from 1 to 100
+     * @param onProgress - optional callback receiving build progress
+     * @param cancel     - optional flag, which aborts the build when set
+     * @param out        - receives the built bank
+     */
+    static BankBuilder::Result runBuild(
+        const std::vector<FSBANK_SUBSOUND> &subsounds, FSBANK_FORMAT format,
+        unsigned quality, const BankBuilder::Progress &onProgress,
+        const std::atomic<bool> *cancel, std::string &out)
     {
-        build_lock.lock();
-        try {
-            if (files.size() != fileSizes.size())
-                return "files and fileSizes mismatch length";
+        // Cancelled while waiting for another build to finish
+        if (cancel && cancel->load())
+            return FSBank_ErrorString(FSBANK_ERR_CANCELLED);
 
-            std::vector<FSBANK_SUBSOUND> subsounds;
+        // Run build
+        {
+            BuildWatcher watcher(subsounds.size(), onProgress, cancel);
+            FSB_CHECK( FSBank_Build(subsounds.data(), subsounds.size(),
+                format, FSBANK_BUILD_DEFAULT, quality, nullptr, nullptr) );
+        }
 
-            // Add files in reverse order, since indexes are reversed when
-            // indexing the bank object in FMOD.
-            for (int i = (int)files.size()-1; i >= 0; --i)
-            {
-                auto &subsound = subsounds.emplace_back();
-                std::memset(&subsound, 0, sizeof(FSBANK_SUBSOUND));
+        // Delete cache files
+        auto fileIt = std::filesystem::recursive_directory_iterator(CacheDirectory);
+        for (auto file : fileIt)
+        {
+            if (file.is_regular_file())
+                std::remove(file.path().c_str());
+        }
+
+        const void *data;
+        unsigned int size;
+        FSB_CHECK( FSBank_FetchFSBMemory(&data, &size) );
 
-                subsound.desiredSampleRate = samplerate;
-                subsound.numFiles = 1;
-                subsound.fileData = &files[i];
-                subsound.fileDataLengths = &fileSizes[i];
+        // FSBank reuses its memory on the next build, so this is the one copy
+        // a bank needs. Callers then move it, see `BankBuilder::release`.
+        out.assign((const char *)data, size);
+        return BankBuilder::OK;
+    }
+
+    /**
+     * Read the samples of a PCM bank holding a single subsound
+     *
+     * @param bank - FSB5 bank data
+     * @param pcm  - receives the samples
+     */
+    static BankBuilder::Result readPcm(const std::string &bank, Pcm &pcm)
+    {
+        Fsb5::Index index;
+        if (auto result = Fsb5::read(bank, index); result != BankBuilder::OK)
+            return result;
+        if (index.subsounds.empty())
+            return "decoded bank is empty";
+
+        auto &subsound = index.subsounds[0];
+        auto channelCount = subsound.channels;
+        pcm.channels = channelCount;
+        pcm.sampleRate = subsound.sampleRate;
+
+        auto data = std::string_view(bank).substr(subsound.offset,
+            subsound.size);
+
+        // FSBank writes 16-bit PCM, others are converted for completeness
+        switch (index.mode)
+        {
+        case Fsb5::Mode::Pcm8:
+            pcm.samples.resize(data.size());
+            for (size_t i = 0; i < data.size(); ++i)
+                pcm.samples[i] = (int16_t)((int8_t)data[i] * 256);
+            break;
+        case Fsb5::Mode::Pcm16:
+            pcm.samples.resize(data.size() / 2);
+            std::memcpy(pcm.samples.data(), data.data(),
+                pcm.samples.size() * 2);
+            break;
+        case Fsb5::Mode::Pcm24: // keeps the upper two bytes
+            pcm.samples.resize(data.size() / 3);
+            for (size_t i = 0; i < pcm.samples.size(); ++i)
+                std::memcpy(&pcm.samples[i], data.data() + i * 3 + 1, 2);
+            break;
+        case Fsb5::Mode::Pcm32:
+            pcm.samples.resize(data.size() / 4);
+            for (size_t i = 0; i < pcm.samples.size(); ++i)
+            {
+                int32_t sample;
+                std::memcpy(&sample, data.data() + i * 4, 4);
+                pcm.samples[i] = (int16_t)(sample >> 16);
+            }
+            break;
+        case Fsb5::Mode::PcmFloat:
+            pcm.samples.resize(data.size() / 4);
+            for (size_t i = 0; i < pcm.samples.size(); ++i)
+            {
+                float sample;
+                std::memcpy(&sample, data.data() + i * 4, 4);
+                pcm.samples[i] = (int16_t)std::clamp(sample * 32767.f,
+                    -32768.f, 32767.f);
             }
+            break;
+        default:
+            return "decoded bank is not PCM";
+        }
 
-            // Run build
-            FSB_CHECK( FSBank_Build(subsounds.data(), subsounds.size(), BankFormat,
-                FSBANK_BUILD_DEFAULT, 75, nullptr, nullptr) );
+        // Drop the alignment padding after the last frame
+        pcm.samples.resize(std::min<size_t>(pcm.samples.size() /
+            channelCount, subsound.samples) * channelCount);
+        return BankBuilder::OK;
+    }
+
+    /**
+     * Build a bank from in-memory files with an encode profile. Must be called
+     * with build_lock held. Does not downmix.
+     */
+    static BankBuilder::Result buildFiles(const std::vector<const void *> &files,
+        const std::vector<unsigned> &sizes, const EncodeProfile &profile,
+        const BankBuilder::Progress &onProgress,
+        const std::atomic<bool> *cancel, std::string &out)
+    {
+        if (files.size() != sizes.size())
+            return "files and fileSizes mismatch length";
 
-            // Delete cache files
-            auto fileIt = std::filesystem::recursive_directory_iterator(CacheDirectory);
-            for (auto file : fileIt)
+        std::vector<FSBANK_SUBSOUND> subsounds;
+
+        // Add files in reverse order, since indexes are reversed when
+        // indexing the bank object in FMOD.
+        for (int i = (int)files.size()-1; i >= 0; --i)
+        {
+            auto &subsound = subsounds.emplace_back();
+            std::memset(&subsound, 0, sizeof(FSBANK_SUBSOUND));
+
+            subsound.desiredSampleRate = (float)profile.sampleRate;
+            subsound.numFiles = 1;
+            subsound.fileData = &files[i];
+            subsound.fileDataLengths = &sizes[i];
+        }
+
+        return runBuild(subsounds, toFsbFormat(profile.format),
+            std::clamp(profile.quality, 1u, 100u), onProgress, cancel, out);
+    }
+
+    BankBuilder::Result BankBuilder::build(float samplerate,
+        const Progress &onProgress, const std::atomic<bool> *cancel) noexcept
+    {
+        auto profile = EncodeProfiles::standard();
+        profile.sampleRate = (unsigned)samplerate;
+
+        return build(profile, onProgress, cancel);
+    }
+
+    BankBuilder::Result BankBuilder::build(const EncodeProfile &profile,
+        const Progress &onProgress, const std::atomic<bool> *cancel) noexcept
+    {
+        try {
+            // FSBank can't downmix, so mono needs the decoded files
+            if (profile.mono)
             {
-                if (file.is_regular_file())
-                    std::remove(file.path().c_str());
+                std::vector<std::string> banks;
+                auto result = buildVariants({profile}, banks, onProgress,
+                    cancel);
+                if (result == OK)
+                    builtFile = std::move(banks[0]);
+                return result;
             }
 
-            const void *data;
-            unsigned int size;
-            FSB_CHECK( FSBank_FetchFSBMemory(&data, &size) );
+            std::lock_guard lock(build_lock);
 
-            auto retrieved = std::string((const char *)data,
-                (const char *)data + size);
+            std::vector<const void *> data(files.begin(), files.end());
+            return buildFiles(data, fileSizes, profile, onProgress, cancel,
+                builtFile);
+        }
+        catch (const std::exception &e)
+        {
+            return e.what();
+        }
+        catch (...) {
+            return "an unknown error occurred";
+        }
+    }
 
-            // Done, commit changes
-            builtFile.swap(retrieved);
+    BankBuilder::Result BankBuilder::buildVariants(
+        const std::vector<EncodeProfile> &profiles,
+        std::vector<std::string> &banks, const Progress &onProgress,
+        const std::atomic<bool> *cancel) noexcept
+    {
+        try {
+            if (files.size() != fileSizes.size())
+                return "files and fileSizes mismatch length";
 
+            // Decoding takes one share of the progress, each variant another
+            const float shares = (float)profiles.size() + 1.f;
+            auto report = [&onProgress, shares](size_t step, float fraction) {
+                if (onProgress)
+                    onProgress(((float)step + fraction) / shares);
+            };
+
+            // Decode each file once into a wave file, which FSBank reads
+            // without decoding again
+            std::vector<std::string> waves, monoWaves;
+            bool needsMono = std::any_of(profiles.begin(), profiles.end(),
+                [](const EncodeProfile &profile) { return profile.mono; });
+            bool needsOriginal = std::any_of(profiles.begin(), profiles.end(),
+                [](const EncodeProfile &profile) { return !profile.mono; });
+            if (needsMono)
+                monoWaves.resize(files.size());
+            if (needsOriginal)
+                waves.resize(files.size());
+
+            for (size_t i = 0; i < files.size(); ++i)
+            {
+                if (cancel && cancel->load())
+                    return FSBank_ErrorString(FSBANK_ERR_CANCELLED);
+
+                Pcm pcm;
+                auto result = decode(files[i], fileSizes[i], pcm);
+                if (result != OK)
+                    return result;
+
+                if (needsMono)
+                {
+                    monoWaves[i] = pcm.channels == 1 ? Mixdown::toWav(pcm) :
+                        Mixdown::toWav(Mixdown::mix({pcm}, {1.0}, {
+                            .sampleRate = pcm.sampleRate, .channels = 1}));
+                }
+                if (needsOriginal)
+                    waves[i] = Mixdown::toWav(pcm);
+
+                report(0, (float)(i + 1) / (float)files.size());
+            }
 
+            auto pointers = [](const std::vector<std::string> &source) {
+                std::vector<const void *> result;
+                for (auto &file : source)
+                    result.emplace_back(file.data());
+                return result;
+            };
+            auto sizes = [](const std::vector<std::string> &source) {
+                std::vector<unsigned> result;
+                for (auto &file : source)
+                    result.emplace_back((unsigned)file.size());
+                return result;
+            };
+
+            std::vector<std::string> results(profiles.size());
+            for (size_t i = 0; i < profiles.size(); ++i)
+            {
+                auto &source = profiles[i].mono ? monoWaves : waves;
+
+                // Lock per variant, so other builds may run in between
+                std::lock_guard lock(build_lock);
+                auto result = buildFiles(pointers(source), sizes(source),
+                    profiles[i], [&report, i](float fraction) {
+                        report(i + 1, fraction);
+                    }, cancel, results[i]);
+                if (result != OK)
+                    return result;
+            }
 
-            build_lock.unlock();
+            banks = std::move(results);
             return OK;
         }
         catch (const std::exception &e)
         {
-            build_lock.unlock();
             return e.what();
         }
         catch (...) {
-            build_lock.unlock();
+            return "an unknown error occurred";
+        }
+    }
+
+    std::string BankBuilder::hashFile(std::string_view file)
+    {
+        std::string digest(SHA256_DIGEST_LENGTH, '\0');
+        SHA256((const unsigned char *)file.data(), file.size(),
+            (unsigned char *)digest.data());
+        return digest;
+    }
+
+    std::string BankBuilder::buildKey(
+        const std::vector<std::string> &fileHashes,
+        const EncodeProfile &profile)
+    {
+        // Bump the version when FSBank or how it is called changes output
+        auto source = sf("bank-v1|{}|{}|{}|{}|{}|", fileHashes.size(),
+            (int)toFsbFormat(profile.format),
+            std::clamp(profile.quality, 1u, 100u), profile.sampleRate,
+            profile.mono);
+        for (auto &hash : fileHashes)
+            source += hash;
+
+        unsigned char digest[SHA256_DIGEST_LENGTH];
+        SHA256((const unsigned char *)source.data(), source.size(), digest);
+
+        return Base64Url::encode(std::string_view((const char *)digest,
+            sizeof(digest)));
+    }
+
+    std::string BankBuilder::buildKey(const EncodeProfile &profile) const
+    {
+        std::vector<std::string> hashes;
+        hashes.reserve(files.size());
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            hashes.emplace_back(hashFile(
+                std::string_view((const char *)files[i], fileSizes[i])));
+        }
+
+        return buildKey(hashes, profile);
+    }
+
+    double BankBuilder::cost(const EncodeProfile &profile) const noexcept
+    {
+        double result = 0;
+        for (auto &probe : probes)
+            result += AudioProbe::cost(probe, profile);
+        return result;
+    }
+
+    BankBuilder::Result BankBuilder::decode(const void *data, unsigned size,
+        Pcm &pcm) noexcept
+    {
+        try {
+            if (data == nullptr)
+                return "file pointer must not be null";
+            if (size == 0)
+                return "byteLength must not be 0";
+
+            std::vector<FSBANK_SUBSOUND> subsounds(1);
+            auto &subsound = subsounds[0];
+            std::memset(&subsound, 0, sizeof(FSBANK_SUBSOUND));
+
+            // A sample rate of 0 keeps the file's own
+            subsound.numFiles = 1;
+            subsound.fileData = &data;
+            subsound.fileDataLengths = &size;
+
+            std::string bank;
+            {
+                std::lock_guard lock(build_lock);
+                auto result = runBuild(subsounds, FSBANK_FORMAT_PCM, 100, {},
+                    nullptr, bank);
+                if (result != OK)
+                    return result;
+            }
+
+            return readPcm(bank, pcm);
+        }
+        catch (const std::exception &e)
+        {
+            return e.what();
+        }
+        catch (...) {
             return "an unknown error occurred";
         }
     }
@@ -155,6 +621,7 @@ namespace Insound
             builtFile.clear();
             files.clear();
             fileSizes.clear();
+            probes.clear();
             return OK;
         }
         catch (const std::exception &e)
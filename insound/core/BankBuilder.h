@@ -5,11 +5,19 @@
  *
  * Please make sure to call static `BankBuilder::initLibrary()` before using
  * this class. BankBuilder::closeLibrary() cleans up resources. Once `build` is
- * called successfully `data()` contains the bank's populated data.
+ * called successfully `data()` contains the bank's populated data, which
+ * `release()` hands off without copying.
  */
 #pragma once
+#include <insound/core/AudioProbe.h>
+#include <insound/core/EncodeProfile.h>
+#include <insound/core/Pcm.h>
 
+#include <atomic>
+#include <functional>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace Insound
@@ -20,6 +28,12 @@ namespace Insound
         using Result = const char *;
         static const Result OK;
 
+        /**
+         * Receives the fraction of a build completed so far, from 0 to 1.
+         * Called from a separate thread than the one running `build`.
+         */
+        using Progress = std::function<void(float)>;
+
         BankBuilder();
         ~BankBuilder();
 
@@ -30,6 +44,9 @@ namespace Insound
          * Add a file pointer to the bank. Do not delete the file until you are
          * done with Bank functionality, as it is not copied.
          *
+         * The file's headers are probed, so corrupt and unsupported files are
+         * rejected here instead of failing the build.
+         *
          * @param file      the file pointer to save with the bank.
          */
         Result addFile(void *data, unsigned size) noexcept;
@@ -45,9 +62,97 @@ namespace Insound
          * will overwrite it.
          *
          * @param samplerate    the desired samplerate, default: 44100
+         * @param onProgress    optional callback receiving build progress
+         * @param cancel        optional flag, which aborts the build when set
          *
          */
-        Result build(float samplerate = 44100.f) noexcept;
+        Result build(float samplerate = 44100.f,
+            const Progress &onProgress = {},
+            const std::atomic<bool> *cancel = nullptr) noexcept;
+
+        /**
+         * Compile the bank with an encode profile. Same as `build`, otherwise.
+         *
+         * @param profile       format, quality, rate and channels to encode
+         * @param onProgress    optional callback receiving build progress
+         * @param cancel        optional flag, which aborts the build when set
+         */
+        Result build(const EncodeProfile &profile,
+            const Progress &onProgress = {},
+            const std::atomic<bool> *cancel = nullptr) noexcept;
+
+        /**
+         * Compile one bank per encode profile. Each file is decoded once and
+         * shared by every variant, instead of once per build.
+         *
+         * A successful call to Bank::initLibrary must be made before running
+         * this function. `data()` is left empty.
+         *
+         * @param profiles      profiles to build
+         * @param banks         receives the bank of each profile, in order
+         * @param onProgress    optional callback receiving progress of all
+         *                      variants together
+         * @param cancel        optional flag, which aborts the build when set
+         */
+        Result buildVariants(const std::vector<EncodeProfile> &profiles,
+            std::vector<std::string> &banks,
+            const Progress &onProgress = {},
+            const std::atomic<bool> *cancel = nullptr) noexcept;
+
+        /**
+         * Decode an audio file to PCM, using FSBank's decoders, so any file
+         * that can be built into a bank can be decoded.
+         *
+         * A successful call to Bank::initLibrary must be made before running
+         * this function.
+         *
+         * @param data    the file data
+         * @param size    byte size of the file data
+         * @param pcm     receives the decoded audio at the file's sample rate
+         */
+        static Result decode(const void *data, unsigned size, Pcm &pcm) noexcept;
+
+        /**
+         * Estimate the CPU time to build the added files with a profile
+         *
+         * @param profile   profile the bank would be built with
+         *
+         * @return the estimate in seconds, see `AudioProbe::cost`.
+         */
+        [[nodiscard]]
+        double cost(const EncodeProfile &profile) const noexcept;
+
+        /**
+         * Get the SHA-256 of a file, as hashed into build keys
+         *
+         * @param file      the file data
+         *
+         * @return the raw 32-byte digest.
+         */
+        [[nodiscard]]
+        static std::string hashFile(std::string_view file);
+
+        /**
+         * Get the key of the bank that files build into with a profile.
+         * Identical builds have identical keys, so a key names a build's
+         * result in caches and storage.
+         *
+         * @param fileHashes    `hashFile` of each file, in the order added
+         * @param profile       profile of the build
+         *
+         * @return a base64url SHA-256 digest.
+         */
+        [[nodiscard]]
+        static std::string buildKey(const std::vector<std::string> &fileHashes,
+            const EncodeProfile &profile);
+
+        /**
+         * Get the key of the bank the added files build into with a profile
+         *
+         * @param profile       profile of the build
+         */
+        [[nodiscard]]
+        std::string buildKey(const EncodeProfile &profile) const;
 
         /**
          * Clear internals for object reuse.
@@ -68,6 +173,13 @@ namespace Insound
         [[nodiscard]]
         const std::string &data() const noexcept { return builtFile; }
 
+        /**
+         * Take ownership of the built file without copying it, e.g. to move
+         * it into a response body. `data()` is left empty.
+         */
+        [[nodiscard]]
+        std::string release() noexcept { return std::exchange(builtFile, {}); }
+
     private:
         // Byte length of each file
         std::vector<unsigned> fileSizes;
@@ -75,6 +187,9 @@ namespace Insound
         // File pointers
         std::vector<void *> files;
 
+        // Header info of each file
+        std::vector<AudioProbe::Probe> probes;
+
         // Data of the built file, only available after a successful call to
         // BankBuilder::build.
         std::string builtFile;
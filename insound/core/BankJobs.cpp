@@ -0,0 +1,631 @@
+#include "BankJobs.h"
+
+#include <insound/core/AudioProbe.h>
+#include <insound/core/BankBuilder.h>
+#include <insound/core/base64.h>
+#include <insound/core/s3.h>
+#include <insound/core/util.h>
+#include <insound/core/Workers.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace Insound::BankJobs {
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Job
+    {
+        std::string id;
+
+        // Audio to build from, released once the build is done
+        std::vector<std::string> files;
+
+        // Variants to build
+        std::vector<EncodeProfile> profiles;
+
+        // `BankBuilder::buildKey` of each profile
+        std::vector<std::string> buildKeys;
+
+        // Build keys joined, identifying the job in sFlights
+        std::string flightKey;
+
+        // Indexes of the profiles not found in storage, which are built
+        std::vector<size_t> missing;
+
+        // Submissions sharing this job. It is only cancelled once each of
+        // them has cancelled.
+        size_t submitters;
+
+        // Read by the build while it runs
+        std::atomic<bool> cancelled;
+
+        // The rest is guarded by sMutex
+        JobState state;
+        float progress;
+        double cost;
+        std::string error;
+        std::string key;
+        std::map<std::string, std::string> variants;
+
+        std::map<size_t, Listener> listeners;
+
+        // Last status check, or when the last follower left
+        Clock::time_point lastSeen;
+        Clock::time_point finishedAt;
+    };
+
+    struct StringHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view str) const
+        {
+            return std::hash<std::string_view>{}(str);
+        }
+    };
+
+    static std::mutex sMutex;
+    static std::unordered_map<std::string, std::shared_ptr<Job>, StringHash,
+        std::equal_to<>> sJobs;
+
+    // Jobs by the build keys of all their profiles, to share identical jobs
+    static std::unordered_map<std::string, std::shared_ptr<Job>, StringHash,
+        std::equal_to<>> sFlights;
+    static size_t sLastSubscription;
+    static BankJobOpts sOpts;
+
+    // Folder of stored banks
+    static constexpr std::string_view BankPrefix = "banks/";
+
+    // Sweeper thread state
+    static std::mutex sRunMutex;
+    static std::condition_variable sWake;
+    static std::thread sThread;
+    static bool sRunning;
+
+    static bool isFinished(JobState state)
+    {
+        return state == JobState::Done || state == JobState::Failed ||
+            state == JobState::Cancelled;
+    }
+
+    /**
+     * Must be called with sMutex locked
+     */
+    static JobStatus statusOf(const Job &job)
+    {
+        return {
+            .id = job.id,
+            .state = job.state,
+            .progress = job.progress,
+            .cost = job.cost,
+            .error = job.error,
+            .key = job.key,
+            .variants = job.variants,
+        };
+    }
+
+    /**
+     * Must be called with sMutex locked
+     */
+    static void notify(const Job &job)
+    {
+        if (job.listeners.empty()) return;
+
+        auto status = statusOf(job);
+        for (auto &[subscription, listener] : job.listeners)
+        {
+            try {
+                listener(status);
+            }
+            catch (const std::exception &e)
+            {
+                IN_ERR("Bank job listener threw: {}", e.what());
+            }
+        }
+    }
+
+    /**
+     * Move a job to another state and let followers know. Finished jobs stay
+     * as they are.
+     *
+     * @return whether the job was updated.
+     */
+    static bool update(Job &job, JobState state, std::string_view error = {},
+        std::map<std::string, std::string> variants = {})
+    {
+        std::lock_guard lock(sMutex);
+        if (isFinished(job.state)) return false;
+
+        job.state = state;
+        job.error = error;
+        job.key = variants.empty() ? std::string{} :
+            variants.at(job.profiles.front().name);
+        job.variants = std::move(variants);
+        if (state == JobState::Done)
+            job.progress = 1.f;
+        if (isFinished(state))
+            job.finishedAt = Clock::now();
+
+        notify(job);
+        return true;
+    }
+
+    /**
+     * Must be called with sMutex locked
+     *
+     * @return whether the job had not finished or been cancelled yet.
+     */
+    static bool cancelJob(Job &job)
+    {
+        if (isFinished(job.state) || job.cancelled.exchange(true))
+            return false;
+
+        // A running build finishes as cancelled once it aborts. Others are
+        // done right away.
+        if (job.state != JobState::Building)
+        {
+            job.state = JobState::Cancelled;
+            job.finishedAt = Clock::now();
+            notify(job);
+        }
+
+        return true;
+    }
+
+    /**
+     * Get the S3 key of each of a job's variants
+     */
+    static std::map<std::string, std::string> variantsOf(const Job &job)
+    {
+        std::map<std::string, std::string> variants;
+        for (size_t i = 0; i < job.profiles.size(); ++i)
+            variants.emplace(job.profiles[i].name, bankKey(job.buildKeys[i]));
+        return variants;
+    }
+
+    /**
+     * Store built banks. Stored banks are kept even if the job was cancelled
+     * meanwhile, since an identical build may reuse them.
+     *
+     * @param banks - bank of each of the job's missing profiles
+     */
+    static void store(const std::shared_ptr<Job> &job,
+        std::vector<std::string> &&banks)
+    {
+        for (size_t i = 0; i < banks.size(); ++i)
+        {
+            auto index = job->missing[i];
+            if (!S3::uploadFile(bankKey(job->buildKeys[index]), banks[i]))
+            {
+                update(*job, JobState::Failed, sf("Failed to store {} bank",
+                    job->profiles[index].name));
+                return;
+            }
+
+            // Release each bank once stored
+            std::string().swap(banks[i]);
+        }
+
+        update(*job, JobState::Done, {}, variantsOf(*job));
+    }
+
+    static void build(const std::shared_ptr<Job> &job)
+    {
+        // Cancelled while queued
+        if (!update(*job, JobState::Building))
+        {
+            job->files.clear();
+            return;
+        }
+
+        std::vector<EncodeProfile> profiles;
+        for (auto index : job->missing)
+            profiles.emplace_back(job->profiles[index]);
+
+        BankBuilder builder;
+        for (auto &file : job->files)
+        {
+            auto result = builder.addFile(file.data(), file.size());
+            if (result != BankBuilder::OK)
+            {
+                update(*job, JobState::Failed,
+                    sf("Failed to add file to bank: {}", result));
+                return;
+            }
+        }
+
+        auto onProgress = [&job](float progress) {
+            std::lock_guard lock(sMutex);
+            if (isFinished(job->state)) return;
+
+            job->progress = progress;
+            notify(*job);
+        };
+
+        std::vector<std::string> banks;
+        BankBuilder::Result result;
+        if (profiles.size() == 1)
+        {
+            result = builder.build(profiles[0], onProgress, &job->cancelled);
+            banks.emplace_back(builder.release());
+        }
+        else
+        {
+            result = builder.buildVariants(profiles, banks, onProgress,
+                &job->cancelled);
+        }
+
+        job->files.clear();
+        job->files.shrink_to_fit();
+
+        if (job->cancelled.load())
+        {
+            update(*job, JobState::Cancelled);
+            return;
+        }
+
+        if (result != BankBuilder::OK)
+        {
+            update(*job, JobState::Failed,
+                sf("Failed to build bank: {}", result));
+            return;
+        }
+
+        update(*job, JobState::Storing);
+
+        // Upload on the storage pool, freeing this worker for the next build
+        try {
+            Workers::get(Workers::S3).submit(
+                [job, banks = std::move(banks)]() mutable {
+                    store(job, std::move(banks));
+                });
+        }
+        catch (const std::exception &e)
+        {
+            update(*job, JobState::Failed, e.what());
+        }
+    }
+
+    /**
+     * Reuse the job's banks that are already stored, and queue a build of
+     * the rest
+     */
+    static void prepare(const std::shared_ptr<Job> &job)
+    {
+        if (job->cancelled.load())
+        {
+            job->files.clear();
+            return;
+        }
+
+        for (size_t i = 0; i < job->buildKeys.size(); ++i)
+        {
+            if (!S3::fileExists(bankKey(job->buildKeys[i])))
+                job->missing.emplace_back(i);
+        }
+
+        if (job->missing.empty())
+        {
+            job->files.clear();
+            update(*job, JobState::Done, {}, variantsOf(*job));
+            return;
+        }
+
+        try {
+            Workers::get(Workers::Bank).submit([job]() {
+                build(job);
+            });
+        }
+        catch (const std::exception &e)
+        {
+            job->files.clear();
+            update(*job, JobState::Failed, e.what());
+        }
+    }
+
+    /**
+     * Delete stored banks past their retention, unless a job or
+     * `BankJobOpts::referenced` still refers to them
+     */
+    static void sweepBanks()
+    {
+        auto cutoff = std::chrono::system_clock::now() - sOpts.bankRetention;
+
+        std::vector<std::string> expired;
+        for (auto &object : S3::listObjectInfo(BankPrefix))
+        {
+            if (object.lastModified < cutoff)
+                expired.emplace_back(std::move(object.key));
+        }
+        if (expired.empty()) return;
+
+        // Checked after listing, so a bank reused meanwhile is kept
+        auto keep = sOpts.referenced ? sOpts.referenced() :
+            std::set<std::string>{};
+        {
+            std::lock_guard lock(sMutex);
+            for (auto &[id, job] : sJobs)
+            {
+                for (auto &buildKey : job->buildKeys)
+                    keep.emplace(bankKey(buildKey));
+            }
+        }
+
+        std::erase_if(expired, [&keep](const std::string &key) {
+            return keep.contains(key);
+        });
+
+        // S3 deletes at most 1000 objects per request
+        for (size_t i = 0; i < expired.size(); i += 1000)
+        {
+            std::vector<std::string> batch(expired.begin() + i,
+                expired.begin() + std::min(i + 1000, expired.size()));
+            if (!S3::deleteFiles(batch))
+                IN_ERR("Failed to delete {} expired banks", batch.size());
+        }
+
+        if (!expired.empty())
+            IN_LOG("Deleted {} expired banks", expired.size());
+    }
+
+    /**
+     * Cancel abandoned jobs and forget expired ones
+     */
+    static void sweep()
+    {
+        auto now = Clock::now();
+
+        {
+            std::lock_guard lock(sMutex);
+            for (auto it = sJobs.begin(); it != sJobs.end();)
+            {
+                auto &job = *it->second;
+                if (isFinished(job.state))
+                {
+                    if (now - job.finishedAt >= sOpts.retention &&
+                        job.listeners.empty())
+                    {
+                        if (auto flight = sFlights.find(job.flightKey);
+                            flight != sFlights.end() &&
+                            flight->second.get() == &job)
+                            sFlights.erase(flight);
+                        it = sJobs.erase(it);
+                        continue;
+                    }
+                }
+                else if (job.listeners.empty() &&
+                    now - job.lastSeen >= sOpts.lease && cancelJob(job))
+                {
+                    IN_LOG("Cancelled abandoned bank job {}", job.id);
+                }
+
+                ++it;
+            }
+        }
+    }
+
+    static void run()
+    {
+        auto lastBankSweep = Clock::now();
+
+        std::unique_lock lock(sRunMutex);
+        while (true)
+        {
+            sWake.wait_for(lock, sOpts.sweepInterval, []() {
+                return !sRunning;
+            });
+            if (!sRunning) break;
+
+            try {
+                sweep();
+            }
+            catch (const std::exception &e)
+            {
+                IN_ERR("Failed to sweep bank jobs: {}", e.what());
+            }
+
+            if (sOpts.bankRetention.count() == 0 ||
+                Clock::now() - lastBankSweep < sOpts.bankSweepInterval)
+                continue;
+
+            lastBankSweep = Clock::now();
+            try {
+                sweepBanks();
+            }
+            catch (const std::exception &e)
+            {
+                IN_ERR("Failed to sweep stored banks: {}", e.what());
+            }
+        }
+    }
+
+    void start(const BankJobOpts &opts)
+    {
+        std::lock_guard lock(sRunMutex);
+        if (sRunning) return;
+
+        {
+            std::lock_guard jobsLock(sMutex);
+            sOpts = opts;
+        }
+
+        sRunning = true;
+        sThread = std::thread(run);
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard lock(sRunMutex);
+            if (!sRunning) return;
+            sRunning = false;
+        }
+
+        sWake.notify_all();
+        sThread.join();
+    }
+
+    std::string submit(std::vector<std::string> files,
+        std::vector<EncodeProfile> profiles)
+    {
+        if (profiles.empty())
+            profiles.emplace_back(EncodeProfiles::standard());
+
+        double cost = 0;
+        std::vector<std::string> hashes;
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            AudioProbe::Probe probe;
+            if (auto error = AudioProbe::read(files[i], probe))
+                throw std::invalid_argument(sf("File {} was rejected: {}",
+                    i + 1, error));
+
+            for (auto &profile : profiles)
+                cost += AudioProbe::cost(probe, profile);
+            hashes.emplace_back(BankBuilder::hashFile(files[i]));
+        }
+
+        std::vector<std::string> buildKeys;
+        std::string flightKey;
+        for (auto &profile : profiles)
+        {
+            buildKeys.emplace_back(BankBuilder::buildKey(hashes, profile));
+            if (!flightKey.empty())
+                flightKey += ',';
+            flightKey += buildKeys.back();
+        }
+
+        auto bytes = genBytes(16);
+        auto id = Base64Url::encode(
+            std::string_view((const char *)bytes.data(), bytes.size()));
+
+        auto job = std::make_shared<Job>();
+        job->id = id;
+        job->files = std::move(files);
+        job->profiles = std::move(profiles);
+        job->buildKeys = std::move(buildKeys);
+        job->flightKey = flightKey;
+        job->submitters = 1;
+        job->state = JobState::Queued;
+        job->progress = 0;
+        job->cost = cost;
+        job->lastSeen = Clock::now();
+
+        {
+            std::lock_guard lock(sMutex);
+
+            // Join an identical job in progress instead of building again
+            if (auto it = sFlights.find(flightKey); it != sFlights.end())
+            {
+                auto &other = *it->second;
+                if (!isFinished(other.state) && !other.cancelled.load())
+                {
+                    ++other.submitters;
+                    other.lastSeen = Clock::now();
+                    return other.id;
+                }
+            }
+
+            double pending = 0;
+            for (auto &[jobId, other] : sJobs)
+            {
+                if (!isFinished(other->state))
+                    pending += other->cost;
+            }
+
+            if (pending > 0 && pending + cost > sOpts.maxPendingCost)
+                throw std::runtime_error("Too many bank builds are pending");
+
+            sJobs.emplace(id, job);
+            sFlights.insert_or_assign(flightKey, job);
+        }
+
+        // Look for stored banks on the storage pool before building
+        try {
+            Workers::get(Workers::S3).submit([job]() {
+                prepare(job);
+            });
+        }
+        catch (...)
+        {
+            std::lock_guard lock(sMutex);
+            sJobs.erase(id);
+            sFlights.erase(flightKey);
+            throw;
+        }
+
+        return id;
+    }
+
+    std::string bankKey(std::string_view buildKey)
+    {
+        return sf("{}{}.fsb", BankPrefix, buildKey);
+    }
+
+    std::optional<JobStatus> status(std::string_view id)
+    {
+        std::lock_guard lock(sMutex);
+        auto it = sJobs.find(id);
+        if (it == sJobs.end())
+            return {};
+
+        auto &job = *it->second;
+        job.lastSeen = Clock::now();
+        return statusOf(job);
+    }
+
+    bool cancel(std::string_view id)
+    {
+        std::lock_guard lock(sMutex);
+        auto it = sJobs.find(id);
+        if (it == sJobs.end())
+            return false;
+
+        auto &job = *it->second;
+        if (job.submitters > 1 && !isFinished(job.state) &&
+            !job.cancelled.load())
+        {
+            --job.submitters;
+            return true;
+        }
+
+        return cancelJob(job);
+    }
+
+    size_t subscribe(std::string_view id, Listener listener)
+    {
+        std::lock_guard lock(sMutex);
+        auto it = sJobs.find(id);
+        if (it == sJobs.end())
+            return 0;
+
+        auto &job = *it->second;
+        auto subscription = ++sLastSubscription;
+
+        listener(statusOf(job));
+        job.listeners.emplace(subscription, std::move(listener));
+
+        return subscription;
+    }
+
+    void unsubscribe(std::string_view id, size_t subscription)
+    {
+        std::lock_guard lock(sMutex);
+        auto it = sJobs.find(id);
+        if (it == sJobs.end())
+            return;
+
+        auto &job = *it->second;
+        if (job.listeners.erase(subscription) && job.listeners.empty())
+            job.lastSeen = Clock::now();
+    }
+}
@@ -0,0 +1,204 @@
+/**
+ * @file BankJobs.h
+ *
+ * Contains functions to build fsbanks in the background. Each submitted build
+ * gets a job id, which clients use to poll its status or follow its progress.
+ * Built banks are stored in S3.
+ *
+ * Banks are stored by the content of their files and profile, so a build
+ * already stored is reused instead of built again, and an identical build
+ * submitted while one is in progress joins it.
+ *
+ * A job whose client has gone away, i.e. it has no followers and its status
+ * was not checked within the lease, is cancelled.
+ *
+ * Stored banks are deleted once past `BankJobOpts::bankRetention`, unless a
+ * job or `BankJobOpts::referenced` still refers to them.
+ */
+#pragma once
+#include <insound/core/EncodeProfile.h>
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Insound::BankJobs {
+
+    enum class JobState
+    {
+        // Waiting for a bank worker
+        Queued,
+        // Encoding the bank
+        Building,
+        // Uploading the bank to S3
+        Storing,
+        // The bank is ready at `JobStatus::key`
+        Done,
+        // See `JobStatus::error`
+        Failed,
+        Cancelled,
+    };
+
+    struct JobStatus
+    {
+        std::string id;
+        JobState state;
+
+        // Fraction of the build completed, from 0 to 1
+        float progress;
+
+        // Estimated CPU time of the build in seconds, see `AudioProbe::cost`
+        double cost;
+
+        // Reason the job failed, empty otherwise
+        std::string error;
+
+        // S3 key of the first profile's bank, once done
+        std::string key;
+
+        // S3 key of each profile's bank by profile name, once done
+        std::map<std::string, std::string> variants;
+    };
+
+    struct BankJobOpts
+    {
+        /**
+         * How long a job without followers may go without a status check
+         * before it is considered abandoned and cancelled
+         */
+        std::chrono::milliseconds lease{30000};
+
+        /**
+         * How long a finished job is kept. Its banks stay in S3, where later
+         * identical builds reuse them.
+         */
+        std::chrono::milliseconds retention{10 * 60 * 1000};
+
+        /**
+         * How often to check for abandoned and expired jobs
+         */
+        std::chrono::milliseconds sweepInterval{1000};
+
+        /**
+         * Estimated CPU seconds of queued and running builds, past which new
+         * jobs are turned away. A job is always admitted when none are
+         * pending, however large.
+         */
+        double maxPendingCost = 300;
+
+        /**
+         * How long a stored bank is kept after it was stored, so identical
+         * builds can reuse it. Banks still referred to are kept longer. Zero
+         * keeps every bank.
+         */
+        std::chrono::milliseconds bankRetention{30ll * 24 * 60 * 60 * 1000};
+
+        /**
+         * How often to look for stored banks past their retention
+         */
+        std::chrono::milliseconds bankSweepInterval{60 * 60 * 1000};
+
+        /**
+         * Get the S3 keys of stored banks referred to elsewhere, e.g. by
+         * tracks, which are kept past their retention. Called from the
+         * sweeper thread.
+         */
+        std::function<std::set<std::string>()> referenced;
+    };
+
+    /**
+     * Receives a job's status each time it changes. Called with the jobs
+     * lock held, so it must be quick and must not call into `BankJobs`.
+     */
+    using Listener = std::function<void(const JobStatus &)>;
+
+    /**
+     * Start sweeping abandoned and expired jobs. Safe to call if already
+     * started.
+     *
+     * @param opts - options to start with
+     */
+    void start(const BankJobOpts &opts = {});
+
+    /**
+     * Stop sweeping jobs. Jobs still running are left to finish.
+     */
+    void stop();
+
+    /**
+     * Queue a bank build on the bank worker pool. With several profiles, each
+     * file is decoded once and shared by every variant.
+     *
+     * Files are probed first, so corrupt and unsupported files are rejected
+     * before a job is created.
+     *
+     * @param files    - audio file data to build the bank from
+     * @param profiles - profiles to build a bank variant of. Empty builds the
+     *                   standard profile.
+     *
+     * @return id of the new job, or of an identical job in progress.
+     *
+     * @throws std::invalid_argument if a file can't be built into a bank.
+     * @throws std::runtime_error if the bank pool was shut down, or pending
+     *         builds are over `BankJobOpts::maxPendingCost`.
+     */
+    [[nodiscard]]
+    std::string submit(std::vector<std::string> files,
+        std::vector<EncodeProfile> profiles = {});
+
+    /**
+     * Get the S3 key a bank is stored at
+     *
+     * @param buildKey - `BankBuilder::buildKey` of the bank
+     */
+    [[nodiscard]]
+    std::string bankKey(std::string_view buildKey);
+
+    /**
+     * Get a job's status, which also renews its lease
+     *
+     * @param id - id of the job
+     *
+     * @return the status, or nothing if no such job exists.
+     */
+    [[nodiscard]]
+    std::optional<JobStatus> status(std::string_view id);
+
+    /**
+     * Cancel a job. A build in progress is aborted. A job shared by several
+     * submissions is only cancelled once each of them has cancelled it.
+     *
+     * @param id - id of the job
+     *
+     * @return whether the job exists and had not finished yet.
+     */
+    bool cancel(std::string_view id);
+
+    /**
+     * Follow a job's status. The listener is called with the current status
+     * right away, and holds the job's lease until unsubscribed.
+     *
+     * @param id       - id of the job
+     * @param listener - function receiving each status update
+     *
+     * @return subscription id to pass to `unsubscribe`, or 0 if no such job
+     *         exists.
+     */
+    [[nodiscard]]
+    size_t subscribe(std::string_view id, Listener listener);
+
+    /**
+     * Stop following a job. The listener is not called once this returns.
+     * The job's lease starts over when its last follower leaves.
+     *
+     * @param id           - id of the job
+     * @param subscription - id returned from `subscribe`
+     */
+    void unsubscribe(std::string_view id, size_t subscription);
+}
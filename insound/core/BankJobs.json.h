@@ -0,0 +1,9 @@
+#pragma once
+#include <insound/core/json.h>
+#include <insound/core/BankJobs.h>
+
+IN_JSON_ENUM(Insound::BankJobs::JobState,
+    Queued, Building, Storing, Done, Failed, Cancelled);
+
+IN_JSON_META(Insound::BankJobs::JobStatus,
+    id, state, progress, cost, error, key, variants);
@@ -0,0 +1,97 @@
+#include "BloomFilter.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace Insound {
+
+    // Final mix of MurmurHash3, spreading every input bit over the output
+    static uint64_t mix(uint64_t x)
+    {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdull;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ull;
+        x ^= x >> 33;
+        return x;
+    }
+
+    // Odd multipliers deriving a separate bit position per word from the
+    // lower half of the hash, as in Parquet's split block bloom filter
+    static constexpr uint32_t Salts[8] = {
+        0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+        0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u,
+    };
+
+    /**
+     * Bit to set in word `word` of a key's block
+     */
+    static uint64_t bitFor(uint64_t hash, int word)
+    {
+        return 1ull << ((uint32_t)hash * Salts[word] >> 26);
+    }
+
+    BloomFilter::BloomFilter(size_t capacity, size_t bitsPerKey) :
+        m_blocks(), m_blockCount(), m_capacity(std::max<size_t>(capacity, 1)),
+        m_size(0)
+    {
+        auto bits = m_capacity * std::max<size_t>(bitsPerKey, 1);
+        m_blockCount = (bits + 511) / 512;
+
+        // Value-initialized, so every word starts at zero
+        m_blocks = std::make_unique<Block[]>(m_blockCount);
+    }
+
+    const BloomFilter::Block &BloomFilter::block(uint64_t hash) const
+    {
+        // Upper 32 bits pick the block, the lower 32 pick the bits
+        return m_blocks[(hash >> 32) * m_blockCount >> 32];
+    }
+
+    void BloomFilter::insert(uint64_t hash)
+    {
+        auto &b = const_cast<Block &>(block(hash));
+        for (int i = 0; i < 8; ++i)
+            b.words[i].fetch_or(bitFor(hash, i), std::memory_order_relaxed);
+
+        m_size.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool BloomFilter::mayContain(uint64_t hash) const
+    {
+        auto &b = block(hash);
+
+        uint64_t missing = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            auto bit = bitFor(hash, i);
+            missing |= ~b.words[i].load(std::memory_order_relaxed) & bit;
+        }
+
+        return missing == 0;
+    }
+
+    uint64_t BloomFilter::hash(std::string_view key)
+    {
+        uint64_t h = 0x9e3779b97f4a7c15ull ^ key.size();
+
+        size_t i = 0;
+        for (; i + 8 <= key.size(); i += 8)
+        {
+            uint64_t chunk;
+            std::memcpy(&chunk, key.data() + i, 8);
+            h = std::rotl(h ^ chunk, 29) * 0xbf58476d1ce4e5b9ull;
+        }
+
+        if (i < key.size())
+        {
+            uint64_t chunk = 0;
+            std::memcpy(&chunk, key.data() + i, key.size() - i);
+            h = std::rotl(h ^ chunk, 29) * 0xbf58476d1ce4e5b9ull;
+        }
+
+        // One full mix at the end is enough, since keys aren't adversarial
+        return mix(h);
+    }
+}
@@ -0,0 +1,75 @@
+#include "ByteBudget.h"
+
+#include <algorithm>
+
+namespace Insound {
+
+    ByteBudget::Ticket::Ticket(Ticket &&other) noexcept :
+        m_budget(other.m_budget), m_bytes(other.m_bytes)
+    {
+        other.m_budget = nullptr;
+        other.m_bytes = 0;
+    }
+
+    ByteBudget::Ticket &ByteBudget::Ticket::operator=(Ticket &&other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            m_budget = other.m_budget;
+            m_bytes = other.m_bytes;
+            other.m_budget = nullptr;
+            other.m_bytes = 0;
+        }
+
+        return *this;
+    }
+
+    void ByteBudget::Ticket::release()
+    {
+        if (m_budget)
+        {
+            m_budget->release(m_bytes);
+            m_budget = nullptr;
+            m_bytes = 0;
+        }
+    }
+
+    ByteBudget::Ticket ByteBudget::acquire(size_t bytes,
+        std::chrono::milliseconds timeout)
+    {
+        if (m_capacity == 0) // unlimited
+            return {this, 0};
+
+        bytes = std::min(bytes, m_capacity);
+
+        std::unique_lock lock(m_mutex);
+        auto hasRoom = [this, bytes]() {
+            return m_used + bytes <= m_capacity;
+        };
+
+        if (!m_cond.wait_for(lock, timeout, hasRoom))
+            return {};
+
+        m_used += bytes;
+        return {this, bytes};
+    }
+
+    size_t ByteBudget::used() const
+    {
+        std::lock_guard lock(m_mutex);
+        return m_used;
+    }
+
+    void ByteBudget::release(size_t bytes)
+    {
+        if (bytes == 0) return;
+
+        {
+            std::lock_guard lock(m_mutex);
+            m_used -= std::min(bytes, m_used);
+        }
+
+        m_cond.notify_all();
+    }
+}
@@ -0,0 +1,93 @@
+/**
+ * @file ByteBudget.h
+ *
+ * Contains `ByteBudget`, a counting semaphore measured in bytes. It is used to
+ * cap the total size of request bodies being processed at the same time.
+ */
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+namespace Insound {
+
+    class ByteBudget
+    {
+    public:
+        /**
+         * Releases its bytes back to the budget on destruction.
+         */
+        class Ticket
+        {
+        public:
+            Ticket() : m_budget(), m_bytes() { }
+            Ticket(Ticket &&other) noexcept;
+            Ticket &operator=(Ticket &&other) noexcept;
+            ~Ticket() { release(); }
+
+            Ticket(const Ticket &) = delete;
+            Ticket &operator=(const Ticket &) = delete;
+
+            /**
+             * Return the reserved bytes to the budget ahead of destruction.
+             */
+            void release();
+
+            [[nodiscard]]
+            size_t bytes() const { return m_bytes; }
+
+            [[nodiscard]]
+            explicit operator bool() const { return m_budget != nullptr; }
+        private:
+            friend class ByteBudget;
+            Ticket(ByteBudget *budget, size_t bytes) :
+                m_budget(budget), m_bytes(bytes) { }
+
+            ByteBudget *m_budget;
+            size_t m_bytes;
+        };
+
+        /**
+         * @param capacity - total bytes that may be reserved at once,
+         *                   0 means unlimited
+         */
+        explicit ByteBudget(size_t capacity = 0) : m_capacity(capacity),
+            m_used(), m_mutex(), m_cond() { }
+
+        /**
+         * Reserve bytes, waiting up to `timeout` for other reservations to
+         * be released. A request larger than the whole capacity is clamped to
+         * the capacity, so it gets processed alone rather than never.
+         *
+         * @param bytes   - number of bytes to reserve
+         * @param timeout - maximum time to wait
+         *
+         * @return a ticket, which evaluates to false if the wait timed out.
+         */
+        [[nodiscard]]
+        Ticket acquire(size_t bytes, std::chrono::milliseconds timeout);
+
+        /**
+         * Set the capacity. Should only be called before use.
+         */
+        void capacity(size_t capacity) { m_capacity = capacity; }
+
+        [[nodiscard]]
+        size_t capacity() const { return m_capacity; }
+
+        /**
+         * Number of bytes currently reserved
+         */
+        [[nodiscard]]
+        size_t used() const;
+
+    private:
+        void release(size_t bytes);
+
+        size_t m_capacity;
+        size_t m_used;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cond;
+    };
+}
@@ -0,0 +1,71 @@
+#include "EncodeProfile.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Insound::EncodeProfiles {
+
+    const std::vector<EncodeProfile> &all()
+    {
+        // Function-local, so it's safe to use during static initialization
+        static const std::vector<EncodeProfile> Profiles = {
+            {.name = "standard", .format = BankFormat::Vorbis, .quality = 75,
+                .sampleRate = 44100, .mono = false},
+            // Small downloads over cellular
+            {.name = "mobile", .format = BankFormat::Vorbis, .quality = 40,
+                .sampleRate = 32000, .mono = true},
+            // Playback on devices that struggle to decode many Vorbis streams
+            {.name = "lowcpu", .format = BankFormat::FAdpcm, .quality = 100,
+                .sampleRate = 44100, .mono = false},
+            // Reviewing mixes at the stems' own quality
+            {.name = "pro", .format = BankFormat::Vorbis, .quality = 100,
+                .sampleRate = 0, .mono = false},
+        };
+
+        return Profiles;
+    }
+
+    const EncodeProfile &standard()
+    {
+        return all()[0];
+    }
+
+    const EncodeProfile *find(std::string_view name)
+    {
+        for (auto &profile : all())
+        {
+            if (profile.name == name)
+                return &profile;
+        }
+
+        return nullptr;
+    }
+
+    std::vector<EncodeProfile> parse(std::string_view names)
+    {
+        std::vector<EncodeProfile> result;
+        while (!names.empty())
+        {
+            auto comma = names.find(',');
+            auto name = names.substr(0, comma);
+            names = comma == std::string_view::npos ? std::string_view{} :
+                names.substr(comma + 1);
+
+            if (name.empty()) continue;
+
+            auto profile = find(name);
+            if (!profile)
+                throw std::runtime_error(sf("Unknown encode profile \"{}\"",
+                    name));
+
+            auto duplicate = std::any_of(result.begin(), result.end(),
+                [&name](const EncodeProfile &p) { return p.name == name; });
+            if (!duplicate)
+                result.emplace_back(*profile);
+        }
+
+        if (result.empty())
+            result.emplace_back(standard());
+        return result;
+    }
+}
@@ -0,0 +1,88 @@
+/**
+ * @file EncodeProfile.h
+ *
+ * Contains the encode settings of bank builds, and the named profiles that
+ * clients pick from, e.g. small Vorbis banks for mobile or FADPCM banks for
+ * low-CPU playback.
+ */
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Insound {
+
+    enum class BankFormat
+    {
+        // Smallest banks, most CPU to decode
+        Vorbis,
+        // Larger banks, cheap to decode
+        FAdpcm,
+        // Uncompressed 16-bit
+        Pcm,
+    };
+
+    struct EncodeProfile
+    {
+        /**
+         * Name clients select the profile by, also used in storage keys
+         */
+        std::string name;
+
+        BankFormat format = BankFormat::Vorbis;
+
+        /**
+         * Encoder quality from 1 to 100. Ignored by FADPCM and PCM.
+         */
+        unsigned quality = 75;
+
+        /**
+         * Sample rate of the bank. 0 keeps each file's own rate.
+         */
+        unsigned sampleRate = 44100;
+
+        /**
+         * Whether to mix each file down to mono before encoding
+         */
+        bool mono = false;
+    };
+
+    namespace EncodeProfiles {
+
+        /**
+         * Get the profile used when none is selected
+         */
+        [[nodiscard]]
+        const EncodeProfile &standard();
+
+        /**
+         * Get every built-in profile
+         */
+        [[nodiscard]]
+        const std::vector<EncodeProfile> &all();
+
+        /**
+         * Find a built-in profile by name
+         *
+         * @param name - name of the profile
+         *
+         * @return the profile, or nullptr if there is none by that name.
+         */
+        [[nodiscard]]
+        const EncodeProfile *find(std::string_view name);
+
+        /**
+         * Parse a comma-separated list of profile names, e.g. "mobile,pro".
+         * Duplicates are dropped.
+         *
+         * @param names - profile names
+         *
+         * @return the profiles in the order named, or the standard profile if
+         *         the list is empty.
+         *
+         * @throws std::runtime_error if a name is unknown.
+         */
+        [[nodiscard]]
+        std::vector<EncodeProfile> parse(std::string_view names);
+    }
+}
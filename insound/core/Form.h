@@ -0,0 +1,121 @@
+/**
+ * @file Form.h
+ *
+ * Contains `Form`, which parses a request body directly into a typed,
+ * glaze-specialized struct.
+ */
+#pragma once
+#include <insound/core/json.h>
+#include <insound/core/MultipartMap.h>
+#include <insound/core/schemas/FormErrors.h>
+
+#include <crow/http_request.h>
+
+#include <map>
+#include <string>
+#include <string_view>
+
+namespace Insound {
+
+    /**
+     * Request body parsed into struct `T`, which must specialize glz::meta.
+     *
+     * JSON bodies are read straight into `T` without an intermediate DOM.
+     * `std::string_view` members point into the request body and hold the
+     * raw text of the value, escape sequences included. Use them for fields
+     * that never need unescaping, like emails and tokens, which saves a copy.
+     * Members that may legitimately contain escaped characters, like
+     * passwords, should be `std::string`.
+     *
+     * Multipart and url-encoded bodies are parsed via `MultipartMap`, so
+     * only string members are supported for them.
+     *
+     * Members missing from the body keep their default value, and unknown
+     * keys are ignored, so handlers should check required fields.
+     *
+     * `string_view` members reference the request or this object, so a Form
+     * may not outlive the request, and cannot be copied or moved.
+     *
+     * @example
+     *     Form<LoginForm> form(req);
+     *     if (!form)
+     *         return Response::json(form.errors, HttpStatus::BadRequest);
+     */
+    template <JSON::Specialized T>
+    class Form
+    {
+    public:
+        explicit Form(const crow::request &req) : value(), errors(), m_map(),
+            m_json()
+        {
+            try {
+                auto &type = req.get_header_value("Content-Type");
+                if (type.starts_with("application/json"))
+                {
+                    read(req.body);
+                }
+                else
+                {
+                    // Re-encode the text fields, so they parse the same way
+                    m_map = MultipartMap::from(req);
+                    JSON::stringify(m_map.fields, m_json);
+                    read(m_json);
+                }
+            }
+            catch(const std::exception &e)
+            {
+                IN_WARN("Failed to parse form: {}", e.what());
+                errors.append("error", "Invalid form data.");
+            }
+        }
+
+        Form(const Form &) = delete;
+        Form &operator=(const Form &) = delete;
+
+        /**
+         * Parsed form fields
+         */
+        T value;
+
+        /**
+         * Contains an "error" entry if the body could not be parsed.
+         * Handlers may append their own validation errors.
+         */
+        FormErrors errors;
+
+        /**
+         * Files uploaded via a multipart body
+         */
+        [[nodiscard]]
+        const std::map<std::string, FileData> &files() const
+        {
+            return m_map.files;
+        }
+
+        /**
+         * Whether the form parsed without errors
+         */
+        explicit operator bool() const { return errors.empty(); }
+
+        const T *operator->() const { return &value; }
+
+    private:
+        void read(std::string_view json)
+        {
+            auto err = glz::read<JSON::Opts{
+                .error_on_unknown_keys=false,
+                .error_on_missing_keys=false
+            }>(value, json);
+
+            if (err.ec != JSON::ErrorCode::none)
+            {
+                IN_WARN("Failed to parse form: {}",
+                    glz::format_error(err, json));
+                errors.append("error", "Invalid form data.");
+            }
+        }
+
+        MultipartMap m_map;
+        std::string m_json;
+    };
+}
@@ -0,0 +1,146 @@
+#include "Fsb5.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace Insound::Fsb5 {
+
+    // Sample rates by the 4-bit index in a subsound's header
+    static constexpr uint32_t Rates[16] = {
+        4000, 8000, 11000, 11025, 16000, 22050, 24000, 32000,
+        44100, 48000, 96000, 0, 0, 0, 0, 0,
+    };
+
+    // Channel counts by the 2-bit index in a subsound's header
+    static constexpr uint32_t Channels[4] = {1, 2, 6, 8};
+
+    // Subsound header chunk types
+    static constexpr uint32_t ChannelsChunk = 1;
+    static constexpr uint32_t RateChunk = 2;
+
+    template <typename T>
+    static T readLE(std::string_view data, size_t offset)
+    {
+        T value;
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        return value;
+    }
+
+    static const char *readIndex(std::string_view bank, Index &index)
+    {
+        if (bank.size() < 0x3c || bank.substr(0, 4) != "FSB5")
+            return "bank is not an FSB5 file";
+
+        auto version = readLE<uint32_t>(bank, 4);
+        auto count = readLE<uint32_t>(bank, 8);
+        auto headersSize = readLE<uint32_t>(bank, 12);
+        auto namesSize = readLE<uint32_t>(bank, 16);
+        auto dataSize = readLE<uint32_t>(bank, 20);
+        auto mode = readLE<uint32_t>(bank, 24);
+
+        size_t pos = version == 0 ? 0x40 : 0x3c;
+        const size_t headersEnd = pos + headersSize;
+        const size_t dataStart = headersEnd + namesSize;
+
+        if (headersEnd > bank.size())
+            return "bank headers are truncated";
+        if (bank.size() > dataStart && dataStart + dataSize > bank.size())
+            return "bank data is truncated";
+
+        // Each subsound takes at least its 8-byte header
+        if (count > headersSize / 8)
+            return "bank has an invalid subsound count";
+
+        Index result{version, (Mode)mode, {}};
+        result.subsounds.reserve(count);
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            if (pos + 8 > headersEnd)
+                return "bank headers are truncated";
+
+            // Bit 0 has chunks, 1-4 rate, 5-6 channels, 7-33 data offset / 32,
+            // 34-63 sample count
+            auto header = readLE<uint64_t>(bank, pos);
+            pos += 8;
+
+            Subsound subsound{
+                .samples = header >> 34,
+                .channels = Channels[(header >> 5) & 0x3],
+                .sampleRate = Rates[(header >> 1) & 0xf],
+                .offset = ((header >> 7) & 0x7ffffff) * 32,
+                .size = 0,
+            };
+
+            // Chunks override the packed channel count and rate
+            auto more = header & 1;
+            while (more)
+            {
+                if (pos + 4 > headersEnd)
+                    return "bank headers are truncated";
+
+                auto chunk = readLE<uint32_t>(bank, pos);
+                pos += 4;
+
+                more = chunk & 1;
+                auto size = (chunk >> 1) & 0xffffff;
+                auto type = chunk >> 25;
+                if (pos + size > headersEnd)
+                    return "bank headers are truncated";
+
+                if (type == ChannelsChunk && size >= 1)
+                    subsound.channels = (uint8_t)bank[pos];
+                else if (type == RateChunk && size >= 4)
+                    subsound.sampleRate = readLE<uint32_t>(bank, pos);
+                pos += size;
+            }
+
+            if (subsound.sampleRate == 0 || subsound.channels == 0)
+                return "bank has a subsound with an invalid format";
+            if (subsound.offset > dataSize || (!result.subsounds.empty() &&
+                subsound.offset < result.subsounds.back().offset))
+                return "bank has a subsound with an invalid data offset";
+
+            result.subsounds.emplace_back(subsound);
+        }
+
+        // Data runs up to the next subsound's
+        for (size_t i = 0; i < result.subsounds.size(); ++i)
+        {
+            auto &subsound = result.subsounds[i];
+            auto end = i + 1 < result.subsounds.size() ?
+                result.subsounds[i + 1].offset : dataSize;
+
+            subsound.size = end - subsound.offset;
+            subsound.offset += dataStart;
+        }
+
+        index = std::move(result);
+        return nullptr;
+    }
+
+    const char *read(std::string_view bank, Index &index) noexcept
+    {
+        try {
+            return readIndex(bank, index);
+        }
+        catch (...)
+        {
+            return "an unknown error occurred";
+        }
+    }
+
+    Index parse(std::string_view bank)
+    {
+        Index index;
+        if (auto error = read(bank, index))
+            throw std::runtime_error(error);
+        return index;
+    }
+
+    std::string range(const Subsound &subsound)
+    {
+        return sf("bytes={}-{}", subsound.offset,
+            subsound.offset + subsound.size - 1);
+    }
+}
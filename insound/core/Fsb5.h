@@ -0,0 +1,103 @@
+/**
+ * @file Fsb5.h
+ *
+ * Contains a reader for the headers of FSB5 banks, as written by FSBank. It
+ * indexes each subsound's format and where its data lies in the file, without
+ * loading the bank in FMOD.
+ *
+ * Layout of an FSB5 file, all values little-endian:
+ *   file header        - 0x3c bytes, 0x40 in version 0
+ *   subsound headers   - `headersSize` bytes, one per subsound, each a 64-bit
+ *                        packed header followed by optional chunks
+ *   name table         - `namesSize` bytes
+ *   sample data        - `dataSize` bytes, each subsound's data at the offset
+ *                        in its header
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Insound::Fsb5 {
+
+    /**
+     * Sample data encodings, as stored in the file header's `mode`
+     */
+    enum class Mode : uint32_t
+    {
+        None = 0,
+        Pcm8 = 1,
+        Pcm16 = 2,
+        Pcm24 = 3,
+        Pcm32 = 4,
+        PcmFloat = 5,
+        GcAdpcm = 6,
+        ImaAdpcm = 7,
+        Vag = 8,
+        HeVag = 9,
+        Xma = 10,
+        Mpeg = 11,
+        Celt = 12,
+        At9 = 13,
+        Xwma = 14,
+        Vorbis = 15,
+        FAdpcm = 16,
+        Opus = 17,
+    };
+
+    struct Subsound
+    {
+        // Samples per channel
+        uint64_t samples;
+        uint32_t channels;
+        uint32_t sampleRate;
+        // Byte offset of the sample data from the start of the file
+        uint64_t offset;
+        // Byte size of the sample data, including any alignment padding
+        uint64_t size;
+    };
+
+    struct Index
+    {
+        uint32_t version;
+        Mode mode;
+        // In the order they are stored in the bank
+        std::vector<Subsound> subsounds;
+    };
+
+    /**
+     * Index a bank's subsounds from its headers
+     *
+     * @param bank  - FSB5 file data. Only the headers need to be present, but
+     *                sample data offsets are checked against the file size
+     *                when it is.
+     * @param index - receives the index
+     *
+     * @return nullptr on success, or a description of why the bank is invalid.
+     */
+    [[nodiscard]]
+    const char *read(std::string_view bank, Index &index) noexcept;
+
+    /**
+     * Index a bank's subsounds from its headers
+     *
+     * @param bank - FSB5 file data
+     *
+     * @return the index.
+     *
+     * @throws std::runtime_error if the bank is invalid.
+     */
+    [[nodiscard]]
+    Index parse(std::string_view bank);
+
+    /**
+     * Get the HTTP Range header value of a subsound's sample data, e.g. to
+     * download only that subsound from storage
+     *
+     * @param subsound - one of a bank's subsounds, with a non-zero size
+     */
+    [[nodiscard]]
+    std::string range(const Subsound &subsound);
+}
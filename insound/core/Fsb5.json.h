@@ -0,0 +1,13 @@
+#pragma once
+#include <insound/core/json.h>
+#include <insound/core/Fsb5.h>
+
+IN_JSON_ENUM(Insound::Fsb5::Mode,
+    None, Pcm8, Pcm16, Pcm24, Pcm32, PcmFloat, GcAdpcm, ImaAdpcm, Vag, HeVag,
+    Xma, Mpeg, Celt, At9, Xwma, Vorbis, FAdpcm, Opus);
+
+IN_JSON_META(Insound::Fsb5::Subsound,
+    samples, channels, sampleRate, offset, size);
+
+IN_JSON_META(Insound::Fsb5::Index,
+    version, mode, subsounds);
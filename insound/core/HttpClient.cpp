@@ -0,0 +1,211 @@
+#include "HttpClient.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace Insound {
+
+    HttpClient &HttpClient::instance()
+    {
+        static HttpClient client;
+        return client;
+    }
+
+    HttpClient::HttpClient() : m_share(curl_share_init()),
+        m_multi(curl_multi_init()), m_shareLocks(), m_mutex(), m_thread(),
+        m_stopping(), m_incoming(), m_active()
+    {
+        if (!m_share || !m_multi)
+            throw std::runtime_error("HttpClient: failed to init curl");
+
+        curl_share_setopt(m_share, CURLSHOPT_LOCKFUNC, lock);
+        curl_share_setopt(m_share, CURLSHOPT_UNLOCKFUNC, unlock);
+        curl_share_setopt(m_share, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(m_share, CURLSHOPT_SHARE,
+            CURL_LOCK_DATA_SSL_SESSION);
+
+        // Connections are not shared: libcurl does not support using a
+        // shared connection cache from threads transferring at once. The
+        // multi handle pools the connections of async transfers, and
+        // `acquire` those of blocking ones.
+
+        curl_multi_setopt(m_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        curl_multi_setopt(m_multi, CURLMOPT_MAX_HOST_CONNECTIONS,
+            MaxHostConnections);
+        curl_multi_setopt(m_multi, CURLMOPT_MAX_TOTAL_CONNECTIONS,
+            MaxTotalConnections);
+    }
+
+    HttpClient::~HttpClient()
+    {
+        shutdown();
+        curl_multi_cleanup(m_multi);
+        curl_share_cleanup(m_share);
+    }
+
+    void HttpClient::lock(CURL *, curl_lock_data data, curl_lock_access,
+        void *userptr)
+    {
+        static_cast<HttpClient *>(userptr)->m_shareLocks[data].lock();
+    }
+
+    void HttpClient::unlock(CURL *, curl_lock_data data, void *userptr)
+    {
+        static_cast<HttpClient *>(userptr)->m_shareLocks[data].unlock();
+    }
+
+    /**
+     * Idle handle of a thread, kept with its open connections
+     */
+    struct SpareHandle
+    {
+        CURL *curl = nullptr;
+
+        ~SpareHandle()
+        {
+            if (curl)
+                curl_easy_cleanup(curl);
+        }
+    };
+
+    static thread_local SpareHandle tSpare;
+
+    CURL *HttpClient::acquire()
+    {
+        auto curl = std::exchange(tSpare.curl, nullptr);
+        if (!curl)
+            curl = curl_easy_init();
+        if (!curl)
+            throw std::runtime_error("HttpClient: failed to init curl handle");
+
+        configure(curl);
+        return curl;
+    }
+
+    void HttpClient::release(CURL *curl) noexcept
+    {
+        if (!curl) return;
+
+        if (tSpare.curl)
+        {
+            curl_easy_cleanup(curl);
+            return;
+        }
+
+        // Resetting keeps the handle's connections open
+        curl_easy_reset(curl);
+        tSpare.curl = curl;
+    }
+
+    void HttpClient::configure(CURL *curl)
+    {
+        curl_easy_setopt(curl, CURLOPT_SHARE, m_share);
+
+        // Negotiate HTTP/2 over TLS, and prefer waiting for a connection to
+        // multiplex on over opening a new one
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+        curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+
+        // Required for timeouts in multithreaded programs
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    }
+
+    void HttpClient::perform(CURL *curl, Callback done)
+    {
+        bool stopping;
+        {
+            std::lock_guard lock(m_mutex);
+            stopping = m_stopping;
+            if (!stopping)
+            {
+                m_incoming.emplace_back(curl, std::move(done));
+                if (!m_thread.joinable())
+                    m_thread = std::thread(&HttpClient::run, this);
+            }
+        }
+
+        if (stopping)
+            done(CURLE_ABORTED_BY_CALLBACK);
+        else
+            curl_multi_wakeup(m_multi);
+    }
+
+    void HttpClient::finish(CURL *curl, CURLcode result)
+    {
+        curl_multi_remove_handle(m_multi, curl);
+
+        auto it = m_active.find(curl);
+        if (it == m_active.end()) return;
+
+        auto done = std::move(it->second);
+        m_active.erase(it);
+        done(result);
+    }
+
+    void HttpClient::run()
+    {
+        while (true)
+        {
+            std::vector<std::pair<CURL *, Callback>> incoming;
+            bool stopping;
+            {
+                std::lock_guard lock(m_mutex);
+                incoming.swap(m_incoming);
+                stopping = m_stopping;
+            }
+
+            for (auto &[curl, done] : incoming)
+            {
+                if (stopping)
+                {
+                    done(CURLE_ABORTED_BY_CALLBACK);
+                    continue;
+                }
+
+                auto code = curl_multi_add_handle(m_multi, curl);
+                if (code != CURLM_OK)
+                {
+                    done(CURLE_FAILED_INIT);
+                    continue;
+                }
+
+                m_active.emplace(curl, std::move(done));
+            }
+
+            if (stopping)
+            {
+                while (!m_active.empty())
+                    finish(m_active.begin()->first, CURLE_ABORTED_BY_CALLBACK);
+                break;
+            }
+
+            int running;
+            curl_multi_perform(m_multi, &running);
+
+            int queued;
+            while (auto msg = curl_multi_info_read(m_multi, &queued))
+            {
+                if (msg->msg == CURLMSG_DONE)
+                    finish(msg->easy_handle, msg->data.result);
+            }
+
+            // Sleeps until there is socket activity, or `perform` or
+            // `shutdown` wakes it
+            curl_multi_poll(m_multi, nullptr, 0, 1000, nullptr);
+        }
+    }
+
+    void HttpClient::shutdown()
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stopping = true;
+        }
+
+        curl_multi_wakeup(m_multi);
+        if (m_thread.joinable())
+            m_thread.join();
+    }
+}
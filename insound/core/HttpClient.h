@@ -0,0 +1,118 @@
+/**
+ * @file HttpClient.h
+ *
+ * Contains `HttpClient`, the shared engine behind outbound http requests made
+ * via `MakeRequest`. Most code should use `MakeRequest` instead of this class.
+ */
+#pragma once
+#include <curl/curl.h>
+
+#include <array>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Insound {
+
+    /**
+     * Shares one DNS cache and TLS session cache between all curl handles,
+     * so repeated calls to the same host skip DNS lookups and full TLS
+     * handshakes. Async transfers share the connections of the multi handle,
+     * and blocking ones on a thread reuse the connections of the thread's
+     * handle, see `acquire`. Connections to a host are capped per host, and
+     * HTTP/2 streams are multiplexed over a single connection when the
+     * server supports it.
+     *
+     * Asynchronous transfers run on one engine thread driving a curl multi
+     * handle, so any number of requests may be in flight at once.
+     */
+    class HttpClient
+    {
+    public:
+        /**
+         * Called on the engine thread once a transfer is done
+         */
+        using Callback = std::function<void(CURLcode)>;
+
+        /**
+         * Get the shared client
+         */
+        static HttpClient &instance();
+
+        ~HttpClient();
+
+        HttpClient(const HttpClient &) = delete;
+        HttpClient &operator=(const HttpClient &) = delete;
+
+        /**
+         * Get a configured handle. Reuses the handle last released on this
+         * thread, along with its open connections, if there is one.
+         *
+         * @throws std::runtime_error if a handle could not be created.
+         */
+        [[nodiscard]]
+        CURL *acquire();
+
+        /**
+         * Give back a handle from `acquire`, keeping it for the next request
+         * on this thread. The handle must not be in use.
+         */
+        void release(CURL *curl) noexcept;
+
+        /**
+         * Attach the shared caches and protocol options to a handle. Must be
+         * called again after `curl_easy_reset`.
+         */
+        void configure(CURL *curl);
+
+        /**
+         * Start a transfer on the engine thread. The handle must not be used
+         * until `done` is called.
+         *
+         * @param curl - configured handle to perform
+         * @param done - called with the result of the transfer, which is
+         *               CURLE_ABORTED_BY_CALLBACK if the client shut down
+         */
+        void perform(CURL *curl, Callback done);
+
+        /**
+         * Abort transfers in flight and stop the engine thread. Synchronous
+         * requests still work afterwards.
+         */
+        void shutdown();
+
+        /**
+         * Max connections kept open to a single host
+         */
+        static constexpr long MaxHostConnections = 8;
+
+        /**
+         * Max connections kept open in total
+         */
+        static constexpr long MaxTotalConnections = 64;
+
+    private:
+        HttpClient();
+
+        void run();
+        void finish(CURL *curl, CURLcode result);
+
+        static void lock(CURL *, curl_lock_data data, curl_lock_access,
+            void *userptr);
+        static void unlock(CURL *, curl_lock_data data, void *userptr);
+
+        CURLSH *m_share;
+        CURLM *m_multi;
+        std::array<std::mutex, CURL_LOCK_DATA_LAST> m_shareLocks;
+
+        std::mutex m_mutex;
+        std::thread m_thread;
+        bool m_stopping;
+        std::vector<std::pair<CURL *, Callback>> m_incoming;
+
+        // Only accessed from the engine thread
+        std::unordered_map<CURL *, Callback> m_active;
+    };
+}
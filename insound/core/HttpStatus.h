@@ -63,10 +63,12 @@ namespace Insound {
         Forbidden = 403,
         NotFound = 404,
         MethodNotAllowed = 405,
-        ProxyAuthRequired = 406,
-        Conflict = 407,
-        Gone = 408,
-        PayloadTooLarge = 409,
+        ProxyAuthRequired = 407,
+        Conflict = 409,
+        Gone = 410,
+
+        // Request body is larger than the server is willing to process
+        PayloadTooLarge = 413,
         UnsupportedMediaType = 415,
         RangeNotSatisfiable = 416,
         ExpectationFailed = 417,
@@ -0,0 +1,58 @@
+#include "Lifecycle.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+namespace Insound::Lifecycle {
+
+    static std::atomic<bool> sDraining{false};
+
+    static std::mutex sMutex;
+    static std::condition_variable sIdle;
+    static size_t sInFlight;
+
+    void requestStarted()
+    {
+        std::lock_guard lock(sMutex);
+        ++sInFlight;
+    }
+
+    void requestEnded()
+    {
+        bool idle;
+        {
+            std::lock_guard lock(sMutex);
+            if (sInFlight > 0)
+                --sInFlight;
+            idle = sInFlight == 0;
+        }
+
+        if (idle)
+            sIdle.notify_all();
+    }
+
+    size_t inFlight()
+    {
+        std::lock_guard lock(sMutex);
+        return sInFlight;
+    }
+
+    void beginDrain()
+    {
+        sDraining.store(true);
+    }
+
+    bool isDraining()
+    {
+        return sDraining.load(std::memory_order_relaxed);
+    }
+
+    bool waitIdle(std::chrono::milliseconds timeout)
+    {
+        std::unique_lock lock(sMutex);
+        return sIdle.wait_for(lock, timeout, []() {
+            return sInFlight == 0;
+        });
+    }
+}
@@ -0,0 +1,50 @@
+/**
+ * @file Lifecycle.h
+ *
+ * Contains process-wide request lifecycle state used for graceful shutdown:
+ * the number of in-flight requests, and whether the app is draining. The
+ * `DrainGuard` middleware keeps these up to date for every request.
+ */
+#pragma once
+#include <chrono>
+#include <cstddef>
+
+namespace Insound::Lifecycle {
+
+    /**
+     * Mark the start of a request. Called by `DrainGuard`.
+     */
+    void requestStarted();
+
+    /**
+     * Mark the end of a request. Called by `DrainGuard`.
+     */
+    void requestEnded();
+
+    /**
+     * Number of requests currently being handled
+     */
+    [[nodiscard]]
+    size_t inFlight();
+
+    /**
+     * Stop accepting new requests. New requests receive 503 Service
+     * Unavailable, so load balancers stop routing to this instance.
+     */
+    void beginDrain();
+
+    /**
+     * Whether the app is draining and no longer accepts requests
+     */
+    [[nodiscard]]
+    bool isDraining();
+
+    /**
+     * Block until no requests are in flight, or the timeout passes.
+     *
+     * @param timeout - max time to wait
+     *
+     * @return whether all requests finished in time.
+     */
+    bool waitIdle(std::chrono::milliseconds timeout);
+}
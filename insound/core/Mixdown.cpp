@@ -0,0 +1,193 @@
+#include "Mixdown.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Insound::Mixdown {
+
+    /**
+     * Add a stem into the mix bus, resampling it to the bus rate and mapping
+     * its channels onto the bus channels
+     *
+     * @param bus      - interleaved float samples at the mix rate
+     * @param channels - channels of the bus
+     * @param rate     - sample rate of the bus
+     * @param stem     - stem to add
+     * @param gain     - linear gain of the stem
+     */
+    static void addStem(std::vector<float> &bus, unsigned channels,
+        unsigned rate, const Pcm &stem, float gain)
+    {
+        const size_t busFrames = bus.size() / channels;
+        const size_t stemFrames = stem.frames();
+        const unsigned stemChannels = stem.channels;
+        if (stemFrames == 0 || gain == 0) return;
+
+        const auto *in = stem.samples.data();
+        const float scale = gain / 32768.f;
+
+        // Folding every stem channel into a mono bus
+        const bool fold = channels == 1 && stemChannels > 1;
+        const float foldScale = scale / stemChannels;
+
+        if (stem.sampleRate == rate)
+        {
+            auto frames = std::min(busFrames, stemFrames);
+            for (unsigned c = 0; c < channels; ++c)
+            {
+                auto *out = bus.data() + c;
+                if (fold)
+                {
+                    for (size_t i = 0; i < frames; ++i)
+                    {
+                        int sum = 0;
+                        for (unsigned s = 0; s < stemChannels; ++s)
+                            sum += in[i * stemChannels + s];
+                        out[i * channels] += sum * foldScale;
+                    }
+                }
+                else
+                {
+                    auto source = std::min(c, stemChannels - 1);
+                    for (size_t i = 0; i < frames; ++i)
+                        out[i * channels] +=
+                            in[i * stemChannels + source] * scale;
+                }
+            }
+            return;
+        }
+
+        // Linear interpolation, stepping through the stem in 32.32 fixed
+        // point to avoid drift over long stems
+        const uint64_t step = ((uint64_t)stem.sampleRate << 32) / rate;
+        uint64_t position = 0;
+        for (size_t i = 0; i < busFrames; ++i, position += step)
+        {
+            auto frame = (size_t)(position >> 32);
+            if (frame >= stemFrames) break;
+
+            auto next = std::min(frame + 1, stemFrames - 1);
+            auto t = (float)(uint32_t)position * (1.f / 4294967296.f);
+
+            for (unsigned c = 0; c < channels; ++c)
+            {
+                float a, b;
+                if (fold)
+                {
+                    int sumA = 0, sumB = 0;
+                    for (unsigned s = 0; s < stemChannels; ++s)
+                    {
+                        sumA += in[frame * stemChannels + s];
+                        sumB += in[next * stemChannels + s];
+                    }
+                    a = sumA * foldScale;
+                    b = sumB * foldScale;
+                }
+                else
+                {
+                    auto source = std::min(c, stemChannels - 1);
+                    a = in[frame * stemChannels + source] * scale;
+                    b = in[next * stemChannels + source] * scale;
+                }
+
+                bus[i * channels + c] += a + (b - a) * t;
+            }
+        }
+    }
+
+    Pcm mix(const std::vector<Pcm> &stems, const std::vector<double> &levels,
+        const MixdownOpts &opts)
+    {
+        const unsigned channels = std::clamp(opts.channels, 1u, 2u);
+        const unsigned rate = std::max(opts.sampleRate, 1u);
+
+        // Length of the longest stem at the mix rate
+        uint64_t length = 0;
+        for (auto &stem : stems)
+        {
+            if (stem.sampleRate == 0 || stem.channels == 0) continue;
+            length = std::max<uint64_t>(length,
+                stem.frames() * rate / stem.sampleRate);
+        }
+
+        const bool loops = opts.loopEnd > opts.loopStart &&
+            opts.loopStart < length;
+        const uint64_t loopEnd = loops ?
+            std::min<uint64_t>(opts.loopEnd, length) : length;
+
+        // Only the audio up to the end of the loop is ever heard
+        std::vector<float> bus(loopEnd * channels, 0.f);
+        for (size_t i = 0; i < stems.size(); ++i)
+        {
+            auto &stem = stems[i];
+            if (stem.sampleRate == 0 || stem.channels == 0) continue;
+
+            auto gain = i < levels.size() ? (float)levels[i] : 1.f;
+            addStem(bus, channels, rate, stem, gain);
+        }
+
+        Pcm result;
+        result.channels = channels;
+        result.sampleRate = rate;
+
+        const uint64_t loopSize = loops ? loopEnd - opts.loopStart : 0;
+        result.samples.resize(
+            (loopEnd + loopSize * opts.loopRepeats) * channels);
+
+        auto *out = result.samples.data();
+        for (auto sample : bus)
+        {
+            *out++ = (int16_t)std::lrint(
+                std::clamp(sample * 32768.f, -32768.f, 32767.f));
+        }
+
+        // Repeat the rendered loop
+        const auto *loop = result.samples.data() + opts.loopStart * channels;
+        for (unsigned i = 0; i < (loops ? opts.loopRepeats : 0); ++i)
+        {
+            std::memcpy(out, loop, loopSize * channels * sizeof(int16_t));
+            out += loopSize * channels;
+        }
+
+        return result;
+    }
+
+    /**
+     * Append a little-endian integer
+     */
+    template <typename T>
+    static void put(std::string &out, T value)
+    {
+        out.append((const char *)&value, sizeof(T));
+    }
+
+    std::string toWav(const Pcm &pcm)
+    {
+        const uint32_t dataSize = (uint32_t)(pcm.samples.size() *
+            sizeof(int16_t));
+        const uint16_t blockAlign = (uint16_t)(pcm.channels * sizeof(int16_t));
+
+        std::string file;
+        file.reserve(44 + dataSize);
+
+        file.append("RIFF");
+        put<uint32_t>(file, 36 + dataSize);
+        file.append("WAVE");
+
+        file.append("fmt ");
+        put<uint32_t>(file, 16);
+        put<uint16_t>(file, 1); // PCM
+        put<uint16_t>(file, (uint16_t)pcm.channels);
+        put<uint32_t>(file, pcm.sampleRate);
+        put<uint32_t>(file, pcm.sampleRate * blockAlign);
+        put<uint16_t>(file, blockAlign);
+        put<uint16_t>(file, 16);
+
+        file.append("data");
+        put<uint32_t>(file, dataSize);
+        file.append((const char *)pcm.samples.data(), dataSize);
+
+        return file;
+    }
+}
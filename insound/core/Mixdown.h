@@ -0,0 +1,72 @@
+/**
+ * @file Mixdown.h
+ *
+ * Contains functions to mix a track's decoded stems into a single file
+ * offline, e.g. to preview a mix preset without streaming every stem.
+ */
+#pragma once
+#include <insound/core/Pcm.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Insound::Mixdown {
+
+    struct MixdownOpts
+    {
+        /**
+         * Sample rate of the mix. Stems at other rates are resampled.
+         */
+        unsigned sampleRate = 44100;
+
+        /**
+         * Channels of the mix, 1 or 2
+         */
+        unsigned channels = 2;
+
+        /**
+         * Start of the loop, in frames at `sampleRate`
+         */
+        uint64_t loopStart = 0;
+
+        /**
+         * End of the loop, in frames at `sampleRate`. The mix only loops if
+         * this is after `loopStart`.
+         */
+        uint64_t loopEnd = 0;
+
+        /**
+         * Times the loop is played again after the first pass reaches
+         * `loopEnd`
+         */
+        unsigned loopRepeats = 1;
+    };
+
+    /**
+     * Mix stems together at their levels. Without a loop, the mix is as
+     * long as the longest stem. With one, it plays up to the loop's end, then
+     * the loop `loopRepeats` more times.
+     *
+     * @param stems  - decoded stems
+     * @param levels - linear gain per stem. Stems without a level play at
+     *                 full volume.
+     * @param opts   - format and loop of the mix
+     *
+     * @return the mix, clipped to 16 bits.
+     */
+    [[nodiscard]]
+    Pcm mix(const std::vector<Pcm> &stems, const std::vector<double> &levels,
+        const MixdownOpts &opts = {});
+
+    /**
+     * Wrap audio in a 16-bit PCM wave file
+     *
+     * @param pcm - audio to write
+     *
+     * @return the file data.
+     */
+    [[nodiscard]]
+    std::string toWav(const Pcm &pcm);
+}
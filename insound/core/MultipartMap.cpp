@@ -1,4 +1,5 @@
 #include "MultipartMap.h"
+#include "UrlEncoded.h"
 #include "crow/json.h"
 #include <crow/multipart.h>
 
@@ -8,46 +9,6 @@
 
 namespace Insound {
 
-    /**
-     * Helper to decode a URL-encoded string. Specifically, it parses all `%HH`
-     * to its char value, and converts '+' to ' '.
-     * @param  in - input url-encoded string
-     * @return      parsed string, e.g. "bob%40mail.com" -> "bob@mail.com"
-     */
-    static inline std::string decodeUrl(const std::string_view &in)
-    {
-        std::string out;
-        auto length = in.length();
-        for (size_t i = 0; i < length;)
-        {
-            switch(in[i])
-            {
-                case '%':
-                {
-                    if (i >= length - 2)
-                        throw std::invalid_argument(sf("Malformed URL-encoded "
-                            "string: escaped char at position {} is missing "
-                            "hex character(s)", i));
-                    auto end = &in[i+2];
-                    out += (unsigned char)std::strtoul(&in[i+1], (char **)&end, 16);
-                    i += 3;
-                    break;
-                }
-                case '+':
-                    out += ' ';
-                    ++i;
-                    break;
-
-                default:
-                    out += in[i];
-                    ++i;
-                    break;
-            }
-        }
-
-        return out;
-    }
-
     /**
      * Handles a JSON response, creating a MultipartMap of first-level
      * key-value strings. (Nested JSON values are not supported)
@@ -137,33 +98,12 @@ namespace Insound {
      */
     static inline MultipartMap handleFormUrlEncoded(const crow::request &req)
     {
-        // Decode the body
-        auto body = decodeUrl(req.body);
+        // Decoded in place, so work on a copy of the body
+        auto body = req.body;
         MultipartMap map;
 
-        // Scan body for key-value pairs
-        for (size_t i = 0, size = body.size(); i < size;)
-        {
-            // Find the current '='
-            auto eq = body.find_first_of('=', i);
-            if (eq == std::string::npos) // weird case: key missing value
-                throw std::invalid_argument("Url-encoded form error: key "
-                    "is missing a value.");
-
-            // Find the end of this value
-            auto end = body.find_first_of('&', i);
-
-            // Get and set kvp
-            auto key = body.substr(i, eq-i);
-            auto value = body.substr(eq+1, end-1-eq);
-
-            map.fields[key] = value;
-
-            // Move to next kvp, or quit if end-of-body
-            if (end == std::string::npos)
-                break;
-            i = end + 1; // move i one past the '&'
-        }
+        for (auto &[key, value] : UrlEncoded::parse(body))
+            map.fields.insert_or_assign(std::string(key), std::string(value));
 
         return map;
     }
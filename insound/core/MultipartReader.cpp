@@ -0,0 +1,175 @@
+#include "MultipartReader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+namespace Insound {
+
+    static std::string_view trim(std::string_view str)
+    {
+        while (!str.empty() && (str.front() == ' ' || str.front() == '\t'))
+            str.remove_prefix(1);
+        while (!str.empty() && (str.back() == ' ' || str.back() == '\t'))
+            str.remove_suffix(1);
+        return str;
+    }
+
+    static bool equalsIgnoreCase(std::string_view a, std::string_view b)
+    {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(),
+            b.begin(), [](char x, char y) {
+                return std::tolower((unsigned char)x) ==
+                    std::tolower((unsigned char)y);
+            });
+    }
+
+    /**
+     * Find a parameter of a header value, e.g. `name` in
+     * `form-data; name="file"`. Quotes are removed.
+     */
+    static std::optional<std::string_view> headerParam(std::string_view value,
+        std::string_view param)
+    {
+        size_t pos = 0;
+        while (pos < value.size())
+        {
+            auto end = value.find(';', pos);
+
+            // A quoted value may contain ';'
+            auto eq = value.find('=', pos);
+            if (eq != std::string_view::npos && eq < end)
+            {
+                auto valueStart = eq + 1;
+                while (valueStart < value.size() && value[valueStart] == ' ')
+                    ++valueStart;
+                if (valueStart < value.size() && value[valueStart] == '"')
+                {
+                    auto close = value.find('"', valueStart + 1);
+                    if (close == std::string_view::npos)
+                        return {};
+                    end = value.find(';', close);
+                }
+            }
+
+            auto item = trim(value.substr(pos, end == std::string_view::npos ?
+                std::string_view::npos : end - pos));
+            if (auto itemEq = item.find('='); itemEq != std::string_view::npos)
+            {
+                if (equalsIgnoreCase(trim(item.substr(0, itemEq)), param))
+                {
+                    auto result = trim(item.substr(itemEq + 1));
+                    if (result.size() >= 2 && result.front() == '"' &&
+                        result.back() == '"')
+                        result = result.substr(1, result.size() - 2);
+                    return result;
+                }
+            }
+
+            if (end == std::string_view::npos)
+                break;
+            pos = end + 1;
+        }
+
+        return {};
+    }
+
+    MultipartReader::MultipartReader(std::string_view contentType,
+        std::string_view body) : m_delimiter(), m_body(body), m_pos(),
+        m_count(), m_done()
+    {
+        if (!contentType.starts_with("multipart/"))
+            throw std::invalid_argument("Content-Type is not multipart");
+
+        auto boundary = headerParam(contentType, "boundary");
+        if (!boundary || boundary->empty())
+            throw std::invalid_argument("Multipart Content-Type is missing "
+                "its boundary");
+
+        m_delimiter = "\r\n--";
+        m_delimiter += *boundary;
+
+        // The first delimiter may start the body, without the leading CRLF
+        auto first = std::string_view(m_delimiter).substr(2);
+        if (m_body.starts_with(first))
+        {
+            m_pos = first.size();
+        }
+        else
+        {
+            auto found = m_body.find(m_delimiter);
+            if (found == std::string_view::npos)
+                throw std::invalid_argument("Multipart body has no parts");
+            m_pos = found + m_delimiter.size();
+        }
+    }
+
+    std::optional<MultipartReader::Part> MultipartReader::next()
+    {
+        if (m_done)
+            return {};
+
+        // After a delimiter comes "--" on the last one, otherwise a CRLF
+        auto rest = m_body.substr(m_pos);
+        if (rest.starts_with("--"))
+        {
+            m_done = true;
+            return {};
+        }
+
+        // Transport padding is allowed before the CRLF
+        auto lineEnd = rest.find("\r\n");
+        if (lineEnd == std::string_view::npos ||
+            !trim(rest.substr(0, lineEnd)).empty())
+            throw std::invalid_argument("Malformed multipart delimiter");
+        m_pos += lineEnd + 2;
+
+        auto headersEnd = m_body.find("\r\n\r\n", m_pos);
+        if (headersEnd == std::string_view::npos)
+            throw std::invalid_argument("Multipart part headers are not "
+                "terminated");
+
+        Part part{};
+        bool hasDisposition = false;
+        auto headers = m_body.substr(m_pos, headersEnd - m_pos);
+        while (!headers.empty())
+        {
+            auto end = headers.find("\r\n");
+            auto line = headers.substr(0, end);
+            headers = end == std::string_view::npos ? std::string_view() :
+                headers.substr(end + 2);
+
+            auto colon = line.find(':');
+            if (colon == std::string_view::npos)
+                continue;
+
+            auto name = trim(line.substr(0, colon));
+            auto value = trim(line.substr(colon + 1));
+            if (equalsIgnoreCase(name, "Content-Disposition"))
+            {
+                hasDisposition = true;
+                part.name = headerParam(value, "name").value_or("");
+                part.filename = headerParam(value, "filename").value_or("");
+            }
+            else if (equalsIgnoreCase(name, "Content-Type"))
+            {
+                part.contentType = value;
+            }
+        }
+
+        if (!hasDisposition)
+            throw std::invalid_argument(sf("Multipart part {} is missing a "
+                "Content-Disposition header", m_count));
+
+        auto dataStart = headersEnd + 4;
+        auto dataEnd = m_body.find(m_delimiter, dataStart);
+        if (dataEnd == std::string_view::npos)
+            throw std::invalid_argument("Multipart body is truncated");
+
+        part.data = m_body.substr(dataStart, dataEnd - dataStart);
+        m_pos = dataEnd + m_delimiter.size();
+        ++m_count;
+
+        return part;
+    }
+}
@@ -0,0 +1,78 @@
+/**
+ * @file MultipartReader.h
+ *
+ * Contains `MultipartReader`, which splits a multipart/form-data body into
+ * its parts one at a time, without copying them.
+ */
+#pragma once
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace Insound {
+
+    /**
+     * Reads the parts of a multipart/form-data body in order. Unlike
+     * `MultipartMap`, which parses and copies every part up front, each part
+     * is found only when asked for, and refers into the body. So the first
+     * parts can be processed while later ones are still unread, and the body
+     * must outlive the parts.
+     */
+    class MultipartReader
+    {
+    public:
+        /**
+         * A part of the body. Views refer into the body.
+         */
+        struct Part
+        {
+            // Field name
+            std::string_view name;
+
+            // File name, empty if the part is a text field
+            std::string_view filename;
+
+            // Value of the part's Content-Type header, if any
+            std::string_view contentType;
+
+            std::string_view data;
+
+            [[nodiscard]]
+            bool isFile() const { return !filename.empty(); }
+        };
+
+        /**
+         * @param contentType - Content-Type header of the request, holding
+         *                      the boundary
+         * @param body        - the request body
+         *
+         * @throws std::invalid_argument if the content type is not multipart
+         *         or has no boundary.
+         */
+        MultipartReader(std::string_view contentType, std::string_view body);
+
+        /**
+         * Read the next part
+         *
+         * @return the part, or nothing once all parts were read.
+         *
+         * @throws std::invalid_argument if the body is malformed.
+         */
+        [[nodiscard]]
+        std::optional<Part> next();
+
+        /**
+         * Number of parts read so far
+         */
+        [[nodiscard]]
+        size_t count() const { return m_count; }
+
+    private:
+        // "\r\n--" followed by the boundary
+        std::string m_delimiter;
+        std::string_view m_body;
+        size_t m_pos;
+        size_t m_count;
+        bool m_done;
+    };
+}
@@ -0,0 +1,573 @@
+#include "ObjectCache.h"
+
+#include <insound/core/base64.h>
+
+#include <openssl/sha.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+
+namespace Insound {
+
+    // Counters saturate here, as 4-bit counters would
+    static constexpr uint8_t MaxCount = 15;
+
+    // Counters are halved once this many requests per counter of a row have
+    // been recorded, so the sketch favors recent popularity
+    static constexpr size_t SampleFactor = 10;
+
+    // Bytes of memory per key the sketch is sized for, which is small, so
+    // that small objects are still tracked well
+    static constexpr size_t SketchBytesPerKey = 16 * 1024;
+
+    static uint64_t mix(uint64_t x)
+    {
+        // splitmix64 finalizer
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        x ^= x >> 31;
+        return x;
+    }
+
+    static uint64_t hashKey(std::string_view key)
+    {
+        return mix(std::hash<std::string_view>{}(key));
+    }
+
+    /**
+     * Get the disk tier's file name of a key
+     */
+    static std::string fileName(std::string_view key, uint64_t count)
+    {
+        unsigned char digest[SHA256_DIGEST_LENGTH];
+        SHA256((const unsigned char *)key.data(), key.size(), digest);
+
+        return sf("{}-{}", Base64Url::encode(std::string_view(
+            (const char *)digest, sizeof(digest))), count);
+    }
+
+    /**
+     * Check whether a file name was made by `fileName`, or is a temporary
+     * file written beside one
+     */
+    static bool isCacheFile(std::string_view name)
+    {
+        if (name.ends_with(".tmp"))
+            name.remove_suffix(4);
+
+        constexpr auto DigestChars = Base64Url::encodedSize(
+            SHA256_DIGEST_LENGTH);
+        if (name.size() < DigestChars + 2 || name[DigestChars] != '-')
+            return false;
+
+        auto isBase64Url = [](char c) {
+            return std::isalnum((unsigned char)c) || c == '-' || c == '_';
+        };
+        auto digest = name.substr(0, DigestChars);
+        auto count = name.substr(DigestChars + 1);
+        return std::all_of(digest.begin(), digest.end(), isBase64Url) &&
+            std::all_of(count.begin(), count.end(), [](char c) {
+                return std::isdigit((unsigned char)c);
+            });
+    }
+
+    static void removeFiles(const std::vector<std::string> &paths)
+    {
+        // Mapped objects stay readable after their file is removed
+        for (auto &path : paths)
+            std::remove(path.c_str());
+    }
+
+    ObjectCache::Object::Object(std::string data, std::string etag) :
+        m_buffer(std::move(data)), m_data(), m_etag(std::move(etag)),
+        m_mapping(), m_mappingSize()
+    {
+        m_data = m_buffer;
+    }
+
+    ObjectCache::Object::~Object()
+    {
+        if (m_mapping)
+            munmap(m_mapping, m_mappingSize);
+    }
+
+    ObjectCache::Ptr ObjectCache::Object::map(const std::string &path,
+        std::string etag)
+    {
+        auto fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return nullptr;
+
+        struct stat info;
+        if (fstat(fd, &info) != 0)
+        {
+            close(fd);
+            return nullptr;
+        }
+
+        std::shared_ptr<Object> object(new Object());
+        object->m_etag = std::move(etag);
+
+        // Empty files can't be mapped, and need not be
+        if (info.st_size > 0)
+        {
+            auto mapping = mmap(nullptr, (size_t)info.st_size, PROT_READ,
+                MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED)
+            {
+                close(fd);
+                return nullptr;
+            }
+
+            object->m_mapping = mapping;
+            object->m_mappingSize = (size_t)info.st_size;
+            object->m_data = std::string_view((const char *)mapping,
+                object->m_mappingSize);
+        }
+
+        // The mapping stays valid after the descriptor is closed
+        close(fd);
+        return object;
+    }
+
+    ObjectCache::ObjectCache(Fetch fetch) :
+        ObjectCache(std::move(fetch), Opts{})
+    { }
+
+    ObjectCache::ObjectCache(Fetch fetch, Opts opts) :
+        m_fetch(std::move(fetch)), m_opts(std::move(opts)), m_mutex(),
+        m_memory(), m_memoryIndex(), m_memoryBytes(), m_disk(), m_diskIndex(),
+        m_diskBytes(), m_sketch(), m_sketchWidth(), m_sketchAdditions(),
+        m_fileCount(), m_flights(), m_hits(), m_misses(), m_revalidations(),
+        m_rejected()
+    {
+        m_sketchWidth = std::bit_ceil(std::max<size_t>(1024,
+            m_opts.memoryBytes / SketchBytesPerKey));
+        m_sketch.resize(m_sketchWidth * 4);
+
+        if (!m_opts.diskDirectory.empty())
+        {
+            // Files left by an earlier run have no known etag, so they can't
+            // be revalidated. Other files are left alone, in case the
+            // directory is shared.
+            std::filesystem::create_directories(m_opts.diskDirectory);
+            for (auto &file : std::filesystem::directory_iterator(
+                m_opts.diskDirectory))
+            {
+                if (file.is_regular_file() &&
+                    isCacheFile(file.path().filename().string()))
+                    std::filesystem::remove(file.path());
+            }
+        }
+    }
+
+    ObjectCache::~ObjectCache()
+    {
+        clear();
+    }
+
+    ObjectCache::Ptr ObjectCache::get(std::string_view key)
+    {
+        auto hash = hashKey(key);
+
+        Ptr stale;
+        if (auto object = find(key, hash, stale))
+            return object;
+
+        {
+            std::lock_guard lock(m_mutex);
+            record(hash);
+        }
+
+        std::string owned(key);
+        return m_flights.run(owned, [&]() {
+            return load(owned, hash, stale);
+        }).get();
+    }
+
+    ObjectCache::Ptr ObjectCache::peek(std::string_view key)
+    {
+        Ptr stale;
+        return find(key, hashKey(key), stale);
+    }
+
+    bool ObjectCache::holds(size_t size) const
+    {
+        return (size <= m_opts.maxObjectBytes && size <= m_opts.memoryBytes) ||
+            (!m_opts.diskDirectory.empty() && size <= m_opts.diskBytes);
+    }
+
+    ObjectCache::Ptr ObjectCache::find(std::string_view key, uint64_t hash,
+        Ptr &stale)
+    {
+        auto now = Clock::now();
+
+        std::string diskPath, diskEtag;
+        bool diskFresh = false;
+        {
+            std::lock_guard lock(m_mutex);
+            if (auto it = m_memoryIndex.find(key); it != m_memoryIndex.end())
+            {
+                auto entry = it->second;
+                m_memory.splice(m_memory.begin(), m_memory, entry);
+                if (now - entry->validatedAt < m_opts.revalidateAfter)
+                {
+                    record(hash);
+                    ++m_hits;
+                    return entry->object;
+                }
+
+                stale = entry->object;
+            }
+            else if (auto it = m_diskIndex.find(key); it != m_diskIndex.end())
+            {
+                auto entry = it->second;
+                m_disk.splice(m_disk.begin(), m_disk, entry);
+                diskPath = entry->path;
+                diskEtag = entry->etag;
+                diskFresh = now - entry->validatedAt <
+                    m_opts.revalidateAfter;
+            }
+        }
+
+        // Map disk hits outside the lock. A file evicted in the meantime is
+        // treated as a miss.
+        if (!diskPath.empty())
+        {
+            auto mapped = Object::map(diskPath, std::move(diskEtag));
+            if (mapped && diskFresh)
+            {
+                std::lock_guard lock(m_mutex);
+                record(hash);
+                ++m_hits;
+                return mapped;
+            }
+
+            stale = std::move(mapped);
+        }
+
+        return nullptr;
+    }
+
+    ObjectCache::Ptr ObjectCache::load(const std::string &key, uint64_t hash,
+        const Ptr &stale)
+    {
+        std::optional<Fetched> fetched;
+        try {
+            fetched = m_fetch(key, stale ? stale->etag() : "");
+        }
+        catch (const std::exception &e)
+        {
+            if (!stale)
+                throw;
+
+            // Left due for revalidation, so the next get tries again
+            IN_WARN("Serving cached {}, which could not be revalidated: {}",
+                key, e.what());
+            return stale;
+        }
+
+        if (fetched && !fetched->modified)
+        {
+            if (stale)
+            {
+                validated(key, stale);
+                return stale;
+            }
+
+            // Not modified from a copy that was never sent
+            fetched = m_fetch(key, "");
+        }
+
+        if (!fetched)
+        {
+            erase(key);
+            return nullptr;
+        }
+
+        auto object = std::make_shared<const Object>(std::move(fetched->data),
+            std::move(fetched->etag));
+        {
+            std::lock_guard lock(m_mutex);
+            ++m_misses;
+        }
+
+        insert(key, hash, object);
+        return object;
+    }
+
+    void ObjectCache::insert(const std::string &key, uint64_t hash,
+        const Ptr &object)
+    {
+        std::vector<Entry> demoted;
+        std::vector<std::string> unlink;
+        {
+            std::lock_guard lock(m_mutex);
+            eraseLocked(key, unlink);
+
+            auto size = object->size();
+            bool admit = size <= m_opts.maxObjectBytes &&
+                size <= m_opts.memoryBytes;
+
+            // Pick the least recently used objects to make room. Any of them
+            // requested as often as the new one keeps its place instead.
+            std::vector<std::list<Entry>::iterator> victims;
+            if (admit)
+            {
+                auto candidate = frequency(hash);
+                size_t freed = 0;
+                auto it = m_memory.end();
+                while (m_memoryBytes - freed + size > m_opts.memoryBytes)
+                {
+                    --it;
+                    if (frequency(it->hash) >= candidate)
+                    {
+                        admit = false;
+                        break;
+                    }
+
+                    freed += it->object->size();
+                    victims.emplace_back(it);
+                }
+            }
+
+            if (admit)
+            {
+                for (auto &victim : victims)
+                {
+                    m_memoryBytes -= victim->object->size();
+                    m_memoryIndex.erase(victim->key);
+                    demoted.emplace_back(std::move(*victim));
+                    m_memory.erase(victim);
+                }
+
+                m_memory.push_front(Entry {
+                    .key = key,
+                    .hash = hash,
+                    .object = object,
+                    .validatedAt = Clock::now(),
+                });
+                m_memoryIndex.emplace(key, m_memory.begin());
+                m_memoryBytes += size;
+            }
+            else
+            {
+                ++m_rejected;
+                demoted.emplace_back(Entry {
+                    .key = key,
+                    .hash = hash,
+                    .object = object,
+                    .validatedAt = Clock::now(),
+                });
+            }
+        }
+
+        removeFiles(unlink);
+
+        if (!m_opts.diskDirectory.empty())
+        {
+            for (auto &entry : demoted)
+                writeToDisk(entry.key, entry.object, entry.validatedAt);
+        }
+    }
+
+    void ObjectCache::writeToDisk(const std::string &key, const Ptr &object,
+        Clock::time_point validatedAt)
+    {
+        if (object->size() > m_opts.diskBytes)
+            return;
+
+        auto path = (std::filesystem::path(m_opts.diskDirectory) /
+            fileName(key, ++m_fileCount)).string();
+
+        // Write beside the final path first, so a partial file is never
+        // mapped
+        auto temp = path + ".tmp";
+        {
+            std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+            file.write(object->data().data(),
+                (std::streamsize)object->size());
+            if (!file)
+            {
+                file.close();
+                std::remove(temp.c_str());
+                IN_ERR("Failed to write cached object {} to disk", key);
+                return;
+            }
+        }
+
+        if (std::rename(temp.c_str(), path.c_str()) != 0)
+        {
+            std::remove(temp.c_str());
+            IN_ERR("Failed to write cached object {} to disk", key);
+            return;
+        }
+
+        std::vector<std::string> unlink;
+        {
+            std::lock_guard lock(m_mutex);
+
+            // Fetched again and admitted to memory in the meantime
+            if (m_memoryIndex.contains(key))
+            {
+                unlink.emplace_back(std::move(path));
+            }
+            else
+            {
+                if (auto it = m_diskIndex.find(key); it != m_diskIndex.end())
+                {
+                    m_diskBytes -= it->second->size;
+                    unlink.emplace_back(std::move(it->second->path));
+                    m_disk.erase(it->second);
+                    m_diskIndex.erase(it);
+                }
+
+                while (!m_disk.empty() &&
+                    m_diskBytes + object->size() > m_opts.diskBytes)
+                {
+                    auto &last = m_disk.back();
+                    m_diskBytes -= last.size;
+                    unlink.emplace_back(std::move(last.path));
+                    m_diskIndex.erase(last.key);
+                    m_disk.pop_back();
+                }
+
+                m_disk.push_front(DiskEntry {
+                    .key = key,
+                    .path = std::move(path),
+                    .etag = object->etag(),
+                    .size = object->size(),
+                    .validatedAt = validatedAt,
+                });
+                m_diskIndex.emplace(key, m_disk.begin());
+                m_diskBytes += object->size();
+            }
+        }
+
+        removeFiles(unlink);
+    }
+
+    void ObjectCache::validated(std::string_view key, const Ptr &object)
+    {
+        std::lock_guard lock(m_mutex);
+        ++m_revalidations;
+
+        auto now = Clock::now();
+        if (auto it = m_memoryIndex.find(key); it != m_memoryIndex.end())
+        {
+            if (it->second->object == object)
+                it->second->validatedAt = now;
+        }
+        else if (auto it = m_diskIndex.find(key); it != m_diskIndex.end())
+        {
+            if (it->second->etag == object->etag())
+                it->second->validatedAt = now;
+        }
+    }
+
+    void ObjectCache::eraseLocked(std::string_view key,
+        std::vector<std::string> &unlink)
+    {
+        if (auto it = m_memoryIndex.find(key); it != m_memoryIndex.end())
+        {
+            m_memoryBytes -= it->second->object->size();
+            m_memory.erase(it->second);
+            m_memoryIndex.erase(it);
+        }
+
+        if (auto it = m_diskIndex.find(key); it != m_diskIndex.end())
+        {
+            m_diskBytes -= it->second->size;
+            unlink.emplace_back(std::move(it->second->path));
+            m_disk.erase(it->second);
+            m_diskIndex.erase(it);
+        }
+    }
+
+    void ObjectCache::erase(std::string_view key)
+    {
+        std::vector<std::string> unlink;
+        {
+            std::lock_guard lock(m_mutex);
+            eraseLocked(key, unlink);
+        }
+
+        removeFiles(unlink);
+    }
+
+    void ObjectCache::clear()
+    {
+        std::vector<std::string> unlink;
+        {
+            std::lock_guard lock(m_mutex);
+            for (auto &entry : m_disk)
+                unlink.emplace_back(std::move(entry.path));
+
+            m_memory.clear();
+            m_memoryIndex.clear();
+            m_memoryBytes = 0;
+            m_disk.clear();
+            m_diskIndex.clear();
+            m_diskBytes = 0;
+        }
+
+        removeFiles(unlink);
+    }
+
+    ObjectCache::Stats ObjectCache::stats() const
+    {
+        std::lock_guard lock(m_mutex);
+        return {
+            .hits = m_hits,
+            .misses = m_misses,
+            .revalidations = m_revalidations,
+            .rejected = m_rejected,
+            .memoryBytes = m_memoryBytes,
+            .memoryObjects = m_memory.size(),
+            .diskBytes = m_diskBytes,
+            .diskObjects = m_disk.size(),
+        };
+    }
+
+    void ObjectCache::record(uint64_t hash)
+    {
+        for (size_t row = 0; row < 4; ++row)
+        {
+            auto &counter = m_sketch[row * m_sketchWidth +
+                (mix(hash + row) & (m_sketchWidth - 1))];
+            if (counter < MaxCount)
+                ++counter;
+        }
+
+        // Age every counter, so keys that were popular long ago give way to
+        // ones popular now
+        if (++m_sketchAdditions >= m_sketchWidth * SampleFactor)
+        {
+            for (auto &counter : m_sketch)
+                counter >>= 1;
+            m_sketchAdditions /= 2;
+        }
+    }
+
+    unsigned ObjectCache::frequency(uint64_t hash) const
+    {
+        unsigned result = MaxCount;
+        for (size_t row = 0; row < 4; ++row)
+        {
+            result = std::min<unsigned>(result, m_sketch[row * m_sketchWidth +
+                (mix(hash + row) & (m_sketchWidth - 1))]);
+        }
+
+        return result;
+    }
+}
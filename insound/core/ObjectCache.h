@@ -0,0 +1,391 @@
+/**
+ * @file ObjectCache.h
+ *
+ * Contains `ObjectCache`, an in-process cache of stored objects, e.g. banks
+ * and stems kept in S3, bounded by a byte budget.
+ */
+#pragma once
+#include <insound/core/SingleFlight.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Insound {
+
+    /**
+     * Cache of objects fetched from a store, by their key in the store.
+     *
+     * Objects are kept in memory in LRU order within a byte budget. A new
+     * object only displaces others if it was requested more often than each
+     * of them recently, as estimated by a count-min sketch (TinyLFU). So a
+     * large object fetched once can't flush many popular small ones.
+     *
+     * Concurrent misses for the same key share one fetch. Cached objects are
+     * revalidated against the store by ETag once they are older than
+     * `Opts::revalidateAfter`.
+     *
+     * Optionally, objects leaving memory or turned away from it are written
+     * to a directory with its own budget, and served from there with mmap,
+     * where the OS page cache keeps the hot ones in memory.
+     *
+     * All functions may be called concurrently from any thread.
+     */
+    class ObjectCache
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /**
+         * A cached object, shared read-only with callers. Its data stays
+         * valid for as long as it is held, even after it leaves the cache.
+         */
+        class Object
+        {
+        public:
+            Object(std::string data, std::string etag);
+            ~Object();
+
+            Object(const Object &) = delete;
+            Object &operator=(const Object &) = delete;
+
+            /**
+             * Map a file read-only
+             *
+             * @param path - path of the file
+             * @param etag - etag of the object stored in the file
+             *
+             * @return the object, or null if the file could not be mapped.
+             */
+            [[nodiscard]]
+            static std::shared_ptr<const Object> map(const std::string &path,
+                std::string etag);
+
+            [[nodiscard]]
+            std::string_view data() const { return m_data; }
+
+            [[nodiscard]]
+            const std::string &etag() const { return m_etag; }
+
+            [[nodiscard]]
+            size_t size() const { return m_data.size(); }
+
+            /**
+             * Whether the data is mapped from a file on disk
+             */
+            [[nodiscard]]
+            bool mapped() const { return m_mapping != nullptr; }
+
+        private:
+            Object() : m_buffer(), m_data(), m_etag(), m_mapping(),
+                m_mappingSize() { }
+
+            std::string m_buffer;
+            std::string_view m_data;
+            std::string m_etag;
+            void *m_mapping;
+            size_t m_mappingSize;
+        };
+
+        using Ptr = std::shared_ptr<const Object>;
+
+        /**
+         * Result of a fetch from the store
+         */
+        struct Fetched
+        {
+            /**
+             * Data of the object. Empty if it was not modified.
+             */
+            std::string data;
+
+            /**
+             * Current etag of the object
+             */
+            std::string etag;
+
+            /**
+             * False if the object still matches the etag given to the fetch
+             */
+            bool modified = true;
+        };
+
+        /**
+         * Fetches an object from the store. Called on the thread of the
+         * `get` that missed.
+         *
+         * @param key  - key of the object
+         * @param etag - etag of the cached copy to revalidate, empty to
+         *               always fetch the data
+         *
+         * @return the object, or nothing if it does not exist. Throw if it
+         *         could not be fetched, so a cached copy is not dropped for
+         *         a store that is briefly unreachable.
+         */
+        using Fetch = std::function<std::optional<Fetched>(std::string_view key,
+            std::string_view etag)>;
+
+        struct Opts
+        {
+            /**
+             * Total bytes of objects held in memory
+             */
+            size_t memoryBytes = 256ull * 1024 * 1024;
+
+            /**
+             * Objects larger than this are never held in memory
+             */
+            size_t maxObjectBytes = 64ull * 1024 * 1024;
+
+            /**
+             * How long a cached object is served before it is revalidated
+             * against the store
+             */
+            std::chrono::milliseconds revalidateAfter{60000};
+
+            /**
+             * Directory of the disk tier. Cache files left in it are removed
+             * on construction, other files are kept. Empty disables the disk
+             * tier.
+             */
+            std::string diskDirectory;
+
+            /**
+             * Total bytes of objects held on disk
+             */
+            size_t diskBytes = 4ull * 1024 * 1024 * 1024;
+        };
+
+        struct Stats
+        {
+            /**
+             * Gets served without fetching the object's data
+             */
+            size_t hits;
+
+            /**
+             * Gets that fetched the object's data
+             */
+            size_t misses;
+
+            /**
+             * Objects the store confirmed were unchanged
+             */
+            size_t revalidations;
+
+            /**
+             * Fetched objects turned away from memory, because they were too
+             * large or were not requested as often as the ones they would
+             * have displaced
+             */
+            size_t rejected;
+
+            size_t memoryBytes;
+            size_t memoryObjects;
+            size_t diskBytes;
+            size_t diskObjects;
+        };
+
+        /**
+         * @param fetch - fetches objects from the store
+         */
+        explicit ObjectCache(Fetch fetch);
+
+        /**
+         * @param fetch - fetches objects from the store
+         * @param opts  - budgets and revalidation settings
+         */
+        ObjectCache(Fetch fetch, Opts opts);
+
+        /**
+         * Removes the files of the disk tier
+         */
+        ~ObjectCache();
+
+        ObjectCache(const ObjectCache &) = delete;
+        ObjectCache &operator=(const ObjectCache &) = delete;
+
+        /**
+         * Get an object, fetching it from the store on a miss, or when the
+         * cached copy is due for revalidation
+         *
+         * @param key - key of the object in the store
+         *
+         * @return the object, or null if it does not exist.
+         *
+         * @throws whatever the fetch throws, unless there is a cached copy to
+         *         keep serving until the next revalidation.
+         */
+        [[nodiscard]]
+        Ptr get(std::string_view key);
+
+        /**
+         * Get an object only if it is cached and not due for revalidation.
+         * Never fetches, so on null the caller may fetch the object another
+         * way, or call `get`. Only a hit counts as a request.
+         *
+         * @param key - key of the object in the store
+         */
+        [[nodiscard]]
+        Ptr peek(std::string_view key);
+
+        /**
+         * Check whether an object of a size could be cached, in memory or on
+         * disk. Larger ones are fetched in full by every `get`.
+         *
+         * @param size - size of the object in bytes
+         */
+        [[nodiscard]]
+        bool holds(size_t size) const;
+
+        /**
+         * Drop an object, e.g. after it was overwritten in or deleted from
+         * the store. Callers still holding it keep their copy.
+         */
+        void erase(std::string_view key);
+
+        /**
+         * Drop all objects
+         */
+        void clear();
+
+        [[nodiscard]]
+        Stats stats() const;
+
+        [[nodiscard]]
+        const Opts &opts() const { return m_opts; }
+
+    private:
+        struct Entry
+        {
+            std::string key;
+            uint64_t hash;
+            Ptr object;
+            Clock::time_point validatedAt;
+        };
+
+        struct DiskEntry
+        {
+            std::string key;
+            std::string path;
+            std::string etag;
+            size_t size;
+            Clock::time_point validatedAt;
+        };
+
+        struct StringHash
+        {
+            using is_transparent = void;
+            size_t operator()(std::string_view str) const
+            {
+                return std::hash<std::string_view>{}(str);
+            }
+        };
+
+        template <typename T>
+        using Index = std::unordered_map<std::string,
+            typename std::list<T>::iterator, StringHash, std::equal_to<>>;
+
+        /**
+         * Look an object up in both tiers. A hit counts as a request.
+         *
+         * @param stale - receives a cached copy that is due for
+         *                revalidation
+         *
+         * @return the object, or null if it is not cached or is due for
+         *         revalidation.
+         */
+        Ptr find(std::string_view key, uint64_t hash, Ptr &stale);
+
+        /**
+         * Fetch an object and cache it
+         *
+         * @param stale - cached copy to revalidate, or null
+         */
+        Ptr load(const std::string &key, uint64_t hash, const Ptr &stale);
+
+        /**
+         * Cache a fetched object, in memory if it is admitted, otherwise on
+         * disk
+         */
+        void insert(const std::string &key, uint64_t hash, const Ptr &object);
+
+        /**
+         * Write an object to the disk tier
+         *
+         * @param validatedAt - when the store last confirmed the object, so
+         *                      one demoted from memory is not served for
+         *                      longer than `revalidateAfter`
+         */
+        void writeToDisk(const std::string &key, const Ptr &object,
+            Clock::time_point validatedAt);
+
+        /**
+         * Mark a cached object as confirmed by the store
+         */
+        void validated(std::string_view key, const Ptr &object);
+
+        /**
+         * Remove a key from both tiers. Must be called with m_mutex locked.
+         *
+         * @param unlink - receives the paths of files to remove
+         */
+        void eraseLocked(std::string_view key,
+            std::vector<std::string> &unlink);
+
+        /**
+         * Count a request for a key in the frequency sketch. Must be called
+         * with m_mutex locked.
+         */
+        void record(uint64_t hash);
+
+        /**
+         * Estimate the recent number of requests for a key. Must be called
+         * with m_mutex locked.
+         */
+        [[nodiscard]]
+        unsigned frequency(uint64_t hash) const;
+
+        Fetch m_fetch;
+        Opts m_opts;
+
+        mutable std::mutex m_mutex;
+
+        // Memory tier, most recently used first
+        std::list<Entry> m_memory;
+        Index<Entry> m_memoryIndex;
+        size_t m_memoryBytes;
+
+        // Disk tier, most recently used first
+        std::list<DiskEntry> m_disk;
+        Index<DiskEntry> m_diskIndex;
+        size_t m_diskBytes;
+
+        // Count-min sketch of request frequency, with four rows of
+        // m_sketchWidth counters
+        std::vector<uint8_t> m_sketch;
+        size_t m_sketchWidth;
+        size_t m_sketchAdditions;
+
+        // Makes each disk file name unique, so a file being replaced is
+        // never removed out from under its successor
+        std::atomic<uint64_t> m_fileCount;
+
+        SingleFlight<std::string, Ptr> m_flights;
+
+        size_t m_hits;
+        size_t m_misses;
+        size_t m_revalidations;
+        size_t m_rejected;
+    };
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include <insound/core/json.h>
+#include <insound/core/ObjectCache.h>
+
+IN_JSON_META(Insound::ObjectCache::Stats,
+    hits, misses, revalidations, rejected, memoryBytes, memoryObjects,
+    diskBytes, diskObjects);
@@ -0,0 +1,31 @@
+/**
+ * @file Pcm.h
+ *
+ * Contains `Pcm`, decoded audio held in memory.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Insound {
+
+    /**
+     * Interleaved 16-bit audio samples
+     */
+    struct Pcm
+    {
+        unsigned channels = 0;
+        unsigned sampleRate = 0;
+        std::vector<int16_t> samples;
+
+        /**
+         * Number of samples per channel
+         */
+        [[nodiscard]]
+        size_t frames() const
+        {
+            return channels ? samples.size() / channels : 0;
+        }
+    };
+}
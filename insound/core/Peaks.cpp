@@ -0,0 +1,327 @@
+#include "Peaks.h"
+
+#include <insound/core/BankBuilder.h>
+#include <insound/core/platform.h>
+#include <insound/core/s3.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#if defined(INSOUND_CPU_X86_64)
+#include <immintrin.h>
+#elif defined(INSOUND_CPU_ARM64)
+#include <arm_neon.h>
+#endif
+
+namespace Insound::Peaks {
+
+    /**
+     * Amplitude stats of a run of samples, mergeable with neighboring runs
+     */
+    struct Summary
+    {
+        int16_t min;
+        int16_t max;
+        uint64_t squares;
+        uint64_t count;
+
+        void merge(const Summary &other)
+        {
+            min = std::min(min, other.min);
+            max = std::max(max, other.max);
+            squares += other.squares;
+            count += other.count;
+        }
+
+        [[nodiscard]]
+        Bin bin() const
+        {
+            if (count == 0) return {0, 0, 0};
+
+            auto rms = std::sqrt((double)squares / (double)count);
+            return {min, max, (uint16_t)std::min(std::lround(rms), 32768l)};
+        }
+    };
+
+    static Summary summarizeScalar(const int16_t *samples, size_t count)
+    {
+        Summary summary{INT16_MAX, INT16_MIN, 0, count};
+        for (size_t i = 0; i < count; ++i)
+        {
+            int32_t sample = samples[i];
+            summary.min = std::min<int16_t>(summary.min, samples[i]);
+            summary.max = std::max<int16_t>(summary.max, samples[i]);
+            summary.squares += (uint64_t)(sample * sample);
+        }
+
+        return summary;
+    }
+
+#if defined(INSOUND_CPU_X86_64)
+    // AVX2 is not part of the x86_64 baseline, so check for it at runtime
+    static const bool HasAvx2 = __builtin_cpu_supports("avx2");
+
+    /**
+     * Add the products of `pmaddwd` to two 64-bit lanes. Each product is a
+     * sum of two squares, which fits in 32 bits unsigned, but not signed.
+     */
+    static __m128i addSquares(__m128i acc, __m128i squares)
+    {
+        auto zero = _mm_setzero_si128();
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(squares, zero));
+        return _mm_add_epi64(acc, _mm_unpackhi_epi32(squares, zero));
+    }
+
+    /**
+     * Reduce 8-lane min, max and 2-lane square sums into a summary
+     */
+    static Summary reduce(__m128i min, __m128i max, __m128i squares,
+        size_t count)
+    {
+        // Min and max across lanes, by folding the upper half onto the lower
+        min = _mm_min_epi16(min, _mm_srli_si128(min, 8));
+        max = _mm_max_epi16(max, _mm_srli_si128(max, 8));
+        min = _mm_min_epi16(min, _mm_srli_si128(min, 4));
+        max = _mm_max_epi16(max, _mm_srli_si128(max, 4));
+        min = _mm_min_epi16(min, _mm_srli_si128(min, 2));
+        max = _mm_max_epi16(max, _mm_srli_si128(max, 2));
+
+        uint64_t lanes[2];
+        _mm_storeu_si128((__m128i *)lanes, squares);
+
+        return {
+            (int16_t)_mm_extract_epi16(min, 0),
+            (int16_t)_mm_extract_epi16(max, 0),
+            lanes[0] + lanes[1],
+            count,
+        };
+    }
+
+    static Summary summarizeSse2(const int16_t *samples, size_t count)
+    {
+        auto min = _mm_set1_epi16(INT16_MAX);
+        auto max = _mm_set1_epi16(INT16_MIN);
+        auto squares = _mm_setzero_si128();
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            auto v = _mm_loadu_si128((const __m128i *)(samples + i));
+            min = _mm_min_epi16(min, v);
+            max = _mm_max_epi16(max, v);
+            squares = addSquares(squares, _mm_madd_epi16(v, v));
+        }
+
+        auto summary = reduce(min, max, squares, i);
+        if (i < count)
+            summary.merge(summarizeScalar(samples + i, count - i));
+        return summary;
+    }
+
+    __attribute__((target("avx2")))
+    static Summary summarizeAvx2(const int16_t *samples, size_t count)
+    {
+        auto min = _mm256_set1_epi16(INT16_MAX);
+        auto max = _mm256_set1_epi16(INT16_MIN);
+        auto squares = _mm256_setzero_si256();
+        auto zero = _mm256_setzero_si256();
+
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            auto v = _mm256_loadu_si256((const __m256i *)(samples + i));
+            min = _mm256_min_epi16(min, v);
+            max = _mm256_max_epi16(max, v);
+
+            auto products = _mm256_madd_epi16(v, v);
+            squares = _mm256_add_epi64(squares,
+                _mm256_unpacklo_epi32(products, zero));
+            squares = _mm256_add_epi64(squares,
+                _mm256_unpackhi_epi32(products, zero));
+        }
+
+        auto summary = reduce(
+            _mm_min_epi16(_mm256_castsi256_si128(min),
+                _mm256_extracti128_si256(min, 1)),
+            _mm_max_epi16(_mm256_castsi256_si128(max),
+                _mm256_extracti128_si256(max, 1)),
+            _mm_add_epi64(_mm256_castsi256_si128(squares),
+                _mm256_extracti128_si256(squares, 1)),
+            i);
+        if (i < count)
+            summary.merge(summarizeSse2(samples + i, count - i));
+        return summary;
+    }
+
+#elif defined(INSOUND_CPU_ARM64)
+    static Summary summarizeNeon(const int16_t *samples, size_t count)
+    {
+        auto min = vdupq_n_s16(INT16_MAX);
+        auto max = vdupq_n_s16(INT16_MIN);
+        auto squares = vdupq_n_s64(0);
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            auto v = vld1q_s16(samples + i);
+            min = vminq_s16(min, v);
+            max = vmaxq_s16(max, v);
+
+            // Each square fits in 31 bits, so signed lanes are safe
+            squares = vpadalq_s32(squares,
+                vmull_s16(vget_low_s16(v), vget_low_s16(v)));
+            squares = vpadalq_s32(squares, vmull_high_s16(v, v));
+        }
+
+        Summary summary{vminvq_s16(min), vmaxvq_s16(max),
+            (uint64_t)vaddvq_s64(squares), i};
+        if (i < count)
+            summary.merge(summarizeScalar(samples + i, count - i));
+        return summary;
+    }
+#endif
+
+    /**
+     * Get the amplitude stats of contiguous samples
+     */
+    static Summary summarize(const int16_t *samples, size_t count)
+    {
+        if (count == 0)
+            return {0, 0, 0, 0};
+
+#if defined(INSOUND_CPU_X86_64)
+        return HasAvx2 ? summarizeAvx2(samples, count) :
+            summarizeSse2(samples, count);
+#elif defined(INSOUND_CPU_ARM64)
+        return summarizeNeon(samples, count);
+#else
+        return summarizeScalar(samples, count);
+#endif
+    }
+
+    std::string compute(const Pcm &pcm, const PeaksOpts &opts)
+    {
+        const size_t channels = std::max(pcm.channels, 1u);
+        const size_t frames = pcm.frames();
+        const size_t binSize = std::max<uint32_t>(opts.binSize, 1);
+        const size_t minBins = std::max<uint32_t>(opts.minBins, 1);
+
+        // Finest level, bin-major like the file's level data
+        std::vector<std::vector<Summary>> levels(1);
+        auto &finest = levels[0];
+        finest.resize((frames + binSize - 1) / binSize * channels);
+
+        std::vector<int16_t> channel(pcm.channels > 1 ? frames : 0);
+        for (size_t c = 0; c < channels; ++c)
+        {
+            // Deinterleave, so bins are contiguous for the kernels
+            const int16_t *samples = pcm.samples.data();
+            if (pcm.channels > 1)
+            {
+                for (size_t i = 0; i < frames; ++i)
+                    channel[i] = pcm.samples[i * channels + c];
+                samples = channel.data();
+            }
+
+            for (size_t start = 0, bin = 0; start < frames;
+                start += binSize, ++bin)
+            {
+                finest[bin * channels + c] = summarize(samples + start,
+                    std::min(binSize, frames - start));
+            }
+        }
+
+        // Halve the resolution until the level is small enough
+        while (levels.back().size() / channels > minBins)
+        {
+            const auto &prev = levels.back();
+            auto prevBins = prev.size() / channels;
+
+            std::vector<Summary> level((prevBins + 1) / 2 * channels);
+            for (size_t bin = 0; bin < prevBins; ++bin)
+            {
+                for (size_t c = 0; c < channels; ++c)
+                {
+                    auto &summary = level[bin / 2 * channels + c];
+                    if (bin % 2 == 0)
+                        summary = prev[bin * channels + c];
+                    else
+                        summary.merge(prev[bin * channels + c]);
+                }
+            }
+
+            levels.emplace_back(std::move(level));
+        }
+
+        // Lay out the file
+        FileHeader header{};
+        std::memcpy(header.magic, Magic, sizeof(Magic));
+        header.version = Version;
+        header.channels = (uint16_t)channels;
+        header.sampleRate = pcm.sampleRate;
+        header.levelCount = (uint32_t)levels.size();
+        header.frames = frames;
+
+        size_t size = sizeof(FileHeader) + levels.size() * sizeof(LevelHeader);
+        std::vector<LevelHeader> levelHeaders(levels.size());
+        for (size_t i = levels.size(); i-- > 0;)
+        {
+            levelHeaders[i] = {
+                .samplesPerBin = (uint32_t)(binSize << i),
+                .bins = (uint32_t)(levels[i].size() / channels),
+                .offset = size,
+            };
+            size += levels[i].size() * sizeof(Bin);
+        }
+
+        std::string file(size, '\0');
+        auto out = file.data();
+        std::memcpy(out, &header, sizeof(header));
+        std::memcpy(out + sizeof(header), levelHeaders.data(),
+            levelHeaders.size() * sizeof(LevelHeader));
+
+        for (size_t i = 0; i < levels.size(); ++i)
+        {
+            auto pos = out + levelHeaders[i].offset;
+            for (auto &summary : levels[i])
+            {
+                auto bin = summary.bin();
+                std::memcpy(pos, &bin, sizeof(Bin));
+                pos += sizeof(Bin);
+            }
+        }
+
+        return file;
+    }
+
+    std::string fromFile(std::string_view file, const PeaksOpts &opts)
+    {
+        Pcm pcm;
+        auto result = BankBuilder::decode(file.data(), (unsigned)file.size(),
+            pcm);
+        if (result != BankBuilder::OK)
+            throw std::runtime_error(sf("Failed to decode stem: {}", result));
+
+        return compute(pcm, opts);
+    }
+
+    std::string key(std::string_view stemKey)
+    {
+        return sf("{}.peaks", stemKey);
+    }
+
+    bool store(std::string_view stemKey, std::string_view file)
+    {
+        try {
+            return S3::uploadFile(key(stemKey), fromFile(file));
+        }
+        catch (const std::exception &e)
+        {
+            IN_ERR("Failed to store peaks of \"{}\": {}", stemKey, e.what());
+            return false;
+        }
+    }
+}
@@ -0,0 +1,119 @@
+/**
+ * @file Peaks.h
+ *
+ * Contains functions to compute waveform overviews of audio stems, so clients
+ * can draw waveforms without downloading and decoding the stems themselves.
+ *
+ * An overview is a pyramid of levels. Each level splits the audio into bins
+ * of a fixed number of samples, holding each channel's min, max and RMS
+ * amplitude per bin. Each level's bins are twice as wide as the previous
+ * one's.
+ *
+ * Binary format, all values little-endian:
+ *   FileHeader
+ *   LevelHeader[levelCount]  - finest level first
+ *   level data               - coarsest level first, so a client can draw
+ *                              a first pass from the start of the file
+ *
+ * A level's data is `bins * channels` `Bin`s, ordered by bin, then channel.
+ */
+#pragma once
+#include <insound/core/Pcm.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Insound::Peaks {
+
+    inline constexpr char Magic[4] = {'I', 'N', 'P', 'K'};
+    inline constexpr uint16_t Version = 1;
+
+    struct FileHeader
+    {
+        char magic[4];
+        uint16_t version;
+        uint16_t channels;
+        uint32_t sampleRate;
+        uint32_t levelCount;
+        // Samples per channel in the source audio
+        uint64_t frames;
+    };
+    static_assert(sizeof(FileHeader) == 24);
+
+    struct LevelHeader
+    {
+        uint32_t samplesPerBin;
+        uint32_t bins;
+        // Byte offset of the level's data from the start of the file
+        uint64_t offset;
+    };
+    static_assert(sizeof(LevelHeader) == 16);
+
+    struct Bin
+    {
+        int16_t min;
+        int16_t max;
+        // Root mean square amplitude, from 0 to 32768
+        uint16_t rms;
+    };
+    static_assert(sizeof(Bin) == 6);
+
+    struct PeaksOpts
+    {
+        /**
+         * Samples per bin in the finest level
+         */
+        uint32_t binSize = 256;
+
+        /**
+         * Levels are added until one has no more than this many bins
+         */
+        uint32_t minBins = 512;
+    };
+
+    /**
+     * Compute the overview of decoded audio
+     *
+     * @param pcm  - audio to summarize
+     * @param opts - level sizes
+     *
+     * @return the overview in the binary format described above.
+     */
+    [[nodiscard]]
+    std::string compute(const Pcm &pcm, const PeaksOpts &opts = {});
+
+    /**
+     * Decode an audio file and compute its overview. FSBank must be
+     * initialized via `BankBuilder::initLibrary`.
+     *
+     * @param file - audio file data in any format FSBank reads
+     * @param opts - level sizes
+     *
+     * @return the overview in the binary format described above.
+     *
+     * @throws std::runtime_error if the file could not be decoded.
+     */
+    [[nodiscard]]
+    std::string fromFile(std::string_view file, const PeaksOpts &opts = {});
+
+    /**
+     * Get the S3 key of a stem's overview, which is stored next to it
+     *
+     * @param stemKey - S3 key of the stem
+     */
+    [[nodiscard]]
+    std::string key(std::string_view stemKey);
+
+    /**
+     * Compute a stem's overview and store it in S3 next to the stem. Meant to
+     * be called at upload time, while the stem's data is still in memory.
+     *
+     * @param stemKey - S3 key of the stem
+     * @param file    - audio file data of the stem
+     *
+     * @return whether the overview was stored.
+     */
+    bool store(std::string_view stemKey, std::string_view file);
+}
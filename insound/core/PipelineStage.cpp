@@ -0,0 +1,102 @@
+#include "PipelineStage.h"
+
+#include <insound/core/Workers.h>
+
+#include <algorithm>
+
+namespace Insound {
+
+    PipelineStage::PipelineStage(std::string_view pool, size_t capacity) :
+        PipelineStage(Workers::get(pool), capacity)
+    { }
+
+    PipelineStage::PipelineStage(ThreadPool &pool, size_t capacity) :
+        m_pool(pool), m_capacity(std::max<size_t>(capacity, 1)),
+        m_mutex(), m_cond(), m_pending(), m_cancelled(), m_error()
+    { }
+
+    PipelineStage::~PipelineStage()
+    {
+        cancel();
+
+        std::unique_lock lock(m_mutex);
+        m_cond.wait(lock, [this]() { return m_pending == 0; });
+    }
+
+    bool PipelineStage::push(std::function<void()> item)
+    {
+        {
+            std::unique_lock lock(m_mutex);
+            m_cond.wait(lock, [this]() {
+                return m_pending < m_capacity || m_cancelled || m_error;
+            });
+
+            if (m_cancelled || m_error)
+                return false;
+            ++m_pending;
+        }
+
+        try {
+            (void)m_pool.submit([this, item = std::move(item)]() {
+                run(item);
+            });
+        }
+        catch (...)
+        {
+            std::lock_guard lock(m_mutex);
+            --m_pending;
+            m_cond.notify_all();
+            throw;
+        }
+
+        return true;
+    }
+
+    void PipelineStage::run(const std::function<void()> &item)
+    {
+        bool skip;
+        {
+            std::lock_guard lock(m_mutex);
+            skip = m_cancelled || m_error;
+        }
+
+        if (!skip)
+        {
+            try {
+                item();
+            }
+            catch (...)
+            {
+                std::lock_guard lock(m_mutex);
+                if (!m_error)
+                    m_error = std::current_exception();
+            }
+        }
+
+        std::lock_guard lock(m_mutex);
+        --m_pending;
+        m_cond.notify_all();
+    }
+
+    void PipelineStage::wait()
+    {
+        std::unique_lock lock(m_mutex);
+        m_cond.wait(lock, [this]() { return m_pending == 0; });
+
+        if (m_error)
+            std::rethrow_exception(m_error);
+    }
+
+    void PipelineStage::cancel()
+    {
+        std::lock_guard lock(m_mutex);
+        m_cancelled = true;
+        m_cond.notify_all();
+    }
+
+    bool PipelineStage::failed() const
+    {
+        std::lock_guard lock(m_mutex);
+        return (bool)m_error;
+    }
+}
@@ -0,0 +1,96 @@
+/**
+ * @file PipelineStage.h
+ *
+ * Contains `PipelineStage`, a bounded queue of work in front of a worker
+ * pool, used to chain the stages of a pipeline.
+ */
+#pragma once
+#include <insound/core/ThreadPool.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string_view>
+
+namespace Insound {
+
+    /**
+     * Runs items on a pool, with at most `capacity` items queued or running
+     * at once. A producer faster than the stage waits in `push`, instead of
+     * piling up work, and the memory it holds, ahead of the stage.
+     *
+     * Once an item throws, the stage fails: items not yet started are
+     * skipped, later pushes are refused, and `wait` rethrows the error.
+     */
+    class PipelineStage
+    {
+    public:
+        /**
+         * @param pool     - name of the pool running the items, see `Workers`
+         * @param capacity - number of items that may be queued or running at
+         *                   once
+         */
+        PipelineStage(std::string_view pool, size_t capacity);
+
+        /**
+         * @param pool     - pool running the items, which must outlive the
+         *                   stage
+         * @param capacity - number of items that may be queued or running at
+         *                   once
+         */
+        PipelineStage(ThreadPool &pool, size_t capacity);
+
+        /**
+         * Cancels the stage, and waits for items in progress
+         */
+        ~PipelineStage();
+
+        PipelineStage(const PipelineStage &) = delete;
+        PipelineStage &operator=(const PipelineStage &) = delete;
+
+        /**
+         * Queue an item, waiting while the stage is full
+         *
+         * @param item - work to run on the pool
+         *
+         * @return false if the stage failed or was cancelled, in which case
+         *         the item is dropped.
+         *
+         * @throws std::runtime_error if the pool was shut down.
+         */
+        bool push(std::function<void()> item);
+
+        /**
+         * Wait for all queued items to finish
+         *
+         * @throws the exception of the first item that threw.
+         */
+        void wait();
+
+        /**
+         * Skip queued items that have not started, and refuse later ones.
+         * Items in progress finish.
+         */
+        void cancel();
+
+        /**
+         * Whether an item threw
+         */
+        [[nodiscard]]
+        bool failed() const;
+
+    private:
+        void run(const std::function<void()> &item);
+
+        ThreadPool &m_pool;
+        size_t m_capacity;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cond;
+        size_t m_pending;
+        bool m_cancelled;
+        std::exception_ptr m_error;
+    };
+}
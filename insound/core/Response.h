@@ -16,6 +16,7 @@
 #include <glaze/json/write.hpp>
 #include <glaze/util/type_traits.hpp>
 
+#include <algorithm>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -37,14 +38,43 @@ namespace Insound {
         {
         }
 
+        /**
+         * Take ownership of a body without copying it, e.g. a built bank
+         */
+        Response(std::string_view contentType, std::string &&body)
+            : crow::response(contentType.data(), std::move(body))
+        {
+        }
+
         /**
          * Set the body to json data
          */
         template <JSON::Serializable T>
         static Response json(const T &obj, int status = 200)
         {
-            return {status, ContentType::Application::JSON,
-                glz::write_json(obj)};
+            // Buffer size the last body of this type needed on this thread
+            thread_local size_t sizeHint = 0;
+
+            Response res;
+            res.code = status;
+            res.set_header("Content-Type",
+                std::string(ContentType::Application::JSON));
+
+            // Serialize in place, so the body is allocated once with enough
+            // room, then owned by the response without copying. A grown
+            // capacity is kept as the hint, since glaze grows the buffer
+            // past the final size to fit worst-case escaping while writing.
+            // Otherwise the hint decays toward the body size, so one large
+            // body doesn't oversize every later one on this thread.
+            res.body.reserve(sizeHint);
+            auto reserved = res.body.capacity();
+            JSON::stringify(obj, res.body);
+            if (res.body.capacity() > reserved)
+                sizeHint = res.body.capacity();
+            else
+                sizeHint = std::max(res.body.size(), sizeHint - sizeHint / 4);
+
+            return res;
         }
 
         /**
@@ -53,10 +83,36 @@ namespace Insound {
         template <JSON::Serializable T>
         static Response json(const T &obj, HttpStatus status)
         {
-            return {(int)status, ContentType::Application::JSON,
-                glz::write_json(obj)};
+            return json(obj, (int)status);
         }
 
+        /**
+         * Set the body to a constant json string, which is escaped at
+         * compile time.
+         *
+         * @example `Response::json<"Success">()`
+         */
+        template <JSON::FixedString Str>
+        static Response json(int status = 200)
+        {
+            Response res;
+            res.code = status;
+            res.set_header("Content-Type",
+                std::string(ContentType::Application::JSON));
+            res.body = JSON::literal<Str>;
+
+            return res;
+        }
+
+        /**
+         * Set the body to a constant json string, which is escaped at
+         * compile time.
+         */
+        template <JSON::FixedString Str>
+        static Response json(HttpStatus status)
+        {
+            return json<Str>((int)status);
+        }
 
         /**
          * Set both the content-type & body at one time
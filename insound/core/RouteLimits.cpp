@@ -0,0 +1,133 @@
+#include "RouteLimits.h"
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Insound::RouteLimits {
+
+    /**
+     * A registered route path containing url parameters
+     */
+    struct Pattern {
+        std::vector<std::string> segments;
+        RouteLimit limit;
+    };
+
+    // Routes without parameters are looked up directly
+    static std::unordered_map<std::string, RouteLimit> sExact;
+
+    // Routes with parameters are matched segment by segment
+    static std::vector<Pattern> sPatterns;
+
+    /**
+     * Normalize a path so that "api/test/", "/api/test" and "/api//test" all
+     * map to "/api/test"
+     */
+    static std::string normalize(std::string_view path)
+    {
+        std::string res;
+        res.reserve(path.size() + 1);
+
+        for (auto c : path)
+        {
+            if (c == '/' && (res.empty() || res.back() == '/'))
+                continue;
+            if (res.empty())
+                res += '/';
+            res += c;
+        }
+
+        if (res.size() > 1 && res.back() == '/')
+            res.pop_back();
+
+        return res.empty() ? "/" : res;
+    }
+
+    static std::vector<std::string> split(std::string_view path)
+    {
+        std::vector<std::string> res;
+        size_t start = 1; // skip leading '/'
+        while (start < path.size())
+        {
+            auto end = path.find('/', start);
+            if (end == std::string_view::npos)
+                end = path.size();
+            res.emplace_back(path.substr(start, end - start));
+            start = end + 1;
+        }
+
+        return res;
+    }
+
+    static bool matches(const Pattern &pattern, std::string_view url)
+    {
+        size_t start = 1;
+        for (auto &segment : pattern.segments)
+        {
+            if (segment == "<path>")
+                return start < url.size();
+
+            if (start > url.size())
+                return false;
+
+            auto end = url.find('/', start);
+            if (end == std::string_view::npos)
+                end = url.size();
+
+            if (!segment.starts_with('<') &&
+                url.substr(start, end - start) != segment)
+                return false;
+
+            start = end + 1;
+        }
+
+        return start > url.size();
+    }
+
+    void set(std::string_view path, const RouteLimit &limit)
+    {
+        auto normalized = normalize(path);
+        if (normalized.find('<') == std::string::npos)
+        {
+            sExact[normalized] = limit;
+            return;
+        }
+
+        auto segments = split(normalized);
+        for (auto &pattern : sPatterns)
+        {
+            if (pattern.segments == segments)
+            {
+                pattern.limit = limit;
+                return;
+            }
+        }
+
+        sPatterns.emplace_back(Pattern {
+            .segments = std::move(segments),
+            .limit = limit,
+        });
+    }
+
+    const RouteLimit *find(std::string_view url)
+    {
+        auto normalized = normalize(url);
+        if (auto it = sExact.find(normalized); it != sExact.end())
+            return &it->second;
+
+        for (auto &pattern : sPatterns)
+        {
+            if (matches(pattern, normalized))
+                return &pattern.limit;
+        }
+
+        return nullptr;
+    }
+
+    void clear()
+    {
+        sExact.clear();
+        sPatterns.clear();
+    }
+}
@@ -0,0 +1,91 @@
+/**
+ * @file RouteLimits.h
+ *
+ * Contains the `RouteLimits` registry, which stores per-route resource limits
+ * declared by Routers when they register their routes. Middleware looks up
+ * the limits of the current request here via its url.
+ */
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace Insound {
+
+    /**
+     * Token bucket rate limit settings. Each client starts with a full bucket
+     * of `capacity` tokens, which refills at `refillPerSecond`. Every request
+     * takes `cost` tokens, and is rejected when not enough are left.
+     */
+    struct RateLimit {
+        /**
+         * Max tokens a bucket holds, i.e. the allowed burst. 0 disables rate
+         * limiting.
+         */
+        double capacity = 0;
+
+        /**
+         * Tokens added back to the bucket per second
+         */
+        double refillPerSecond = 0;
+
+        /**
+         * Tokens taken per request, so that expensive routes can drain the
+         * bucket faster
+         */
+        double cost = 1;
+
+        [[nodiscard]]
+        bool enabled() const { return capacity > 0 && refillPerSecond > 0; }
+    };
+
+    /**
+     * Limits applied to a single route.
+     */
+    struct RouteLimit {
+        /**
+         * Maximum byte size of the request body. 0 uses the App's default.
+         */
+        size_t maxBodySize = 0;
+
+        /**
+         * Rate limit applied both per client ip and per logged-in user.
+         * Disabled by default.
+         */
+        RateLimit rate{};
+    };
+
+    /**
+     * Registry of route limits. Limits should be registered during App
+     * initialization (e.g. inside `Router::init`), before the server starts
+     * accepting requests. Lookups are safe from any thread afterwards.
+     */
+    namespace RouteLimits {
+
+        /**
+         * Set the limits for a route.
+         *
+         * @param path  - full route path including any blueprint prefix,
+         *                e.g. "/api/test/make-fsb". Crow-style parameters such
+         *                as "<string>" match any single path segment, and
+         *                "<path>" matches the rest of the url.
+         * @param limit - limits to set
+         */
+        void set(std::string_view path, const RouteLimit &limit);
+
+        /**
+         * Find the limits of the route matching `url`.
+         *
+         * @param url - request url, without the query string
+         *
+         * @return pointer to the limits, or nullptr if none were registered.
+         */
+        [[nodiscard]]
+        const RouteLimit *find(std::string_view url);
+
+        /**
+         * Remove all registered limits.
+         */
+        void clear();
+    }
+}
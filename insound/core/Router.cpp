@@ -23,6 +23,11 @@ namespace Insound {
         return bp;
     }
 
+    void Router::limit(std::string_view rule, const RouteLimit &limit)
+    {
+        RouteLimits::set(bp.prefix() + "/" + std::string(rule), limit);
+    }
+
     void Router::catchAll(const crow::request &req, crow::response &res)
     {
         IN_LOG( sf("Hit bp catchall route: {}", req.url) );
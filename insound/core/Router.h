@@ -3,6 +3,7 @@
  * implementing this class.
  */
 #pragma once
+#include <insound/core/RouteLimits.h>
 #include <insound/core/thirdparty/crow.hpp>
 #include <string_view>
 
@@ -23,6 +24,16 @@ namespace Insound {
         crow::Blueprint &config();
 
       protected:
+        /**
+         * Declare limits for one of this router's routes. Call it from `init`
+         * alongside the route's registration.
+         *
+         * @param rule  - the route rule as passed to CROW_BP_ROUTE,
+         *                e.g. "/make-fsb"
+         * @param limit - limits to apply to the route
+         */
+        void limit(std::string_view rule, const RouteLimit &limit);
+
         crow::Blueprint bp;
         RouterOpt opts;
 
@@ -0,0 +1,82 @@
+/**
+ * @file SingleFlight.h
+ *
+ * Contains `SingleFlight`, which collapses concurrent calls for the same key
+ * into one.
+ */
+#pragma once
+#include <exception>
+#include <future>
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace Insound {
+
+    /**
+     * Runs at most one call per key at a time. Callers that arrive while a
+     * call for their key is running wait for it and share its result,
+     * instead of doing the same work again. Results are not kept once the
+     * call finishes, so pair this with a cache to reuse them later.
+     *
+     * @tparam Key   - ordered key type
+     * @tparam Value - result of a call, shared read-only by its callers
+     */
+    template <typename Key, typename Value>
+    class SingleFlight
+    {
+    public:
+        /**
+         * Run a call for a key, or join the one running
+         *
+         * @param key - identifies the call
+         * @param fn  - returns the result. Not called when joining. Anything
+         *              it throws is rethrown to every caller.
+         *
+         * @return the call's result.
+         */
+        template <typename F>
+        std::shared_future<Value> run(const Key &key, F &&fn)
+        {
+            std::promise<Value> promise;
+            std::shared_future<Value> future;
+            {
+                std::lock_guard lock(m_mutex);
+                if (auto it = m_calls.find(key); it != m_calls.end())
+                    return it->second;
+
+                future = promise.get_future().share();
+                m_calls.emplace(key, future);
+            }
+
+            try {
+                promise.set_value(std::forward<F>(fn)());
+            }
+            catch (...)
+            {
+                promise.set_exception(std::current_exception());
+            }
+
+            {
+                std::lock_guard lock(m_mutex);
+                m_calls.erase(key);
+            }
+
+            return future;
+        }
+
+        /**
+         * Check whether a call for a key is running
+         */
+        [[nodiscard]]
+        bool running(const Key &key) const
+        {
+            std::lock_guard lock(m_mutex);
+            return m_calls.count(key) > 0;
+        }
+
+    private:
+        mutable std::mutex m_mutex;
+        std::map<Key, std::shared_future<Value>> m_calls;
+    };
+}
@@ -0,0 +1,192 @@
+#include "StemPipeline.h"
+
+#include <insound/core/BankBuilder.h>
+#include <insound/core/BankJobs.h>
+#include <insound/core/Peaks.h>
+#include <insound/core/PipelineStage.h>
+#include <insound/core/s3.h>
+#include <insound/core/Workers.h>
+
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <optional>
+
+namespace Insound::StemPipeline {
+
+    /**
+     * Encode stems into a bank, on the Bank pool
+     */
+    static std::string encode(const std::deque<Stem> &stems,
+        const EncodeProfile &profile)
+    {
+        return Workers::get(Workers::Bank).submit([&stems, &profile]() {
+            BankBuilder builder;
+            for (auto &stem : stems)
+            {
+                // FSBank only reads the data
+                auto result = builder.addFile(
+                    const_cast<char *>(stem.data.data()),
+                    (unsigned)stem.data.size());
+                if (result != BankBuilder::OK)
+                    throw Rejected(sf("{}: {}", stem.filename, result));
+            }
+
+            auto result = builder.build(profile);
+            if (result != BankBuilder::OK)
+                throw std::runtime_error(sf("Failed to build bank: {}",
+                    result));
+            return builder.release();
+        }).get();
+    }
+
+    /**
+     * Cancel a stage and wait for the items in progress, ignoring their
+     * errors
+     */
+    static void settle(PipelineStage &stage)
+    {
+        stage.cancel();
+        try {
+            stage.wait();
+        }
+        catch (...) { }
+    }
+
+    Result run(MultipartReader &reader, const Opts &opts)
+    {
+        std::deque<Stem> stems; // stable references while stages run
+        std::vector<std::string> stored;
+        std::mutex storedMutex;
+
+        PipelineStage hashing(Workers::Crypto, opts.hashes);
+        PipelineStage uploads(Workers::S3, opts.uploads);
+        PipelineStage overviews(Workers::Bank, opts.overviews);
+
+        Result result;
+        try {
+            // Receive and probe on this thread. The other stages take each
+            // stem as soon as it is read.
+            while (auto part = reader.next())
+            {
+                if (!part->isFile())
+                    continue;
+                if (stems.size() == opts.maxStems)
+                    throw Rejected(sf("Too many files, at most {} are "
+                        "accepted", opts.maxStems));
+                if (part->data.size() > opts.maxStemBytes)
+                    throw Rejected(sf("{}: File is too large",
+                        part->filename));
+
+                auto index = stems.size();
+                auto &stem = stems.emplace_back(Stem{
+                    .name = part->name,
+                    .filename = part->filename,
+                    .data = part->data,
+                    .key = opts.stemKey(index),
+                });
+
+                if (auto error = AudioProbe::read(stem.data, stem.probe))
+                    throw Rejected(sf("{}: {}", stem.filename, error));
+
+                // A push is refused once a stage failed, which `wait`
+                // reports below
+                if (!hashing.push([&stem]() {
+                    stem.hash = BankBuilder::hashFile(stem.data);
+                }))
+                    break;
+
+                if (!uploads.push([&stem, &stored, &storedMutex]() {
+                    if (!S3::uploadFile(stem.key, stem.data))
+                        throw std::runtime_error(sf("Failed to store {}",
+                            stem.filename));
+                    std::lock_guard lock(storedMutex);
+                    stored.emplace_back(stem.key);
+                }))
+                    break;
+
+                if (opts.peaks && !overviews.push(
+                    [&stem, &stored, &storedMutex]() {
+                        if (!Peaks::store(stem.key, stem.data))
+                            throw std::runtime_error(sf("Failed to compute "
+                                "the overview of {}", stem.filename));
+                        std::lock_guard lock(storedMutex);
+                        stored.emplace_back(Peaks::key(stem.key));
+                    }))
+                    break;
+            }
+
+            hashing.wait();
+
+            // Don't encode a batch that failed already
+            if (uploads.failed())
+                uploads.wait();
+            if (overviews.failed())
+                overviews.wait();
+
+            if (stems.empty())
+                throw std::invalid_argument("No files were uploaded");
+            if (stems.size() < opts.minStems)
+                throw Rejected(sf("Too few files, {} are expected",
+                    opts.minStems));
+
+            std::vector<std::string> hashes;
+            hashes.reserve(stems.size());
+            for (auto &stem : stems)
+                hashes.emplace_back(stem.hash);
+            result.buildKey = BankBuilder::buildKey(hashes, opts.profile);
+            result.bankKey = BankJobs::bankKey(result.buildKey);
+
+            // Reuse an identical bank, or encode one while the last stems
+            // are still uploading
+            auto existing = Workers::get(Workers::S3).submit([&result]() {
+                return S3::fileExists(result.bankKey) ?
+                    S3::downloadFile(result.bankKey) :
+                    std::optional<std::string>{};
+            }).get();
+            if (existing)
+            {
+                result.bank = std::move(*existing);
+            }
+            else
+            {
+                result.bank = encode(stems, opts.profile);
+                uploads.push([&result]() {
+                    if (!S3::uploadFile(result.bankKey, result.bank))
+                        throw std::runtime_error("Failed to store bank");
+                });
+            }
+
+            uploads.wait();
+            overviews.wait();
+        }
+        catch (...)
+        {
+            settle(hashing);
+            settle(uploads);
+            settle(overviews);
+
+            // Banks are shared by build key, so only stems and their
+            // overviews are removed
+            if (!stored.empty())
+            {
+                try {
+                    Workers::get(Workers::S3).submit([&stored]() {
+                        return S3::deleteFiles(stored);
+                    }).get();
+                }
+                catch (const std::exception &e)
+                {
+                    IN_ERR("Failed to delete stems of a failed upload: {}",
+                        e.what());
+                }
+            }
+
+            throw;
+        }
+
+        result.stems.assign(std::make_move_iterator(stems.begin()),
+            std::make_move_iterator(stems.end()));
+        return result;
+    }
+}
@@ -0,0 +1,134 @@
+/**
+ * @file StemPipeline.h
+ *
+ * Contains functions to take in a batch of uploaded stems and build their
+ * bank, with storage, probing and encoding overlapping each other.
+ *
+ * Each part of a multipart body passes through stages, each running on its
+ * own pool with a bounded number of items in flight:
+ *
+ *   receive + probe  - calling thread, reads the next part from the body
+ *   hash             - Crypto pool, content hash for the build key
+ *   upload           - S3 pool, stores the original stem
+ *   peaks            - Bank pool, computes and stores the stem's overview
+ *
+ * Once every part was received, the bank is encoded on the Bank pool while
+ * the last stems are still uploading, then stored on the S3 pool. A bank
+ * already stored under the same build key is reused instead.
+ */
+#pragma once
+#include <insound/core/AudioProbe.h>
+#include <insound/core/EncodeProfile.h>
+#include <insound/core/MultipartReader.h>
+
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Insound::StemPipeline {
+
+    /**
+     * Thrown when an uploaded file can't be built into a bank
+     */
+    class Rejected : public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    struct Stem
+    {
+        // Field name of the part
+        std::string_view name;
+
+        // File name the client sent
+        std::string_view filename;
+
+        // Audio file data, referring into the body
+        std::string_view data;
+
+        // S3 key the stem was stored at
+        std::string key;
+
+        // `BankBuilder::hashFile` of the data
+        std::string hash;
+
+        AudioProbe::Probe probe;
+    };
+
+    struct Opts
+    {
+        /**
+         * Get the S3 key to store a stem at, by its index among the body's
+         * files
+         */
+        std::function<std::string(size_t index)> stemKey;
+
+        /**
+         * Profile the bank is encoded with
+         */
+        EncodeProfile profile = EncodeProfiles::standard();
+
+        /**
+         * Files expected. Fewer or more are rejected.
+         */
+        size_t minStems = 1;
+        size_t maxStems = 64;
+
+        /**
+         * Largest file accepted
+         */
+        size_t maxStemBytes = 256 * 1024 * 1024;
+
+        /**
+         * Whether to compute and store each stem's overview
+         */
+        bool peaks = true;
+
+        /**
+         * Items in flight per stage. A stage that is full holds up the ones
+         * before it, so memory stays bounded by these, instead of by the
+         * number of stems.
+         */
+        size_t hashes = 2;
+        size_t uploads = 4;
+        size_t overviews = 2;
+    };
+
+    struct Result
+    {
+        // In the order they appeared in the body
+        std::vector<Stem> stems;
+
+        // `BankBuilder::buildKey` of the stems with the profile
+        std::string buildKey;
+
+        // S3 key the bank is stored at, see `BankJobs::bankKey`
+        std::string bankKey;
+
+        // FSB5 data of the bank
+        std::string bank;
+    };
+
+    /**
+     * Store, probe and build a bank from each file of a multipart body. Text
+     * fields are skipped. Blocks until every stage finished. On failure,
+     * stems stored so far are deleted again.
+     *
+     * @param reader - reader over the body, which must outlive the call
+     * @param opts   - keys, profile and stage sizes
+     *
+     * @return the stems and their bank.
+     *
+     * @throws std::invalid_argument if the body is malformed or holds no
+     *         files.
+     * @throws Rejected if a file is not audio that can be built into a bank,
+     *         is too large, or there are too few or too many files.
+     * @throws std::runtime_error if a stage failed.
+     */
+    [[nodiscard]]
+    Result run(MultipartReader &reader, const Opts &opts);
+}
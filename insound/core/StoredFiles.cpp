@@ -0,0 +1,72 @@
+#include "StoredFiles.h"
+
+#include <insound/core/s3.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace Insound::StoredFiles {
+
+    static std::mutex sMutex;
+    static std::shared_ptr<ObjectCache> sCache;
+
+    static std::optional<ObjectCache::Fetched> fetch(std::string_view key,
+        std::string_view etag)
+    {
+        auto file = S3::downloadIfChanged(key, etag);
+        if (!file)
+            return {};
+
+        return ObjectCache::Fetched{
+            .data = std::move(file->data),
+            .etag = std::move(file->etag),
+            .modified = file->modified,
+        };
+    }
+
+    /**
+     * Get the current cache. Held by callers, so that `configure` does not
+     * free it while in use.
+     */
+    static std::shared_ptr<ObjectCache> cache()
+    {
+        std::lock_guard lock(sMutex);
+        if (!sCache)
+            sCache = std::make_shared<ObjectCache>(fetch);
+        return sCache;
+    }
+
+    void configure(const ObjectCache::Opts &opts)
+    {
+        auto cache = std::make_shared<ObjectCache>(fetch, opts);
+
+        std::lock_guard lock(sMutex);
+        sCache = std::move(cache);
+    }
+
+    ObjectCache::Ptr get(std::string_view key)
+    {
+        return cache()->get(key);
+    }
+
+    ObjectCache::Ptr peek(std::string_view key)
+    {
+        return cache()->peek(key);
+    }
+
+    bool holds(uint64_t size)
+    {
+        return size <= SIZE_MAX && cache()->holds((size_t)size);
+    }
+
+    void invalidate(std::string_view key)
+    {
+        cache()->erase(key);
+    }
+
+    ObjectCache::Stats stats()
+    {
+        return cache()->stats();
+    }
+}
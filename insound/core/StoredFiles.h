@@ -0,0 +1,69 @@
+/**
+ * @file StoredFiles.h
+ *
+ * Contains functions to read files stored in S3 through an in-process
+ * `ObjectCache`, so that popular banks and stems are not downloaded on every
+ * request.
+ */
+#pragma once
+#include <insound/core/ObjectCache.h>
+
+#include <string_view>
+
+namespace Insound::StoredFiles {
+
+    /**
+     * Replace the cache with one using `opts`. Files cached so far are
+     * dropped. Until this is called, a cache with default options is used.
+     *
+     * @param opts - budgets, revalidation and disk tier settings
+     */
+    void configure(const ObjectCache::Opts &opts);
+
+    /**
+     * Get a stored file, downloading it from S3 on the calling thread on a
+     * miss. Call it from the S3 pool.
+     *
+     * @param key - S3 key of the file
+     *
+     * @return the file, or null if it does not exist.
+     *
+     * @throws AwsS3Error if the file could not be downloaded, and there is no
+     *         cached copy to serve instead.
+     */
+    [[nodiscard]]
+    ObjectCache::Ptr get(std::string_view key);
+
+    /**
+     * Get a stored file only if it is cached and not due for revalidation,
+     * see `ObjectCache::peek`. Never downloads.
+     *
+     * @param key - S3 key of the file
+     */
+    [[nodiscard]]
+    ObjectCache::Ptr peek(std::string_view key);
+
+    /**
+     * Check whether a file of a size could be cached. Larger ones are
+     * downloaded in full by every `get`, so ranges of them are better
+     * downloaded on their own.
+     *
+     * @param size - size of the file in bytes
+     */
+    [[nodiscard]]
+    bool holds(uint64_t size);
+
+    /**
+     * Drop a file from the cache, e.g. after overwriting or deleting it in
+     * S3, so other requests don't wait for revalidation to see the change
+     *
+     * @param key - S3 key of the file
+     */
+    void invalidate(std::string_view key);
+
+    /**
+     * Get hit rates and sizes of the cache
+     */
+    [[nodiscard]]
+    ObjectCache::Stats stats();
+}
@@ -0,0 +1,144 @@
+#include "ThreadPool.h"
+
+#include <insound/core/log.h>
+#include <insound/core/platform.h>
+
+#include <stdexcept>
+
+#if defined(INSOUND_PLATFORM_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace Insound {
+
+    /**
+     * Pin a thread to a cpu. Only supported on Linux, other platforms only
+     * log a warning.
+     */
+    static void pinThread(std::thread &thread, unsigned cpu,
+        std::string_view poolName)
+    {
+    #if defined(INSOUND_PLATFORM_LINUX)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        auto result = pthread_setaffinity_np(thread.native_handle(),
+            sizeof(cpu_set_t), &set);
+        if (result != 0)
+            IN_WARN("ThreadPool \"{}\": failed to pin thread to cpu {}",
+                poolName, cpu);
+    #else
+        IN_WARN("ThreadPool \"{}\": cpu pinning is not supported on this "
+            "platform", poolName);
+    #endif
+    }
+
+    ThreadPool::ThreadPool(std::string_view name, unsigned threads,
+        const std::vector<unsigned> &cpus) :
+        m_name(name), m_threads(), m_tasks(), m_mutex(), m_cond(),
+        m_stopping(false), m_active(), m_completed(), m_busyNanos(),
+        m_startTime(std::chrono::steady_clock::now())
+    {
+        if (threads == 0)
+            threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+        m_threads.reserve(threads);
+        for (unsigned i = 0; i < threads; ++i)
+        {
+            auto &thread = m_threads.emplace_back(&ThreadPool::work, this);
+            if (!cpus.empty())
+                pinThread(thread, cpus[i % cpus.size()], m_name);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        shutdown(false);
+    }
+
+    void ThreadPool::push(std::function<void()> &&task)
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            if (m_stopping)
+                throw std::runtime_error(sf("ThreadPool \"{}\" was shut down",
+                    m_name));
+            m_tasks.emplace_back(std::move(task));
+        }
+
+        m_cond.notify_one();
+    }
+
+    void ThreadPool::work()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock lock(m_mutex);
+                m_cond.wait(lock, [this]() {
+                    return m_stopping || !m_tasks.empty();
+                });
+
+                if (m_tasks.empty()) // stopping and fully drained
+                    return;
+
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+
+            ++m_active;
+            auto start = std::chrono::steady_clock::now();
+
+            task(); // packaged_task stores exceptions in its future
+
+            m_busyNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            ++m_completed;
+            --m_active;
+        }
+    }
+
+    void ThreadPool::shutdown(bool drain)
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stopping = true;
+
+            if (!drain)
+                m_tasks.clear();
+        }
+
+        m_cond.notify_all();
+
+        for (auto &thread : m_threads)
+        {
+            if (thread.joinable())
+                thread.join();
+        }
+    }
+
+    ThreadPool::Stats ThreadPool::stats() const
+    {
+        size_t queued;
+        {
+            std::lock_guard lock(m_mutex);
+            queued = m_tasks.size();
+        }
+
+        auto threads = (unsigned)m_threads.size();
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - m_startTime).count();
+        auto total = (double)elapsed * threads;
+
+        return Stats {
+            .name = m_name,
+            .threads = threads,
+            .active = m_active.load(),
+            .queued = queued,
+            .completed = m_completed.load(),
+            .utilization = total > 0 ? (double)m_busyNanos.load() / total : 0,
+        };
+    }
+}
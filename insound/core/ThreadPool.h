@@ -0,0 +1,119 @@
+/**
+ * @file ThreadPool.h
+ *
+ * Contains `ThreadPool`, a fixed-size pool of named worker threads for
+ * running blocking work (bank builds, hashing, storage & database calls)
+ * outside of the http worker threads.
+ */
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Insound {
+
+    class ThreadPool
+    {
+    public:
+        /**
+         * Snapshot of a pool's utilization
+         */
+        struct Stats {
+            std::string name;
+
+            // Number of worker threads
+            unsigned threads;
+
+            // Workers currently running a task
+            unsigned active;
+
+            // Tasks waiting for a worker
+            size_t queued;
+
+            // Tasks finished since the pool started
+            size_t completed;
+
+            // Fraction of total worker time spent running tasks since the
+            // pool started, from 0 to 1
+            double utilization;
+        };
+
+        /**
+         * @param name    - name of the pool, used in logs and stats
+         * @param threads - number of worker threads, 0 uses the number of
+         *                  hardware threads
+         * @param cpus    - optional list of cpu indices to pin workers to,
+         *                  assigned round-robin. Empty for no pinning.
+         */
+        ThreadPool(std::string_view name, unsigned threads,
+            const std::vector<unsigned> &cpus = {});
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        /**
+         * Queue a task to run on the pool
+         *
+         * @param task - callable taking no arguments
+         *
+         * @return future containing the task's result, or its exception.
+         *
+         * @throws std::runtime_error if the pool was shut down.
+         */
+        template <typename F>
+        auto submit(F &&task) -> std::future<std::invoke_result_t<F>>
+        {
+            using R = std::invoke_result_t<F>;
+            auto packaged = std::make_shared<std::packaged_task<R()>>(
+                std::forward<F>(task));
+            auto future = packaged->get_future();
+
+            push([packaged]() { (*packaged)(); });
+            return future;
+        }
+
+        /**
+         * Stop accepting tasks and join all workers.
+         *
+         * @param drain - whether to finish queued tasks first (true), or
+         *                discard them (false), which breaks their futures.
+         */
+        void shutdown(bool drain = true);
+
+        [[nodiscard]]
+        Stats stats() const;
+
+        [[nodiscard]]
+        const std::string &name() const { return m_name; }
+
+        [[nodiscard]]
+        unsigned size() const { return (unsigned)m_threads.size(); }
+
+    private:
+        void push(std::function<void()> &&task);
+        void work();
+
+        std::string m_name;
+        std::vector<std::thread> m_threads;
+        std::deque<std::function<void()>> m_tasks;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cond;
+        bool m_stopping;
+
+        std::atomic<unsigned> m_active;
+        std::atomic<size_t> m_completed;
+        std::atomic<long long> m_busyNanos;
+        std::chrono::steady_clock::time_point m_startTime;
+    };
+}
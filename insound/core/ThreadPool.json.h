@@ -0,0 +1,6 @@
+#pragma once
+#include <insound/core/json.h>
+#include <insound/core/ThreadPool.h>
+
+IN_JSON_META(Insound::ThreadPool::Stats,
+    name, threads, active, queued, completed, utilization);
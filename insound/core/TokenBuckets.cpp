@@ -0,0 +1,105 @@
+#include "TokenBuckets.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Insound {
+
+    // Tokens a bucket holds after refilling from `last` until `now`
+    static double refilled(double tokens, double capacity,
+        double refillPerSecond, TokenBuckets::Clock::duration elapsed)
+    {
+        auto seconds = std::chrono::duration<double>(elapsed).count();
+        return std::min(capacity, tokens + seconds * refillPerSecond);
+    }
+
+    TokenBuckets::TokenBuckets(size_t compactEvery) : m_shards(),
+        m_compactEvery(std::max<size_t>(compactEvery, 1))
+    { }
+
+    TokenBuckets::Result TokenBuckets::take(std::string_view key,
+        const RateLimit &limit, Clock::time_point now)
+    {
+        if (!limit.enabled())
+            return {.allowed = true, .retryAfter = 0};
+
+        auto &shard = m_shards[StringHash{}(key) % ShardCount];
+        std::lock_guard lock(shard.mutex);
+
+        if (++shard.ops % m_compactEvery == 0)
+            compactShard(shard, now);
+
+        auto it = shard.buckets.find(key);
+        if (it == shard.buckets.end())
+        {
+            it = shard.buckets.emplace(std::string(key), Bucket {
+                .tokens = limit.capacity,
+                .capacity = limit.capacity,
+                .refillPerSecond = limit.refillPerSecond,
+                .last = now,
+            }).first;
+        }
+
+        auto &bucket = it->second;
+        bucket.tokens = refilled(bucket.tokens, bucket.capacity,
+            bucket.refillPerSecond, now - bucket.last);
+        bucket.last = now;
+
+        // A cost larger than the bucket could never be paid, so cap it
+        auto cost = std::min(limit.cost, bucket.capacity);
+        if (bucket.tokens >= cost)
+        {
+            bucket.tokens -= cost;
+            return {.allowed = true, .retryAfter = 0};
+        }
+
+        auto wait = (cost - bucket.tokens) / bucket.refillPerSecond;
+        return {
+            .allowed = false,
+            .retryAfter = (unsigned)std::max(std::ceil(wait), 1.0),
+        };
+    }
+
+    size_t TokenBuckets::compactShard(Shard &shard, Clock::time_point now)
+    {
+        return std::erase_if(shard.buckets, [now](const auto &entry) {
+            auto &bucket = entry.second;
+            return refilled(bucket.tokens, bucket.capacity,
+                bucket.refillPerSecond, now - bucket.last) >= bucket.capacity;
+        });
+    }
+
+    size_t TokenBuckets::compact(Clock::time_point now)
+    {
+        size_t dropped = 0;
+        for (auto &shard : m_shards)
+        {
+            std::lock_guard lock(shard.mutex);
+            dropped += compactShard(shard, now);
+        }
+
+        return dropped;
+    }
+
+    size_t TokenBuckets::size() const
+    {
+        size_t count = 0;
+        for (auto &shard : m_shards)
+        {
+            std::lock_guard lock(shard.mutex);
+            count += shard.buckets.size();
+        }
+
+        return count;
+    }
+
+    void TokenBuckets::clear()
+    {
+        for (auto &shard : m_shards)
+        {
+            std::lock_guard lock(shard.mutex);
+            shard.buckets.clear();
+            shard.ops = 0;
+        }
+    }
+}
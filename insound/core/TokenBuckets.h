@@ -0,0 +1,116 @@
+/**
+ * @file TokenBuckets.h
+ *
+ * Contains `TokenBuckets`, a thread-safe table of token buckets keyed by
+ * client, used by the `RateLimiter` middleware.
+ */
+#pragma once
+#include <insound/core/RouteLimits.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace Insound {
+
+    /**
+     * Table of token buckets split into independently locked shards, so that
+     * requests from different clients rarely contend on the same lock.
+     *
+     * Buckets that have fully refilled are indistinguishable from new ones,
+     * so each shard periodically drops them to keep memory bounded by the
+     * number of recently active clients.
+     */
+    class TokenBuckets
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        struct Result
+        {
+            /**
+             * Whether the tokens were taken and the request may proceed
+             */
+            bool allowed;
+
+            /**
+             * Whole seconds until enough tokens will be available, when not
+             * allowed
+             */
+            unsigned retryAfter;
+        };
+
+        /**
+         * @param compactEvery - number of takes on a shard between sweeps of
+         *                       its idle buckets
+         */
+        explicit TokenBuckets(size_t compactEvery = 4096);
+
+        /**
+         * Take `limit.cost` tokens from the bucket at `key`, creating a full
+         * bucket if there is none.
+         *
+         * @param key   - client key, e.g. ip address or user id, prefixed by
+         *                route
+         * @param limit - bucket settings
+         * @param now   - current time
+         */
+        Result take(std::string_view key, const RateLimit &limit,
+            Clock::time_point now = Clock::now());
+
+        /**
+         * Drop all buckets that have refilled by `now`.
+         *
+         * @return number of buckets dropped.
+         */
+        size_t compact(Clock::time_point now = Clock::now());
+
+        /**
+         * Number of buckets currently stored
+         */
+        [[nodiscard]]
+        size_t size() const;
+
+        /**
+         * Remove all buckets.
+         */
+        void clear();
+
+    private:
+        struct Bucket
+        {
+            double tokens;
+            double capacity;
+            double refillPerSecond;
+            Clock::time_point last;
+        };
+
+        struct StringHash
+        {
+            using is_transparent = void;
+            size_t operator()(std::string_view str) const
+            {
+                return std::hash<std::string_view>{}(str);
+            }
+        };
+
+        struct alignas(64) Shard
+        {
+            mutable std::mutex mutex;
+            std::unordered_map<std::string, Bucket, StringHash,
+                std::equal_to<>> buckets;
+            size_t ops = 0;
+        };
+
+        static constexpr size_t ShardCount = 64;
+
+        static size_t compactShard(Shard &shard, Clock::time_point now);
+
+        std::array<Shard, ShardCount> m_shards;
+        size_t m_compactEvery;
+    };
+}
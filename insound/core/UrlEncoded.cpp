@@ -0,0 +1,201 @@
+#include "UrlEncoded.h"
+
+#include <insound/core/platform.h>
+
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(INSOUND_CPU_X86_64)
+#include <emmintrin.h>
+#elif defined(INSOUND_CPU_ARM64)
+#include <arm_neon.h>
+#endif
+
+namespace Insound::UrlEncoded {
+
+    static bool isSpecial(char c)
+    {
+        return c == '%' || c == '+' || c == '&' || c == '=';
+    }
+
+    size_t findSpecial(const char *data, size_t size)
+    {
+        size_t i = 0;
+
+#if defined(INSOUND_CPU_X86_64)
+        const auto percent = _mm_set1_epi8('%');
+        const auto plus = _mm_set1_epi8('+');
+        const auto amp = _mm_set1_epi8('&');
+        const auto equals = _mm_set1_epi8('=');
+
+        for (; i + 16 <= size; i += 16)
+        {
+            auto chunk = _mm_loadu_si128((const __m128i *)(data + i));
+            auto hits = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, percent),
+                    _mm_cmpeq_epi8(chunk, plus)),
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, amp),
+                    _mm_cmpeq_epi8(chunk, equals)));
+
+            auto mask = (unsigned)_mm_movemask_epi8(hits);
+            if (mask)
+                return i + std::countr_zero(mask);
+        }
+#elif defined(INSOUND_CPU_ARM64)
+        const auto percent = vdupq_n_u8('%');
+        const auto plus = vdupq_n_u8('+');
+        const auto amp = vdupq_n_u8('&');
+        const auto equals = vdupq_n_u8('=');
+
+        for (; i + 16 <= size; i += 16)
+        {
+            auto chunk = vld1q_u8((const uint8_t *)(data + i));
+            auto hits = vorrq_u8(
+                vorrq_u8(vceqq_u8(chunk, percent), vceqq_u8(chunk, plus)),
+                vorrq_u8(vceqq_u8(chunk, amp), vceqq_u8(chunk, equals)));
+
+            // Narrow to 4 bits per byte to get a 64-bit mask
+            auto mask = vget_lane_u64(vreinterpret_u64_u8(
+                vshrn_n_u16(vreinterpretq_u16_u8(hits), 4)), 0);
+            if (mask)
+                return i + (std::countr_zero(mask) >> 2);
+        }
+#endif
+
+        for (; i < size; ++i)
+        {
+            if (isSpecial(data[i]))
+                return i;
+        }
+
+        return size;
+    }
+
+    static int hexValue(char c)
+    {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    /**
+     * Decode the component starting at `begin` in place, stopping at '&', or
+     * also at '=' when decoding a key.
+     *
+     * @param data  - buffer to decode
+     * @param begin - index of the component's first char
+     * @param size  - size of the buffer
+     * @param isKey - whether the component is a key
+     * @param end   - [out] index of the terminating char, or `size`
+     *
+     * @return size of the decoded component, which starts at `begin`.
+     */
+    static size_t decodeComponent(char *data, size_t begin, size_t size,
+        bool isKey, size_t &end)
+    {
+        size_t read = begin, write = begin;
+        while (true)
+        {
+            auto next = read + findSpecial(data + read, size - read);
+
+            // Shift plain chars left over previously decoded escapes
+            if (write != read)
+                std::memmove(data + write, data + read, next - read);
+            write += next - read;
+            read = next;
+
+            if (read == size)
+                break;
+
+            auto c = data[read];
+            if (c == '&' || (c == '=' && isKey))
+                break;
+
+            switch(c)
+            {
+                case '=':
+                    data[write++] = '=';
+                    ++read;
+                    break;
+
+                case '+':
+                    data[write++] = ' ';
+                    ++read;
+                    break;
+
+                default: // '%'
+                {
+                    auto high = read + 2 < size ? hexValue(data[read + 1]) : -1;
+                    auto low = read + 2 < size ? hexValue(data[read + 2]) : -1;
+                    if (high < 0 || low < 0)
+                        throw std::invalid_argument(sf("Malformed URL-encoded "
+                            "string: invalid escape at position {}", read));
+
+                    data[write++] = (char)((high << 4) | low);
+                    read += 3;
+                    break;
+                }
+            }
+        }
+
+        end = read;
+        return write - begin;
+    }
+
+    std::string decode(std::string_view in)
+    {
+        std::string out(in);
+
+        // Decode as a single value, so '&' is the only terminator
+        size_t size = 0, begin = 0, end = 0;
+        while (begin <= out.size())
+        {
+            auto length = decodeComponent(out.data(), begin, out.size(),
+                false, end);
+            std::memmove(out.data() + size, out.data() + begin, length);
+            size += length;
+
+            if (end == out.size())
+                break;
+
+            out[size++] = '&';
+            begin = end + 1;
+        }
+
+        out.resize(size);
+        return out;
+    }
+
+    std::vector<Field> parse(std::string &body)
+    {
+        std::vector<Field> fields;
+        auto data = body.data();
+        auto size = body.size();
+
+        size_t i = 0;
+        while (i < size)
+        {
+            size_t end;
+            auto keyLength = decodeComponent(data, i, size, true, end);
+            std::string_view key(data + i, keyLength);
+
+            std::string_view value;
+            if (end < size && data[end] == '=')
+            {
+                auto valueBegin = end + 1;
+                auto valueLength = decodeComponent(data, valueBegin, size,
+                    false, end);
+                value = std::string_view(data + valueBegin, valueLength);
+            }
+
+            if (!key.empty() || !value.empty())
+                fields.emplace_back(Field{.key = key, .value = value});
+
+            i = end + 1; // one past the '&'
+        }
+
+        return fields;
+    }
+}
@@ -0,0 +1,62 @@
+/**
+ * @file UrlEncoded.h
+ *
+ * Contains functions for decoding application/x-www-form-urlencoded data.
+ */
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Insound::UrlEncoded {
+
+    /**
+     * A key-value pair of a url-encoded form
+     */
+    struct Field {
+        std::string_view key;
+        std::string_view value;
+    };
+
+    /**
+     * Decode a url-encoded string, converting each `%HH` to its byte value,
+     * and '+' to ' '.
+     *
+     * @param in - input string, e.g. "bob%40mail.com"
+     *
+     * @return decoded string, e.g. "bob@mail.com"
+     *
+     * @throws std::invalid_argument if an escape is malformed.
+     */
+    [[nodiscard]]
+    std::string decode(std::string_view in);
+
+    /**
+     * Split a url-encoded form body into its key-value pairs, decoding each
+     * key and value in place. Since decoding never lengthens a component,
+     * decoded components overwrite the start of their own span of `body`,
+     * and all returned views point into `body`. Components without escapes
+     * are left untouched.
+     *
+     * Splitting happens before decoding, so encoded '&' and '=' characters
+     * are kept as part of the key or value. A key without '=' has an empty
+     * value, and empty pairs e.g. "a=1&&b=2" are skipped.
+     *
+     * @param body - form body, modified in place
+     *
+     * @return fields in the order they appear in the body. Views are valid
+     *         while `body` is unchanged.
+     *
+     * @throws std::invalid_argument if an escape is malformed.
+     */
+    [[nodiscard]]
+    std::vector<Field> parse(std::string &body);
+
+    /**
+     * Find the first '%', '+', '&' or '=' in a string.
+     *
+     * @return index of the character, or `size` if there is none.
+     */
+    [[nodiscard]]
+    size_t findSpecial(const char *data, size_t size);
+}
@@ -0,0 +1,123 @@
+#include "Workers.h"
+
+#include <insound/core/env.h>
+#include <insound/core/util.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace Insound::Workers {
+
+    static std::mutex sMutex;
+
+    // Pools are never erased while the app is running, so references
+    // returned by `get` remain valid.
+    static std::map<std::string, std::unique_ptr<ThreadPool>, std::less<>>
+        sPools;
+
+    // Pools that were shut down. Kept alive, since references to them may
+    // still be held.
+    static std::vector<std::unique_ptr<ThreadPool>> sRetired;
+
+    static std::vector<unsigned> allCpus()
+    {
+        std::vector<unsigned> cpus;
+        auto count = std::max(std::thread::hardware_concurrency(), 1u);
+        for (unsigned i = 0; i < count; ++i)
+            cpus.emplace_back(i);
+        return cpus;
+    }
+
+    void configure(const std::map<std::string, unsigned> &pools,
+        bool pinCpus)
+    {
+        std::lock_guard lock(sMutex);
+
+        std::vector<std::pair<std::string, unsigned>> created;
+        unsigned total = 0;
+        for (auto &[name, threads] : pools)
+        {
+            if (sPools.contains(name))
+                continue;
+
+            auto count = (unsigned)getEnv<int>(
+                sf("POOL_{}_THREADS", toUpper(name)), (int)threads);
+            if (count == 0)
+                count = std::max(std::thread::hardware_concurrency(), 1u);
+
+            created.emplace_back(name, count);
+            total += count;
+        }
+
+        // Give each pool its own range of cpus, sized by its share of the
+        // threads, so pools don't pile onto the same cores. Ranges wrap
+        // around when there are more pools than cpus.
+        auto cpus = pinCpus ? allCpus() : std::vector<unsigned>{};
+        size_t next = 0;
+        for (auto &[name, count] : created)
+        {
+            std::vector<unsigned> range;
+            if (!cpus.empty())
+            {
+                auto share = std::max<size_t>(
+                    (size_t)count * cpus.size() / total, 1);
+                for (size_t i = 0; i < share; ++i)
+                    range.emplace_back(cpus[(next + i) % cpus.size()]);
+                next += share;
+            }
+
+            sPools[name] = std::make_unique<ThreadPool>(name, count, range);
+            IN_LOG("Worker pool \"{}\" started with {} threads", name,
+                sPools[name]->size());
+        }
+    }
+
+    ThreadPool &get(std::string_view name)
+    {
+        std::lock_guard lock(sMutex);
+
+        auto it = sPools.find(name);
+        if (it == sPools.end())
+        {
+            it = sPools.emplace(std::string(name),
+                std::make_unique<ThreadPool>(name, 0)).first;
+        }
+
+        return *it->second;
+    }
+
+    std::vector<ThreadPool::Stats> stats()
+    {
+        std::lock_guard lock(sMutex);
+
+        std::vector<ThreadPool::Stats> res;
+        res.reserve(sPools.size());
+        for (auto &[name, pool] : sPools)
+            res.emplace_back(pool->stats());
+
+        return res;
+    }
+
+    void shutdown(bool drain)
+    {
+        // Joined without the lock, since draining tasks may call `get`
+        std::vector<ThreadPool *> pools;
+        {
+            std::lock_guard lock(sMutex);
+            for (auto &[name, pool] : sPools)
+                pools.emplace_back(pool.get());
+        }
+
+        for (auto pool : pools)
+            pool->shutdown(drain);
+
+        // Later calls to `get` start new pools
+        std::lock_guard lock(sMutex);
+        for (auto &[name, pool] : sPools)
+            sRetired.emplace_back(std::move(pool));
+        sPools.clear();
+    }
+}
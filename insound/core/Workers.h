@@ -0,0 +1,72 @@
+/**
+ * @file Workers.h
+ *
+ * Contains the app-wide registry of named `ThreadPool`s used to run blocking
+ * work off of the http worker threads. Pools are configured by `App::run`
+ * from `AppOpts`, and can be sized per instance via the environment.
+ *
+ * @example
+ * ```cpp
+ * auto result = Workers::get(Workers::Bank).submit([&]() {
+ *     return builder.build();
+ * }).get();
+ * ```
+ */
+#pragma once
+#include <insound/core/ThreadPool.h>
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Insound::Workers {
+
+    // Names of the pools used by the app
+
+    // FSBank encoding and other audio processing
+    inline constexpr std::string_view Bank = "bank";
+
+    // Password hashing & comparison
+    inline constexpr std::string_view Crypto = "crypto";
+
+    // S3 storage calls
+    inline constexpr std::string_view S3 = "s3";
+
+    // MongoDB calls
+    inline constexpr std::string_view Mongo = "mongo";
+
+    /**
+     * Create the pools. Pools that already exist are left untouched.
+     *
+     * @param pools    - map of pool name to thread count, where 0 uses the
+     *                   number of hardware threads. The count can be
+     *                   overridden via env var "POOL_<NAME>_THREADS".
+     * @param pinCpus  - whether to pin pool threads to cpus. Each pool is
+     *                   pinned to its own range of cpus, sized by its share
+     *                   of the threads.
+     */
+    void configure(const std::map<std::string, unsigned> &pools,
+        bool pinCpus = false);
+
+    /**
+     * Get a pool by name. A pool that was not configured is created on first
+     * use with one thread per hardware thread.
+     */
+    [[nodiscard]]
+    ThreadPool &get(std::string_view name);
+
+    /**
+     * Get utilization stats of every pool
+     */
+    [[nodiscard]]
+    std::vector<ThreadPool::Stats> stats();
+
+    /**
+     * Shut down all pools. Pools requested afterwards are started anew,
+     * while references to the old ones stay valid.
+     *
+     * @param drain - whether to finish queued tasks before returning
+     */
+    void shutdown(bool drain = true);
+}
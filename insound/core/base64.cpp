@@ -0,0 +1,376 @@
+#include "base64.h"
+
+#include <insound/core/platform.h>
+
+#include <array>
+#include <cstdint>
+
+#if defined(INSOUND_CPU_X86_64)
+#include <tmmintrin.h>
+#elif defined(INSOUND_CPU_ARM64)
+#include <arm_neon.h>
+#endif
+
+namespace Insound::Base64Url {
+
+    static constexpr char Alphabet[65] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+    static constexpr uint8_t Invalid = 0xff;
+
+    // Maps each character to its 6-bit value, or Invalid
+    static constexpr auto Values = []() {
+        std::array<uint8_t, 256> values{};
+        values.fill(Invalid);
+        for (uint8_t i = 0; i < 64; ++i)
+            values[(uint8_t)Alphabet[i]] = i;
+        return values;
+    }();
+
+#if defined(INSOUND_CPU_X86_64)
+    // SSSE3 is not part of the x86_64 baseline, so check for it at runtime
+    static const bool HasSsse3 = __builtin_cpu_supports("ssse3");
+
+    /**
+     * Encode 12 bytes from 16 loaded bytes into 16 characters.
+     * Based on Wojciech Muła's pshufb base64 encoder.
+     */
+    __attribute__((target("ssse3")))
+    static __m128i encodeBlock(__m128i in)
+    {
+        // Spread each 3-byte group across 4 bytes: [b1 b0 b2 b1]
+        in = _mm_shuffle_epi8(in, _mm_setr_epi8(
+            1, 0, 2, 1,  4, 3, 5, 4,  7, 6, 8, 7,  10, 9, 11, 10));
+
+        // Move each 6-bit index into its own byte
+        auto t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+        auto t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+        auto t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+        auto t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+        auto indices = _mm_or_si128(t1, t3);
+
+        // Map each index range to the offset of its alphabet range:
+        // 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12
+        auto ranges = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+        auto upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+        ranges = _mm_or_si128(ranges, _mm_and_si128(upper, _mm_set1_epi8(13)));
+
+        const auto offsets = _mm_setr_epi8(
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '-' - 62,
+            '_' - 63, 'A', 0, 0);
+
+        return _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, ranges));
+    }
+
+    __attribute__((target("ssse3")))
+    static size_t encodeSimd(const uint8_t *in, size_t size, char *out)
+    {
+        size_t i = 0;
+
+        // Each block reads 16 bytes but consumes 12
+        for (; i + 16 <= size; i += 12, out += 16)
+        {
+            auto block = _mm_loadu_si128((const __m128i *)(in + i));
+            _mm_storeu_si128((__m128i *)out, encodeBlock(block));
+        }
+
+        return i;
+    }
+
+    /**
+     * Map 16 characters to their 6-bit values, flagging invalid ones in
+     * `bad`. Characters outside of ASCII compare as negative, so they fall
+     * outside every range.
+     */
+    static __m128i decodeValues(__m128i c, __m128i &bad)
+    {
+        auto inRange = [c](char lo, char hi) {
+            return _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8(lo - 1)),
+                _mm_cmpgt_epi8(_mm_set1_epi8(hi + 1), c));
+        };
+
+        auto upper = inRange('A', 'Z');
+        auto lower = inRange('a', 'z');
+        auto digit = inRange('0', '9');
+        auto dash = _mm_cmpeq_epi8(c, _mm_set1_epi8('-'));
+        auto underscore = _mm_cmpeq_epi8(c, _mm_set1_epi8('_'));
+
+        auto shift = _mm_or_si128(
+            _mm_or_si128(
+                _mm_and_si128(upper, _mm_set1_epi8(-'A')),
+                _mm_and_si128(lower, _mm_set1_epi8(26 - 'a'))),
+            _mm_or_si128(
+                _mm_and_si128(digit, _mm_set1_epi8(52 - '0')),
+                _mm_or_si128(
+                    _mm_and_si128(dash, _mm_set1_epi8(62 - '-')),
+                    _mm_and_si128(underscore, _mm_set1_epi8(63 - '_')))));
+
+        auto valid = _mm_or_si128(_mm_or_si128(upper, lower),
+            _mm_or_si128(digit, _mm_or_si128(dash, underscore)));
+        bad = _mm_or_si128(bad, _mm_cmpeq_epi8(valid, _mm_setzero_si128()));
+
+        return _mm_add_epi8(c, shift);
+    }
+
+    __attribute__((target("ssse3")))
+    static size_t decodeSimd(const char *in, size_t size, uint8_t *out,
+        bool &ok)
+    {
+        auto bad = _mm_setzero_si128();
+        size_t i = 0;
+
+        // Each block writes 16 bytes but produces 12, so stop while there is
+        // enough input left for the extra 4 bytes to land inside `out`
+        for (; i + 24 <= size; i += 16, out += 12)
+        {
+            auto values = decodeValues(
+                _mm_loadu_si128((const __m128i *)(in + i)), bad);
+
+            // Pack pairs of 6-bit values into 12 bits, then pairs of those
+            // into 24 bits per 32-bit lane
+            auto pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+            auto groups = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+
+            auto bytes = _mm_shuffle_epi8(groups, _mm_setr_epi8(
+                2, 1, 0,  6, 5, 4,  10, 9, 8,  14, 13, 12,  -1, -1, -1, -1));
+            _mm_storeu_si128((__m128i *)out, bytes);
+        }
+
+        ok = _mm_movemask_epi8(bad) == 0;
+        return i;
+    }
+#elif defined(INSOUND_CPU_ARM64)
+    static size_t encodeSimd(const uint8_t *in, size_t size, char *out)
+    {
+        const auto table = vld1q_u8_x4((const uint8_t *)Alphabet);
+        const auto low2 = vdupq_n_u8(0x30);
+        const auto low4 = vdupq_n_u8(0x3c);
+        const auto low6 = vdupq_n_u8(0x3f);
+
+        size_t i = 0;
+        for (; i + 48 <= size; i += 48, out += 64)
+        {
+            // De-interleaves the first, second and third byte of each group
+            auto bytes = vld3q_u8(in + i);
+
+            uint8x16x4_t chars;
+            chars.val[0] = vshrq_n_u8(bytes.val[0], 2);
+            chars.val[1] = vorrq_u8(
+                vandq_u8(vshlq_n_u8(bytes.val[0], 4), low2),
+                vshrq_n_u8(bytes.val[1], 4));
+            chars.val[2] = vorrq_u8(
+                vandq_u8(vshlq_n_u8(bytes.val[1], 2), low4),
+                vshrq_n_u8(bytes.val[2], 6));
+            chars.val[3] = vandq_u8(bytes.val[2], low6);
+
+            for (auto &c : chars.val)
+                c = vqtbl4q_u8(table, c);
+
+            vst4q_u8((uint8_t *)out, chars);
+        }
+
+        return i;
+    }
+
+    /**
+     * Map 16 characters to their 6-bit values, flagging invalid ones in
+     * `bad`
+     */
+    static uint8x16_t decodeValues(uint8x16_t c, uint8x16_t &bad)
+    {
+        auto inRange = [c](uint8_t lo, uint8_t hi) {
+            return vandq_u8(vcgeq_u8(c, vdupq_n_u8(lo)),
+                vcleq_u8(c, vdupq_n_u8(hi)));
+        };
+
+        auto upper = inRange('A', 'Z');
+        auto lower = inRange('a', 'z');
+        auto digit = inRange('0', '9');
+        auto dash = vceqq_u8(c, vdupq_n_u8('-'));
+        auto underscore = vceqq_u8(c, vdupq_n_u8('_'));
+
+        auto shift = vorrq_u8(
+            vorrq_u8(
+                vandq_u8(upper, vdupq_n_u8((uint8_t)-'A')),
+                vandq_u8(lower, vdupq_n_u8((uint8_t)(26 - 'a')))),
+            vorrq_u8(
+                vandq_u8(digit, vdupq_n_u8((uint8_t)(52 - '0'))),
+                vorrq_u8(
+                    vandq_u8(dash, vdupq_n_u8((uint8_t)(62 - '-'))),
+                    vandq_u8(underscore, vdupq_n_u8((uint8_t)(63 - '_'))))));
+
+        auto valid = vorrq_u8(vorrq_u8(upper, lower),
+            vorrq_u8(digit, vorrq_u8(dash, underscore)));
+        bad = vorrq_u8(bad, vmvnq_u8(valid));
+
+        return vaddq_u8(c, shift);
+    }
+
+    static size_t decodeSimd(const char *in, size_t size, uint8_t *out,
+        bool &ok)
+    {
+        auto bad = vdupq_n_u8(0);
+
+        size_t i = 0;
+        for (; i + 64 <= size; i += 64, out += 48)
+        {
+            // De-interleaves the first, second, third and fourth character
+            // of each group
+            auto chars = vld4q_u8((const uint8_t *)(in + i));
+            auto a = decodeValues(chars.val[0], bad);
+            auto b = decodeValues(chars.val[1], bad);
+            auto c = decodeValues(chars.val[2], bad);
+            auto d = decodeValues(chars.val[3], bad);
+
+            uint8x16x3_t bytes;
+            bytes.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+            bytes.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(c, 2));
+            bytes.val[2] = vorrq_u8(vshlq_n_u8(c, 6), d);
+            vst3q_u8(out, bytes);
+        }
+
+        ok = vmaxvq_u8(bad) == 0;
+        return i;
+    }
+#endif
+
+    size_t encode(const void *data, size_t size, char *out)
+    {
+        auto in = static_cast<const uint8_t *>(data);
+        auto start = out;
+        size_t i = 0;
+
+#if defined(INSOUND_CPU_X86_64)
+        if (HasSsse3)
+        {
+            i = encodeSimd(in, size, out);
+            out += i / 3 * 4;
+        }
+#elif defined(INSOUND_CPU_ARM64)
+        i = encodeSimd(in, size, out);
+        out += i / 3 * 4;
+#endif
+
+        for (; i + 3 <= size; i += 3)
+        {
+            uint32_t group = (uint32_t)in[i] << 16 | (uint32_t)in[i + 1] << 8 |
+                in[i + 2];
+            *out++ = Alphabet[group >> 18];
+            *out++ = Alphabet[group >> 12 & 0x3f];
+            *out++ = Alphabet[group >> 6 & 0x3f];
+            *out++ = Alphabet[group & 0x3f];
+        }
+
+        switch (size - i)
+        {
+        case 1:
+            *out++ = Alphabet[in[i] >> 2];
+            *out++ = Alphabet[(in[i] & 0x3) << 4];
+            break;
+        case 2:
+            *out++ = Alphabet[in[i] >> 2];
+            *out++ = Alphabet[(in[i] & 0x3) << 4 | in[i + 1] >> 4];
+            *out++ = Alphabet[(in[i + 1] & 0xf) << 2];
+            break;
+        default:
+            break;
+        }
+
+        return out - start;
+    }
+
+    std::string encode(std::string_view data)
+    {
+        std::string res(encodedSize(data.size()), '\0');
+        encode(data.data(), data.size(), res.data());
+        return res;
+    }
+
+    bool decode(std::string_view in, void *data, size_t &size) noexcept
+    {
+        // A single leftover character can't hold a full byte
+        if (in.size() % 4 == 1)
+            return false;
+
+        auto out = static_cast<uint8_t *>(data);
+        auto start = out;
+        size_t i = 0;
+
+#if defined(INSOUND_CPU_X86_64)
+        if (HasSsse3)
+        {
+            bool ok;
+            i = decodeSimd(in.data(), in.size(), out, ok);
+            if (!ok)
+                return false;
+            out += i / 4 * 3;
+        }
+#elif defined(INSOUND_CPU_ARM64)
+        bool ok;
+        i = decodeSimd(in.data(), in.size(), out, ok);
+        if (!ok)
+            return false;
+        out += i / 4 * 3;
+#endif
+
+        uint32_t invalid = 0;
+        for (; i + 4 <= in.size(); i += 4)
+        {
+            uint32_t a = Values[(uint8_t)in[i]], b = Values[(uint8_t)in[i + 1]],
+                c = Values[(uint8_t)in[i + 2]], d = Values[(uint8_t)in[i + 3]];
+
+            // Invalid values have their high bits set
+            invalid |= a | b | c | d;
+
+            auto group = a << 18 | b << 12 | c << 6 | d;
+            *out++ = (uint8_t)(group >> 16);
+            *out++ = (uint8_t)(group >> 8);
+            *out++ = (uint8_t)group;
+        }
+
+        switch (in.size() - i)
+        {
+        case 2:
+        {
+            uint32_t a = Values[(uint8_t)in[i]], b = Values[(uint8_t)in[i + 1]];
+            invalid |= a | b;
+            if (b & 0xf) // unused bits must be zero
+                return false;
+            *out++ = (uint8_t)(a << 2 | b >> 4);
+            break;
+        }
+        case 3:
+        {
+            uint32_t a = Values[(uint8_t)in[i]], b = Values[(uint8_t)in[i + 1]],
+                c = Values[(uint8_t)in[i + 2]];
+            invalid |= a | b | c;
+            if (c & 0x3)
+                return false;
+            *out++ = (uint8_t)(a << 2 | b >> 4);
+            *out++ = (uint8_t)(b << 4 | c >> 2);
+            break;
+        }
+        default:
+            break;
+        }
+
+        if (invalid & ~0x3fu)
+            return false;
+
+        size = out - start;
+        return true;
+    }
+
+    bool decode(std::string_view in, std::string &out)
+    {
+        out.resize(decodedSize(in.size()));
+
+        size_t size;
+        if (!decode(in, out.data(), size))
+            return false;
+
+        out.resize(size);
+        return true;
+    }
+}
@@ -0,0 +1,81 @@
+/**
+ * @file base64.h
+ *
+ * Contains functions for encoding and decoding base64url, the url-safe base64
+ * alphabet without padding used by json web tokens (RFC 4648 §5).
+ */
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace Insound::Base64Url {
+
+    /**
+     * Number of characters needed to encode `size` bytes, without padding
+     */
+    [[nodiscard]]
+    constexpr size_t encodedSize(size_t size)
+    {
+        return (size * 4 + 2) / 3;
+    }
+
+    /**
+     * Encode bytes as base64url without padding. Uses vectorized code when
+     * the CPU supports it.
+     *
+     * @param data - bytes to encode
+     * @param size - number of bytes
+     * @param out  - receives `encodedSize(size)` characters. No terminator is
+     *               written.
+     *
+     * @return number of characters written.
+     */
+    size_t encode(const void *data, size_t size, char *out);
+
+    /**
+     * Encode bytes as base64url without padding.
+     *
+     * @param data - bytes to encode
+     *
+     * @return encoded string.
+     */
+    [[nodiscard]]
+    std::string encode(std::string_view data);
+
+    /**
+     * Number of bytes `size` characters of valid base64url decode to
+     */
+    [[nodiscard]]
+    constexpr size_t decodedSize(size_t size)
+    {
+        return size * 3 / 4;
+    }
+
+    /**
+     * Decode unpadded base64url. Uses vectorized code when the CPU supports
+     * it. Input with padding, characters outside the alphabet, an impossible
+     * length, or non-zero trailing bits is rejected, so every byte string
+     * has exactly one accepted encoding.
+     *
+     * @param in   - characters to decode
+     * @param out  - receives up to `decodedSize(in.size())` bytes, which may
+     *               be partially written on failure
+     * @param size - [out] number of bytes written
+     *
+     * @return whether `in` was valid.
+     */
+    [[nodiscard]]
+    bool decode(std::string_view in, void *out, size_t &size) noexcept;
+
+    /**
+     * Decode unpadded base64url into a string, reusing its capacity.
+     *
+     * @param in  - characters to decode
+     * @param out - receives the decoded bytes, replacing its contents
+     *
+     * @return whether `in` was valid.
+     */
+    [[nodiscard]]
+    bool decode(std::string_view in, std::string &out);
+}
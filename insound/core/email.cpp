@@ -1,4 +1,5 @@
 #include "email.h"
+#include "email.json.h"
 
 #include <crow/utility.h>
 
@@ -8,13 +9,6 @@
 
 #include <utility>
 
-using Insound::Email::Attachment;
-using Insound::Email::SendEmailOpts;
-
-IN_JSON_META(Attachment, filename, content, path, href, httpHeaders,
-            contentType, contentDisposition, cid, encoding, headers, raw);
-IN_JSON_META(SendEmailOpts, from, to, cc, bcc, subject, text, html);
-
 namespace Insound::Email
 {
     SendEmail::SendEmail() : opts()
@@ -24,9 +18,18 @@ namespace Insound::Email
 
     bool SendEmail::send() const
     {
-        auto payload = JSON::stringify(this->opts);
+        MakeRequest request;
+        return post(request, Settings::emailEndpointURL(),
+            JSON::stringify(this->opts));
+    }
 
-        auto request = MakeRequest(Settings::emailEndpointURL(), "POST")
+
+    bool post(MakeRequest &request, std::string_view url,
+        std::string_view payload)
+    {
+        request.clear();
+        request.url(url)
+            .method("POST")
             .header("Authorization", Settings::emailAccessKey())
             .header("Content-Type", "application/json")
             .body(payload);
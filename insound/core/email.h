@@ -9,8 +9,13 @@
 #include <optional>
 #include <map>
 #include <string>
+#include <string_view>
 #include <vector>
 
+namespace Insound {
+    class MakeRequest;
+}
+
 namespace Insound::Email
 {
     /**
@@ -285,8 +290,30 @@ namespace Insound::Email
          */
         bool send() const;
 
+        /**
+         * Message options set so far
+         */
+        [[nodiscard]]
+        const SendEmailOpts &options() const { return opts; }
+
     private:
         SendEmailOpts opts;
     };
 
+
+    /**
+     * Post a JSON email payload to the email provider. Pass the same request
+     * object to consecutive calls to reuse its connection.
+     *
+     * @param request - request to send with, reset before use
+     * @param url     - provider endpoint
+     * @param payload - JSON message, or array of messages for a batch
+     *                  endpoint
+     *
+     * @return whether the provider accepted the payload.
+     *
+     * @throws CurlError if the request could not be performed.
+     */
+    bool post(MakeRequest &request, std::string_view url,
+        std::string_view payload);
 }
@@ -0,0 +1,10 @@
+#pragma once
+#include <insound/core/email.h>
+#include <insound/core/json.h>
+
+using Insound::Email::Attachment;
+using Insound::Email::SendEmailOpts;
+
+IN_JSON_META(Attachment, filename, content, path, href, httpHeaders,
+            contentType, contentDisposition, cid, encoding, headers, raw);
+IN_JSON_META(SendEmailOpts, from, to, cc, bcc, subject, text, html);
@@ -101,3 +101,15 @@ inline double Insound::getEnv<double>(std::string_view varName, double defaultVa
         return defaultVal;
     }
 }
+
+template<>
+inline size_t Insound::getEnv<size_t>(std::string_view varName,
+    size_t defaultVal)
+{
+    auto var = std::getenv(varName.data());
+    if (!var) return defaultVal;
+
+    char *end;
+    auto value = std::strtoull(var, &end, 10);
+    return (end == var) ? defaultVal : (size_t)value;
+}
@@ -9,6 +9,8 @@ namespace Insound::Jwt {
         case Code::BadTokenFormat: return "Bad input token string";
         case Code::ConversionFailure:
             return "Error during token conversion";
+        case Code::TokenExpired: return "Token expired";
+        case Code::TokenRevoked: return "Token revoked";
         case Code::VerificationFailure:
             return "Token converted, but failed verification";
         default:
@@ -19,6 +19,8 @@ namespace Insound::Jwt {
             ConversionFailure,
             // Token is expired and no longer valid
             TokenExpired,
+            // Token was revoked before its expiry, e.g. on logout
+            TokenRevoked,
             // Token converted, but failed to pass verification,
             // wrong algorithm, missing claims, claim type/value mismatch, etc.
             VerificationFailure,
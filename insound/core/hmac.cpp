@@ -0,0 +1,73 @@
+// The low-level SHA-256 functions are deprecated in OpenSSL 3, but remain
+// the only way to copy a hash state without an allocation
+#define OPENSSL_SUPPRESS_DEPRECATED
+#include "hmac.h"
+
+#include <openssl/crypto.h>
+
+#include <algorithm>
+
+namespace Insound {
+
+    static constexpr size_t BlockSize = SHA256_CBLOCK;
+
+    HmacSha256::HmacSha256(std::string_view key) : m_inner(), m_outer()
+    {
+        unsigned char block[BlockSize] = {};
+
+        // Keys longer than a block are hashed first
+        if (key.size() > BlockSize)
+            SHA256((const unsigned char *)key.data(), key.size(), block);
+        else
+            std::copy(key.begin(), key.end(), block);
+
+        unsigned char pad[BlockSize];
+        for (size_t i = 0; i < BlockSize; ++i)
+            pad[i] = block[i] ^ 0x36;
+        SHA256_Init(&m_inner);
+        SHA256_Update(&m_inner, pad, BlockSize);
+
+        for (size_t i = 0; i < BlockSize; ++i)
+            pad[i] = block[i] ^ 0x5c;
+        SHA256_Init(&m_outer);
+        SHA256_Update(&m_outer, pad, BlockSize);
+
+        OPENSSL_cleanse(block, BlockSize);
+        OPENSSL_cleanse(pad, BlockSize);
+    }
+
+    HmacSha256::~HmacSha256()
+    {
+        OPENSSL_cleanse(&m_inner, sizeof(m_inner));
+        OPENSSL_cleanse(&m_outer, sizeof(m_outer));
+    }
+
+    HmacSha256::Digest HmacSha256::sign(std::string_view message) const
+    {
+        Digest digest;
+
+        auto ctx = m_inner;
+        SHA256_Update(&ctx, message.data(), message.size());
+        SHA256_Final(digest.data(), &ctx);
+
+        ctx = m_outer;
+        SHA256_Update(&ctx, digest.data(), digest.size());
+        SHA256_Final(digest.data(), &ctx);
+
+        OPENSSL_cleanse(&ctx, sizeof(ctx));
+        return digest;
+    }
+
+    bool HmacSha256::verify(std::string_view message, const void *signature,
+        size_t size) const
+    {
+        if (size != Size)
+            return false;
+
+        auto expected = sign(message);
+        auto result = CRYPTO_memcmp(expected.data(), signature, Size) == 0;
+
+        OPENSSL_cleanse(expected.data(), Size);
+        return result;
+    }
+}
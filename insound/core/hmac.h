@@ -0,0 +1,71 @@
+/**
+ * @file hmac.h
+ *
+ * Contains `HmacSha256`, an HMAC-SHA256 key with its padded states computed
+ * once, for signing many messages with the same secret.
+ */
+#pragma once
+#include <openssl/sha.h>
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+namespace Insound {
+
+    /**
+     * HMAC-SHA256 with a fixed key (RFC 2104). The SHA-256 states after
+     * absorbing the inner and outer padded keys are computed on construction,
+     * so each signature only hashes the message and the inner digest,
+     * instead of rehashing the key twice.
+     *
+     * Signing and verifying are const and safe to call from any thread.
+     */
+    class HmacSha256
+    {
+    public:
+        /**
+         * Byte size of a signature
+         */
+        static constexpr size_t Size = SHA256_DIGEST_LENGTH;
+
+        using Digest = std::array<unsigned char, Size>;
+
+        /**
+         * @param key - secret key, of any length
+         */
+        explicit HmacSha256(std::string_view key);
+        ~HmacSha256();
+
+        HmacSha256(const HmacSha256 &) = delete;
+        HmacSha256 &operator=(const HmacSha256 &) = delete;
+
+        /**
+         * Compute the signature of a message
+         *
+         * @param message - data to sign
+         *
+         * @return signature bytes.
+         */
+        [[nodiscard]]
+        Digest sign(std::string_view message) const;
+
+        /**
+         * Check a signature in constant time, so that timing does not reveal
+         * how many leading bytes of a forged signature were correct.
+         *
+         * @param message   - data that was signed
+         * @param signature - signature to check
+         * @param size      - byte size of `signature`
+         *
+         * @return whether `signature` is the signature of `message`.
+         */
+        [[nodiscard]]
+        bool verify(std::string_view message, const void *signature,
+            size_t size) const;
+
+    private:
+        SHA256_CTX m_inner;
+        SHA256_CTX m_outer;
+    };
+}
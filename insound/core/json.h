@@ -16,6 +16,7 @@
 #include <glaze/util/type_traits.hpp>
 
 // json-serializable stl templates built in to glaze
+#include <algorithm>
 #include <array>
 #include <concepts>
 #include <deque>
@@ -117,6 +118,21 @@ namespace Insound::JSON
         return glz::write_json(obj);
     }
 
+    /**
+     * Stringify a JSON-serializable object into an existing buffer, reusing
+     * its capacity. The buffer's previous contents are replaced.
+     *
+     * @param obj    - object to serialize
+     * @param buffer - string to write to
+     */
+    template <Serializable T>
+    inline
+    void stringify(const T &obj, std::string &buffer)
+    {
+        buffer.clear();
+        (void)glz::write_json(obj, buffer);
+    }
+
     /**
      * Parse JSON-serializable object into a JSON string.
      *
@@ -160,4 +176,118 @@ namespace Insound::JSON
     {
         return glz::read<O>(json, obj);
     }
+
+
+    // ===== Compile-time literals ============================================
+
+    /**
+     * String literal usable as a template parameter, e.g. `Literal<"hi">`
+     */
+    template <size_t N>
+    struct FixedString
+    {
+        char value[N]{};
+
+        consteval FixedString(const char (&str)[N])
+        {
+            std::copy_n(str, N, value);
+        }
+
+        [[nodiscard]]
+        constexpr std::string_view view() const { return {value, N - 1}; }
+    };
+
+    namespace detail
+    {
+        /**
+         * Get the escape sequence of a character inside a JSON string, or
+         * nullptr if it is written as is
+         */
+        constexpr const char *escapeChar(char c)
+        {
+            switch(c)
+            {
+                case '"':  return "\\\"";
+                case '\\': return "\\\\";
+                case '\b': return "\\b";
+                case '\f': return "\\f";
+                case '\n': return "\\n";
+                case '\r': return "\\r";
+                case '\t': return "\\t";
+                default:   return nullptr;
+            }
+        }
+
+        constexpr bool isControl(char c)
+        {
+            return (unsigned char)c < 0x20;
+        }
+
+        /**
+         * Size of a string once written as a quoted JSON string
+         */
+        constexpr size_t quotedSize(std::string_view str)
+        {
+            size_t size = 2;
+            for (auto c : str)
+            {
+                if (auto esc = escapeChar(c))
+                    size += std::string_view(esc).size();
+                else if (isControl(c))
+                    size += 6; // \u00XX
+                else
+                    ++size;
+            }
+
+            return size;
+        }
+
+        template <size_t Size>
+        constexpr std::array<char, Size> quote(std::string_view str)
+        {
+            constexpr char hex[] = "0123456789abcdef";
+
+            std::array<char, Size> res{};
+            size_t i = 0;
+            res[i++] = '"';
+            for (auto c : str)
+            {
+                if (auto esc = escapeChar(c))
+                {
+                    for (; *esc; ++esc)
+                        res[i++] = *esc;
+                }
+                else if (isControl(c))
+                {
+                    for (auto e : {'\\', 'u', '0', '0'})
+                        res[i++] = e;
+                    res[i++] = hex[((unsigned char)c >> 4) & 0xF];
+                    res[i++] = hex[(unsigned char)c & 0xF];
+                }
+                else
+                {
+                    res[i++] = c;
+                }
+            }
+            res[i++] = '"';
+
+            return res;
+        }
+
+        template <FixedString Str>
+        struct Literal
+        {
+            static constexpr auto data =
+                quote<quotedSize(Str.view())>(Str.view());
+        };
+    }
+
+    /**
+     * JSON string literal of `Str`, escaped and quoted at compile time.
+     *
+     * @example `JSON::literal<"Success">` is `"\"Success\""`
+     */
+    template <FixedString Str>
+    inline constexpr std::string_view literal{
+        detail::Literal<Str>::data.data(), detail::Literal<Str>::data.size()};
 }
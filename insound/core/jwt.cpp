@@ -1,67 +1,170 @@
 #include "jwt.h"
+#include <insound/core/base64.h>
+#include <insound/core/hmac.h>
+#include <insound/core/revocation.h>
 #include <insound/core/errors/GlazeError.h>
 #include <insound/core/errors/JwtError.h>
 #include <insound/core/settings.h>
-#include <insound/core/thirdparty/glaze.traits.h>
 
-#include <jwt-cpp/jwt.h>
+#include <openssl/rand.h>
 
 #include <chrono>
 #include <cstdint>
-#include <sstream>
-#include <typeinfo>
-#include <typeindex>
+#include <cstring>
+#include <iterator>
+#include <optional>
 #include <utility>
 
 namespace Insound::Jwt
 {
+    // base64url of {"alg":"HS256","typ":"JWT"}, the same for every token
+    static constexpr std::string_view Header =
+        "eyJhbGciOiJIUzI1NiIsInR5cCI6IkpXVCJ9";
 
-    std::string verify(std::string_view token)
+    // Longest header accepted when it isn't the one above
+    static constexpr size_t MaxHeaderSize = 256;
+
+    struct TokenHeader {
+        std::string alg;
+        IN_JSON_LOCAL_META(TokenHeader, alg);
+    };
+
+    struct TokenClaims {
+        std::optional<long long> exp;
+
+        // Points into the payload. Ids are base64url, so never escaped.
+        std::string_view jti;
+        IN_JSON_LOCAL_META(TokenClaims, exp, jti);
+    };
+
+    // Random bytes in each token id
+    static constexpr size_t IdSize = 16;
+
+    static constexpr JSON::Opts ClaimOpts {
+        .error_on_unknown_keys=false,
+        .error_on_missing_keys=false
+    };
+
+    static const HmacSha256 &secret()
     {
-        static const auto verifier = jwt::verify<glaze_traits>()
-            .allow_algorithm(jwt::algorithm::hs256{
-                Settings::jwtSecret().data()
-            });
+        static const HmacSha256 key(Settings::jwtSecret());
+        return key;
+    }
 
-        std::optional<jwt::decoded_jwt<glaze_traits>> decoded;
-        try {
-            decoded = jwt::decode<glaze_traits>(token.data());
+    /**
+     * Check a header that differs from ours, e.g. with other key order
+     */
+    static bool isHS256(std::string_view header)
+    {
+        char buffer[Base64Url::decodedSize(MaxHeaderSize) + 1];
+        size_t size;
+        if (header.size() > MaxHeaderSize ||
+            !Base64Url::decode(header, buffer, size))
+        {
+            return false;
         }
-        catch (const std::invalid_argument &e)
+
+        buffer[size] = '\0';
+        TokenHeader parsed;
+        auto err = glz::read<ClaimOpts>(parsed, std::string_view(buffer, size));
+
+        return err.ec == JSON::ErrorCode::none && parsed.alg == "HS256";
+    }
+
+    /**
+     * Verify a token, reading its registered claims into `claims`
+     */
+    static std::string_view verifyClaims(std::string_view token,
+        TokenClaims &claims)
+    {
+        auto headerEnd = token.find('.');
+        auto payloadEnd = token.rfind('.');
+        if (headerEnd == std::string_view::npos || headerEnd == payloadEnd)
+            throw Jwt::Error(Jwt::Error::Code::BadTokenFormat);
+
+        auto header = token.substr(0, headerEnd);
+        auto payload = token.substr(headerEnd + 1, payloadEnd - headerEnd - 1);
+        auto signature = token.substr(payloadEnd + 1);
+
+        if (header != Header && !isHS256(header))
+        {
+            throw Jwt::Error(Jwt::Error::Code::VerificationFailure,
+                "unsupported header");
+        }
+
+        // Nothing is parsed before the signature checks out
+        unsigned char mac[HmacSha256::Size];
+        size_t macSize;
+        if (signature.size() != Base64Url::encodedSize(HmacSha256::Size) ||
+            !Base64Url::decode(signature, mac, macSize))
         {
             throw Jwt::Error(Jwt::Error::Code::BadTokenFormat);
         }
-        catch (const std::runtime_error &e)
+
+        if (!secret().verify(token.substr(0, payloadEnd), mac, macSize))
         {
-            throw Jwt::Error(Jwt::Error::Code::ConversionFailure);
+            throw Jwt::Error(Jwt::Error::Code::VerificationFailure,
+                "signature mismatch");
         }
 
-        // check for expiration explicitly here for fine-grained error message
-        auto exp = decoded.value().get_expires_at().time_since_epoch();
-        auto now = std::chrono::system_clock::now().time_since_epoch();
+        thread_local std::string json;
+        if (!Base64Url::decode(payload, json))
+            throw Jwt::Error(Jwt::Error::Code::ConversionFailure);
 
-        if ((now - exp).count() >= 0) // expired
+        auto err = glz::read<ClaimOpts>(claims, json);
+        if (err.ec != JSON::ErrorCode::none)
+            throw Jwt::Error(Jwt::Error::Code::ConversionFailure);
+        if (!claims.exp)
         {
-            throw Jwt::Error(Jwt::Error::Code::TokenExpired);
+            throw Jwt::Error(Jwt::Error::Code::VerificationFailure,
+                "missing exp claim");
         }
 
+        auto now = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        if (now >= *claims.exp)
+            throw Jwt::Error(Jwt::Error::Code::TokenExpired);
+
+        if (!claims.jti.empty() && Revocation::isRevoked(claims.jti))
+            throw Jwt::Error(Jwt::Error::Code::TokenRevoked);
+
+        return json;
+    }
+
+    std::string_view detail::verify(std::string_view token)
+    {
+        TokenClaims claims;
+        return verifyClaims(token, claims);
+    }
+
+    bool revoke(std::string_view token)
+    {
+        TokenClaims claims;
         try {
-            verifier.verify(*decoded);
+            verifyClaims(token, claims);
         }
-        catch (const std::system_error &e)
+        catch (const Error &error)
         {
-            throw Jwt::Error(Jwt::Error::Code::VerificationFailure, e.what());
+            return error.code() == Error::Code::TokenRevoked;
         }
 
-        return decoded->get_payload();
+        if (claims.jti.empty())
+            return false;
+
+        return Revocation::revoke(claims.jti, *claims.exp);
+    }
+
+    std::string verify(std::string_view token)
+    {
+        return std::string(detail::verify(token));
     }
 
     Error::Code verify(std::string_view token, std::string &buffer)
     {
         try {
-            buffer = std::move(verify(token));
+            buffer = detail::verify(token);
         }
-        catch (Error error)
+        catch (const Error &error)
         {
             return error.code();
         }
@@ -69,27 +172,84 @@ namespace Insound::Jwt
         return Error::Code::OK;
     }
 
-    std::string sign(std::string_view payloadStr, long long duration)
+    static bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    std::string detail::sign(std::string &json, long long duration)
     {
-        using std::chrono::system_clock;
-        using std::chrono::microseconds;
+        using namespace std::chrono;
 
-        static auto algo = jwt::algorithm::hs256{Settings::jwtSecret().data()};
+        while (!json.empty() && isSpace(json.back()))
+            json.pop_back();
+
+        size_t start = 0;
+        while (start < json.size() && isSpace(json[start]))
+            ++start;
+
+        if (json.size() - start < 2 || json[start] != '{' ||
+            json.back() != '}')
+        {
+            throw Jwt::Error(Jwt::Error::Code::ConversionFailure,
+                "payload must be a JSON object");
+        }
 
         auto now = system_clock::now();
-        auto expires_at = now + microseconds{duration};
+        auto issuedAt = duration_cast<seconds>(now.time_since_epoch());
+        auto expiresAt = duration_cast<seconds>(
+            (now + microseconds{duration}).time_since_epoch());
+
+        // Splice the claims into the end of the object
+        json.pop_back();
+        bool empty = true;
+        for (auto i = start + 1; i < json.size(); ++i)
+        {
+            if (!isSpace(json[i]))
+            {
+                empty = false;
+                break;
+            }
+        }
+
+        // Unique id, so the token can be revoked
+        unsigned char id[IdSize];
+        if (RAND_bytes(id, IdSize) != 1)
+        {
+            throw Jwt::Error(Jwt::Error::Code::ConversionFailure,
+                "failed to generate token id");
+        }
+
+        char jti[Base64Url::encodedSize(IdSize)];
+        Base64Url::encode(id, IdSize, jti);
 
-        glz::json_t payload;
-        auto err = glz::read_json<glz::json_t>(payload, payloadStr);
-        if (err.ec != glz::error_code::none)
-            throw GlazeError(err, payloadStr);
+        fmt::format_to(std::back_inserter(json),
+            "{}\"iat\":{},\"exp\":{},\"jti\":\"{}\"}}",
+            empty ? "" : ",", issuedAt.count(), expiresAt.count(),
+            std::string_view(jti, sizeof(jti)));
 
-        auto builder = jwt::builder<glaze_traits>(
-                payload.as<glz::json_t::object_t>())
-            .set_type("JWT")
-            .set_issued_at(now)
-            .set_expires_at(expires_at);
+        // Encode straight into the token: header.payload.signature
+        auto payloadSize = Base64Url::encodedSize(json.size());
+        auto signedSize = Header.size() + 1 + payloadSize;
+
+        std::string token(signedSize + 1 +
+            Base64Url::encodedSize(HmacSha256::Size), '.');
+        std::memcpy(token.data(), Header.data(), Header.size());
+        Base64Url::encode(json.data(), json.size(),
+            token.data() + Header.size() + 1);
+
+        auto signature = secret().sign({token.data(), signedSize});
+        Base64Url::encode(signature.data(), signature.size(),
+            token.data() + signedSize + 1);
+
+        return token;
+    }
+
+    std::string sign(std::string_view payloadStr, long long duration)
+    {
+        thread_local std::string json;
+        json.assign(payloadStr);
 
-        return builder.sign(algo);
+        return detail::sign(json, duration);
     }
 }
@@ -13,6 +13,34 @@
 
 namespace Insound::Jwt
 {
+    namespace detail {
+        /**
+         * Verify an HS256 token's signature, then decode its payload and
+         * check that it has not expired. The payload is only decoded and
+         * parsed once the signature is known to be good.
+         *
+         * @param jwt - the token string
+         *
+         * @return payload JSON, in a per-thread buffer that is valid until
+         *         the next call on the same thread.
+         *
+         * @throws Jwt::Error if the token is malformed, forged, expired or
+         *         revoked
+         */
+        std::string_view verify(std::string_view jwt);
+    }
+
+    /**
+     * Revoke a valid token, so it fails verification from now on, on every
+     * server instance. See `Revocation` for details.
+     *
+     * @param jwt - the token string
+     *
+     * @return whether the token is revoked. False if the token was invalid,
+     *         or the revocation could not be saved.
+     */
+    bool revoke(std::string_view jwt);
+
     /**
      * Attempts to decode and verify a JSON web token.
      * @param  jwt - the base64-encoded token string
@@ -52,14 +80,13 @@ namespace Insound::Jwt
     }>
     inline T verify(std::string_view jwt)
     {
-        std::string payloadStr = verify(jwt);
+        auto payload = detail::verify(jwt);
 
         T res;
-        glz::context ctx{};
-        auto error = glz::read<O>(res, payloadStr, ctx);
+        auto error = glz::read<O>(res, payload);
 
-        if (error != glz::error_code::none)
-            throw GlazeError(error, payloadStr);
+        if (error.ec != JSON::ErrorCode::none)
+            throw GlazeError(error, payload);
 
         return res;
     }
@@ -85,7 +112,7 @@ namespace Insound::Jwt
     inline Error::Code verify(std::string_view jwt, T &output)
     {
         try {
-            auto obj = verify<T, O>(jwt);
+            output = verify<T, O>(jwt);
         }
         catch (const Jwt::Error &e)
         {
@@ -96,11 +123,27 @@ namespace Insound::Jwt
     }
 
 
+    namespace detail {
+        /**
+         * Add the `iat`, `exp` and `jti` claims to a JSON object payload, then
+         * encode and sign it as an HS256 token.
+         *
+         * @param json      - payload JSON object, modified in place
+         * @param expiresIn - microseconds from now until expiration
+         *
+         * @throws Jwt::Error if `json` is not an object
+         */
+        std::string sign(std::string &json, long long expiresIn);
+    }
+
+
     /**
      * Sign a JSON web token with payload, which expires after the
      * duration specified.
-     * @param   payloadStr - the payload as a json string
+     * @param   payloadStr - the payload as a json object string
      * @param   expiresIn  - microseconds from now until expiration
+     *
+     * @throws Jwt::Error if `payloadStr` is not a JSON object
      */
     std::string sign(std::string_view payloadStr, long long expiresIn);
 
@@ -111,22 +154,25 @@ namespace Insound::Jwt
 
 
     /**
-     * Signs a token with an object as a payload.
+     * Signs a token with an object as a payload. The payload is written once
+     * into a reused per-thread buffer, the claims are appended to it, and the
+     * token is encoded and signed straight into the returned string.
      *
-     * @tname   T         - must be registered with glz::meta specialization
+     * @tname   T         - must be registered with glz::meta specialization,
+     *                      and must not have `iat`, `exp` or `jti` fields,
+     *                      which are set by the signer
      * @param   payload   - the object to read data into the token from
      * @param   expiresIn - microseconds from now until expiration
      *
      * @returns a string of the json web token
-     *
-     * @throws system_error on any problem during jwt conversion/verification
      */
     template<JSON::Specialized T>
     inline std::string sign(const T &payload, long long expiresIn)
     {
-        auto payloadStr = glz::write_json(payload);
+        thread_local std::string json;
+        JSON::stringify(payload, json);
 
-        return sign(std::string_view(payloadStr), expiresIn);
+        return detail::sign(json, expiresIn);
     }
 
     /**
@@ -143,14 +189,14 @@ namespace Insound::Jwt
     template <JSON::Specialized T>
     inline Error::Code sign(const T&payload, long long expiresIn, std::string &output)
     {
-        auto payloadStr = glz::write_json(payload);
-
         try {
-            output = std::move(sign(std::string_view(payloadStr), expiresIn));
+            output = sign(payload, expiresIn);
         }
-        catch (const std::system_error &e)
+        catch (const Jwt::Error &e)
         {
-            return Error::Code::VerificationFailure;
+            return e.code();
         }
+
+        return Error::Code::OK;
     }
 }
@@ -0,0 +1,68 @@
+#include "BodyLimit.h"
+
+#include <insound/core/HttpStatus.h>
+#include <insound/core/RouteLimits.h>
+#include <insound/core/log.h>
+
+#include <crow/http_request.h>
+#include <crow/http_response.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace Insound {
+
+    /**
+     * Get the declared Content-Length, or the actual body size if the header
+     * is missing (e.g. chunked transfer encoding)
+     */
+    static size_t getBodySize(const crow::request &req)
+    {
+        auto header = req.get_header_value("Content-Length");
+        if (header.empty())
+            return req.body.size();
+
+        char *end;
+        auto length = std::strtoull(header.c_str(), &end, 10);
+        if (end == header.c_str())
+            return req.body.size();
+
+        return std::max((size_t)length, req.body.size());
+    }
+
+    void BodyLimit::before_handle(crow::request &req, crow::response &res,
+        context &ctx)
+    {
+        auto size = getBodySize(req);
+        if (size == 0) return;
+
+        auto route = RouteLimits::find(req.url);
+        auto limit = (route && route->maxBodySize) ? route->maxBodySize :
+            m_defaultLimit;
+
+        if (limit && size > limit)
+        {
+            IN_WARN("Rejected request to {}: body of {} bytes exceeds limit "
+                "of {} bytes", req.url, size, limit);
+            res.code = (int)HttpStatus::PayloadTooLarge;
+            res.set_header("Connection", "close");
+            return res.end("Payload too large.");
+        }
+
+        ctx.ticket = m_budget.acquire(size, m_wait);
+        if (!ctx.ticket)
+        {
+            IN_WARN("Rejected request to {}: upload budget exhausted",
+                req.url);
+            res.code = (int)HttpStatus::ServiceUnavailable;
+            res.set_header("Retry-After", "1");
+            return res.end("Server busy, please try again.");
+        }
+    }
+
+    void BodyLimit::after_handle(crow::request &req, crow::response &res,
+        context &ctx)
+    {
+        ctx.ticket.release();
+    }
+}
@@ -0,0 +1,74 @@
+/**
+ * @file BodyLimit.h
+ *
+ * Contains crow middleware class `BodyLimit`, which rejects requests whose
+ * body exceeds the limit of its route, and applies backpressure when too many
+ * request body bytes are being processed at once.
+ */
+#pragma once
+#include <insound/core/ByteBudget.h>
+
+#include <crow/middleware.h>
+
+#include <chrono>
+#include <cstddef>
+
+namespace Insound {
+
+    /**
+     * Checks the declared Content-Length of each request against the limit
+     * registered for its route in `RouteLimits` (or the default limit), and
+     * responds with 413 Payload Too Large when it is exceeded. This happens
+     * before any other middleware or route touches the body.
+     *
+     * Requests that carry a body then reserve its size from a global upload
+     * budget for the duration of the request. If the budget stays exhausted
+     * past the wait timeout, the request receives 503 Service Unavailable
+     * with a Retry-After header.
+     */
+    class BodyLimit
+    {
+    public:
+        struct context
+        {
+            ByteBudget::Ticket ticket;
+        };
+
+        BodyLimit() : m_defaultLimit(), m_budget(), m_wait() { }
+
+        /**
+         * Set the limits. Should be called before the server starts.
+         *
+         * @param defaultLimit - max body size of routes without their own
+         *                       limit, 0 for no limit
+         * @param budget       - total body bytes that may be in flight,
+         *                       0 for no limit
+         * @param wait         - how long a request waits for budget before
+         *                       being turned away
+         */
+        void configure(size_t defaultLimit, size_t budget,
+            std::chrono::milliseconds wait)
+        {
+            m_defaultLimit = defaultLimit;
+            m_budget.capacity(budget);
+            m_wait = wait;
+        }
+
+        /**
+         * Bytes of request bodies currently in flight
+         */
+        [[nodiscard]]
+        size_t inFlight() const { return m_budget.used(); }
+
+        void before_handle(crow::request &req, crow::response &res,
+            context &ctx);
+
+        void after_handle(crow::request &req, crow::response &res,
+            context &ctx);
+
+    private:
+        size_t m_defaultLimit;
+        ByteBudget m_budget;
+        std::chrono::milliseconds m_wait;
+    };
+}
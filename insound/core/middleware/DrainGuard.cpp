@@ -0,0 +1,35 @@
+#include "DrainGuard.h"
+
+#include <insound/core/HttpStatus.h>
+#include <insound/core/Lifecycle.h>
+
+#include <crow/http_request.h>
+#include <crow/http_response.h>
+
+namespace Insound {
+
+    void DrainGuard::before_handle(crow::request &req, crow::response &res,
+        context &ctx)
+    {
+        if (Lifecycle::isDraining())
+        {
+            res.code = (int)HttpStatus::ServiceUnavailable;
+            res.set_header("Connection", "close");
+            res.set_header("Retry-After", "1");
+            return res.end("Server is restarting, please try again.");
+        }
+
+        Lifecycle::requestStarted();
+        ctx.counted = true;
+    }
+
+    void DrainGuard::after_handle(crow::request &req, crow::response &res,
+        context &ctx)
+    {
+        if (ctx.counted)
+        {
+            ctx.counted = false;
+            Lifecycle::requestEnded();
+        }
+    }
+}
@@ -0,0 +1,32 @@
+/**
+ * @file DrainGuard.h
+ *
+ * Contains crow middleware class `DrainGuard`, which counts in-flight requests
+ * and turns away new ones while the app is shutting down.
+ */
+#pragma once
+#include <crow/middleware.h>
+
+namespace Insound {
+
+    /**
+     * Tracks each request in `Lifecycle`. Once `Lifecycle::beginDrain` has
+     * been called, new requests receive 503 Service Unavailable with
+     * "Connection: close", so clients and load balancers move on to another
+     * instance while in-flight requests finish.
+     */
+    class DrainGuard
+    {
+    public:
+        struct context
+        {
+            bool counted = false;
+        };
+
+        void before_handle(crow::request &req, crow::response &res,
+            context &ctx);
+
+        void after_handle(crow::request &req, crow::response &res,
+            context &ctx);
+    };
+}
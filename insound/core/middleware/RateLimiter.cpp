@@ -0,0 +1,71 @@
+#include "RateLimiter.h"
+
+#include <insound/core/HttpStatus.h>
+#include <insound/core/RouteLimits.h>
+#include <insound/core/log.h>
+
+#include <crow/http_request.h>
+#include <crow/http_response.h>
+
+#include <algorithm>
+#include <string_view>
+
+namespace Insound {
+
+    static std::string_view trim(std::string_view str)
+    {
+        auto begin = str.find_first_not_of(' ');
+        if (begin == std::string_view::npos)
+            return {};
+        auto end = str.find_last_not_of(' ');
+        return str.substr(begin, end - begin + 1);
+    }
+
+    std::string RateLimiter::clientIp(const crow::request &req) const
+    {
+        if (m_trustProxy)
+        {
+            // The proxy appends the address it received the request from.
+            // Entries before it are sent by the client, which can forge them
+            // to dodge its bucket, so only the right-most one is used.
+            auto &forwarded = req.get_header_value("X-Forwarded-For");
+            auto comma = forwarded.rfind(',');
+            auto ip = trim(std::string_view(forwarded).substr(
+                comma == std::string::npos ? 0 : comma + 1));
+            if (!ip.empty())
+                return std::string(ip);
+        }
+
+        return req.remote_ip_address;
+    }
+
+    void RateLimiter::limit(crow::request &req, crow::response &res,
+        const UserToken &user)
+    {
+        auto route = RouteLimits::find(req.url);
+        if (!route || !route->rate.enabled()) return;
+
+        // Limits are registered once at startup, so the address of the
+        // route's limit identifies the route for all requests
+        auto routeId = (const void *)route;
+
+        auto result = m_buckets.take(
+            sf("{}:ip:{}", routeId, clientIp(req)), route->rate);
+
+        if (result.allowed && user.type != User::Type::Guest &&
+            !user.username.empty())
+        {
+            result = m_buckets.take(
+                sf("{}:user:{}", routeId, user.username), route->rate);
+        }
+
+        if (!result.allowed)
+        {
+            IN_WARN("Rate limited request to {} from {}", req.url,
+                req.remote_ip_address);
+            res.code = (int)HttpStatus::TooManyRequests;
+            res.set_header("Retry-After", std::to_string(result.retryAfter));
+            return res.end("Too many requests, please try again later.");
+        }
+    }
+}
@@ -0,0 +1,73 @@
+/**
+ * @file RateLimiter.h
+ *
+ * Contains crow middleware class `RateLimiter`, which throttles clients on
+ * routes that declare a rate limit via `Router::limit`.
+ */
+#pragma once
+#include <insound/core/TokenBuckets.h>
+#include <insound/core/middleware/UserAuth.h>
+
+#include <crow/middleware.h>
+
+#include <string>
+
+namespace Insound {
+
+    /**
+     * Applies the `RouteLimit::rate` of the current route with one token
+     * bucket per client ip, and one per logged-in user, so that a user cannot
+     * get around the limit by switching networks, and clients behind a shared
+     * ip are not all throttled by a single user. When either bucket is empty,
+     * the request receives 429 Too Many Requests with a Retry-After header.
+     *
+     * Must come after `UserAuth` in the middleware list.
+     */
+    class RateLimiter
+    {
+    public:
+        struct context { };
+
+        RateLimiter() : m_buckets(), m_trustProxy() { }
+
+        /**
+         * Set options. Should be called before the server starts.
+         *
+         * @param trustProxy - whether to identify clients by the address a
+         *                     single reverse proxy appends to
+         *                     X-Forwarded-For, instead of the connection's
+         *                     ip address
+         */
+        void configure(bool trustProxy)
+        {
+            m_trustProxy = trustProxy;
+        }
+
+        template <typename AllContext>
+        void before_handle(crow::request &req, crow::response &res,
+            context &ctx, AllContext &all)
+        {
+            auto &user = all.template get<UserAuth>().user;
+            limit(req, res, user);
+        }
+
+        void after_handle(crow::request &req, crow::response &res,
+            context &ctx) { }
+
+        /**
+         * Client buckets, exposed for inspection
+         */
+        [[nodiscard]]
+        const TokenBuckets &buckets() const { return m_buckets; }
+
+    private:
+        void limit(crow::request &req, crow::response &res,
+            const UserToken &user);
+
+        [[nodiscard]]
+        std::string clientIp(const crow::request &req) const;
+
+        TokenBuckets m_buckets;
+        bool m_trustProxy;
+    };
+}
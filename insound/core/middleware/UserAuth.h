@@ -6,7 +6,7 @@
 
 namespace Insound {
 
-    class UserAuth : crow::ILocalMiddleware
+    class UserAuth
     {
     public:
         struct context
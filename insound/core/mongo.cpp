@@ -73,6 +73,12 @@ namespace Insound::Mongo
         return sClient.connect();
     }
 
+    void disconnect()
+    {
+        entry.reset();
+        sClient.disconnect();
+    }
+
     mongocxx::database db()
     {
         return sClient.db();
@@ -21,4 +21,10 @@ namespace Insound::Mongo
      * @returns whether call was successful.
      */
     bool connect();
+
+    /**
+     * Release the connection pool. Must only be called once no threads use
+     * the database anymore, e.g. during app shutdown.
+     */
+    void disconnect();
 }
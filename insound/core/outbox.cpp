@@ -0,0 +1,342 @@
+#include "outbox.h"
+
+#include <insound/core/mongo.h>
+#include <insound/core/mongo/Model.h>
+#include <insound/core/request.h>
+#include <insound/core/schemas/OutboxEmail.json.h>
+#include <insound/core/settings.h>
+
+#include <bsoncxx/builder/basic/array.hpp>
+#include <bsoncxx/builder/basic/document.hpp>
+#include <bsoncxx/builder/basic/kvp.hpp>
+#include <mongocxx/collection.hpp>
+#include <mongocxx/options/find_one_and_update.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace Insound::Email::Outbox {
+
+    using bsoncxx::builder::basic::kvp;
+    using bsoncxx::builder::basic::make_array;
+    using bsoncxx::builder::basic::make_document;
+
+    using OutboxDoc = Mongo::Document<OutboxEmail>;
+
+    static std::mutex sMutex;
+    static std::condition_variable sWake;
+    static std::vector<std::thread> sThreads;
+    static bool sRunning;
+
+    // Emails enqueued by this process that no dispatcher has woken for yet
+    static size_t sSignals;
+
+    // Only written by `start` while no dispatchers are running
+    static OutboxOpts sOpts;
+
+    static int64_t nowMs()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    static mongocxx::collection collection()
+    {
+        return Mongo::db().collection(glz::meta<OutboxEmail>::name);
+    }
+
+    /**
+     * Delay before the next attempt, doubling each attempt
+     */
+    static int64_t backoff(unsigned attempts)
+    {
+        auto shift = std::min(attempts > 0 ? attempts - 1 : 0u, 20u);
+        auto delay = std::min<int64_t>(sOpts.baseBackoff.count() << shift,
+            sOpts.maxBackoff.count());
+
+        // Jitter keeps emails that failed together from retrying in lockstep
+        thread_local std::mt19937_64 rng{std::random_device{}()};
+        return delay +
+            std::uniform_int_distribution<int64_t>(0, delay / 4)(rng);
+    }
+
+    /**
+     * Claim up to `max` emails that are due, or whose claim expired. Each
+     * claim is a single atomic update, so dispatchers in any process never
+     * claim the same email.
+     */
+    static std::vector<OutboxDoc> claim(mongocxx::collection &outbox,
+        size_t max)
+    {
+        auto now = nowMs();
+        auto filter = make_document(kvp("$or", make_array(
+            make_document(
+                kvp("status", "Pending"),
+                kvp("nextAttempt", make_document(kvp("$lte", now)))),
+            make_document(
+                kvp("status", "Sending"),
+                kvp("lockedUntil", make_document(kvp("$lte", now)))))));
+
+        auto update = make_document(
+            kvp("$set", make_document(
+                kvp("status", "Sending"),
+                kvp("lockedUntil", now + (int64_t)sOpts.lease.count()))),
+            kvp("$inc", make_document(kvp("attempts", 1))));
+
+        mongocxx::options::find_one_and_update opts;
+        opts.return_document(mongocxx::options::return_document::k_after);
+        opts.sort(make_document(kvp("nextAttempt", 1)));
+
+        std::vector<OutboxDoc> res;
+        while (res.size() < max)
+        {
+            auto doc = outbox.find_one_and_update(filter.view(), update.view(),
+                opts);
+            if (!doc) break;
+
+            res.emplace_back(OutboxDoc::fromBson(doc->view()));
+        }
+
+        return res;
+    }
+
+    /**
+     * Filter matching an email only while this dispatcher's claim on it
+     * holds. Once the lease expired and another dispatcher claimed it,
+     * `lockedUntil` differs.
+     */
+    static bsoncxx::document::value claimed(const OutboxDoc &doc)
+    {
+        return make_document(
+            kvp("_id", doc.id.oid().value()),
+            kvp("status", "Sending"),
+            kvp("lockedUntil", doc.body.lockedUntil));
+    }
+
+    /**
+     * Extend the claim on an email by a full lease, before sending it
+     *
+     * @return whether the claim still held, i.e. the email may be sent.
+     */
+    static bool renew(mongocxx::collection &outbox, OutboxDoc &doc)
+    {
+        auto lockedUntil = nowMs() + (int64_t)sOpts.lease.count();
+        auto result = outbox.update_one(claimed(doc).view(), make_document(
+            kvp("$set", make_document(
+                kvp("lockedUntil", lockedUntil)))).view());
+        if (!result || result->modified_count() == 0)
+            return false;
+
+        doc.body.lockedUntil = lockedUntil;
+        return true;
+    }
+
+    /**
+     * Remove sent emails, or schedule failed ones for a retry. Emails whose
+     * claim was taken over are left to their new dispatcher.
+     */
+    static void finish(mongocxx::collection &outbox, std::span<OutboxDoc> docs,
+        bool sent, std::string_view error)
+    {
+        for (auto &doc : docs)
+        {
+            auto filter = claimed(doc);
+            if (sent)
+            {
+                outbox.delete_one(filter.view());
+                continue;
+            }
+
+            auto attempts = doc.body.attempts;
+            if (attempts >= sOpts.maxAttempts)
+            {
+                IN_ERR("Giving up on email to {} after {} attempts: {}",
+                    doc.body.message.to.value_or(""), attempts, error);
+                outbox.update_one(filter.view(), make_document(
+                    kvp("$set", make_document(
+                        kvp("status", "Failed"),
+                        kvp("lastError", error)))).view());
+            }
+            else
+            {
+                outbox.update_one(filter.view(), make_document(
+                    kvp("$set", make_document(
+                        kvp("status", "Pending"),
+                        kvp("nextAttempt", nowMs() + backoff(attempts)),
+                        kvp("lastError", error)))).view());
+            }
+        }
+    }
+
+    /**
+     * Post a payload to the provider
+     *
+     * @return whether it was accepted. Otherwise `error` receives why not.
+     */
+    static bool send(MakeRequest &request, std::string_view url,
+        const std::string &payload, std::string &error)
+    {
+        try {
+            if (post(request, url, payload))
+                return true;
+            error = sf("Provider responded with {}", request.getCode());
+        }
+        catch(const std::exception &e)
+        {
+            error = e.what();
+        }
+
+        return false;
+    }
+
+    static void dispatch(MakeRequest &request, mongocxx::collection &outbox,
+        std::vector<OutboxDoc> &batch)
+    {
+        std::string error;
+        if (batch.size() > 1 && !sOpts.batchEndpoint.empty())
+        {
+            // A single request, which the claim's lease covers
+            std::vector<SendEmailOpts> messages;
+            messages.reserve(batch.size());
+            for (auto &doc : batch)
+                messages.emplace_back(doc.body.message);
+
+            if (send(request, sOpts.batchEndpoint, JSON::stringify(messages),
+                error))
+            {
+                finish(outbox, batch, true, {});
+                return;
+            }
+
+            // One bad message can fail the whole batch, so the others are
+            // not held back with it
+            IN_WARN("Batch of {} emails failed, sending them one at a time: "
+                "{}", batch.size(), error);
+        }
+
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            // Sending the batch one by one may outlast the claim's lease
+            if (!renew(outbox, batch[i]))
+                continue;
+
+            auto sent = send(request, sOpts.endpoint,
+                JSON::stringify(batch[i].body.message), error);
+            finish(outbox, std::span(batch).subspan(i, 1), sent, error);
+        }
+    }
+
+    static void run()
+    {
+        // Reused for every send, keeping the connection to the provider open
+        MakeRequest request;
+
+        while (true)
+        {
+            {
+                std::lock_guard lock(sMutex);
+                if (!sRunning) break;
+            }
+
+            try {
+                auto outbox = collection();
+                auto batch = claim(outbox, sOpts.batchSize);
+                if (!batch.empty())
+                {
+                    dispatch(request, outbox, batch);
+                    continue;
+                }
+            }
+            catch(const std::exception &e)
+            {
+                // Claimed emails are retried once their lease expires
+                IN_ERR("Email outbox error: {}", e.what());
+            }
+
+            std::unique_lock lock(sMutex);
+            sWake.wait_for(lock, sOpts.pollInterval, []() {
+                return !sRunning || sSignals > 0;
+            });
+
+            if (sSignals > 0)
+                --sSignals;
+        }
+    }
+
+    void start(const OutboxOpts &opts)
+    {
+        std::lock_guard lock(sMutex);
+        if (sRunning) return;
+
+        sOpts = opts;
+        sOpts.batchSize = std::max<size_t>(sOpts.batchSize, 1);
+        if (sOpts.endpoint.empty())
+            sOpts.endpoint = Settings::emailEndpointURL();
+        if (sOpts.batchEndpoint.empty())
+            sOpts.batchEndpoint = Settings::emailBatchEndpointURL();
+
+        // Creates the collection if needed
+        Mongo::Model<OutboxEmail> OutboxModel;
+        collection().create_index(make_document(
+            kvp("status", 1), kvp("nextAttempt", 1)).view());
+
+        sRunning = true;
+        sSignals = 0;
+        for (unsigned i = 0; i < std::max(sOpts.workers, 1u); ++i)
+            sThreads.emplace_back(run);
+
+        IN_LOG("Email outbox started with {} dispatchers", sThreads.size());
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard lock(sMutex);
+            if (!sRunning) return;
+            sRunning = false;
+        }
+
+        sWake.notify_all();
+        for (auto &thread : sThreads)
+            thread.join();
+        sThreads.clear();
+    }
+
+    bool enqueue(const SendEmail &email)
+    {
+        try {
+            OutboxEmail entry;
+            entry.message = email.options();
+            entry.nextAttempt = nowMs();
+
+            Mongo::Model<OutboxEmail> OutboxModel;
+            if (!OutboxModel.insertOne(entry))
+                return false;
+        }
+        catch(const std::exception &e)
+        {
+            IN_ERR("Failed to queue email: {}", e.what());
+            return false;
+        }
+
+        {
+            std::lock_guard lock(sMutex);
+            ++sSignals;
+        }
+        sWake.notify_one();
+
+        return true;
+    }
+
+    size_t pending()
+    {
+        return (size_t)collection().count_documents(make_document(
+            kvp("status", make_document(kvp("$ne", "Failed")))).view());
+    }
+}
@@ -0,0 +1,105 @@
+/**
+ * @file outbox.h
+ *
+ * Contains the email outbox, which queues emails in MongoDB and sends them
+ * from background dispatcher threads, so requests never wait on the email
+ * provider.
+ */
+#pragma once
+#include <insound/core/email.h>
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace Insound::Email {
+
+    /**
+     * Options to set when starting the outbox
+     */
+    struct OutboxOpts
+    {
+        /**
+         * Number of dispatcher threads. Each keeps its own connection to
+         * the provider open between sends.
+         */
+        unsigned workers = 2;
+
+        /**
+         * Max emails claimed at once by a dispatcher. Claimed emails are sent
+         * together via the batch endpoint, if one is set.
+         */
+        size_t batchSize = 50;
+
+        /**
+         * Attempts before an email is marked as failed
+         */
+        unsigned maxAttempts = 8;
+
+        /**
+         * Delay before the first retry, doubling with each attempt
+         */
+        std::chrono::milliseconds baseBackoff{2000};
+
+        /**
+         * Max delay between retries
+         */
+        std::chrono::milliseconds maxBackoff{10 * 60 * 1000};
+
+        /**
+         * How often idle dispatchers check the outbox for emails queued by
+         * other processes, or that are due for a retry
+         */
+        std::chrono::milliseconds pollInterval{5000};
+
+        /**
+         * How long a claimed email stays locked to its dispatcher. Renewed
+         * before each email of a batch that is sent one at a time.
+         */
+        std::chrono::milliseconds lease{60000};
+
+        /**
+         * Provider endpoint for single emails. Empty uses
+         * `Settings::emailEndpointURL`.
+         */
+        std::string endpoint;
+
+        /**
+         * Provider endpoint accepting a JSON array of emails. Empty uses
+         * `Settings::emailBatchEndpointURL`, and if that is empty too, emails
+         * are always sent one at a time.
+         */
+        std::string batchEndpoint;
+    };
+
+    namespace Outbox {
+
+        /**
+         * Start the dispatcher threads. MongoDB must be connected first.
+         * Safe to call if already started.
+         */
+        void start(const OutboxOpts &opts = {});
+
+        /**
+         * Stop the dispatcher threads, waiting for in-progress sends. Queued
+         * emails stay in the outbox for the next start.
+         */
+        void stop();
+
+        /**
+         * Store an email in the outbox to be sent in the background. Does
+         * not require the dispatchers to be running in this process.
+         *
+         * @param email - email to send
+         *
+         * @return whether the email was stored.
+         */
+        bool enqueue(const SendEmail &email);
+
+        /**
+         * Number of emails waiting to be sent, not counting failed ones
+         */
+        [[nodiscard]]
+        size_t pending();
+    }
+}
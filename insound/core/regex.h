@@ -9,6 +9,9 @@
 namespace Insound::Regex {
     /**
      * Check for a valid email address.
+     *
+     * Prefer `Validate::email`, which accepts the same addresses in linear
+     * time. This is kept as the reference it is tested against.
      */
     extern std::regex email;
 
@@ -1,10 +1,12 @@
 #include "request.h"
 
+#include <insound/core/HttpClient.h>
 #include <insound/core/errors/CurlError.h>
 #include <insound/core/errors/CurlHeaderError.h>
 #include <curl/curl.h>
 
 #include <cassert>
+#include <cstdio>
 #include <memory>
 #include <sstream>
 #include <stdexcept>
@@ -19,22 +21,72 @@ namespace Insound::HttpMethod {
 
 static auto InitOk = curl_global_init(CURL_GLOBAL_ALL);
 
-static size_t write_data(void *buffer, size_t size, size_t nmemb, void *userp)
+// Largest body reserved up front from Content-Length. Anything bigger grows
+// as it arrives, so a bogus header can't make us allocate gigabytes.
+static constexpr curl_off_t MaxReserve = 64 * 1024 * 1024;
+
+/**
+ * Collects the response body into a string
+ */
+struct StringSink {
+    CURL *curl;
+    std::string *out;
+    bool reserved;
+};
+
+static size_t write_string(char *data, size_t size, size_t nmemb, void *userp)
 {
     auto bytes = size * nmemb;
-    std::string &file = *static_cast<std::string *>(userp);
-    file = std::string{(char *)buffer, (char *)buffer + bytes};
+    auto &sink = *static_cast<StringSink *>(userp);
+
+    // Headers are in by the first chunk, so the body can be sized once
+    if (!sink.reserved)
+    {
+        sink.reserved = true;
+
+        curl_off_t length;
+        if (curl_easy_getinfo(sink.curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T,
+            &length) == CURLE_OK && length > 0 && length <= MaxReserve)
+        {
+            sink.out->reserve(sink.out->size() + (size_t)length);
+        }
+    }
 
+    sink.out->append(data, bytes);
     return bytes;
 }
 
+static size_t write_file(char *data, size_t size, size_t nmemb, void *userp)
+{
+    // A short count makes curl abort with CURLE_WRITE_ERROR
+    return std::fwrite(data, size, nmemb, static_cast<std::FILE *>(userp))
+        * size;
+}
+
+static size_t write_sink(char *data, size_t size, size_t nmemb, void *userp)
+{
+    auto bytes = size * nmemb;
+    auto &sink = *static_cast<const Insound::MakeRequest::Sink *>(userp);
+
+    return sink(std::string_view(data, bytes)) ? bytes : 0;
+}
+
 class CurlHeaders {
 public:
     CurlHeaders() : list() { }
     ~CurlHeaders()
+    {
+        clear();
+    }
+
+    CurlHeaders(const CurlHeaders &) = delete;
+    CurlHeaders &operator=(const CurlHeaders &) = delete;
+
+    void clear()
     {
         if (list)
             curl_slist_free_all(list);
+        list = nullptr;
     }
 
     void append(std::string_view name, std::string_view value)
@@ -54,20 +106,22 @@ private:
 
 
 struct CurlContext {
-    CurlContext() : headers(), curl(curl_easy_init())
+    CurlContext() : headers(),
+        curl(Insound::HttpClient::instance().acquire())
     {
         assert(InitOk == CURLE_OK);
     }
 
     ~CurlContext()
     {
-        curl_easy_cleanup(curl);
+        Insound::HttpClient::instance().release(curl);
     }
 
     void clear()
     {
         curl_easy_reset(curl);
-        headers = CurlHeaders();
+        Insound::HttpClient::instance().configure(curl);
+        headers.clear();
     }
 
     CurlHeaders headers;
@@ -119,7 +173,8 @@ Insound::MakeRequest::~MakeRequest()
 Insound::MakeRequest &
 Insound::MakeRequest::url(std::string_view url)
 {
-    auto result = curl_easy_setopt(m->curl(), CURLOPT_URL, url.data());
+    auto result = curl_easy_setopt(m->curl(), CURLOPT_URL,
+        std::string(url).c_str());
     if (result != CURLE_OK)
         throw CurlError(result);
 
@@ -131,7 +186,7 @@ Insound::MakeRequest &
 Insound::MakeRequest::method(std::string_view method)
 {
     auto code = curl_easy_setopt(m->curl(), CURLOPT_CUSTOMREQUEST,
-        method.data());
+        std::string(method).c_str());
     if (code != CURLE_OK)
         throw CurlError(code);
     return *this;
@@ -140,7 +195,13 @@ Insound::MakeRequest::method(std::string_view method)
 Insound::MakeRequest &
 Insound::MakeRequest::body(std::string_view body)
 {
-    auto code = curl_easy_setopt(m->curl(), CURLOPT_POSTFIELDS, body.data());
+    // Copied, so the payload may be released before the request is sent
+    auto code = curl_easy_setopt(m->curl(), CURLOPT_POSTFIELDSIZE_LARGE,
+        (curl_off_t)body.size());
+    if (code != CURLE_OK)
+        throw CurlError(code);
+
+    code = curl_easy_setopt(m->curl(), CURLOPT_COPYPOSTFIELDS, body.data());
     if (code != CURLE_OK)
         throw CurlError(code);
     return *this;
@@ -154,8 +215,8 @@ Insound::MakeRequest::header(std::string_view name,
     return *this;
 }
 
-std::string
-Insound::MakeRequest::send()
+void
+Insound::MakeRequest::prepare(WriteFunction write, void *userp)
 {
     CURLcode result;
 
@@ -167,16 +228,24 @@ Insound::MakeRequest::send()
             throw CurlError(result);
     }
 
-    result = curl_easy_setopt(m->curl(), CURLOPT_WRITEFUNCTION, write_data);
+    result = curl_easy_setopt(m->curl(), CURLOPT_WRITEFUNCTION, write);
     if (result != CURLE_OK)
         throw CurlError(result);
 
-    std::string resBody;
-    result = curl_easy_setopt(m->curl(), CURLOPT_WRITEDATA, &resBody);
+    result = curl_easy_setopt(m->curl(), CURLOPT_WRITEDATA, userp);
     if (result != CURLE_OK)
         throw CurlError(result);
+}
+
+
+std::string
+Insound::MakeRequest::send()
+{
+    std::string resBody;
+    StringSink sink{m->curl(), &resBody, false};
+    prepare(write_string, &sink);
 
-    result = curl_easy_perform(m->curl());
+    auto result = curl_easy_perform(m->curl());
     if (result != CURLE_OK)
         throw CurlError(result);
 
@@ -184,6 +253,84 @@ Insound::MakeRequest::send()
 }
 
 
+size_t
+Insound::MakeRequest::send(const Sink &sink)
+{
+    prepare(write_sink, const_cast<Sink *>(&sink));
+
+    auto result = curl_easy_perform(m->curl());
+    if (result != CURLE_OK)
+        throw CurlError(result);
+
+    curl_off_t bytes;
+    result = curl_easy_getinfo(m->curl(), CURLINFO_SIZE_DOWNLOAD_T, &bytes);
+    if (result != CURLE_OK)
+        throw CurlError(result);
+
+    return (size_t)bytes;
+}
+
+
+size_t
+Insound::MakeRequest::download(const std::filesystem::path &path)
+{
+    auto file = std::fopen(path.c_str(), "wb");
+    if (!file)
+        throw std::runtime_error(sf("Failed to open \"{}\" for writing",
+            path.string()));
+
+    curl_off_t bytes;
+    prepare(write_file, file);
+    auto result = curl_easy_perform(m->curl());
+    if (result == CURLE_OK)
+        result = curl_easy_getinfo(m->curl(), CURLINFO_SIZE_DOWNLOAD_T,
+            &bytes);
+
+    // Close before checking, since flushing may fail too
+    auto closed = std::fclose(file) == 0;
+    if (result != CURLE_OK || !closed)
+    {
+        std::error_code ec;
+        std::filesystem::remove(path, ec); // don't leave partial files
+        if (result != CURLE_OK)
+            throw CurlError(result);
+        throw std::runtime_error(sf("Failed to write \"{}\"",
+            path.string()));
+    }
+
+    return (size_t)bytes;
+}
+
+
+std::future<std::string>
+Insound::MakeRequest::sendAsync()
+{
+    // Owns everything the transfer uses until it completes
+    struct Transfer {
+        std::shared_ptr<CurlContext> ctx;
+        std::string body;
+        StringSink sink;
+        std::promise<std::string> promise;
+    };
+
+    auto transfer = std::make_shared<Transfer>();
+    transfer->ctx = m->ctx;
+    transfer->sink = StringSink{m->curl(), &transfer->body, false};
+    prepare(write_string, &transfer->sink);
+
+    auto future = transfer->promise.get_future();
+    HttpClient::instance().perform(m->curl(), [transfer](CURLcode result) {
+        if (result == CURLE_OK)
+            transfer->promise.set_value(std::move(transfer->body));
+        else
+            transfer->promise.set_exception(
+                std::make_exception_ptr(CurlError(result)));
+    });
+
+    return future;
+}
+
+
 std::string
 Insound::MakeRequest::getHeader(std::string_view name) const
 {
@@ -233,6 +380,14 @@ Insound::MakeRequest::getHeaders(std::string_view name) const
 }
 
 
+void
+Insound::MakeRequest::clear()
+{
+    // Resets options, but keeps the handle's open connections for reuse
+    m->ctx->clear();
+}
+
+
 long
 Insound::MakeRequest::getCode() const
 {
@@ -250,44 +405,38 @@ std::string Insound::request(std::string_view url, std::string_view method,
 {
     assert(InitOk == CURLE_OK);
 
-    auto curl = curl_easy_init();
-
-    if (!curl) throw "Error initializaing curl";
+    auto &client = HttpClient::instance();
+    auto curl = client.acquire();
 
     try {
         CurlHeaders headers;
         headers.append("Content-Type", "application/json");
         std::string resBody;
-        curl_easy_setopt(curl, CURLOPT_URL, url.data());
-        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method.data());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_data);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &resBody);
+        StringSink sink{curl, &resBody, false};
+        curl_easy_setopt(curl, CURLOPT_URL, std::string(url).c_str());
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST,
+            std::string(method).c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_string);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &sink);
         curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers.getList());
         curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "br, gzip, deflate");
         curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payload.data());
 
         auto result = curl_easy_perform(curl);
         if (result != CURLE_OK)
-        {
-            curl_easy_cleanup(curl);
             throw CurlError(result);
-        }
 
         long code;
         result = curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
         if (result != CURLE_OK)
-        {
-            curl_easy_cleanup(curl);
             throw CurlError(result);
-        }
-
 
-        curl_easy_cleanup(curl);
+        client.release(curl);
         return resBody;
     }
     catch (...)
     {
-        curl_easy_cleanup(curl);
+        client.release(curl);
         throw;
     }
 }
@@ -11,6 +11,9 @@
 
 #include <insound/core/json.h>
 
+#include <filesystem>
+#include <functional>
+#include <future>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -73,34 +76,83 @@ namespace Insound {
             std::string_view value);
 
 
+        /**
+         * Receives the response body chunk by chunk as it arrives. Return
+         * false to abort the transfer.
+         */
+        using Sink = std::function<bool(std::string_view chunk)>;
+
         /**
          * Send/perform the request, converting json response body to data type
          * specified - type `T` must specialize the glz::meta class
          *
+         * The body is buffered in full, then parsed once in place. (glaze
+         * cannot resume a parse across chunks.)
+         *
          * @return object of type `T` parsed from the body
          *
-         * @throws if there was a problem with the request, or if there was
-         *         a problem parsing the response body.
+         * @throws CurlError if there was a problem with the request, or
+         *         GlazeError if there was a problem parsing the response body.
          */
         template <typename T>
         T send()
         {
-            T obj;
-            glz::read<glz::opts{
+            return JSON::parse<T, JSON::Opts{
                 .error_on_unknown_keys=false,
                 .error_on_missing_keys=false
-            }>(send(), obj);
-
-            return obj;
+            }>(send());
         }
 
 
         /**
          * Send/perform the request, retrieving the JSON response body as
-         * a string.
+         * a string. The string is reserved once from the Content-Length of
+         * the response, when the server sends one.
          */
         std::string send();
 
+        /**
+         * Send/perform the request, streaming the response body to `sink`
+         * without buffering it.
+         *
+         * @param sink - called with each chunk of the body
+         *
+         * @return total bytes received.
+         *
+         * @throws CurlError if the request failed, or CURLE_WRITE_ERROR if
+         *         the sink aborted it.
+         */
+        size_t send(const Sink &sink);
+
+        /**
+         * Send/perform the request, writing the response body to a file.
+         * The file is created or truncated, and removed again if the
+         * request fails.
+         *
+         * @param path - file to write
+         *
+         * @return total bytes written.
+         *
+         * @throws CurlError if the request failed, or std::runtime_error if
+         *         the file could not be written.
+         */
+        size_t download(const std::filesystem::path &path);
+
+        /**
+         * Send the request on the shared http client thread, without
+         * blocking. Any number of requests may be in flight at once, reusing
+         * pooled connections. A MakeRequest, and copies of it, may only
+         * perform one request at a time, so use one per concurrent request.
+         *
+         * `getHeader`, `getHeaders` and `getCode` are valid once the future
+         * is ready.
+         *
+         * @return future response body.
+         *
+         * @throws via the future a CurlError if the request failed.
+         */
+        std::future<std::string> sendAsync();
+
 
         /**
          * Get the first header with `name` in response retrieved after a call
@@ -143,8 +195,18 @@ namespace Insound {
          */
         void clear();
 
+        /**
+         * Set the request body. The payload is copied.
+         */
         MakeRequest &body(std::string_view payload);
     private:
+        using WriteFunction = size_t (*)(char *, size_t, size_t, void *);
+
+        /**
+         * Apply headers, and direct the response body to `write`
+         */
+        void prepare(WriteFunction write, void *userp);
+
         struct Impl;
         Impl *m;
     };
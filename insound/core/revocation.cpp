@@ -0,0 +1,297 @@
+#include "revocation.h"
+
+#include <insound/core/BloomFilter.h>
+#include <insound/core/mongo.h>
+
+#include <bsoncxx/builder/basic/document.hpp>
+#include <bsoncxx/builder/basic/kvp.hpp>
+#include <bsoncxx/types.hpp>
+#include <mongocxx/collection.hpp>
+#include <mongocxx/options/find.hpp>
+#include <mongocxx/options/index.hpp>
+#include <mongocxx/options/update.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace Insound::Revocation {
+
+    using bsoncxx::builder::basic::kvp;
+    using bsoncxx::builder::basic::make_document;
+
+    // Documents are written directly as bson, since the TTL index on
+    // `expiresAt` needs a BSON date, and `_id` is the token id itself
+    static constexpr std::string_view CollectionName = "RevokedToken";
+
+    // Each refresh looks back a little before the newest revocation seen, in
+    // case an insert on another instance with an earlier time landed late.
+    // Re-adding ids to the filter is harmless.
+    static constexpr int64_t OverlapMs = 10000;
+
+    struct StringHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view str) const
+        {
+            return std::hash<std::string_view>{}(str);
+        }
+    };
+
+    static std::mutex sMutex;
+    static std::condition_variable sWake;
+    static std::thread sThread;
+    static bool sRunning;
+    static RevocationOpts sOpts;
+
+    // Newest `revokedAt` pulled so far, in milliseconds since epoch
+    static int64_t sLastSeen;
+    static std::chrono::steady_clock::time_point sLastRebuild;
+
+    // Read without locking on every verification
+    static std::atomic<BloomFilter *> sFilter{nullptr};
+    static std::unique_ptr<BloomFilter> sCurrent;
+
+    // A replaced filter is freed at the rebuild after, long after any reader
+    // could still be holding it
+    static std::unique_ptr<BloomFilter> sRetired;
+
+    // Results of database lookups for ids that passed the filter
+    static std::mutex sCacheMutex;
+    static std::unordered_map<std::string, bool, StringHash, std::equal_to<>>
+        sCache;
+
+    static int64_t nowMs()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    static mongocxx::collection collection()
+    {
+        return Mongo::db().collection(CollectionName);
+    }
+
+    static void remember(std::string_view jti, bool revoked)
+    {
+        std::lock_guard lock(sCacheMutex);
+        if (sCache.size() >= sOpts.cacheSize)
+            sCache.clear();
+
+        auto it = sCache.find(jti);
+        if (it != sCache.end())
+            it->second = revoked;
+        else
+            sCache.emplace(jti, revoked);
+    }
+
+    /**
+     * Add revocations with `revokedAt` at or after `since` to `filter`.
+     * Must be called with sMutex locked.
+     *
+     * @return number of revocations added.
+     */
+    static size_t pull(BloomFilter &filter, int64_t since)
+    {
+        auto now = bsoncxx::types::b_date{std::chrono::system_clock::now()};
+        auto query = make_document(
+            kvp("revokedAt", make_document(kvp("$gte", since))),
+            kvp("expiresAt", make_document(kvp("$gt", now))));
+
+        mongocxx::options::find opts;
+        opts.projection(make_document(kvp("_id", 1), kvp("revokedAt", 1)));
+
+        size_t count = 0;
+        for (auto &&doc : collection().find(query.view(), opts))
+        {
+            auto jti = doc["_id"].get_string().value;
+            filter.insert(BloomFilter::hash(jti));
+
+            // Drops any cached "not revoked" lookup result
+            remember(jti, true);
+
+            sLastSeen = std::max(sLastSeen, doc["revokedAt"].get_int64().value);
+            ++count;
+        }
+
+        return count;
+    }
+
+    /**
+     * Replace the filter with one holding every unexpired revocation.
+     * Must be called with sMutex locked.
+     */
+    static void rebuild()
+    {
+        auto count = (size_t)collection().count_documents(make_document(
+            kvp("expiresAt", make_document(kvp("$gt",
+                bsoncxx::types::b_date{std::chrono::system_clock::now()}))))
+            .view());
+
+        // Room to grow before the next rebuild
+        auto filter = std::make_unique<BloomFilter>(
+            std::max(sOpts.minCapacity, count * 2));
+
+        sLastSeen = 0;
+        pull(*filter, 0);
+
+        sRetired = std::move(sCurrent);
+        sCurrent = std::move(filter);
+        sFilter.store(sCurrent.get(), std::memory_order_release);
+        sLastRebuild = std::chrono::steady_clock::now();
+
+        {
+            std::lock_guard lock(sCacheMutex);
+            sCache.clear();
+        }
+    }
+
+    /**
+     * Must be called with sMutex locked
+     */
+    static void update()
+    {
+        if (!sCurrent || sCurrent->size() > sCurrent->capacity() ||
+            std::chrono::steady_clock::now() - sLastRebuild >=
+                sOpts.rebuildInterval)
+        {
+            rebuild();
+        }
+        else
+        {
+            pull(*sCurrent, sLastSeen - OverlapMs);
+        }
+    }
+
+    static void run()
+    {
+        std::unique_lock lock(sMutex);
+        while (true)
+        {
+            sWake.wait_for(lock, sOpts.refreshInterval, []() {
+                return !sRunning;
+            });
+            if (!sRunning) break;
+
+            try {
+                update();
+            }
+            catch(const std::exception &e)
+            {
+                IN_ERR("Failed to refresh token revocations: {}", e.what());
+            }
+        }
+    }
+
+    void start(const RevocationOpts &opts)
+    {
+        std::lock_guard lock(sMutex);
+        if (sRunning) return;
+
+        sOpts = opts;
+
+        auto revoked = collection();
+        mongocxx::options::index ttl;
+        ttl.expire_after(std::chrono::seconds(0));
+        revoked.create_index(make_document(kvp("expiresAt", 1)).view(), ttl);
+        revoked.create_index(make_document(kvp("revokedAt", 1)).view());
+
+        rebuild();
+
+        sRunning = true;
+        sThread = std::thread(run);
+
+        IN_LOG("Token revocation started with {} revoked tokens",
+            sCurrent->size());
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard lock(sMutex);
+            if (!sRunning) return;
+            sRunning = false;
+        }
+
+        sWake.notify_all();
+        sThread.join();
+
+        std::lock_guard lock(sMutex);
+        sFilter.store(nullptr, std::memory_order_release);
+        sRetired.reset();
+
+        // Kept alive in case a check is still reading it
+        sRetired = std::move(sCurrent);
+    }
+
+    bool revoke(std::string_view jti, int64_t expiresAt)
+    {
+        try {
+            auto now = nowMs();
+            auto expires = bsoncxx::types::b_date{
+                std::chrono::system_clock::time_point(
+                    std::chrono::seconds(expiresAt))};
+
+            mongocxx::options::update opts;
+            opts.upsert(true);
+            collection().update_one(
+                make_document(kvp("_id", jti)).view(),
+                make_document(kvp("$setOnInsert", make_document(
+                    kvp("expiresAt", expires),
+                    kvp("revokedAt", now)))).view(),
+                opts);
+        }
+        catch(const std::exception &e)
+        {
+            IN_ERR("Failed to revoke token: {}", e.what());
+            return false;
+        }
+
+        if (auto filter = sFilter.load(std::memory_order_acquire))
+            filter->insert(BloomFilter::hash(jti));
+        remember(jti, true);
+
+        return true;
+    }
+
+    bool isRevoked(std::string_view jti)
+    {
+        auto filter = sFilter.load(std::memory_order_acquire);
+        if (!filter || !filter->mayContain(BloomFilter::hash(jti)))
+            return false;
+
+        {
+            std::lock_guard lock(sCacheMutex);
+            auto it = sCache.find(jti);
+            if (it != sCache.end())
+                return it->second;
+        }
+
+        try {
+            auto doc = collection().find_one(
+                make_document(kvp("_id", jti)).view());
+
+            remember(jti, (bool)doc);
+            return (bool)doc;
+        }
+        catch(const std::exception &e)
+        {
+            IN_ERR("Failed to check token revocation: {}", e.what());
+            return true;
+        }
+    }
+
+    void refresh()
+    {
+        std::lock_guard lock(sMutex);
+        if (!sRunning) return;
+
+        update();
+    }
+}
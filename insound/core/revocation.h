@@ -0,0 +1,87 @@
+/**
+ * @file revocation.h
+ *
+ * Contains functions to revoke json web tokens before they expire, by their
+ * token id (jti claim). Revocations are stored in MongoDB and shared by all
+ * server instances.
+ */
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace Insound::Revocation {
+
+    struct RevocationOpts
+    {
+        /**
+         * How often to pull revocations made by other instances
+         */
+        std::chrono::milliseconds refreshInterval{5000};
+
+        /**
+         * How often to rebuild the filter from scratch, dropping tokens
+         * that have since expired
+         */
+        std::chrono::milliseconds rebuildInterval{60 * 60 * 1000};
+
+        /**
+         * Smallest number of token ids the filter is sized for
+         */
+        size_t minCapacity = 1 << 16;
+
+        /**
+         * Max token ids whose database lookup result is remembered
+         */
+        size_t cacheSize = 4096;
+    };
+
+    /**
+     * Load revoked token ids into memory and start pulling new revocations
+     * in the background. Mongo must be connected.
+     *
+     * @param opts - options to start with
+     */
+    void start(const RevocationOpts &opts = {});
+
+    /**
+     * Stop the background refresh. Revocation checks pass from then on.
+     */
+    void stop();
+
+    /**
+     * Revoke a token, so that it fails verification on every instance.
+     * Takes effect on this instance immediately, and on others within the
+     * refresh interval.
+     *
+     * @param jti       - id of the token to revoke
+     * @param expiresAt - expiry of the token in seconds since epoch, after
+     *                    which the revocation is deleted
+     *
+     * @return whether the revocation was saved.
+     */
+    bool revoke(std::string_view jti, int64_t expiresAt);
+
+    /**
+     * Check whether a token id was revoked.
+     *
+     * Ids are first checked against an in-memory bloom filter, which rules
+     * out nearly every live token in a few nanoseconds without locking. The
+     * rare ids that pass the filter are confirmed against the database, and
+     * the result is cached.
+     *
+     * @param jti - token id to check
+     *
+     * @return whether the token was revoked. Errs on the side of revoked if
+     *         the database could not be reached to confirm a filter hit.
+     */
+    [[nodiscard]]
+    bool isRevoked(std::string_view jti);
+
+    /**
+     * Pull revocations made since the last refresh right away, instead of
+     * waiting for the background refresh
+     */
+    void refresh();
+}
@@ -5,6 +5,9 @@
 #include <insound/core/util.h>
 
 #include <aws/core/Aws.h>
+#include <aws/core/http/HttpResponse.h>
+#include <aws/core/http/HttpTypes.h>
+#include <aws/core/utils/stream/PreallocatedStreamBuf.h>
 #include <aws/s3/S3Client.h>
 #include <aws/s3/model/ChecksumAlgorithm.h>
 #include <aws/s3/model/CreateBucketRequest.h>
@@ -12,6 +15,7 @@
 #include <aws/s3/model/DeleteObjectRequest.h>
 #include <aws/s3/model/DeleteObjectsRequest.h>
 #include <aws/s3/model/GetObjectRequest.h>
+#include <aws/s3/model/HeadObjectRequest.h>
 #include <aws/s3/model/ListObjectsV2Request.h>
 #include <aws/s3/model/PutObjectRequest.h>
 
@@ -48,6 +52,22 @@ namespace Insound::S3
         return sClient.value();
     }
 
+    /**
+     * Read the body of a downloaded object straight into a string, sized up
+     * front, instead of through a string stream, which would copy the whole
+     * file once more
+     */
+    static std::string readBody(Aws::S3::Model::GetObjectResult &result)
+    {
+        auto &body = result.GetBody();
+        std::string file;
+        file.resize((size_t)result.GetContentLength());
+        body.read(file.data(), (std::streamsize)file.size());
+        file.resize((size_t)body.gcount());
+
+        return file;
+    }
+
     /**
      * Create a bucket
      *
@@ -137,8 +157,39 @@ namespace Insound::S3
         return res;
     }
 
-    bool uploadFile(std::string_view key,
-        const std::string &file)
+    std::vector<ListedObject> listObjectInfo(std::string_view prefix)
+    {
+        auto &client = getClient();
+        auto request = Aws::S3::Model::ListObjectsV2Request();
+        request.SetBucket(Settings::s3Bucket().data());
+        request.SetPrefix(Aws::String(prefix));
+
+        std::vector<ListedObject> res;
+        while (true)
+        {
+            auto result = client.ListObjectsV2(request);
+            if (!result.IsSuccess())
+                throw AwsS3Error(result.GetError());
+
+            for (auto &obj : result.GetResult().GetContents())
+            {
+                res.emplace_back(ListedObject{
+                    .key = obj.GetKey(),
+                    .size = (uint64_t)obj.GetSize(),
+                    .lastModified = obj.GetLastModified().UnderlyingTimestamp(),
+                });
+            }
+
+            if (!result.GetResult().GetIsTruncated())
+                break;
+            request.SetContinuationToken(
+                result.GetResult().GetNextContinuationToken());
+        }
+
+        return res;
+    }
+
+    bool uploadFile(std::string_view key, std::string_view file)
     {
         auto &client = getClient();
 
@@ -147,9 +198,13 @@ namespace Insound::S3
         request.SetBucket(Settings::s3Bucket().data());
         request.SetKey(key.data());
 
+        // Stream straight from the file's buffer instead of copying it into
+        // a string stream. The SDK only reads from it, and it outlives the
+        // request, since PutObject is synchronous.
+        Aws::Utils::Stream::PreallocatedStreamBuf buffer(
+            (unsigned char *)file.data(), file.length());
         std::shared_ptr<Aws::IOStream> inputData =
-            Aws::MakeShared<Aws::StringStream>("");
-        *inputData << file;
+            Aws::MakeShared<Aws::IOStream>("", &buffer);
 
         request.SetContentLength(file.length());
         request.SetBody(inputData);
@@ -186,10 +241,151 @@ namespace Insound::S3
             return {};
         }
 
-        std::stringstream stream;
+        return readBody(res.GetResult());
+    }
+
+    std::optional<FileVersion> downloadIfChanged(std::string_view key,
+        std::string_view etag)
+    {
+        auto &client = getClient();
+
+        auto request = Aws::S3::Model::GetObjectRequest{};
+        request.SetBucket(Settings::s3Bucket().data());
+        request.SetKey(Aws::String(key));
+        if (!etag.empty())
+            request.SetIfNoneMatch(Aws::String(etag));
+
+        auto res = client.GetObject(request);
+
+        if (!res.IsSuccess())
+        {
+            // The SDK reports 304 as an error
+            if (!etag.empty() && res.GetError().GetResponseCode() ==
+                Aws::Http::HttpResponseCode::NOT_MODIFIED)
+            {
+                return FileVersion{
+                    .data = {},
+                    .etag = std::string(etag),
+                    .modified = false,
+                };
+            }
+
+            // Misses are expected when checking for a file, e.g. a bank
+            // that was never built
+            if (res.GetError().GetResponseCode() ==
+                Aws::Http::HttpResponseCode::NOT_FOUND)
+                return {};
+
+            // Anything else, e.g. S3 being unreachable, says nothing about
+            // whether the file exists
+            throw AwsS3Error(res.GetError());
+        }
+
+        return FileVersion{
+            .data = readBody(res.GetResult()),
+            .etag = res.GetResult().GetETag(),
+            .modified = true,
+        };
+    }
+
+    bool fileExists(std::string_view key)
+    {
+        auto &client = getClient();
 
+        auto request = Aws::S3::Model::HeadObjectRequest{};
+        request.SetBucket(Settings::s3Bucket().data());
+        request.SetKey(Aws::String(key));
+
+        return client.HeadObject(request).IsSuccess();
+    }
+
+    std::optional<FileInfo> fileInfo(std::string_view key)
+    {
+        auto &client = getClient();
+
+        auto request = Aws::S3::Model::HeadObjectRequest{};
+        request.SetBucket(Settings::s3Bucket().data());
+        request.SetKey(Aws::String(key));
+
+        auto res = client.HeadObject(request);
+        if (!res.IsSuccess())
+            return {};
+
+        return FileInfo{
+            .size = (uint64_t)res.GetResult().GetContentLength(),
+            .etag = res.GetResult().GetETag(),
+            .contentType = res.GetResult().GetContentType(),
+        };
+    }
+
+    PresignedUrl presignUpload(std::string_view key,
+        std::chrono::seconds expiresIn, std::string_view contentType)
+    {
+        auto &client = getClient();
+
+        PresignedUrl result{
+            .url = {},
+            .method = "PUT",
+            .headers = {},
+            .expiresIn = (int64_t)expiresIn.count(),
+        };
+
+        Aws::Http::HeaderValueCollection headers;
+        if (!contentType.empty())
+        {
+            headers.emplace("content-type", Aws::String(contentType));
+            result.headers.emplace("Content-Type", contentType);
+        }
+
+        result.url = client.GeneratePresignedUrl(
+            Aws::String(Settings::s3Bucket()), Aws::String(key),
+            Aws::Http::HttpMethod::HTTP_PUT, headers, expiresIn.count());
+        return result;
+    }
+
+    PresignedUrl presignDownload(std::string_view key,
+        std::chrono::seconds expiresIn)
+    {
+        auto &client = getClient();
+
+        return PresignedUrl{
+            .url = client.GeneratePresignedUrl(
+                Aws::String(Settings::s3Bucket()), Aws::String(key),
+                Aws::Http::HttpMethod::HTTP_GET, expiresIn.count()),
+            .method = "GET",
+            .headers = {},
+            .expiresIn = (int64_t)expiresIn.count(),
+        };
+    }
+
+    std::optional<FileRange> downloadRange(std::string_view key,
+        std::string_view range)
+    {
+        auto &client = getClient();
+
+        auto request = Aws::S3::Model::GetObjectRequest{};
+        request.SetBucket(Settings::s3Bucket().data());
+        request.SetKey(Aws::String(key));
+        if (!range.empty())
+            request.SetRange(Aws::String(range));
+
+        auto res = client.GetObject(request);
+
+        if (!res.IsSuccess())
+        {
+            IN_ERR("S3 Download Error: {}: {}",
+                res.GetError().GetExceptionName(),
+                res.GetError().GetMessage());
+            return {};
+        }
+
+        std::stringstream stream;
         stream << res.GetResult().GetBody().rdbuf();
-        return stream.str();
+
+        return FileRange{
+            .data = stream.str(),
+            .contentRange = res.GetResult().GetContentRange(),
+        };
     }
 
     bool deleteFile(std::string_view key)
@@ -4,6 +4,9 @@
  * Contains functions dealing with S3 connection, uploads, downloads, etc.
  */
 #pragma once
+#include <chrono>
+#include <cstdint>
+#include <map>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -54,6 +57,30 @@ namespace Insound::S3 {
     std::vector<std::string> listObjects(std::string_view prefix = "");
 
 
+    /**
+     * An object in the store, as listed
+     */
+    struct ListedObject
+    {
+        std::string key;
+        uint64_t size;
+        std::chrono::system_clock::time_point lastModified;
+    };
+
+
+    /**
+     * Get every object stemming from `prefix`, with its size and when it was
+     * last written. Unlike `listObjects`, pages past the first 1000 objects.
+     *
+     * @param     prefix   - the prefix to list the objects under
+     *
+     * @returns              the objects
+     *
+     * @throws AwsS3Error if the objects could not be listed.
+     */
+    std::vector<ListedObject> listObjectInfo(std::string_view prefix);
+
+
     /**
      * Upload a file to the project's s3 bucket
      *
@@ -62,8 +89,7 @@ namespace Insound::S3 {
      *
      * @return             whether upload was successful
      */
-    bool uploadFile(std::string_view key,
-        const std::string &file); // leave string in case string_view can't maintain binary data
+    bool uploadFile(std::string_view key, std::string_view file);
 
 
     /**
@@ -77,6 +103,149 @@ namespace Insound::S3 {
     std::optional<std::string> downloadFile(std::string_view key);
 
 
+    /**
+     * A stored file with its version
+     */
+    struct FileVersion
+    {
+        // Empty if the file was not modified
+        std::string data;
+
+        // Current etag of the file
+        std::string etag;
+
+        // False if the file still matches the etag it was checked against
+        bool modified;
+    };
+
+
+    /**
+     * Download a file, unless it still matches a copy already held. The
+     * check is made by S3 with If-None-Match, so an unchanged file costs a
+     * round trip but no transfer.
+     *
+     * @param   key     - the key of the file to download
+     * @param   etag    - etag of the copy held, empty to always download
+     *
+     * @return            the file, or only `modified` false if it matches
+     *                    `etag`. Nothing if the file does not exist.
+     *
+     * @throws AwsS3Error if the file could not be downloaded for another
+     *         reason.
+     */
+    std::optional<FileVersion> downloadIfChanged(std::string_view key,
+        std::string_view etag);
+
+
+    /**
+     * Check whether a file exists, without downloading it
+     *
+     * @param   key     - the key of the file to check
+     *
+     * @return            whether the file exists.
+     */
+    bool fileExists(std::string_view key);
+
+
+    /**
+     * Size and version of a stored file
+     */
+    struct FileInfo
+    {
+        uint64_t size;
+        std::string etag;
+        std::string contentType;
+    };
+
+
+    /**
+     * Get the size and version of a file, without downloading it
+     *
+     * @param   key     - the key of the file
+     *
+     * @return            the file's info, or nothing if it does not exist.
+     */
+    std::optional<FileInfo> fileInfo(std::string_view key);
+
+
+    /**
+     * URL through which a client can reach a file in S3 directly, without
+     * its bytes passing through this server
+     */
+    struct PresignedUrl
+    {
+        std::string url;
+
+        // Http method the url is signed for
+        std::string method;
+
+        // Headers the request must send with exactly these values, since
+        // they are part of the signature
+        std::map<std::string, std::string> headers;
+
+        // Seconds until the url expires
+        int64_t expiresIn;
+    };
+
+
+    /**
+     * Sign a URL, through which a client can upload a file with a PUT
+     * request. Signing is done locally with the server's credentials, so
+     * it makes no request to S3.
+     *
+     * @param   key         - the key to store the file at
+     * @param   expiresIn   - how long the url may be used
+     * @param   contentType - content type the upload must declare, or empty
+     *                        to allow any
+     *
+     * @return                the url.
+     */
+    PresignedUrl presignUpload(std::string_view key,
+        std::chrono::seconds expiresIn, std::string_view contentType = {});
+
+
+    /**
+     * Sign a URL, through which a client can download a file with a GET
+     * request. Signing is done locally, so it makes no request to S3, and
+     * does not check whether the file exists.
+     *
+     * @param   key         - the key of the file
+     * @param   expiresIn   - how long the url may be used
+     *
+     * @return                the url.
+     */
+    PresignedUrl presignDownload(std::string_view key,
+        std::chrono::seconds expiresIn);
+
+
+    /**
+     * Part of a stored file
+     */
+    struct FileRange
+    {
+        std::string data;
+
+        // Value for a Content-Range response header, e.g.
+        // "bytes 0-1023/4096". Empty if the whole file was returned.
+        std::string contentRange;
+    };
+
+
+    /**
+     * Download part of a file. The range is applied by S3, so only the
+     * requested bytes are transferred.
+     *
+     * @param   key     - the key of the file to download
+     * @param   range   - value of an http Range header, e.g. "bytes=0-1023".
+     *                    Empty downloads the whole file.
+     *
+     * @return            the requested bytes, or nothing if the file does not
+     *                    exist or the range could not be satisfied.
+     */
+    std::optional<FileRange> downloadRange(std::string_view key,
+        std::string_view range);
+
+
     /**
      * Delete a file in the project's S3 bucket
      *
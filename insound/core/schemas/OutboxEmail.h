@@ -0,0 +1,56 @@
+/**
+ * @file OutboxEmail.h
+ *
+ * OutboxEmail is a MongoDB model used by `Email::Outbox` to store queued
+ * emails until they are sent.
+ *
+ * Please include OutboxEmail.json.h to include json stringification bindings.
+ */
+#pragma once
+#include <insound/core/email.h>
+
+#include <cstdint>
+#include <string>
+
+namespace Insound {
+    /**
+     * Email waiting in the outbox. Sent emails are removed.
+     */
+    class OutboxEmail {
+    public:
+        enum class Status { Pending, Sending, Failed };
+
+        /**
+         * Pending emails are sent once `nextAttempt` passes. Sending emails
+         * are claimed by a dispatcher until `lockedUntil`. Failed emails ran
+         * out of attempts and are kept for inspection.
+         */
+        Status status = Status::Pending;
+
+        /**
+         * Number of send attempts made so far
+         */
+        unsigned attempts = 0;
+
+        /**
+         * Earliest time to send, in milliseconds since epoch
+         */
+        int64_t nextAttempt = 0;
+
+        /**
+         * Time a claim by a dispatcher expires, in milliseconds since epoch.
+         * Lets another dispatcher retry if the claiming process died.
+         */
+        int64_t lockedUntil = 0;
+
+        /**
+         * Reason the last attempt failed
+         */
+        std::string lastError;
+
+        /**
+         * The email to send
+         */
+        Email::SendEmailOpts message;
+    };
+}
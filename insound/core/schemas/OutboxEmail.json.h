@@ -0,0 +1,10 @@
+#pragma once
+#include <insound/core/schemas/OutboxEmail.h>
+#include <insound/core/email.json.h>
+#include <insound/core/json.h>
+
+using Insound::OutboxEmail;
+
+IN_JSON_ENUM(OutboxEmail::Status, Pending, Sending, Failed);
+IN_JSON_META(OutboxEmail, status, attempts, nextAttempt, lockedUntil,
+    lastError, message);
@@ -38,6 +38,13 @@ namespace Insound::Settings
     }
 
 
+    std::string_view emailBatchEndpointURL()
+    {
+        static std::string s_url{getEnv("EMAIL_BATCH_ENDPOINT_URL")};
+        return s_url;
+    }
+
+
     bool isProd()
     {
         static bool s_production = getEnv("PRODUCTION") == "true" ||
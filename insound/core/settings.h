@@ -20,6 +20,12 @@ namespace Insound::Settings
     [[nodiscard]]
     std::string_view emailAccessKey();
 
+    /**
+     * Optional endpoint accepting an array of emails, empty if not set
+     */
+    [[nodiscard]]
+    std::string_view emailBatchEndpointURL();
+
     [[nodiscard]]
     bool isProd();
 
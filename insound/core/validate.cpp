@@ -0,0 +1,250 @@
+#include "validate.h"
+
+namespace Insound::Validate {
+
+    static bool inRange(char c, unsigned char first, unsigned char last)
+    {
+        return (unsigned char)c >= first && (unsigned char)c <= last;
+    }
+
+    static bool isLowerAlnum(char c)
+    {
+        return inRange(c, 'a', 'z') || inRange(c, '0', '9');
+    }
+
+    static bool isDigit(char c)
+    {
+        return inRange(c, '0', '9');
+    }
+
+    /**
+     * Chars of an unquoted local part, other than '.'
+     */
+    static bool isAtext(char c)
+    {
+        if (isLowerAlnum(c)) return true;
+
+        switch(c)
+        {
+            case '!': case '#': case '$': case '%': case '&': case '\'':
+            case '*': case '+': case '/': case '=': case '?': case '^':
+            case '_': case '`': case '{': case '|': case '}': case '~':
+            case '-':
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * Chars that may follow a backslash in a quoted string or ip literal
+     */
+    static bool isEscapable(char c)
+    {
+        return inRange(c, 0x01, 0x09) || c == 0x0b || c == 0x0c ||
+            inRange(c, 0x0e, 0x7f);
+    }
+
+    /**
+     * Chars that may appear unescaped in a quoted local part
+     */
+    static bool isQtext(char c)
+    {
+        return inRange(c, 0x01, 0x08) || c == 0x0b || c == 0x0c ||
+            inRange(c, 0x0e, 0x1f) || c == 0x21 || inRange(c, 0x23, 0x5b) ||
+            inRange(c, 0x5d, 0x7f);
+    }
+
+    /**
+     * Chars that may appear unescaped in an ip literal's content. This
+     * includes '\' and ']', so a backslash may stand alone.
+     */
+    static bool isLiteralText(char c)
+    {
+        return inRange(c, 0x01, 0x08) || c == 0x0b || c == 0x0c ||
+            inRange(c, 0x0e, 0x1f) || inRange(c, 0x21, 0x7f);
+    }
+
+    /**
+     * Check a dot-atom local part, e.g. "first.last"
+     */
+    static bool isDotAtom(std::string_view str)
+    {
+        if (str.empty() || str.front() == '.' || str.back() == '.')
+            return false;
+
+        for (size_t i = 0; i < str.size(); ++i)
+        {
+            if (str[i] == '.')
+            {
+                if (str[i - 1] == '.')
+                    return false;
+            }
+            else if (!isAtext(str[i]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * Find the end of a quoted local part starting at str[0] == '"'
+     *
+     * @return index one past the closing quote, or 0 if invalid.
+     */
+    static size_t quotedEnd(std::string_view str)
+    {
+        for (size_t i = 1; i < str.size(); ++i)
+        {
+            auto c = str[i];
+            if (c == '"')
+                return i + 1;
+
+            if (c == '\\')
+            {
+                if (++i == str.size() || !isEscapable(str[i]))
+                    return 0;
+            }
+            else if (!isQtext(c))
+            {
+                return 0;
+            }
+        }
+
+        return 0;
+    }
+
+    /**
+     * Check a hostname with at least two labels, e.g. "mail.example.com"
+     */
+    static bool isHostname(std::string_view str)
+    {
+        size_t labels = 0, start = 0;
+        while (true)
+        {
+            auto end = str.find('.', start);
+            auto label = str.substr(start,
+                end == std::string_view::npos ? end : end - start);
+
+            if (label.empty() || !isLowerAlnum(label.front()) ||
+                !isLowerAlnum(label.back()))
+                return false;
+
+            for (auto c : label)
+            {
+                if (!isLowerAlnum(c) && c != '-')
+                    return false;
+            }
+
+            ++labels;
+            if (end == std::string_view::npos)
+                break;
+            start = end + 1;
+        }
+
+        return labels >= 2;
+    }
+
+    /**
+     * Check a decimal octet of 1 to 3 digits, allowing leading zeros
+     */
+    static bool isOctet(std::string_view str)
+    {
+        if (str.empty() || str.size() > 3)
+            return false;
+
+        for (auto c : str)
+        {
+            if (!isDigit(c))
+                return false;
+        }
+
+        return str.size() < 3 || str[0] == '0' || str[0] == '1' ||
+            (str[0] == '2' && (str[1] < '5' ||
+                (str[1] == '5' && str[2] <= '5')));
+    }
+
+    /**
+     * Check the content of a tagged ip literal after the ':'. Tabs and
+     * spaces are only allowed escaped, other chars may also be escaped.
+     */
+    static bool isLiteralContent(std::string_view str)
+    {
+        if (str.empty())
+            return false;
+
+        for (size_t i = 0; i < str.size(); ++i)
+        {
+            auto c = str[i];
+            if (isLiteralText(c))
+                continue;
+
+            // Since a backslash is valid text, it can always start an
+            // escape pair with the char that follows it
+            if (!isEscapable(c) || i == 0 || str[i - 1] != '\\')
+                return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Check an ip literal domain, e.g. "[127.0.0.1]" or "[1.2.3.tag:text]"
+     */
+    static bool isIpLiteral(std::string_view str)
+    {
+        if (str.size() < 2 || str.front() != '[' || str.back() != ']')
+            return false;
+
+        auto inner = str.substr(1, str.size() - 2);
+
+        // First three octets
+        for (int i = 0; i < 3; ++i)
+        {
+            auto dot = inner.find('.');
+            if (dot == std::string_view::npos || !isOctet(inner.substr(0, dot)))
+                return false;
+            inner.remove_prefix(dot + 1);
+        }
+
+        if (isOctet(inner))
+            return true;
+
+        // Otherwise a tag, e.g. "IPv6:..." (lowercase only)
+        auto colon = inner.find(':');
+        if (colon == std::string_view::npos || colon == 0 ||
+            !isLowerAlnum(inner[colon - 1]))
+            return false;
+
+        for (auto c : inner.substr(0, colon))
+        {
+            if (!isLowerAlnum(c) && c != '-')
+                return false;
+        }
+
+        return isLiteralContent(inner.substr(colon + 1));
+    }
+
+    bool email(std::string_view str) noexcept
+    {
+        size_t at;
+        if (!str.empty() && str.front() == '"')
+        {
+            // A quoted local part may contain '@', so find where it ends
+            at = quotedEnd(str);
+            if (at == 0 || at >= str.size() || str[at] != '@')
+                return false;
+        }
+        else
+        {
+            at = str.find('@');
+            if (at == std::string_view::npos || !isDotAtom(str.substr(0, at)))
+                return false;
+        }
+
+        auto domain = str.substr(at + 1);
+        return isHostname(domain) || isIpLiteral(domain);
+    }
+}
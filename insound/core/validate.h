@@ -0,0 +1,25 @@
+/**
+ * @file validate.h
+ *
+ * Contains validation checks for user input. These run in linear time and do
+ * not allocate, unlike the presets in regex.h they replace.
+ */
+#pragma once
+#include <string_view>
+
+namespace Insound::Validate {
+
+    /**
+     * Check for a valid email address. Accepts the same RFC 5322 subset as
+     * `Regex::email`:
+     *     - local part: lowercase dot-atom, or a quoted string
+     *     - domain: two or more lowercase hostname labels, or an ip address
+     *       literal e.g. "[127.0.0.1]" or "[1.2.3.tag:content]"
+     *
+     * @param str - string to check
+     *
+     * @return whether the string is a valid email address.
+     */
+    [[nodiscard]]
+    bool email(std::string_view str) noexcept;
+}
@@ -1,5 +1,7 @@
 #include "Server.h"
 #include <insound/core/BankBuilder.h>
+#include <insound/core/BankJobs.h>
+#include <insound/server/models/Track.h>
 #include <insound/server/routes/api/test.h>
 
 #include <crow/app.h>
@@ -9,12 +11,20 @@
 #include <insound/core/email.h>
 #include <insound/core/env.h>
 #include <insound/core/mongo.h>
+#include <insound/core/outbox.h>
+#include <insound/core/revocation.h>
 #include <insound/core/s3.h>
+#include <insound/core/StoredFiles.h>
 #include <insound/core/util.h>
 #include <insound/server/routes/api/auth.h>
+#include <insound/server/routes/api/status.h>
+#include <insound/server/routes/api/tracks.h>
 
 #include <insound/core/middleware/Helmet.h>
 
+#include <algorithm>
+#include <chrono>
+
 namespace Insound {
 
     // Return param string without '?' in front of it, if any
@@ -33,7 +43,18 @@ namespace Insound {
 
     Server::~Server()
     {
-        BankBuilder::closeLibrary();
+    }
+
+    void Server::close()
+    {
+        Email::Outbox::stop();
+        Revocation::stop();
+        BankJobs::stop();
+
+        if (auto result = BankBuilder::closeLibrary();
+            result != BankBuilder::OK)
+            IN_ERR("FSBank builder failed to close: {}", result);
+
         S3::close();
     }
 
@@ -81,6 +102,10 @@ namespace Insound {
             buildResult != BankBuilder::OK)
             IN_ERR("FSBank builder failed to init: {}", buildResult);
 
+        // Cancel abandoned bank builds, and clean up finished ones and stored
+        // banks no track uses
+        BankJobs::start({.referenced = Track::bankKeys});
+
         // Connect to S3, check for error
         bool result;
         result = S3::config();
@@ -90,6 +115,21 @@ namespace Insound {
         else
             IN_ERR("S3 client failed to initialize.");
 
+        // Keep popular stored files in memory, and optionally on disk
+        {
+            ObjectCache::Opts cache;
+            cache.memoryBytes = getEnv<size_t>("CACHE_MEMORY_MB",
+                cache.memoryBytes >> 20) << 20;
+            cache.maxObjectBytes = std::min(cache.maxObjectBytes,
+                cache.memoryBytes / 4);
+            cache.diskDirectory = getEnv("CACHE_DISK_DIR", "");
+            cache.diskBytes = getEnv<size_t>("CACHE_DISK_MB",
+                cache.diskBytes >> 20) << 20;
+            cache.revalidateAfter = std::chrono::milliseconds(getEnv<size_t>(
+                "CACHE_REVALIDATE_MS", (size_t)cache.revalidateAfter.count()));
+            StoredFiles::configure(cache);
+        }
+
 
         // Connect to MongoDB, check for error
         result = Mongo::connect();
@@ -99,10 +139,23 @@ namespace Insound {
         else
             IN_ERR("MongoDB client failed to connect.");
 
+        // Send queued emails in the background
+        if (result)
+            Email::Outbox::start({
+                .workers = (unsigned)getEnv<int>("EMAIL_WORKERS", 2),
+            });
+
+        // Load revoked tokens, and keep up with revocations
+        if (result)
+            Revocation::start();
+
 
         // Mount routers
         mount<Auth>();
+        mount<StatusRouter>();
         mount<TestRouter>();
+        mount<TrackRouter>();
+        TestRouter::mountSockets(*this);
 
         // Main route
         CROW_ROUTE(this->internal(), "/")(mainRoute);
@@ -21,5 +21,6 @@ namespace Insound {
 
     private:
       bool init() override;
+      void close() override;
     };
 }
@@ -70,6 +70,7 @@ The Insound Audio Team
             case Jwt::Error::Code::BadTokenFormat:
             case Jwt::Error::Code::ConversionFailure:
             case Jwt::Error::Code::VerificationFailure:
+            case Jwt::Error::Code::TokenRevoked:
                 return VerificationResult::InvalidToken;
 
             case Jwt::Error::Code::TokenExpired:
@@ -7,6 +7,11 @@
 
 int main(int argc, char *argv[])
 {
-    Insound::Server().run();
+    Insound::Server server;
+    if (!server.run())
+        return 1;
+
+    // Runs until SIGINT or SIGTERM, then drains and shuts down gracefully
+    server.waitForShutdown();
     return 0;
 }
@@ -1,7 +1,25 @@
 #include "Track.h"
+#include "Track.json.h"
+#include <insound/core/BankBuilder.h>
+#include <insound/core/base64.h>
+#include <insound/core/Mixdown.h>
+#include <insound/core/mongo.h>
 #include <insound/core/mongo/Model.h>
 #include <insound/core/ZipWriter.h>
 #include <insound/core/s3.h>
+#include <insound/core/StoredFiles.h>
+#include <insound/core/Workers.h>
+
+#include <bsoncxx/builder/basic/document.hpp>
+#include <bsoncxx/builder/basic/kvp.hpp>
+#include <bsoncxx/json.hpp>
+#include <mongocxx/collection.hpp>
+#include <mongocxx/options/find.hpp>
+#include <openssl/sha.h>
+
+#include <algorithm>
+#include <future>
+#include <stdexcept>
 
 namespace Insound
 {
@@ -18,6 +36,213 @@ namespace Insound
         return ownerDoc.value();
     }
 
+    std::string Track::stemKey(std::string_view trackId,
+        const TrackChannel &channel)
+    {
+        return sf("tracks/{}/{}", trackId, channel.filename);
+    }
+
+    /**
+     * Mix options for a track's previews
+     */
+    using bsoncxx::builder::basic::kvp;
+    using bsoncxx::builder::basic::make_document;
+
+    static mongocxx::collection collection()
+    {
+        return Mongo::db().collection(glz::meta<Track>::name);
+    }
+
+    bool Track::swapStem(std::string_view trackId, size_t channel,
+        std::string_view from, std::string_view to)
+    {
+        auto field = sf("channels.{}.filename", channel);
+        auto result = collection().update_one(
+            make_document(
+                kvp("_id", bsoncxx::oid(trackId)),
+                kvp(field, from)).view(),
+            make_document(
+                kvp("$set", make_document(kvp(field, to))),
+                kvp("$unset", make_document(
+                    kvp("bank", ""),
+                    kvp("bankKey", "")))).view());
+
+        return result && result->matched_count() == 1;
+    }
+
+    bool Track::swapStems(std::string_view trackId,
+        const std::vector<TrackChannel> &from,
+        const std::vector<TrackChannel> &to, const Fsb5::Index &bank,
+        std::string_view bankKey)
+    {
+        if (from.size() != to.size())
+            throw std::invalid_argument("Channel counts differ");
+
+        bsoncxx::builder::basic::document filter, set;
+        filter.append(kvp("_id", bsoncxx::oid(trackId)));
+        for (size_t i = 0; i < from.size(); ++i)
+        {
+            auto field = sf("channels.{}.filename", i);
+            filter.append(kvp(field, from[i].filename));
+            set.append(kvp(field, to[i].filename));
+        }
+
+        // No channel was added meanwhile, which the bank would lack
+        filter.append(kvp(sf("channels.{}", from.size()),
+            make_document(kvp("$exists", false))));
+
+        set.append(kvp("bank", bsoncxx::from_json(glz::write_json(bank))));
+        set.append(kvp("bankKey", bankKey));
+
+        auto result = collection().update_one(filter.view(),
+            make_document(kvp("$set", set.extract())).view());
+
+        return result && result->matched_count() == 1;
+    }
+
+    std::set<std::string> Track::bankKeys()
+    {
+        mongocxx::options::find opts;
+        opts.projection(make_document(kvp("bankKey", 1)));
+
+        std::set<std::string> keys;
+        for (auto &&doc : collection().find(make_document(
+            kvp("bankKey", make_document(kvp("$gt", "")))).view(), opts))
+        {
+            keys.emplace(doc["bankKey"].get_string().value);
+        }
+
+        return keys;
+    }
+
+    static Mixdown::MixdownOpts previewOpts(const Track &track)
+    {
+        // Loop points are sample positions in the track's banks, which are
+        // built at 44100 Hz
+        return {
+            .sampleRate = 44100,
+            .channels = 2,
+            .loopStart = track.isLooping ? track.loopStart : 0,
+            .loopEnd = track.isLooping ? track.loopEnd : 0,
+            .loopRepeats = 1,
+        };
+    }
+
+    std::string Track::previewKey(std::string_view trackId,
+        const MixPreset &preset) const
+    {
+        auto opts = previewOpts(*this);
+
+        // Bump the version when the mixer's output changes
+        auto source = sf("v1|{}|{}|{}|{}|{}|{}", trackId, opts.sampleRate,
+            opts.channels, opts.loopStart, opts.loopEnd, opts.loopRepeats);
+        for (size_t i = 0; i < channels.size(); ++i)
+        {
+            source += sf("|{}:{}", channels[i].filename,
+                i < preset.levels.size() ? preset.levels[i] : 1.0);
+        }
+
+        unsigned char digest[SHA256_DIGEST_LENGTH];
+        SHA256((const unsigned char *)source.data(), source.size(), digest);
+
+        return sf("tracks/{}/previews/{}.wav", trackId,
+            Base64Url::encode(std::string_view((const char *)digest,
+                sizeof(digest))));
+    }
+
+    std::string Track::renderPreview(std::string_view trackId,
+        const MixPreset &preset) const
+    {
+        auto key = previewKey(trackId, preset);
+
+        auto &storage = Workers::get(Workers::S3);
+        if (storage.submit([&key]() { return S3::fileExists(key); }).get())
+            return key;
+
+        // Download every stem at once, through the cache, since the other
+        // presets of a track mix the same stems
+        std::vector<std::future<ObjectCache::Ptr>> downloads;
+        downloads.reserve(channels.size());
+        for (auto &channel : channels)
+        {
+            downloads.emplace_back(storage.submit(
+                [stem = stemKey(trackId, channel)]() {
+                    return StoredFiles::get(stem);
+                }));
+        }
+
+        std::vector<ObjectCache::Ptr> files;
+        files.reserve(channels.size());
+        for (size_t i = 0; i < downloads.size(); ++i)
+        {
+            auto file = downloads[i].get();
+            if (!file)
+                throw std::runtime_error(sf("Failed to download stem \"{}\"",
+                    channels[i].name));
+            files.emplace_back(std::move(file));
+        }
+
+        auto wav = Workers::get(Workers::Bank).submit([&]() {
+            std::vector<Pcm> stems(files.size());
+            for (size_t i = 0; i < files.size(); ++i)
+            {
+                auto result = BankBuilder::decode(files[i]->data().data(),
+                    (unsigned)files[i]->size(), stems[i]);
+                if (result != BankBuilder::OK)
+                    throw std::runtime_error(sf(
+                        "Failed to decode stem \"{}\": {}",
+                        channels[i].name, result));
+
+                // Let go of the encoded stem as soon as it is decoded
+                files[i].reset();
+            }
+
+            return Mixdown::toWav(Mixdown::mix(stems, preset.levels,
+                previewOpts(*this)));
+        }).get();
+
+        if (!storage.submit([&]() { return S3::uploadFile(key, wav); }).get())
+            throw std::runtime_error("Failed to store preview");
+
+        return key;
+    }
+
+    void Track::indexBank(std::string_view bankData)
+    {
+        auto index = Fsb5::parse(bankData);
+        if (index.subsounds.size() != channels.size())
+            throw std::runtime_error(sf("Bank has {} subsounds, but the track "
+                "has {} channels", index.subsounds.size(), channels.size()));
+
+        bank = std::move(index);
+    }
+
+    const Fsb5::Subsound *Track::subsound(size_t channel) const
+    {
+        auto count = bank.subsounds.size();
+        if (channel >= count || count != channels.size())
+            return nullptr;
+
+        // BankBuilder adds files in reverse, so the last channel comes first
+        return &bank.subsounds[count - 1 - channel];
+    }
+
+    uint64_t Track::length() const
+    {
+        uint64_t result = 0;
+        for (auto &subsound : bank.subsounds)
+            result = std::max(result, subsound.samples);
+        return result;
+    }
+
+    bool Track::hasValidLoop() const
+    {
+        if (!isLooping || bank.subsounds.empty())
+            return true;
+
+        return loopStart < loopEnd && loopEnd <= length();
+    }
+
     std::string Track::downloadZip() const
     {
         throw "not implemented";
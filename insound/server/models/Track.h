@@ -2,9 +2,12 @@
 
 #include <insound/core/schemas/User.json.h>
 #include <insound/core/mongo/Document.h>
+#include <insound/core/Fsb5.h>
 
 #include <map>
+#include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace Insound
@@ -51,6 +54,18 @@ namespace Insound
 
         std::vector<TrackMarker> markers;
 
+        /**
+         * Subsound table of the track's built bank. Empty until a bank is
+         * indexed via `indexBank`.
+         */
+        Fsb5::Index bank;
+
+        /**
+         * S3 key of the track's built bank. Empty until stems are uploaded
+         * through `POST /api/tracks/<id>/stems`.
+         */
+        std::string bankKey;
+
         /**
          * Lua Script text data
          */
@@ -70,5 +85,122 @@ namespace Insound
          * Get the User object that owns this track
          */
         Mongo::Document<User> getOwner() const;
+
+        /**
+         * Index a bank built from the track's channels, in channel order
+         *
+         * @param bankData - FSB5 data of the bank
+         *
+         * @throws std::runtime_error if the bank is invalid, or does not have
+         *         a subsound per channel.
+         */
+        void indexBank(std::string_view bankData);
+
+        /**
+         * Get the bank subsound of one of the track's channels
+         *
+         * @param channel - index of the channel
+         *
+         * @return the subsound, or nullptr if the bank is not indexed or the
+         *         channel does not exist.
+         */
+        [[nodiscard]]
+        const Fsb5::Subsound *subsound(size_t channel) const;
+
+        /**
+         * Get the length of the track in samples, which is the length of its
+         * longest channel. Requires an indexed bank.
+         */
+        [[nodiscard]]
+        uint64_t length() const;
+
+        /**
+         * Check that the loop points lie within the track. Tracks that do not
+         * loop, or have no indexed bank yet, always pass.
+         */
+        [[nodiscard]]
+        bool hasValidLoop() const;
+
+        /**
+         * Get the S3 key of a channel's audio file
+         *
+         * @param trackId - id of the track's document
+         * @param channel - one of the track's channels
+         */
+        [[nodiscard]]
+        static std::string stemKey(std::string_view trackId,
+            const TrackChannel &channel);
+
+        /**
+         * Point one of a track's channels at a new file, if the channel still
+         * has the file it was read with. The track's bank was built from the
+         * old file, so its index and key are cleared.
+         *
+         * @param trackId - id of the track's document
+         * @param channel - index of the channel
+         * @param from    - file name the channel was read with
+         * @param to      - new file name
+         *
+         * @return whether the channel still had `from` and was updated, i.e.
+         *         false if another upload replaced the file meanwhile.
+         */
+        static bool swapStem(std::string_view trackId, size_t channel,
+            std::string_view from, std::string_view to);
+
+        /**
+         * Point each of a track's channels at a new file, along with the bank
+         * built from the new files, if the track still has the files it was
+         * read with. Passing the same channels as `from` and `to` only sets
+         * the bank.
+         *
+         * @param trackId - id of the track's document
+         * @param from    - channels the track was read with
+         * @param to      - channels with their new file names, in the same
+         *                  order
+         * @param bank    - index of the bank built from the new files
+         * @param bankKey - S3 key of that bank
+         *
+         * @return whether the track still had the files of `from` and was
+         *         updated.
+         */
+        static bool swapStems(std::string_view trackId,
+            const std::vector<TrackChannel> &from,
+            const std::vector<TrackChannel> &to, const Fsb5::Index &bank,
+            std::string_view bankKey);
+
+        /**
+         * Get the S3 keys of the banks of all tracks
+         */
+        [[nodiscard]]
+        static std::set<std::string> bankKeys();
+
+        /**
+         * Get the S3 key of a mix preset's preview. The key is a hash of the
+         * stems, levels and loop, so editing the track or preset leads to a
+         * new preview.
+         *
+         * @param trackId - id of the track's document
+         * @param preset  - one of the track's presets
+         */
+        [[nodiscard]]
+        std::string previewKey(std::string_view trackId,
+            const MixPreset &preset) const;
+
+        /**
+         * Mix the track's stems at a preset's levels into a wave file, and
+         * store it in S3, unless it was stored already. Stems are downloaded
+         * on the S3 pool, then decoded and mixed on the bank pool. Looping
+         * tracks play to `loopEnd`, then repeat the loop once.
+         *
+         * @param trackId - id of the track's document
+         * @param preset  - one of the track's presets
+         *
+         * @return S3 key of the preview.
+         *
+         * @throws std::runtime_error if a stem could not be downloaded or
+         *         decoded, or the preview could not be stored.
+         */
+        std::string renderPreview(std::string_view trackId,
+            const MixPreset &preset) const;
     };
 }
@@ -1,6 +1,8 @@
 #pragma once
 #include <insound/core/json.h>
+#include <insound/core/Fsb5.json.h>
 #include <insound/server/models/Track.h>
 
 IN_DOC(Insound::Track,
-    title, isLooping, loopStart, loopEnd, owner, presets, channels, markers);
+    title, isLooping, loopStart, loopEnd, owner, presets, channels, markers,
+    bank, bankKey);
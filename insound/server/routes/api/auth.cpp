@@ -2,16 +2,18 @@
 
 #include <insound/core/chrono.h>
 #include <insound/core/email.h>
+#include <insound/core/Form.h>
 #include <insound/core/HttpStatus.h>
 #include <insound/core/json.h>
 #include <insound/core/jwt.h>
 #include <insound/core/mongo/Model.h>
-#include <insound/core/MultipartMap.h>
+#include <insound/core/outbox.h>
 #include <insound/core/password.h>
-#include <insound/core/regex.h>
 #include <insound/core/schemas/FormErrors.json.h>
 #include <insound/core/schemas/User.json.h>
 #include <insound/core/util.h>
+#include <insound/core/validate.h>
+#include <insound/core/Workers.h>
 
 #include <insound/server/Server.h>
 #include <insound/server/emails.h>
@@ -48,6 +50,15 @@ namespace Insound
         CROW_BP_ROUTE(bp, "/activate")
             .methods("POST"_method)
             (Auth::activate);
+
+        // Slow down password guessing and account spam: bursts of 10 login
+        // attempts refilling at one per 6 seconds, and 3 sign-ups per 20 min
+        limit("/login/email", {.rate = {.capacity = 10,
+            .refillPerSecond = 1.0 / 6.0}});
+        limit("/create/email", {.rate = {.capacity = 3,
+            .refillPerSecond = 1.0 / 400.0}});
+        limit("/activate", {.rate = {.capacity = 10,
+            .refillPerSecond = 1.0 / 6.0}});
     }
 
     struct AuthCheckResult {
@@ -65,7 +76,9 @@ namespace Insound
 
         AuthCheckResult result;
         if (user.isAuthorized(User::Type::Unverified) &&    // TODO:Set this to verified user later after testing.
-            compare(fingerprint, user.fingerprint))
+            Workers::get(Workers::Crypto).submit([&]() {
+                return compare(fingerprint, user.fingerprint);
+            }).get())
         {
             result.auth = true;
             return Response::json(result);
@@ -79,6 +92,11 @@ namespace Insound
 
     Response Auth::logout(const crow::request &req)
     {
+        // Revoke the token, so a copy of it can't be used anymore
+        auto auth = req.get_header_value("Authorization");
+        if (auth.starts_with("Bearer "))
+            Jwt::revoke(std::string_view(auth).substr(7));
+
         auto &cookies = Server::getContext<crow::CookieParser>(req);
         cookies.set_cookie("fingerprint", "")
             .httponly()
@@ -89,22 +107,30 @@ namespace Insound
         return Response::json(true);
     }
 
+    struct LoginForm {
+        std::string_view email;
+        std::string password;
+
+        // Honeypot, should be left empty
+        std::string_view password2;
+
+        IN_JSON_LOCAL_META(LoginForm, email, password, password2);
+    };
+
     Response Auth::login_email(const crow::request &req)
     {
         auto &cookies = Server::getContext<crow::CookieParser>(req);
-        auto body = MultipartMap::from(req);
 
-        // Required fields to collect
-        std::string email;
-        std::string password;
+        Form<LoginForm> form(req);
+        auto &errors = form.errors;
+        if (!form)
+            return Response::json(errors, HttpStatus::BadRequest);
 
-        auto errors = FormErrors();
+        // Required fields to collect
+        auto email = form->email;
+        auto &password = form->password;
 
-        try {
-            email = body.fields.at("email");
-            password = body.fields.at("password");
-        }
-        catch(...)
+        if (email.empty() || password.empty())
         {
             if (email.empty())
                 errors.append("email", "Missing field.");
@@ -115,13 +141,13 @@ namespace Insound
         }
 
         // Check honeypot
-        if (!body.fields["password2"].empty())
+        if (!form->password2.empty())
         {
             errors.append("password2", "Field should be empty.");
             return Response::json(errors, HttpStatus::BadRequest);
         }
 
-        if (!std::regex_match(email, Regex::email))
+        if (!Validate::email(email))
         {
             errors.append("email", "Invalid email address.");
             return Response::json(errors, HttpStatus::BadRequest);
@@ -138,7 +164,10 @@ namespace Insound
 
         // Check password
         auto &user = userRes.value();
-        if (!compare(password, user.body.password))
+        auto matches = Workers::get(Workers::Crypto).submit([&]() {
+            return compare(password, user.body.password);
+        }).get();
+        if (!matches)
         {
             errors.append("password", "Invalid password.");
             return Response::json(errors, HttpStatus::Unauthorized);
@@ -153,7 +182,9 @@ namespace Insound
             token.displayName = user.body.displayName;
             token.email = user.body.email;
             token.type = user.body.type;
-            token.fingerprint = hash(fingerprint);
+            token.fingerprint = Workers::get(Workers::Crypto).submit([&]() {
+                return hash(fingerprint);
+            }).get();
 
             // Sign the token
             auto jwt = Jwt::sign(token, 2_w);
@@ -180,44 +211,53 @@ namespace Insound
         }
     }
 
+    struct SignupForm {
+        std::string_view email;
+        std::string password;
+        std::string password2;
+
+        // Honeypot, should be left empty
+        std::string_view username2;
+
+        IN_JSON_LOCAL_META(SignupForm, email, password, password2,
+            username2);
+    };
+
     Response Auth::create_email(const crow::request &req)
     {
-        auto body = MultipartMap::from(req);
-
-        auto errors = FormErrors();
+        Form<SignupForm> form(req);
+        auto &errors = form.errors;
+        if (!form)
+            return Response::json(errors, HttpStatus::BadRequest);
 
         // Check honeypot
-        if (!body.fields["username2"].empty())
+        if (!form->username2.empty())
         {
             errors.append("username2", "This field should be empty.");
             return Response::json(errors, HttpStatus::BadRequest);
         }
 
         // Get fields
-        std::string email;
-        std::string password;
-        try {
-            email = body.fields.at("email");
-            password = body.fields.at("password");
-
-            if (password != body.fields.at("password2"))
-            {
-                errors.append("password", "Passwords mismatch.");
-                return Response::json(errors, HttpStatus::BadRequest);
-            }
-        }
-        catch (...)
+        auto email = form->email;
+        auto &password = form->password;
+        if (email.empty() || password.empty())
         {
-            if (body.fields["email"].empty())
+            if (email.empty())
                 errors.append("email", "Missing email field.");
-            if (body.fields["password"].empty())
+            if (password.empty())
                 errors.append("password", "Missing password field.");
             return Response::json(errors, HttpStatus::BadRequest);
         }
 
+        if (password != form->password2)
+        {
+            errors.append("password", "Passwords mismatch.");
+            return Response::json(errors, HttpStatus::BadRequest);
+        }
+
         // Main validation checks
 
-        if (!std::regex_match(email, Regex::email))
+        if (!Validate::email(email))
         {
             errors.append("email", "Invalid email address.");
         }
@@ -244,8 +284,10 @@ namespace Insound
 
         // Create new user
         User newUser;
-        newUser.email = email;
-        newUser.password = hash(password);
+        newUser.email = std::string(email);
+        newUser.password = Workers::get(Workers::Crypto).submit([&]() {
+            return hash(password);
+        }).get();
         newUser.type = User::Type::Unverified;
 
         auto doc = UserModel.insertOne(newUser);
@@ -264,50 +306,53 @@ namespace Insound
         auto emailStrs = Emails::createVerificationStrings(email,
             doc.value().id.str());
 
-        // Send verification email here
-        auto sendEmail = Email::SendEmail();
-        auto result = sendEmail
+        // Queue the verification email, it is sent in the background
+        auto sendEmail = Email::SendEmail()
             .to(email)
             .subject("Insound Account Verification")
             .html(emailStrs.html)
-            .text(emailStrs.text)
-            .send();
+            .text(emailStrs.text);
 
-        if (!result)
+        if (!Email::Outbox::enqueue(sendEmail))
         {
-            // try again...
-            result = sendEmail.send();
-            if (!result)
-            {
-                return Response::json("Account created, but failed to send verification email");
-            }
+            return Response::json<"Account created, but failed to send "
+                "verification email">();
         }
 
-        return Response::json("Success");
+        return Response::json<"Success">();
     }
 
+    struct ActivateForm {
+        std::string_view token;
+
+        IN_JSON_LOCAL_META(ActivateForm, token);
+    };
+
     Response Auth::activate(const crow::request &req)
     {
         try {
-            auto body = MultipartMap::from(req);
-            auto token_it = body.fields.find("token");
-            if (token_it == body.fields.end() || token_it->second.empty())
+            Form<ActivateForm> form(req);
+            if (!form)
+                return Response::json<"Invalid Request.">(
+                    HttpStatus::BadRequest);
+
+            if (form->token.empty())
             {
-                return Response::json("Missing token.",
+                return Response::json<"Missing token.">(
                     HttpStatus::BadRequest);
             }
 
             Emails::EmailVerificationToken token;
-            auto verifyResult = Emails::verifyEmail(token_it->second, &token);
+            auto verifyResult = Emails::verifyEmail(form->token, &token);
 
             if (verifyResult == Emails::VerificationResult::TokenExpired)
             {
-                return Response::json("Token expired.",
+                return Response::json<"Token expired.">(
                     HttpStatus::BadRequest);
             }
             else if (verifyResult == Emails::VerificationResult::InvalidToken)
             {
-                return Response::json("Invalid token.",
+                return Response::json<"Invalid token.">(
                     HttpStatus::BadRequest);
             }
 
@@ -316,13 +361,13 @@ namespace Insound
 
             if (!user || user->body.email != token.email)
             {
-                return Response::json("Bad token.",
+                return Response::json<"Bad token.">(
                     HttpStatus::BadRequest);
             }
 
             if (user->body.isVerified())
             {
-                return Response::json("User already verified.");
+                return Response::json<"User already verified.">();
             }
 
             user->body.type = User::Type::User;
@@ -333,16 +378,17 @@ namespace Insound
                 result = user->save();
                 if (!result)
                 {
-                    return Response::json("Failed to update user validation "
-                        "status.", HttpStatus::InternalServerError);
+                    return Response::json<"Failed to update user "
+                        "validation status.">(
+                        HttpStatus::InternalServerError);
                 }
             }
 
-            return Response::json("Success");
+            return Response::json<"Success">();
         }
         catch(const std::invalid_argument &e)
         {
-            return Response::json("Invalid Request.", HttpStatus::BadRequest);
+            return Response::json<"Invalid Request.">(HttpStatus::BadRequest);
         }
 
     }
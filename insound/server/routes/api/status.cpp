@@ -0,0 +1,55 @@
+#include "status.h"
+
+#include <insound/core/HttpStatus.h>
+#include <insound/core/ObjectCache.json.h>
+#include <insound/core/settings.h>
+#include <insound/core/StoredFiles.h>
+#include <insound/core/ThreadPool.json.h>
+#include <insound/core/Workers.h>
+
+#include <insound/server/Server.h>
+
+#include <crow/common.h>
+
+namespace Insound
+{
+    StatusRouter::StatusRouter() : Router("api/status") {}
+
+    void StatusRouter::init()
+    {
+        CROW_BP_ROUTE(bp, "/pools")
+            .methods("GET"_method)
+            (StatusRouter::pools);
+
+        CROW_BP_ROUTE(bp, "/cache")
+            .methods("GET"_method)
+            (StatusRouter::cache);
+
+        CROW_BP_ROUTE(bp, "/ready")
+            .methods("GET"_method)
+            (StatusRouter::ready);
+    }
+
+    Response StatusRouter::pools(const crow::request &req)
+    {
+        auto &user = Server::getContext<UserAuth>(req).user;
+        if (Settings::isProd() && !user.isStaff())
+            return Response::json<"Unauthorized.">(HttpStatus::Unauthorized);
+
+        return Response::json(Workers::stats());
+    }
+
+    Response StatusRouter::cache(const crow::request &req)
+    {
+        auto &user = Server::getContext<UserAuth>(req).user;
+        if (Settings::isProd() && !user.isStaff())
+            return Response::json<"Unauthorized.">(HttpStatus::Unauthorized);
+
+        return Response::json(StoredFiles::stats());
+    }
+
+    Response StatusRouter::ready(const crow::request &req)
+    {
+        return Response::json<"OK">();
+    }
+}
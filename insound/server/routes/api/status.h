@@ -0,0 +1,68 @@
+/**
+ * @file status.h
+ *
+ * Contains server status routes at "/api/status"
+ */
+#pragma once
+#include <insound/core/Router.h>
+#include <insound/core/Response.h>
+
+namespace Insound {
+    class StatusRouter : public Router
+    {
+    public:
+        StatusRouter();
+
+        void init() override;
+
+        /**
+         * Get utilization of the worker pools. Staff only in production.
+         *
+         * @route GET /api/status/pools
+         *
+         * @return
+         * JSON:
+         * [
+         *     {
+         *         name: string,
+         *         threads: number,
+         *         active: number,
+         *         queued: number,
+         *         completed: number,
+         *         utilization: number
+         *     }
+         * ]
+         */
+        static Response pools(const crow::request &req);
+
+        /**
+         * Get hit rates and sizes of the stored file cache. Staff only in
+         * production.
+         *
+         * @route GET /api/status/cache
+         *
+         * @return
+         * JSON:
+         * {
+         *     hits: number,
+         *     misses: number,
+         *     revalidations: number,
+         *     rejected: number,
+         *     memoryBytes: number,
+         *     memoryObjects: number,
+         *     diskBytes: number,
+         *     diskObjects: number
+         * }
+         */
+        static Response cache(const crow::request &req);
+
+        /**
+         * Readiness check for load balancers. Responds with 200 while the
+         * server accepts requests, and 503 once it has begun draining for
+         * shutdown (via the `DrainGuard` middleware).
+         *
+         * @route GET /api/status/ready
+         */
+        static Response ready(const crow::request &req);
+    };
+}
@@ -1,11 +1,22 @@
 #include "test.h"
 
 #include <insound/core/BankBuilder.h>
+#include <insound/core/BankJobs.json.h>
+#include <insound/core/EncodeProfile.h>
+#include <insound/core/HttpStatus.h>
 #include <insound/core/MultipartMap.h>
 #include <insound/core/Response.h>
+#include <insound/core/s3.h>
+#include <insound/core/SingleFlight.h>
+#include <insound/core/StoredFiles.h>
+#include <insound/core/Workers.h>
+#include <insound/server/Server.h>
 
 #include <crow/common.h>
 
+#include <chrono>
+#include <memory>
+#include <stdexcept>
 #include <utility>
 
 namespace Insound
@@ -15,8 +26,35 @@ namespace Insound
 
     }
 
+    /**
+     * Get the encode profiles selected by a request's "profiles" query
+     * parameter, e.g. `?profiles=mobile,pro`
+     *
+     * @throws std::runtime_error if a profile is unknown.
+     */
+    static std::vector<EncodeProfile> selectedProfiles(
+        const crow::request &req)
+    {
+        auto names = req.url_params.get("profiles");
+        return EncodeProfiles::parse(names ? names : "");
+    }
+
+    // Builds in progress by build key, shared by identical requests
+    static SingleFlight<std::string, std::shared_ptr<const std::string>>
+        sBankBuilds;
+
     static Response make_fsb(const crow::request &req)
     {
+        // One bank per request, so only the first profile is used
+        EncodeProfile profile;
+        try {
+            profile = selectedProfiles(req).front();
+        }
+        catch (const std::exception &e)
+        {
+            return Response::json(std::string(e.what()), HttpStatus::BadRequest);
+        }
+
         // Get files from multipart data
         auto map = MultipartMap::from(req);
 
@@ -27,17 +65,201 @@ namespace Insound
             // Add each file to the fsbank
             result = builder.addFile(file.data.data(), file.data.length());
             if (result != BankBuilder::OK)
-                IN_ERR("Failed to add file \"{}\" to bank: {}",
-                    name, result);
+            {
+                return Response::json(sf("File \"{}\" was rejected: {}",
+                    name, result), HttpStatus::UnsupportedMediaType);
+            }
+        }
+
+        // A bank already stored is reused instead of built again
+        auto key = BankJobs::bankKey(builder.buildKey(profile));
+        ObjectCache::Ptr stored;
+        try {
+            stored = Workers::get(Workers::S3).submit([&key]() {
+                return StoredFiles::get(key);
+            }).get();
+        }
+        catch (const std::exception &e)
+        {
+            // Build it again rather than fail
+            IN_WARN("Failed to look up stored bank {}: {}", key, e.what());
+        }
+        if (stored)
+            return {"application/octet-stream", std::string(stored->data())};
+
+        // Identical requests share one build
+        std::shared_ptr<const std::string> bank;
+        try {
+            bank = sBankBuilds.run(key, [&]() {
+                // Encode on the bank pool to bound the number of concurrent
+                // builds
+                auto status = Workers::get(Workers::Bank).submit(
+                    [&builder, &profile]() {
+                        return builder.build(profile);
+                    }).get();
+                if (status != BankBuilder::OK)
+                {
+                    throw std::runtime_error(
+                        sf("Failed to build bank: {}", status));
+                }
+
+                auto data = std::make_shared<const std::string>(
+                    builder.release());
+
+                // Store in the background for later requests
+                try {
+                    Workers::get(Workers::S3).submit([key, data]() {
+                        if (!S3::uploadFile(key, *data))
+                            IN_ERR("Failed to store bank {}", key);
+                    });
+                }
+                catch (const std::exception &e)
+                {
+                    IN_ERR("Failed to store bank {}: {}", key, e.what());
+                }
+
+                return data;
+            }).get();
+        }
+        catch (const std::exception &e)
+        {
+            return Response::json(std::string(e.what()), 500);
         }
 
-        result = builder.build();
-        if (result != BankBuilder::OK)
+        // The bank may be shared with other requests, so each response gets
+        // its own copy of the body
+        return {"application/octet-stream", *bank};
+    }
+
+    static Response submit_fsb_job(const crow::request &req)
+    {
+        std::vector<EncodeProfile> profiles;
+        try {
+            profiles = selectedProfiles(req);
+        }
+        catch (const std::exception &e)
+        {
+            return Response::json(std::string(e.what()), HttpStatus::BadRequest);
+        }
+
+        auto map = MultipartMap::from(req);
+
+        std::vector<std::string> files;
+        files.reserve(map.files.size());
+        for (auto &[name, file] : map.files)
+            files.emplace_back(std::move(file.data));
+
+        try {
+            auto id = BankJobs::submit(std::move(files), std::move(profiles));
+            return Response::json(BankJobs::status(id).value(),
+                HttpStatus::Accepted);
+        }
+        catch (const std::invalid_argument &e)
+        {
+            return Response::json(std::string(e.what()),
+                HttpStatus::UnsupportedMediaType);
+        }
+        catch (const std::exception &e)
         {
-            return Response::json( sf("Failed to build bank: {}", result), 500);
+            IN_ERR("Failed to submit bank job: {}", e.what());
+            return Response::json<"Bank builds are unavailable.">(
+                HttpStatus::ServiceUnavailable);
         }
+    }
+
+    static Response get_fsb_job(const crow::request &req, const std::string &id)
+    {
+        auto status = BankJobs::status(id);
+        if (!status)
+            return Response::json<"Job not found.">(HttpStatus::NotFound);
 
-        return {"application/octet-stream", builder.data()};
+        return Response::json(status.value());
+    }
+
+    static Response cancel_fsb_job(const crow::request &req,
+        const std::string &id)
+    {
+        if (!BankJobs::cancel(id))
+            return Response::json<"No running job found.">(
+                HttpStatus::NotFound);
+
+        return Response::json(BankJobs::status(id).value());
+    }
+
+    static Response get_fsb_job_bank(const crow::request &req,
+        const std::string &id)
+    {
+        auto status = BankJobs::status(id);
+        if (!status)
+            return Response::json<"Job not found.">(HttpStatus::NotFound);
+        if (status->state != BankJobs::JobState::Done)
+            return Response::json<"Bank is not ready.">(HttpStatus::Conflict);
+
+        // The first profile's bank, unless another is named
+        auto key = status->key;
+        if (auto profile = req.url_params.get("profile"))
+        {
+            auto it = status->variants.find(profile);
+            if (it == status->variants.end())
+                return Response::json<"Profile was not built.">(
+                    HttpStatus::NotFound);
+            key = it->second;
+        }
+
+        // `?direct` redirects to the bank in storage, so its bytes don't
+        // pass through this server
+        if (req.url_params.get("direct"))
+        {
+            Response res;
+            res.redirect(S3::presignDownload(key, std::chrono::minutes(5)).url);
+            return res;
+        }
+
+        auto bank = Workers::get(Workers::S3).submit([&key]() {
+            return StoredFiles::get(key);
+        }).get();
+        if (!bank)
+            return Response::json<"Bank is no longer available.">(
+                HttpStatus::Gone);
+
+        return {"application/octet-stream", std::string(bank->data())};
+    }
+
+    // Job followed by a websocket connection, stored as its userdata
+    struct FollowedJob
+    {
+        std::string id;
+        size_t subscription;
+    };
+
+    static void follow_fsb_job(crow::websocket::connection &conn,
+        const std::string &message, bool isBinary)
+    {
+        // One job per connection
+        if (isBinary || conn.userdata())
+            return;
+
+        auto subscription = BankJobs::subscribe(message,
+            [&conn](const BankJobs::JobStatus &status) {
+                conn.send_text(JSON::stringify(status));
+            });
+        if (!subscription)
+        {
+            conn.close("Job not found.");
+            return;
+        }
+
+        conn.userdata(new FollowedJob{message, subscription});
+    }
+
+    static void unfollow_fsb_job(crow::websocket::connection &conn)
+    {
+        auto job = static_cast<FollowedJob *>(conn.userdata());
+        if (!job) return;
+
+        BankJobs::unsubscribe(job->id, job->subscription);
+        conn.userdata(nullptr);
+        delete job;
     }
 
     void TestRouter::init()
@@ -45,6 +267,41 @@ namespace Insound
         CROW_BP_ROUTE(bp, "/make-fsb")
             .methods("POST"_method)
             (make_fsb);
+        limit("/make-fsb", {
+            .maxBodySize = 256 * 1024 * 1024,
+            // Bank builds are expensive, allow a couple at once per client
+            .rate = {.capacity = 4, .refillPerSecond = 0.2, .cost = 2},
+        });
+
+        CROW_BP_ROUTE(bp, "/make-fsb/jobs")
+            .methods("POST"_method)
+            (submit_fsb_job);
+        limit("/make-fsb/jobs", {
+            .maxBodySize = 256 * 1024 * 1024,
+            .rate = {.capacity = 4, .refillPerSecond = 0.2, .cost = 2},
+        });
+
+        CROW_BP_ROUTE(bp, "/make-fsb/jobs/<string>")
+            .methods("GET"_method)
+            (get_fsb_job);
+
+        CROW_BP_ROUTE(bp, "/make-fsb/jobs/<string>")
+            .methods("DELETE"_method)
+            (cancel_fsb_job);
+
+        CROW_BP_ROUTE(bp, "/make-fsb/jobs/<string>/bank")
+            .methods("GET"_method)
+            (get_fsb_job_bank);
+    }
+
+    void TestRouter::mountSockets(Server &server)
+    {
+        CROW_WEBSOCKET_ROUTE(server.internal(), "/api/test/make-fsb/jobs/follow")
+            .onmessage(follow_fsb_job)
+            .onclose([](crow::websocket::connection &conn,
+                const std::string &reason, auto &&...) {
+                unfollow_fsb_job(conn);
+            });
     }
 
 }
@@ -6,14 +6,28 @@
 #pragma once
 
 #include "insound/core/Router.h"
+
 namespace Insound {
+    class Server;
+
     class TestRouter : public Router
     {
     public:
         TestRouter();
 
         void init() override;
-    private:
 
+        /**
+         * Register the router's websocket routes. Websocket routes need the
+         * app itself, so they can't be set up on the blueprint in `init`.
+         *
+         * "/api/test/make-fsb/jobs/follow" - send a bank job id as the first
+         * message to receive the job's status as json each time it changes.
+         * Closing the socket starts the job's lease, so it is cancelled unless
+         * its status is polled.
+         *
+         * @param server - server to register routes on
+         */
+        static void mountSockets(Server &server);
     };
 }
@@ -0,0 +1,846 @@
+#include "tracks.h"
+
+#include <insound/core/AudioProbe.h>
+#include <insound/core/BankJobs.json.h>
+#include <insound/core/HttpStatus.h>
+#include <insound/core/mongo/Model.h>
+#include <insound/core/MultipartReader.h>
+#include <insound/core/Peaks.h>
+#include <insound/core/s3.h>
+#include <insound/core/StemPipeline.h>
+#include <insound/core/StoredFiles.h>
+#include <insound/core/util.h>
+#include <insound/core/Workers.h>
+
+#include <insound/server/models/Track.json.h>
+#include <insound/server/routes/api/tracks.json.h>
+#include <insound/server/Server.h>
+
+#include <crow/common.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace Insound
+{
+    // How long a client has to start uploading a stem
+    static constexpr std::chrono::seconds UploadUrlExpiry{15 * 60};
+
+    // How long a stem's download url is valid. Clients are redirected to it
+    // right away, so it is short.
+    static constexpr std::chrono::seconds DownloadUrlExpiry{5 * 60};
+
+    // Largest stem accepted. Presigned uploads can't limit their size, so
+    // larger ones are deleted once reported.
+    static constexpr uint64_t MaxStemBytes = 256 * 1024 * 1024;
+
+    // Length of the random file names stems are stored under
+    static constexpr unsigned StemFileNameLength = 24;
+
+    // Largest body of a batch of stems
+    static constexpr size_t MaxStemsBodyBytes = 1024 * 1024 * 1024;
+
+    TrackRouter::TrackRouter() : Router("api/tracks") {}
+
+    void TrackRouter::init()
+    {
+        CROW_BP_ROUTE(bp, "/<string>/channels/<uint>/peaks")
+            .methods("GET"_method)
+            (TrackRouter::peaks);
+
+        CROW_BP_ROUTE(bp, "/<string>/presets/<uint>/preview")
+            .methods("GET"_method)
+            (TrackRouter::preview);
+        // The first request for a preset mixes every stem
+        limit("/<string>/presets/<uint>/preview", {
+            .rate = {.capacity = 4, .refillPerSecond = 0.2, .cost = 2},
+        });
+
+        CROW_BP_ROUTE(bp, "/<string>/channels/<uint>/upload")
+            .methods("POST"_method)
+            (TrackRouter::uploadUrl);
+
+        CROW_BP_ROUTE(bp, "/<string>/channels/<uint>/uploaded")
+            .methods("POST"_method)
+            (TrackRouter::uploaded);
+        // Decodes the whole stem
+        limit("/<string>/channels/<uint>/uploaded", {
+            .rate = {.capacity = 4, .refillPerSecond = 0.2, .cost = 2},
+        });
+
+        CROW_BP_ROUTE(bp, "/<string>/channels/<uint>/stem")
+            .methods("GET"_method)
+            (TrackRouter::stem);
+
+        CROW_BP_ROUTE(bp, "/<string>/stems")
+            .methods("POST"_method)
+            (TrackRouter::stems);
+        // Encodes a bank and decodes every stem
+        limit("/<string>/stems", {
+            .maxBodySize = MaxStemsBodyBytes,
+            .rate = {.capacity = 4, .refillPerSecond = 0.1, .cost = 4},
+        });
+    }
+
+    /**
+     * Find a track on the Mongo pool
+     *
+     * @param id - id of the track's document
+     *
+     * @return the track, or nothing if the id is unknown or malformed.
+     */
+    static std::optional<Mongo::Document<Track>> findTrack(
+        const std::string &id)
+    {
+        return Workers::get(Workers::Mongo).submit([&id]() {
+            try {
+                return Mongo::Model<Track>().findById(id);
+            }
+            catch (const std::exception &)
+            {
+                // Malformed id
+                return std::optional<Mongo::Document<Track>>{};
+            }
+        }).get();
+    }
+
+    /**
+     * Check whether the requesting user may edit a track, i.e. owns it or is
+     * staff. The owner is looked up on the Mongo pool.
+     */
+    static bool canEdit(const crow::request &req, const Track &track)
+    {
+        auto &user = Server::getContext<UserAuth>(req).user;
+        if (user.isStaff())
+            return true;
+        if (user.username.empty())
+            return false;
+
+        return Workers::get(Workers::Mongo).submit([&track, &user]() {
+            try {
+                return track.getOwner().body.username == user.username;
+            }
+            catch (const std::exception &)
+            {
+                return false;
+            }
+        }).get();
+    }
+
+    /**
+     * Bytes of a file selected by a Range header
+     */
+    struct ByteRange
+    {
+        size_t first;
+        size_t last;
+
+        // False if the range lies outside the file
+        bool satisfiable;
+    };
+
+    /**
+     * Resolve a Range header against the size of a file
+     *
+     * @param header - value of the header, e.g. "bytes=0-1023", "bytes=512-"
+     *                 or "bytes=-512"
+     * @param size   - byte size of the file
+     *
+     * @return the range, or nothing if the header is not a single byte range,
+     *         in which case it is ignored and the whole file is sent.
+     */
+    static std::optional<ByteRange> byteRange(std::string_view header,
+        size_t size)
+    {
+        constexpr std::string_view Prefix = "bytes=";
+        if (!header.starts_with(Prefix))
+            return {};
+        header.remove_prefix(Prefix.size());
+
+        auto dash = header.find('-');
+        if (dash == std::string_view::npos ||
+            header.find(',') != std::string_view::npos)
+            return {};
+
+        auto parse = [](std::string_view str, size_t &value) {
+            auto end = str.data() + str.size();
+            auto [ptr, ec] = std::from_chars(str.data(), end, value);
+            return !str.empty() && ec == std::errc() && ptr == end;
+        };
+
+        auto firstStr = header.substr(0, dash);
+        auto lastStr = header.substr(dash + 1);
+        size_t first = 0, last = 0;
+
+        // Suffix range: the last `n` bytes
+        if (firstStr.empty())
+        {
+            if (!parse(lastStr, last))
+                return {};
+            if (last == 0 || size == 0)
+                return ByteRange{0, 0, false};
+            return ByteRange{size - std::min(last, size), size - 1, true};
+        }
+
+        if (!parse(firstStr, first))
+            return {};
+        if (lastStr.empty())
+            last = size ? size - 1 : 0;
+        else if (!parse(lastStr, last) || last < first)
+            return {};
+
+        if (first >= size)
+            return ByteRange{0, 0, false};
+        return ByteRange{first, std::min(last, size - 1), true};
+    }
+
+    /**
+     * Check whether an If-None-Match header lists an etag
+     */
+    static bool etagMatches(std::string_view header, std::string_view etag)
+    {
+        while (!header.empty())
+        {
+            auto comma = header.find(',');
+            auto item = header.substr(0, comma);
+            header = comma == std::string_view::npos ? std::string_view() :
+                header.substr(comma + 1);
+
+            while (!item.empty() && item.front() == ' ')
+                item.remove_prefix(1);
+            while (!item.empty() && item.back() == ' ')
+                item.remove_suffix(1);
+
+            // Weak comparison, as for GET requests
+            if (item.starts_with("W/"))
+                item.remove_prefix(2);
+            auto strong = etag.starts_with("W/") ? etag.substr(2) : etag;
+            if (item == "*" || item == strong)
+                return true;
+        }
+
+        return false;
+    }
+
+    /**
+     * Respond that the client's copy of a stored file is current
+     */
+    static Response notModified(const std::string &etag)
+    {
+        Response res;
+        res.code = (int)HttpStatus::NotModified;
+        res.set_header("ETag", etag);
+        res.set_header("Cache-Control", "public, no-cache");
+        return res;
+    }
+
+    /**
+     * Respond that a Range header lies outside a stored file
+     */
+    static Response rangeNotSatisfiable(size_t size)
+    {
+        auto res = Response::json<"Range not satisfiable.">(
+            HttpStatus::RangeNotSatisfiable);
+        res.set_header("Content-Range", sf("bytes */{}", size));
+        return res;
+    }
+
+    /**
+     * Set the headers shared by full and partial responses of a stored file
+     */
+    static void setStoredHeaders(Response &res, const std::string &etag)
+    {
+        res.set_header("Accept-Ranges", "bytes");
+        if (!etag.empty())
+            res.set_header("ETag", etag);
+
+        // Stems, overviews and previews may be rewritten under the same key,
+        // so clients revalidate by etag instead of caching for good
+        res.set_header("Cache-Control", "public, no-cache");
+    }
+
+    /**
+     * Respond with part of a stored file too large for the cache. Only the
+     * requested bytes are downloaded, instead of the whole file on every
+     * request.
+     *
+     * @param info  - size and etag of the file
+     * @param range - satisfiable range of the file to send
+     */
+    static Response sendUncachedRange(const std::string &key,
+        const std::string &contentType, const S3::FileInfo &info,
+        const ByteRange &range)
+    {
+        auto part = Workers::get(Workers::S3).submit([&key, &range]() {
+            return S3::downloadRange(key,
+                sf("bytes={}-{}", range.first, range.last));
+        }).get();
+        if (!part)
+        {
+            IN_ERR("Failed to download range of stored file {}", key);
+            return Response::json<"Failed to read file.">(
+                HttpStatus::InternalServerError);
+        }
+
+        Response res{contentType, std::move(part->data)};
+        res.code = (int)HttpStatus::PartialContent;
+        res.set_header("Content-Range", part->contentRange.empty() ?
+            sf("bytes {}-{}/{}", range.first, range.last, info.size) :
+            part->contentRange);
+        setStoredHeaders(res, info.etag);
+        return res;
+    }
+
+    /**
+     * Respond with a stored file, or part of it if the request has a Range
+     * header. Files are read through the stored file cache, and ranges are
+     * cut from the cached file. Ranges of files too large for the cache are
+     * downloaded on their own. Clients holding the current version, per
+     * If-None-Match, get 304 Not Modified.
+     *
+     * @param req         - the request
+     * @param key         - S3 key of the file
+     * @param contentType - content type of the file
+     */
+    static Response sendStored(const crow::request &req,
+        const std::string &key, const std::string &contentType)
+    {
+        auto rangeHeader = req.get_header_value("Range");
+        auto ifNoneMatch = req.get_header_value("If-None-Match");
+
+        ObjectCache::Ptr file;
+        std::optional<S3::FileInfo> uncached;
+        try {
+            file = Workers::get(Workers::S3).submit(
+                [&key, &rangeHeader, &uncached]() {
+                    if (!rangeHeader.empty())
+                    {
+                        if (auto cached = StoredFiles::peek(key))
+                            return cached;
+
+                        // Check the size before downloading the whole file
+                        auto info = S3::fileInfo(key);
+                        if (info && !StoredFiles::holds(info->size))
+                        {
+                            uncached = std::move(info);
+                            return ObjectCache::Ptr{};
+                        }
+                    }
+
+                    return StoredFiles::get(key);
+                }).get();
+        }
+        catch (const std::exception &e)
+        {
+            IN_ERR("Failed to read stored file {}: {}", key, e.what());
+            return Response::json<"Failed to read file.">(
+                HttpStatus::InternalServerError);
+        }
+
+        if (uncached)
+        {
+            if (!uncached->etag.empty() &&
+                etagMatches(ifNoneMatch, uncached->etag))
+                return notModified(uncached->etag);
+
+            // Only a single range is downloaded on its own
+            auto range = byteRange(rangeHeader, uncached->size);
+            if (range && !range->satisfiable)
+                return rangeNotSatisfiable(uncached->size);
+            if (range)
+                return sendUncachedRange(key, contentType, *uncached, *range);
+
+            file = Workers::get(Workers::S3).submit([&key]() {
+                return StoredFiles::get(key);
+            }).get();
+        }
+
+        if (!file)
+            return Response::json<"Not found.">(HttpStatus::NotFound);
+
+        if (!file->etag().empty() && etagMatches(ifNoneMatch, file->etag()))
+            return notModified(file->etag());
+
+        auto data = file->data();
+        auto range = byteRange(rangeHeader, data.size());
+        if (range && !range->satisfiable)
+            return rangeNotSatisfiable(data.size());
+
+        Response res;
+        if (range)
+        {
+            res = Response{contentType, std::string(data.substr(range->first,
+                range->last - range->first + 1))};
+            res.code = (int)HttpStatus::PartialContent;
+            res.set_header("Content-Range", sf("bytes {}-{}/{}",
+                range->first, range->last, data.size()));
+        }
+        else
+        {
+            res = Response{contentType, std::string(data)};
+        }
+
+        setStoredHeaders(res, file->etag());
+        return res;
+    }
+
+    Response TrackRouter::peaks(const crow::request &req,
+        const std::string &id, uint64_t channel)
+    {
+        auto track = findTrack(id);
+        if (!track || channel >= track->body.channels.size())
+            return Response::json<"Not found.">(HttpStatus::NotFound);
+
+        auto key = Peaks::key(Track::stemKey(track->id.str(),
+            track->body.channels[channel]));
+        return sendStored(req, key, "application/octet-stream");
+    }
+
+    Response TrackRouter::preview(const crow::request &req,
+        const std::string &id, uint64_t preset)
+    {
+        auto track = findTrack(id);
+        if (!track || preset >= track->body.presets.size())
+            return Response::json<"Not found.">(HttpStatus::NotFound);
+
+        std::string key;
+        try {
+            key = track->body.renderPreview(track->id.str(),
+                track->body.presets[preset]);
+        }
+        catch (const std::exception &e)
+        {
+            IN_ERR("Failed to render preview of track {}: {}", id, e.what());
+            return Response::json<"Failed to render preview.">(
+                HttpStatus::InternalServerError);
+        }
+
+        return sendStored(req, key, "audio/wav");
+    }
+
+    Response TrackRouter::uploadUrl(const crow::request &req,
+        const std::string &id, uint64_t channel)
+    {
+        auto track = findTrack(id);
+        if (!track || channel >= track->body.channels.size())
+            return Response::json<"Not found.">(HttpStatus::NotFound);
+        if (!canEdit(req, track->body))
+            return Response::json<"Unauthorized.">(HttpStatus::Unauthorized);
+
+        // A new name, so the channel's current file isn't overwritten before
+        // the upload is checked
+        auto filename = genHexString(StemFileNameLength);
+
+        // Signed locally, so there's no need for the S3 pool
+        auto key = Track::stemKey(track->id.str(), {.filename = filename});
+        auto upload = S3::presignUpload(key, UploadUrlExpiry);
+        return Response::json(StemUpload{
+            .filename = std::move(filename),
+            .url = std::move(upload.url),
+            .method = std::move(upload.method),
+            .headers = std::move(upload.headers),
+            .expiresIn = upload.expiresIn,
+        });
+    }
+
+    /**
+     * Check that a file name could have come from `uploadUrl`, so a client
+     * can't point a channel at another key
+     */
+    static bool isStemFileName(std::string_view filename)
+    {
+        return filename.size() == StemFileNameLength &&
+            std::all_of(filename.begin(), filename.end(), [](char c) {
+                return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+            });
+    }
+
+    /**
+     * A bank build of a track's stems, followed until it finishes
+     */
+    struct BankFollow
+    {
+        std::string jobId;
+        std::string trackId;
+
+        // Channels the bank is built from
+        std::vector<TrackChannel> channels;
+
+        std::mutex mutex;
+
+        // Set once `BankJobs::subscribe` returns, which may be after the job
+        // finished
+        size_t subscription = 0;
+        bool finished = false;
+    };
+
+    /**
+     * Index a track's rebuilt bank, unless the track's stems were changed
+     * while it was built. Runs on the S3 pool.
+     */
+    static void finishBankFollow(const std::shared_ptr<BankFollow> &follow,
+        const BankJobs::JobStatus &status)
+    {
+        {
+            // Whichever of this and `rebuildBank` comes second unsubscribes
+            std::lock_guard lock(follow->mutex);
+            follow->finished = true;
+            if (follow->subscription)
+                BankJobs::unsubscribe(follow->jobId, follow->subscription);
+        }
+
+        if (status.state != BankJobs::JobState::Done)
+        {
+            IN_WARN("Bank of track {} was not rebuilt: {}", follow->trackId,
+                status.error.empty() ? "cancelled" : status.error);
+            return;
+        }
+
+        try {
+            auto bank = S3::downloadFile(status.key);
+            if (!bank)
+                throw std::runtime_error("Built bank is missing");
+
+            Track track;
+            track.channels = follow->channels;
+            track.indexBank(*bank);
+
+            if (!Track::swapStems(follow->trackId, follow->channels,
+                follow->channels, track.bank, status.key))
+            {
+                IN_LOG("Stems of track {} changed while its bank was built",
+                    follow->trackId);
+            }
+        }
+        catch (const std::exception &e)
+        {
+            IN_ERR("Failed to index rebuilt bank of track {}: {}",
+                follow->trackId, e.what());
+        }
+    }
+
+    /**
+     * Rebuild a track's bank from its stored stems in the background. The
+     * job is followed, so it is not cancelled for lack of a client, and the
+     * track's bank is set once it is done.
+     *
+     * @param trackId  - id of the track's document
+     * @param channels - the track's channels, each with a stored file
+     *
+     * @return id of the bank job.
+     *
+     * @throws std::invalid_argument if a stem can't be built into a bank.
+     * @throws std::runtime_error if a stem could not be read, or bank builds
+     *         are unavailable.
+     */
+    static std::string rebuildBank(const std::string &trackId,
+        const std::vector<TrackChannel> &channels)
+    {
+        auto &storage = Workers::get(Workers::S3);
+        auto files = storage.submit([&trackId, &channels]() {
+            std::vector<std::string> files;
+            for (auto &channel : channels)
+            {
+                auto key = Track::stemKey(trackId, channel);
+                auto file = StoredFiles::get(key);
+                if (!file)
+                    throw std::runtime_error(sf("Stem {} is missing",
+                        channel.filename));
+                files.emplace_back(file->data());
+            }
+            return files;
+        }).get();
+
+        auto follow = std::make_shared<BankFollow>();
+        follow->jobId = BankJobs::submit(std::move(files));
+        follow->trackId = trackId;
+        follow->channels = channels;
+
+        // Called with the jobs lock held, so the bank is indexed on the S3
+        // pool instead
+        auto subscription = BankJobs::subscribe(follow->jobId,
+            [follow](const BankJobs::JobStatus &status) {
+                if (status.state != BankJobs::JobState::Done &&
+                    status.state != BankJobs::JobState::Failed &&
+                    status.state != BankJobs::JobState::Cancelled)
+                    return;
+
+                Workers::get(Workers::S3).submit([follow, status]() {
+                    finishBankFollow(follow, status);
+                });
+            });
+
+        std::lock_guard lock(follow->mutex);
+        if (follow->finished)
+            BankJobs::unsubscribe(follow->jobId, subscription);
+        else
+            follow->subscription = subscription;
+
+        return follow->jobId;
+    }
+
+    /**
+     * Respond to a processed upload, starting a rebuild of the track's bank
+     * once every channel has a file
+     */
+    static Response uploadedResponse(const std::string &trackId,
+        const std::vector<TrackChannel> &channels)
+    {
+        if (std::any_of(channels.begin(), channels.end(),
+            [](const TrackChannel &channel) {
+                return channel.filename.empty();
+            }))
+            return Response::json<"Upload processed.">();
+
+        try {
+            auto job = BankJobs::status(rebuildBank(trackId, channels));
+            if (job)
+                return Response::json(job.value(), HttpStatus::Accepted);
+        }
+        catch (const std::exception &e)
+        {
+            IN_ERR("Failed to rebuild bank of track {}: {}", trackId,
+                e.what());
+        }
+
+        return Response::json<"Bank builds are unavailable.">(
+            HttpStatus::ServiceUnavailable);
+    }
+
+    Response TrackRouter::uploaded(const crow::request &req,
+        const std::string &id, uint64_t channel)
+    {
+        auto track = findTrack(id);
+        if (!track || channel >= track->body.channels.size())
+            return Response::json<"Not found.">(HttpStatus::NotFound);
+        if (!canEdit(req, track->body))
+            return Response::json<"Unauthorized.">(HttpStatus::Unauthorized);
+
+        auto filename = req.url_params.get("filename");
+        if (!filename || !isStemFileName(filename))
+            return Response::json<"Missing or malformed filename.">(
+                HttpStatus::BadRequest);
+
+        auto trackId = track->id.str();
+        auto &current = track->body.channels[channel];
+
+        // Already processed. A repeated call retries a bank build that could
+        // not be started, or joins the one in progress.
+        if (current.filename == filename)
+        {
+            if (!track->body.bankKey.empty())
+                return Response::json<"Upload processed.">();
+            return uploadedResponse(trackId, track->body.channels);
+        }
+
+        auto key = Track::stemKey(trackId, {.filename = filename});
+        auto &storage = Workers::get(Workers::S3);
+
+        auto info = storage.submit([&key]() {
+            return S3::fileInfo(key);
+        }).get();
+        if (!info)
+            return Response::json<"Upload not found.">(HttpStatus::NotFound);
+
+        auto reject = [&storage, &key]() {
+            storage.submit([&key]() {
+                return S3::deleteFiles({key, Peaks::key(key)});
+            }).get();
+            StoredFiles::invalidate(key);
+        };
+
+        if (info->size > MaxStemBytes)
+        {
+            reject();
+            return Response::json<"File is too large.">(
+                HttpStatus::PayloadTooLarge);
+        }
+
+        // Read the new file through the cache, where it is kept for the
+        // previews mixed from it
+        auto file = storage.submit([&key]() {
+            return StoredFiles::get(key);
+        }).get();
+        if (!file)
+            return Response::json<"Upload not found.">(HttpStatus::NotFound);
+
+        AudioProbe::Probe probe;
+        if (auto error = AudioProbe::read(file->data(), probe))
+        {
+            reject();
+            return Response::json(sf("File was rejected: {}", error),
+                HttpStatus::UnsupportedMediaType);
+        }
+
+        auto stored = Workers::get(Workers::Bank).submit([&key, &file]() {
+            return Peaks::store(key, file->data());
+        }).get();
+        if (!stored)
+        {
+            reject();
+            return Response::json<"Failed to process upload.">(
+                HttpStatus::InternalServerError);
+        }
+
+        // Point the channel at the new file, unless another upload replaced
+        // the channel's file since the track was read. The bank was built
+        // from the old file, so it is cleared until rebuilt.
+        auto swapped = Workers::get(Workers::Mongo).submit(
+            [&trackId, channel, &current, filename]() {
+                return Track::swapStem(trackId, channel, current.filename,
+                    filename);
+            }).get();
+        if (!swapped)
+        {
+            reject();
+            return Response::json<"Channel was changed by another upload.">(
+                HttpStatus::Conflict);
+        }
+
+        auto oldKey = current.filename.empty() ? std::string() :
+            Track::stemKey(trackId, current);
+        current.filename = filename;
+
+        // Drop the old file, its overview, and the previews mixed from it
+        if (!oldKey.empty())
+        {
+            StoredFiles::invalidate(oldKey);
+            StoredFiles::invalidate(Peaks::key(oldKey));
+        }
+        storage.submit([&oldKey, &trackId]() {
+            if (!oldKey.empty())
+                S3::deleteFiles({oldKey, Peaks::key(oldKey)});
+            S3::deleteFolder(sf("tracks/{}/previews", trackId));
+        }).get();
+
+        return uploadedResponse(trackId, track->body.channels);
+    }
+
+    Response TrackRouter::stem(const crow::request &req,
+        const std::string &id, uint64_t channel)
+    {
+        auto track = findTrack(id);
+        if (!track || channel >= track->body.channels.size())
+            return Response::json<"Not found.">(HttpStatus::NotFound);
+
+        // No stem has been uploaded to this channel yet
+        if (track->body.channels[channel].filename.empty())
+            return Response::json<"Not found.">(HttpStatus::NotFound);
+
+        auto key = Track::stemKey(track->id.str(),
+            track->body.channels[channel]);
+
+        Response res;
+        res.redirect(S3::presignDownload(key, DownloadUrlExpiry).url);
+        return res;
+    }
+
+    Response TrackRouter::stems(const crow::request &req,
+        const std::string &id)
+    {
+        auto track = findTrack(id);
+        if (!track)
+            return Response::json<"Not found.">(HttpStatus::NotFound);
+        if (!canEdit(req, track->body))
+            return Response::json<"Unauthorized.">(HttpStatus::Unauthorized);
+
+        auto trackId = track->id.str();
+        auto &storage = Workers::get(Workers::S3);
+
+        // Store under new file names, so the old stems stay valid until the
+        // track points to the new ones
+        auto channels = track->body.channels;
+        for (auto &channel : channels)
+            channel.filename = genHexString(StemFileNameLength);
+
+        StemPipeline::Result result;
+        try {
+            MultipartReader reader(req.get_header_value("Content-Type"),
+                req.body);
+            result = StemPipeline::run(reader, {
+                .stemKey = [&trackId, &channels](size_t index) {
+                    return Track::stemKey(trackId, channels[index]);
+                },
+                .minStems = channels.size(),
+                .maxStems = channels.size(),
+                .maxStemBytes = MaxStemBytes,
+            });
+        }
+        catch (const StemPipeline::Rejected &e)
+        {
+            return Response::json(sf("File was rejected: {}", e.what()),
+                HttpStatus::UnsupportedMediaType);
+        }
+        catch (const std::invalid_argument &e)
+        {
+            return Response::json(std::string(e.what()),
+                HttpStatus::BadRequest);
+        }
+        catch (const std::exception &e)
+        {
+            IN_ERR("Failed to upload stems of track {}: {}", trackId,
+                e.what());
+            return Response::json<"Failed to process upload.">(
+                HttpStatus::InternalServerError);
+        }
+
+        std::vector<std::string> newKeys, oldKeys;
+        for (size_t i = 0; i < channels.size(); ++i)
+        {
+            newKeys.emplace_back(result.stems[i].key);
+            newKeys.emplace_back(Peaks::key(result.stems[i].key));
+
+            // Channels that never had a file
+            if (track->body.channels[i].filename.empty())
+                continue;
+            auto oldKey = Track::stemKey(trackId, track->body.channels[i]);
+            oldKeys.emplace_back(Peaks::key(oldKey));
+            oldKeys.emplace_back(std::move(oldKey));
+        }
+
+        auto previous = std::exchange(track->body.channels, channels);
+        try {
+            track->body.indexBank(result.bank);
+        }
+        catch (const std::exception &e)
+        {
+            IN_ERR("Failed to index bank of track {}: {}", trackId, e.what());
+            storage.submit([&newKeys]() {
+                return S3::deleteFiles(newKeys);
+            }).get();
+            return Response::json<"Failed to process upload.">(
+                HttpStatus::InternalServerError);
+        }
+
+        // Unless another upload replaced the stems since the track was read
+        auto swapped = Workers::get(Workers::Mongo).submit(
+            [&trackId, &previous, &channels, &track, &result]() {
+                return Track::swapStems(trackId, previous, channels,
+                    track->body.bank, result.bankKey);
+            }).get();
+        if (!swapped)
+        {
+            storage.submit([&newKeys]() {
+                return S3::deleteFiles(newKeys);
+            }).get();
+            return Response::json<"Track was changed by another upload.">(
+                HttpStatus::Conflict);
+        }
+
+        // The track points to the new stems now, so drop the old ones and
+        // the previews mixed from them
+        for (auto &key : oldKeys)
+            StoredFiles::invalidate(key);
+        storage.submit([&oldKeys, &trackId]() {
+            if (!oldKeys.empty())
+                S3::deleteFiles(oldKeys);
+            S3::deleteFolder(sf("tracks/{}/previews", trackId));
+        }).get();
+
+        return Response::json<"Stems uploaded.">();
+    }
+}
@@ -0,0 +1,159 @@
+/**
+ * @file tracks.h
+ *
+ * Contains track routes at "/api/tracks"
+ */
+#pragma once
+#include <insound/core/Router.h>
+#include <insound/core/Response.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace Insound {
+
+    /**
+     * Presigned upload of a channel's audio file, see `TrackRouter::uploadUrl`
+     */
+    struct StemUpload
+    {
+        // New file name of the channel, passed back to `uploaded`
+        std::string filename;
+
+        std::string url;
+        std::string method;
+        std::map<std::string, std::string> headers;
+        int64_t expiresIn;
+    };
+
+    class TrackRouter : public Router
+    {
+    public:
+        TrackRouter();
+
+        void init() override;
+
+        /**
+         * Get the waveform overview of a track channel, in the binary format
+         * described in insound/core/Peaks.h. Supports the Range header, so
+         * clients can fetch the header and level table first, then only the
+         * level they need to draw. Clients revalidate their copy by ETag.
+         *
+         * @route GET /api/tracks/<id>/channels/<index>/peaks
+         *
+         * @return
+         * 200 or 206 application/octet-stream: overview bytes
+         * 304: client's copy, per If-None-Match, is current
+         * 404: track, channel or overview not found
+         */
+        static Response peaks(const crow::request &req, const std::string &id,
+            uint64_t channel);
+
+        /**
+         * Get a stereo wave file of a track mixed at one of its presets'
+         * levels. The first request renders and stores the mix, later ones
+         * are served from storage. Supports the Range header.
+         *
+         * @route GET /api/tracks/<id>/presets/<index>/preview
+         *
+         * @return
+         * 200 or 206 audio/wav: preview bytes
+         * 304: client's copy, per If-None-Match, is current
+         * 404: track or preset not found
+         * 500: preview could not be rendered
+         */
+        static Response preview(const crow::request &req,
+            const std::string &id, uint64_t preset);
+
+        /**
+         * Get a url through which the track's owner uploads a channel's
+         * audio file straight to storage. The file is stored under a new
+         * name, so the channel's current file stays in place until the new
+         * one is accepted. Once the upload finishes, the client calls
+         * `uploaded` with the new name.
+         *
+         * @route POST /api/tracks/<id>/channels/<index>/upload
+         *
+         * @return
+         * JSON:
+         * {
+         *     filename: string,
+         *     url: string,
+         *     method: "PUT",
+         *     headers: { [name: string]: string },
+         *     expiresIn: number
+         * }
+         * 401: not the track's owner
+         * 404: track or channel not found
+         */
+        static Response uploadUrl(const crow::request &req,
+            const std::string &id, uint64_t channel);
+
+        /**
+         * Process a channel's audio file once the client has uploaded it via
+         * `uploadUrl`. The file's headers are probed, and a file that can't
+         * be used is deleted. Then its waveform overview is computed, and
+         * the channel is pointed at the new file, unless another upload
+         * replaced the channel's file meanwhile. The old file, its overview
+         * and previews mixed from it are dropped.
+         *
+         * The track's bank is cleared, and rebuilt in the background once
+         * every channel has a file. Clients follow the returned job through
+         * `/api/test/make-fsb/jobs/<id>`. The track's bank is set when the
+         * job is done.
+         *
+         * @route POST /api/tracks/<id>/channels/<index>/uploaded?filename=
+         *
+         * @return
+         * 200: upload processed, and some channels have no file yet
+         * 202 JSON: status of the bank build, see `BankJobs::JobStatus`
+         * 400: filename is missing or malformed
+         * 401: not the track's owner
+         * 404: track, channel or upload not found
+         * 409: the channel's file was replaced by another upload
+         * 413: file too large
+         * 415: file is not supported audio
+         * 500: file could not be processed
+         * 503: upload processed, but the bank build could not be started.
+         *      Calling again retries it.
+         */
+        static Response uploaded(const crow::request &req,
+            const std::string &id, uint64_t channel);
+
+        /**
+         * Redirect to a short-lived url of a channel's audio file in storage,
+         * so the file is downloaded without passing through this server
+         *
+         * @route GET /api/tracks/<id>/channels/<index>/stem
+         *
+         * @return
+         * 307: redirect to the file
+         * 404: track or channel not found, or the channel has no file yet
+         */
+        static Response stem(const crow::request &req, const std::string &id,
+            uint64_t channel);
+
+        /**
+         * Replace all of a track's channel audio files at once, and build
+         * the track's bank from them. Expects a multipart/form-data body
+         * with a file per channel, in channel order. Files are stored while
+         * later ones are still being read and while the bank is encoded.
+         * The old files are kept until the new ones are all stored.
+         *
+         * @route POST /api/tracks/<id>/stems
+         *
+         * @return
+         * 200: stems stored and bank built
+         * 400: body is not multipart, or holds no files
+         * 401: not the track's owner
+         * 404: track not found
+         * 409: the track's files were replaced by another upload
+         * 415: a file is not supported audio or too large, or the number of
+         *      files does not match the channels
+         * 500: stems could not be stored, or the bank could not be built
+         */
+        static Response stems(const crow::request &req,
+            const std::string &id);
+    };
+}
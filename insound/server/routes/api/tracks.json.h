@@ -0,0 +1,6 @@
+#pragma once
+#include <insound/core/json.h>
+#include <insound/server/routes/api/tracks.h>
+
+IN_JSON_META(Insound::StemUpload,
+    filename, url, method, headers, expiresIn);
@@ -0,0 +1,143 @@
+#include <insound/core/AudioProbe.h>
+#include <insound/tests/definitions.h>
+#include <insound/tests/test.h>
+
+#include <string>
+
+static void putBE(std::string &out, uint64_t value, size_t size)
+{
+    for (size_t i = size; i-- > 0;)
+        out.push_back((char)((value >> (i * 8)) & 0xff));
+}
+
+/**
+ * Create a 16-bit AIFF file of silence
+ */
+static std::string makeAiff(uint16_t channels, uint32_t frames)
+{
+    std::string comm;
+    putBE(comm, channels, 2);
+    putBE(comm, frames, 4);
+    putBE(comm, 16, 2);
+    // 44100 as an 80-bit extended float
+    comm.append("\x40\x0e\xac\x44\0\0\0\0\0\0", 10);
+
+    std::string file = "FORM";
+    putBE(file, 4 + 8 + comm.size() + 8 + 8 + frames * channels * 2, 4);
+    file.append("AIFFCOMM");
+    putBE(file, comm.size(), 4);
+    file.append(comm);
+    file.append("SSND");
+    putBE(file, 8 + frames * channels * 2, 4);
+    file.append(8 + frames * channels * 2, '\0');
+    return file;
+}
+
+/**
+ * Create the start of a FLAC file, up to its stream info
+ */
+static std::string makeFlac(uint32_t channels, uint32_t sampleRate,
+    uint64_t frames)
+{
+    std::string file = "fLaC";
+    file.push_back('\x80'); // last metadata block, STREAMINFO
+    putBE(file, 34, 3);
+    putBE(file, 4096, 2);
+    putBE(file, 4096, 2);
+    putBE(file, 0, 3);
+    putBE(file, 0, 3);
+    putBE(file, (uint64_t)sampleRate << 44 | (uint64_t)(channels - 1) << 41 |
+        (uint64_t)15 << 36 | frames, 8);
+    file.append(16, '\0'); // MD5
+    return file;
+}
+
+TEST_CASE("AudioProbe::read reads test files", "[AudioProbe]")
+{
+    auto mp3 = AudioProbe::probe(readFile(STATIC_DIR "/audio/test.mp3"));
+    REQUIRE(mp3.container == AudioProbe::Container::Mpeg);
+    REQUIRE(mp3.channels == 1);
+    REQUIRE(mp3.sampleRate == 44100);
+    // From the Info header's frame count
+    REQUIRE(mp3.frames == 2 * 1152);
+
+    auto ogg = AudioProbe::probe(readFile(STATIC_DIR "/audio/test.ogg"));
+    REQUIRE(ogg.container == AudioProbe::Container::Ogg);
+    REQUIRE(ogg.channels == 1);
+    REQUIRE(ogg.sampleRate == 44100);
+    REQUIRE(ogg.frames == 102);
+
+    auto wav = AudioProbe::probe(readFile(STATIC_DIR "/audio/test.wav"));
+    REQUIRE(wav.container == AudioProbe::Container::Wav);
+    REQUIRE(wav.channels == 1);
+    REQUIRE(wav.sampleRate == 44100);
+    REQUIRE(wav.frames == 102);
+}
+
+TEST_CASE("AudioProbe::read reads AIFF and FLAC headers", "[AudioProbe]")
+{
+    auto aiff = AudioProbe::probe(makeAiff(2, 4410));
+    REQUIRE(aiff.container == AudioProbe::Container::Aiff);
+    REQUIRE(aiff.channels == 2);
+    REQUIRE(aiff.sampleRate == 44100);
+    REQUIRE(aiff.duration() == 0.1);
+
+    auto flac = AudioProbe::probe(makeFlac(6, 96000, 96000 * 90));
+    REQUIRE(flac.container == AudioProbe::Container::Flac);
+    REQUIRE(flac.channels == 6);
+    REQUIRE(flac.sampleRate == 96000);
+    REQUIRE(flac.duration() == 90);
+
+    SECTION("ID3 tags are skipped")
+    {
+        std::string tagged("ID3\x04\0\0\0\0\0\x0a", 10);
+        tagged.append(10, '\0');
+        tagged.append(makeFlac(2, 48000, 48000));
+        REQUIRE(AudioProbe::probe(tagged).sampleRate == 48000);
+    }
+}
+
+TEST_CASE("AudioProbe::read rejects bad files", "[AudioProbe]")
+{
+    AudioProbe::Probe probe;
+
+    REQUIRE(AudioProbe::read("", probe) != nullptr);
+    REQUIRE(AudioProbe::read("not an audio file at all", probe) != nullptr);
+    REQUIRE(AudioProbe::read(std::string(8192, '\0'), probe) != nullptr);
+    REQUIRE_THROWS(AudioProbe::probe("RIFF\0\0\0\0WAVE"));
+
+    // Truncated files
+    for (auto path : {STATIC_DIR "/audio/test.mp3",
+        STATIC_DIR "/audio/test.ogg", STATIC_DIR "/audio/test.wav"})
+    {
+        auto file = readFile(path);
+        REQUIRE(AudioProbe::read(file.substr(0, file.size() / 2), probe) !=
+            nullptr);
+    }
+
+    auto aiff = makeAiff(2, 4410);
+    REQUIRE(AudioProbe::read(aiff.substr(0, aiff.size() - 100), probe) !=
+        nullptr);
+
+    // Invalid formats
+    REQUIRE(AudioProbe::read(makeFlac(2, 0, 1000), probe) != nullptr);
+    REQUIRE(AudioProbe::read(makeFlac(2, 44100, 0), probe) != nullptr);
+    REQUIRE(AudioProbe::read(makeAiff(0, 10), probe) != nullptr);
+}
+
+TEST_CASE("AudioProbe::cost ranks encode work", "[AudioProbe]")
+{
+    auto stereo = AudioProbe::probe(makeFlac(2, 44100, 44100 * 60));
+    auto shorter = AudioProbe::probe(makeFlac(2, 44100, 44100 * 30));
+
+    auto profile = [](std::string_view name) {
+        return *EncodeProfiles::find(name);
+    };
+
+    auto standard = AudioProbe::cost(stereo, profile("standard"));
+    REQUIRE(standard > 0);
+    REQUIRE(AudioProbe::cost(shorter, profile("standard")) < standard);
+    REQUIRE(AudioProbe::cost(stereo, profile("lowcpu")) < standard);
+    REQUIRE(AudioProbe::cost(stereo, profile("mobile")) < standard);
+    REQUIRE(AudioProbe::cost(stereo, profile("pro")) > standard);
+}
@@ -1,22 +1,14 @@
 #include <insound/core/BankBuilder.h>
+#include <insound/core/Fsb5.h>
+#include <insound/core/Mixdown.h>
 #include <insound/tests/definitions.h>
 #include <insound/tests/test.h>
 
-#include <fstream>
 #include <thread>
 
 
 // ===== Helper function declarations =========================================
 
-/**
- * Helper function for this test - opens binary files into strings
- *
- * @param  path - path to the file
- *
- * @returns     the file data wrapped in a string
- */
-static std::string openFile(std::string_view path);
-
 /**
  * Thread-safe helper to add a file string to a files vector.
  *
@@ -44,9 +36,9 @@ public:
     void testRunStarting(const Catch::TestRunInfo &) override
     {
         BankBuilder::initLibrary();
-        file1 = openFile(STATIC_DIR "/audio/test.mp3");
-        file2 = openFile(STATIC_DIR "/audio/test.ogg");
-        file3 = openFile(STATIC_DIR "/audio/test.wav");
+        file1 = readFile(STATIC_DIR "/audio/test.mp3");
+        file2 = readFile(STATIC_DIR "/audio/test.ogg");
+        file3 = readFile(STATIC_DIR "/audio/test.wav");
     }
 
     // Tear down
@@ -77,6 +69,90 @@ TEST_CASE("Bank can build")
     bank.addFile(file3.data(), file3.size());
     REQUIRE(bank.build() == nullptr);
     REQUIRE(!bank.data().empty());
+
+    SECTION("The built file is released without copying")
+    {
+        auto buffer = bank.data().data();
+        auto size = bank.data().size();
+
+        auto released = bank.release();
+        REQUIRE(released.data() == buffer);
+        REQUIRE(released.size() == size);
+        REQUIRE(bank.data().empty());
+    }
+}
+
+
+TEST_CASE("Bank can decode files to PCM")
+{
+    for (auto file : {&file1, &file2, &file3})
+    {
+        Pcm pcm;
+        REQUIRE(BankBuilder::decode(file->data(), file->size(), pcm) == nullptr);
+        REQUIRE(pcm.channels >= 1);
+        REQUIRE(pcm.sampleRate == 44100);
+        REQUIRE(pcm.frames() > 0);
+        REQUIRE(pcm.samples.size() == pcm.frames() * pcm.channels);
+    }
+
+    Pcm pcm;
+    std::string garbage = "not an audio file";
+    REQUIRE(BankBuilder::decode(garbage.data(), garbage.size(), pcm) != nullptr);
+}
+
+
+TEST_CASE("Bank can build variants from one decode")
+{
+    // Stereo file, to check the mono downmix
+    Pcm stereo;
+    stereo.channels = 2;
+    stereo.sampleRate = 48000;
+    stereo.samples.resize(48000 * 2);
+    for (size_t i = 0; i < stereo.samples.size(); ++i)
+        stereo.samples[i] = (int16_t)((i * 37) % 20000 - 10000);
+    auto wav = Mixdown::toWav(stereo);
+
+    BankBuilder bank;
+    bank.addFile(file1.data(), file1.size());
+    bank.addFile(wav.data(), wav.size());
+
+    auto profiles = EncodeProfiles::parse("mobile,lowcpu,pro");
+    std::vector<float> progress;
+    std::vector<std::string> banks;
+    REQUIRE(bank.buildVariants(profiles, banks, [&progress](float fraction) {
+        progress.emplace_back(fraction);
+    }) == nullptr);
+    REQUIRE(banks.size() == 3);
+    REQUIRE(!progress.empty());
+    REQUIRE(progress.back() <= 1.f);
+
+    auto mobile = Fsb5::parse(banks[0]);
+    auto lowcpu = Fsb5::parse(banks[1]);
+    auto pro = Fsb5::parse(banks[2]);
+
+    // Files are stored in reverse
+    REQUIRE(mobile.subsounds.size() == 2);
+    REQUIRE(mobile.subsounds[0].channels == 1);
+    REQUIRE(mobile.subsounds[0].sampleRate == 32000);
+    REQUIRE(lowcpu.mode == Fsb5::Mode::FAdpcm);
+    REQUIRE(lowcpu.subsounds[0].channels == 2);
+    REQUIRE(lowcpu.subsounds[0].sampleRate == 44100);
+    REQUIRE(pro.subsounds[0].sampleRate == 48000);
+    REQUIRE(pro.subsounds[1].sampleRate == 44100);
+
+    SECTION("A single profile builds the same as buildVariants")
+    {
+        REQUIRE(bank.build(profiles[1]) == nullptr);
+        REQUIRE(bank.data() == banks[1]);
+    }
+
+    SECTION("Unknown profiles are rejected")
+    {
+        REQUIRE_THROWS(EncodeProfiles::parse("mobile,unknown"));
+        REQUIRE(EncodeProfiles::parse("").at(0).name ==
+            EncodeProfiles::standard().name);
+        REQUIRE(EncodeProfiles::parse("pro,pro").size() == 1);
+    }
 }
 
 
@@ -134,24 +210,6 @@ TEST_CASE("Bank can build in multithreaded context")
 
 // ===== Helper function definitions ==========================================
 
-std::string openFile(std::string_view path)
-{
-    std::ifstream file(path, std::ios::binary | std::ios::binary);
-    if (!file.is_open())
-    {
-        throw std::runtime_error(sf("Failed to open file at path {}", path));
-    }
-
-    file.seekg(0, std::ios::end);
-    auto filesize = file.tellg();
-    std::string buffer(filesize, ' ');
-    file.seekg(0);
-    file.read(buffer.data(), filesize);
-
-    file.close();
-    return buffer;
-}
-
 void addToVector(std::vector<std::string> &files,
     const std::string &file)
 {
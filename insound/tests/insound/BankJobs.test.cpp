@@ -0,0 +1,301 @@
+#include <insound/core/BankBuilder.h>
+#include <insound/core/BankJobs.h>
+#include <insound/core/s3.h>
+#include <insound/core/Workers.h>
+#include <insound/tests/definitions.h>
+#include <insound/tests/test.h>
+
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+static std::vector<std::string> testFiles()
+{
+    return {
+        readFile(STATIC_DIR "/audio/test.mp3"),
+        readFile(STATIC_DIR "/audio/test.ogg"),
+        readFile(STATIC_DIR "/audio/test.wav"),
+    };
+}
+
+/**
+ * Get the test files with the wav's audio changed, so jobs of different `n`
+ * are not identical
+ */
+static std::vector<std::string> distinctFiles(size_t n)
+{
+    auto files = testFiles();
+    files[2][44 + n % 100] ^= 1;
+    return files;
+}
+
+static bool isFinished(BankJobs::JobState state)
+{
+    return state == BankJobs::JobState::Done ||
+        state == BankJobs::JobState::Failed ||
+        state == BankJobs::JobState::Cancelled;
+}
+
+/**
+ * Poll a job until it finishes
+ */
+static BankJobs::JobStatus waitFor(const std::string &id)
+{
+    auto deadline = std::chrono::steady_clock::now() + 60s;
+    while (true)
+    {
+        auto status = BankJobs::status(id);
+        REQUIRE(status);
+        if (isFinished(status->state) ||
+            std::chrono::steady_clock::now() > deadline)
+            return status.value();
+        std::this_thread::sleep_for(10ms);
+    }
+}
+
+/**
+ * Occupies every bank worker until released, so submitted jobs stay queued
+ */
+class BankPoolBlocker
+{
+public:
+    BankPoolBlocker() : m_release(), m_released(m_release.get_future())
+    {
+        auto &pool = Workers::get(Workers::Bank);
+        for (unsigned i = 0; i < pool.size(); ++i)
+            m_tasks.emplace_back(pool.submit([this]() { m_released.wait(); }));
+    }
+
+    ~BankPoolBlocker() { release(); }
+
+    void release()
+    {
+        if (m_tasks.empty()) return;
+
+        m_release.set_value();
+        for (auto &task : m_tasks)
+            task.wait();
+        m_tasks.clear();
+    }
+
+private:
+    std::promise<void> m_release;
+    std::shared_future<void> m_released;
+    std::vector<std::future<void>> m_tasks;
+};
+
+TEST_CASE("Bank jobs build banks in the background", "[BankJobs]")
+{
+    // S3 is set up by the listener in s3.test.cpp
+    REQUIRE(BankBuilder::initLibrary() == BankBuilder::OK);
+
+    // Enough pending cost for a few builds of the test files
+    BankJobs::start({.lease = 100ms, .retention = 1min, .sweepInterval = 10ms,
+        .maxPendingCost = 0.001});
+
+    SECTION("Followers receive progress until the bank is stored")
+    {
+        std::mutex mutex;
+        std::condition_variable cond;
+        std::vector<BankJobs::JobStatus> updates;
+
+        auto id = BankJobs::submit(testFiles());
+        auto subscription = BankJobs::subscribe(id,
+            [&](const BankJobs::JobStatus &status) {
+                std::lock_guard lock(mutex);
+                updates.emplace_back(status);
+                cond.notify_one();
+            });
+        REQUIRE(subscription);
+
+        {
+            std::unique_lock lock(mutex);
+            REQUIRE(cond.wait_for(lock, 60s, [&]() {
+                return isFinished(updates.back().state);
+            }));
+        }
+
+        BankJobs::unsubscribe(id, subscription);
+
+        auto &last = updates.back();
+        REQUIRE(last.id == id);
+        REQUIRE(last.state == BankJobs::JobState::Done);
+        REQUIRE(last.progress == 1.f);
+        REQUIRE(last.error.empty());
+
+        // Progress only moves forward
+        for (size_t i = 1; i < updates.size(); ++i)
+            REQUIRE(updates[i].progress >= updates[i - 1].progress);
+
+        auto bank = S3::downloadFile(last.key);
+        REQUIRE(bank);
+        REQUIRE(bank->substr(0, 4) == "FSB5");
+        REQUIRE(S3::deleteFile(last.key));
+    }
+
+    SECTION("Each profile's bank is stored")
+    {
+        auto id = BankJobs::submit(testFiles(),
+            EncodeProfiles::parse("mobile,lowcpu"));
+        auto status = waitFor(id);
+        REQUIRE(status.state == BankJobs::JobState::Done);
+        REQUIRE(status.variants.size() == 2);
+        REQUIRE(status.key == status.variants.at("mobile"));
+
+        for (auto &[name, key] : status.variants)
+        {
+            auto bank = S3::downloadFile(key);
+            REQUIRE(bank);
+            REQUIRE(bank->substr(0, 4) == "FSB5");
+            REQUIRE(S3::deleteFile(key));
+        }
+    }
+
+    SECTION("Cancelled jobs don't build")
+    {
+        BankPoolBlocker blocker;
+
+        auto id = BankJobs::submit(testFiles());
+        REQUIRE(BankJobs::cancel(id));
+        REQUIRE(BankJobs::status(id)->state == BankJobs::JobState::Cancelled);
+
+        // Already cancelled
+        REQUIRE(!BankJobs::cancel(id));
+
+        blocker.release();
+        auto status = waitFor(id);
+        REQUIRE(status.state == BankJobs::JobState::Cancelled);
+        REQUIRE(status.key.empty());
+    }
+
+    SECTION("Jobs whose client went away are cancelled")
+    {
+        BankPoolBlocker blocker;
+
+        auto id = BankJobs::submit(testFiles());
+        auto subscription = BankJobs::subscribe(id,
+            [](const BankJobs::JobStatus &) {});
+
+        // Followers hold the lease
+        std::this_thread::sleep_for(200ms);
+        REQUIRE(BankJobs::status(id)->state == BankJobs::JobState::Queued);
+
+        // Neither followed nor polled
+        BankJobs::unsubscribe(id, subscription);
+        std::this_thread::sleep_for(200ms);
+
+        blocker.release();
+        REQUIRE(waitFor(id).state == BankJobs::JobState::Cancelled);
+    }
+
+    SECTION("Bad files are rejected before a job is created")
+    {
+        auto files = testFiles();
+        files.emplace_back("not an audio file");
+        REQUIRE_THROWS_AS(BankJobs::submit(std::move(files)),
+            std::invalid_argument);
+    }
+
+    SECTION("Jobs over the pending cost are turned away")
+    {
+        BankPoolBlocker blocker;
+
+        std::vector<std::string> ids;
+        ids.emplace_back(BankJobs::submit(distinctFiles(0)));
+        auto cost = BankJobs::status(ids[0])->cost;
+        REQUIRE(cost > 0);
+
+        bool turnedAway = false;
+        while (ids.size() < 100 && !turnedAway)
+        {
+            try {
+                ids.emplace_back(BankJobs::submit(distinctFiles(ids.size())));
+            }
+            catch (const std::runtime_error &)
+            {
+                turnedAway = true;
+            }
+        }
+
+        REQUIRE(turnedAway);
+        REQUIRE(ids.size() * cost <= 0.001 + cost);
+
+        for (auto &id : ids)
+            REQUIRE(BankJobs::cancel(id));
+        blocker.release();
+    }
+
+    SECTION("Identical builds are shared and reused")
+    {
+        std::string id;
+        {
+            BankPoolBlocker blocker;
+
+            // Identical jobs in progress are joined
+            id = BankJobs::submit(testFiles());
+            REQUIRE(BankJobs::submit(testFiles()) == id);
+
+            // Still wanted by the other submission
+            REQUIRE(BankJobs::cancel(id));
+            REQUIRE(BankJobs::status(id)->state ==
+                BankJobs::JobState::Queued);
+        }
+
+        auto status = waitFor(id);
+        REQUIRE(status.state == BankJobs::JobState::Done);
+
+        // Stored banks are reused by later jobs without building
+        auto reused = waitFor(BankJobs::submit(testFiles()));
+        REQUIRE(reused.id != id);
+        REQUIRE(reused.state == BankJobs::JobState::Done);
+        REQUIRE(reused.key == status.key);
+
+        REQUIRE(S3::deleteFile(status.key));
+    }
+
+    SECTION("Unknown jobs")
+    {
+        REQUIRE(!BankJobs::status("unknown"));
+        REQUIRE(!BankJobs::cancel("unknown"));
+        REQUIRE(BankJobs::subscribe("unknown",
+            [](const BankJobs::JobStatus &) {}) == 0);
+    }
+
+    BankJobs::stop();
+}
+
+TEST_CASE("Stored banks are deleted once past their retention", "[BankJobs]")
+{
+    // S3 is set up by the listener in s3.test.cpp
+    REQUIRE(BankBuilder::initLibrary() == BankBuilder::OK);
+
+    auto expired = BankJobs::bankKey("test-expired");
+    auto referenced = BankJobs::bankKey("test-referenced");
+    REQUIRE(S3::uploadFile(expired, "bank"));
+    REQUIRE(S3::uploadFile(referenced, "bank"));
+
+    BankJobs::start({.retention = 1min, .sweepInterval = 10ms,
+        .bankRetention = 1ms, .bankSweepInterval = 50ms,
+        .referenced = [&referenced]() {
+            return std::set<std::string>{referenced};
+        }});
+
+    // Kept while the job that stored it is
+    auto job = waitFor(BankJobs::submit(testFiles()));
+    REQUIRE(job.state == BankJobs::JobState::Done);
+
+    auto deadline = std::chrono::steady_clock::now() + 10s;
+    while (S3::fileExists(expired) &&
+        std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(50ms);
+
+    REQUIRE(!S3::fileExists(expired));
+    REQUIRE(S3::fileExists(referenced));
+    REQUIRE(S3::fileExists(job.key));
+
+    BankJobs::stop();
+    REQUIRE(S3::deleteFiles({referenced, job.key}));
+}
@@ -0,0 +1,73 @@
+#include <insound/tests/test.h>
+#include <insound/core/BloomFilter.h>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("BloomFilter", "[BloomFilter]")
+{
+    BloomFilter filter(10000);
+
+    SECTION("Empty filter contains nothing")
+    {
+        REQUIRE(!filter.mayContain(BloomFilter::hash("anything")));
+        REQUIRE(filter.size() == 0);
+    }
+
+    SECTION("Never misses an inserted key")
+    {
+        for (int i = 0; i < 10000; ++i)
+            filter.insert(BloomFilter::hash(sf("key-{}", i)));
+
+        for (int i = 0; i < 10000; ++i)
+            REQUIRE(filter.mayContain(BloomFilter::hash(sf("key-{}", i))));
+        REQUIRE(filter.size() == 10000);
+    }
+
+    SECTION("False positive rate stays low at capacity")
+    {
+        for (int i = 0; i < 10000; ++i)
+            filter.insert(BloomFilter::hash(sf("key-{}", i)));
+
+        int falsePositives = 0;
+        for (int i = 0; i < 100000; ++i)
+        {
+            if (filter.mayContain(BloomFilter::hash(sf("other-{}", i))))
+                ++falsePositives;
+        }
+
+        // Expected around 0.1%
+        REQUIRE(falsePositives < 500);
+    }
+
+    SECTION("Reads while another thread inserts")
+    {
+        std::thread writer([&filter]() {
+            for (int i = 0; i < 10000; ++i)
+                filter.insert(BloomFilter::hash(sf("key-{}", i)));
+        });
+
+        for (int i = 0; i < 10000; ++i)
+            (void)filter.mayContain(BloomFilter::hash(sf("key-{}", i)));
+        writer.join();
+
+        for (int i = 0; i < 10000; ++i)
+            REQUIRE(filter.mayContain(BloomFilter::hash(sf("key-{}", i))));
+    }
+}
+
+TEST_CASE("BloomFilter benchmarks", "[BloomFilter][!benchmark]")
+{
+    BloomFilter filter(1 << 16);
+    for (int i = 0; i < (1 << 16); ++i)
+        filter.insert(BloomFilter::hash(sf("key-{}", i)));
+
+    const std::string jti = "GPBId1G_QQu5EtqHLdjtEw";
+    BENCHMARK("Hash and look up an absent token id")
+    {
+        return filter.mayContain(BloomFilter::hash(jti));
+    };
+}
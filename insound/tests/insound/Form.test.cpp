@@ -0,0 +1,85 @@
+#include <insound/tests/test.h>
+#include <insound/core/Form.h>
+
+#include <string>
+#include <string_view>
+
+struct FormTestFields {
+    std::string_view email;
+    std::string password;
+
+    IN_JSON_LOCAL_META(FormTestFields, email, password);
+};
+
+static crow::request makeRequest(std::string_view type, std::string body)
+{
+    crow::request req;
+    req.add_header("Content-Type", std::string(type));
+    req.body = std::move(body);
+    return req;
+}
+
+TEST_CASE("Form parses request bodies into structs", "[Form]")
+{
+    SECTION("JSON bodies are read in place")
+    {
+        auto req = makeRequest("application/json; charset=utf-8",
+            R"({"email":"bob@mail.com","password":"a\"b","extra":[1,2]})");
+
+        Form<FormTestFields> form(req);
+        REQUIRE(form);
+        REQUIRE(form->email == "bob@mail.com");
+        REQUIRE(form->password == "a\"b");
+
+        // Views point into the request body
+        REQUIRE(form->email.data() >= req.body.data());
+        REQUIRE(form->email.data() < req.body.data() + req.body.size());
+    }
+
+    SECTION("Missing fields keep their defaults")
+    {
+        auto req = makeRequest("application/json", R"({"password":"pw"})");
+
+        Form<FormTestFields> form(req);
+        REQUIRE(form);
+        REQUIRE(form->email.empty());
+        REQUIRE(form->password == "pw");
+    }
+
+    SECTION("Url-encoded bodies fall back to MultipartMap")
+    {
+        auto req = makeRequest("application/x-www-form-urlencoded",
+            "email=bob%40mail.com&password=pw");
+
+        Form<FormTestFields> form(req);
+        REQUIRE(form);
+        REQUIRE(form->email == "bob@mail.com");
+        REQUIRE(form->password == "pw");
+    }
+
+    SECTION("Malformed bodies map to form errors")
+    {
+        auto req = makeRequest("application/json", R"({"email":)");
+
+        Form<FormTestFields> form(req);
+        REQUIRE(!form);
+        REQUIRE(form.errors.errors.contains("error"));
+    }
+
+    SECTION("Wrong value types map to form errors")
+    {
+        auto req = makeRequest("application/json", R"({"email":5})");
+
+        Form<FormTestFields> form(req);
+        REQUIRE(!form);
+    }
+
+    SECTION("Missing content type maps to form errors")
+    {
+        crow::request req;
+        req.body = "email=a";
+
+        Form<FormTestFields> form(req);
+        REQUIRE(!form);
+    }
+}
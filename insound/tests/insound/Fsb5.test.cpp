@@ -0,0 +1,90 @@
+#include <insound/core/BankBuilder.h>
+#include <insound/core/Fsb5.h>
+#include <insound/tests/definitions.h>
+#include <insound/tests/test.h>
+
+#include <string>
+
+/**
+ * Build a bank from the test mp3, ogg and wav files, in that order
+ */
+static std::string buildTestBank()
+{
+    REQUIRE(BankBuilder::initLibrary() == BankBuilder::OK);
+
+    auto mp3 = readFile(STATIC_DIR "/audio/test.mp3");
+    auto ogg = readFile(STATIC_DIR "/audio/test.ogg");
+    auto wav = readFile(STATIC_DIR "/audio/test.wav");
+
+    BankBuilder builder;
+    REQUIRE(builder.addFile(mp3.data(), mp3.size()) == BankBuilder::OK);
+    REQUIRE(builder.addFile(ogg.data(), ogg.size()) == BankBuilder::OK);
+    REQUIRE(builder.addFile(wav.data(), wav.size()) == BankBuilder::OK);
+    REQUIRE(builder.build() == BankBuilder::OK);
+
+    return builder.release();
+}
+
+TEST_CASE("Fsb5::parse indexes built banks", "[Fsb5]")
+{
+    auto bank = buildTestBank();
+    auto index = Fsb5::parse(bank);
+
+    REQUIRE(index.version == 1);
+    REQUIRE(index.subsounds.size() == 3);
+
+    // Files are stored in reverse
+    REQUIRE(index.subsounds[0].samples == 102);
+    REQUIRE(index.subsounds[1].samples == 102);
+    REQUIRE(index.subsounds[2].samples > 3000);
+
+    for (size_t i = 0; i < index.subsounds.size(); ++i)
+    {
+        auto &subsound = index.subsounds[i];
+        REQUIRE(subsound.channels == 1);
+        REQUIRE(subsound.sampleRate == 44100);
+        REQUIRE(subsound.size > 0);
+
+        // Data is contiguous up to the end of the file
+        auto end = i + 1 < index.subsounds.size() ?
+            index.subsounds[i + 1].offset : bank.size();
+        REQUIRE(subsound.offset + subsound.size == end);
+    }
+
+    REQUIRE(Fsb5::range(index.subsounds[0]) == sf("bytes={}-{}",
+        index.subsounds[0].offset, index.subsounds[1].offset - 1));
+
+    SECTION("Headers alone are enough")
+    {
+        auto headers = Fsb5::parse(std::string_view(bank).substr(0,
+            index.subsounds[0].offset));
+        REQUIRE(headers.subsounds.size() == 3);
+        REQUIRE(headers.subsounds[2].offset == index.subsounds[2].offset);
+    }
+
+    SECTION("Invalid banks are rejected")
+    {
+        Fsb5::Index result;
+        REQUIRE(Fsb5::read("not a bank", result) != nullptr);
+        REQUIRE(Fsb5::read(std::string_view(bank).substr(0, 0x40), result)
+            != nullptr);
+        REQUIRE(Fsb5::read(std::string_view(bank).substr(0, bank.size() - 1),
+            result) != nullptr);
+
+        auto wrongMagic = bank;
+        wrongMagic[3] = '4';
+        REQUIRE_THROWS(Fsb5::parse(wrongMagic));
+    }
+}
+
+TEST_CASE("BankBuilder::decode keeps the exact sample count", "[Fsb5]")
+{
+    REQUIRE(BankBuilder::initLibrary() == BankBuilder::OK);
+
+    auto wav = readFile(STATIC_DIR "/audio/test.wav");
+
+    Pcm pcm;
+    REQUIRE(BankBuilder::decode(wav.data(), wav.size(), pcm) ==
+        BankBuilder::OK);
+    REQUIRE(pcm.frames() == 102);
+}
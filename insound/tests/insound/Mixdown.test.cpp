@@ -0,0 +1,146 @@
+#include <insound/core/Mixdown.h>
+#include <insound/tests/test.h>
+
+#include <cstring>
+
+static Pcm constant(unsigned channels, unsigned sampleRate, size_t frames,
+    int16_t value)
+{
+    Pcm pcm;
+    pcm.channels = channels;
+    pcm.sampleRate = sampleRate;
+    pcm.samples.assign(frames * channels, value);
+    return pcm;
+}
+
+static Pcm ramp(unsigned sampleRate, size_t frames)
+{
+    Pcm pcm;
+    pcm.channels = 1;
+    pcm.sampleRate = sampleRate;
+    pcm.samples.resize(frames);
+    for (size_t i = 0; i < frames; ++i)
+        pcm.samples[i] = (int16_t)(i * 2 % 1000);
+    return pcm;
+}
+
+TEST_CASE("Mixdown::mix sums stems at their levels", "[Mixdown]")
+{
+    auto mix = Mixdown::mix(
+        {constant(1, 44100, 100, 1000), constant(1, 44100, 50, 2000)},
+        {0.5, 1.0});
+
+    REQUIRE(mix.channels == 2);
+    REQUIRE(mix.sampleRate == 44100);
+    REQUIRE(mix.frames() == 100);
+
+    // Both stems, then only the longer one
+    REQUIRE(mix.samples[0] == 2500);
+    REQUIRE(mix.samples[1] == 2500);
+    REQUIRE(mix.samples[99 * 2] == 500);
+
+    SECTION("Stems without a level play at full volume")
+    {
+        auto full = Mixdown::mix({constant(1, 44100, 10, 1000)}, {});
+        REQUIRE(full.samples[0] == 1000);
+    }
+
+    SECTION("Loud mixes are clipped")
+    {
+        auto loud = Mixdown::mix({constant(1, 44100, 10, 30000),
+            constant(1, 44100, 10, 30000)}, {1.0, 1.0});
+        REQUIRE(loud.samples[0] == INT16_MAX);
+    }
+}
+
+TEST_CASE("Mixdown::mix maps channels", "[Mixdown]")
+{
+    Pcm stereo;
+    stereo.channels = 2;
+    stereo.sampleRate = 44100;
+    stereo.samples = {1000, 3000, 1000, 3000};
+
+    SECTION("Stereo stems keep their sides")
+    {
+        auto mix = Mixdown::mix({stereo}, {1.0});
+        REQUIRE(mix.samples == std::vector<int16_t>{1000, 3000, 1000, 3000});
+    }
+
+    SECTION("Stereo stems are folded into mono mixes")
+    {
+        auto mix = Mixdown::mix({stereo}, {1.0}, {.channels = 1});
+        REQUIRE(mix.channels == 1);
+        REQUIRE(mix.samples == std::vector<int16_t>{2000, 2000});
+    }
+}
+
+TEST_CASE("Mixdown::mix resamples stems to the mix rate", "[Mixdown]")
+{
+    auto mix = Mixdown::mix({ramp(22050, 1000)}, {1.0},
+        {.sampleRate = 44100, .channels = 1});
+
+    REQUIRE(mix.frames() == 2000);
+
+    // Frames between source frames are interpolated
+    REQUIRE(mix.samples[10] == 10);
+    REQUIRE(mix.samples[11] == 11);
+    REQUIRE(mix.samples[12] == 12);
+}
+
+TEST_CASE("Mixdown::mix repeats the loop", "[Mixdown]")
+{
+    auto stem = ramp(44100, 1000);
+
+    auto mix = Mixdown::mix({stem}, {1.0}, {.channels = 1, .loopStart = 200,
+        .loopEnd = 600, .loopRepeats = 2});
+
+    // Plays to the loop end, then the loop twice more
+    REQUIRE(mix.frames() == 600 + 2 * 400);
+    REQUIRE(std::memcmp(mix.samples.data(), stem.samples.data(),
+        600 * sizeof(int16_t)) == 0);
+    for (size_t i = 0; i < 2; ++i)
+    {
+        REQUIRE(std::memcmp(mix.samples.data() + 600 + i * 400,
+            stem.samples.data() + 200, 400 * sizeof(int16_t)) == 0);
+    }
+
+    SECTION("Loops past the end are cut to the mix length")
+    {
+        auto cut = Mixdown::mix({stem}, {1.0}, {.channels = 1,
+            .loopStart = 800, .loopEnd = 5000});
+        REQUIRE(cut.frames() == 1000 + 200);
+    }
+
+    SECTION("Empty loops are ignored")
+    {
+        auto none = Mixdown::mix({stem}, {1.0}, {.channels = 1,
+            .loopStart = 600, .loopEnd = 600});
+        REQUIRE(none.frames() == 1000);
+    }
+}
+
+TEST_CASE("Mixdown::toWav writes a PCM wave file", "[Mixdown]")
+{
+    auto wav = Mixdown::toWav(constant(2, 48000, 10, 7));
+
+    REQUIRE(wav.size() == 44 + 10 * 2 * sizeof(int16_t));
+    REQUIRE(wav.compare(0, 4, "RIFF") == 0);
+    REQUIRE(wav.compare(8, 4, "WAVE") == 0);
+    REQUIRE(wav.compare(36, 4, "data") == 0);
+
+    auto read = [&wav](size_t offset, size_t size) {
+        uint32_t value = 0;
+        std::memcpy(&value, wav.data() + offset, size);
+        return value;
+    };
+
+    REQUIRE(read(4, 4) == wav.size() - 8);
+    REQUIRE(read(20, 2) == 1);        // PCM
+    REQUIRE(read(22, 2) == 2);        // channels
+    REQUIRE(read(24, 4) == 48000);    // sample rate
+    REQUIRE(read(28, 4) == 48000 * 4);// byte rate
+    REQUIRE(read(32, 2) == 4);        // block align
+    REQUIRE(read(34, 2) == 16);       // bits per sample
+    REQUIRE(read(40, 4) == 40);
+    REQUIRE(read(44, 2) == 7);
+}
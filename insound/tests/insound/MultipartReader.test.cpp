@@ -0,0 +1,75 @@
+#include <insound/tests/test.h>
+#include <insound/core/MultipartReader.h>
+
+#include <stdexcept>
+#include <string>
+
+TEST_CASE("MultipartReader reads parts in order", "[MultipartReader]")
+{
+    std::string body =
+        "preamble\r\n"
+        "--XyZ\r\n"
+        "Content-Disposition: form-data; name=\"title\"\r\n"
+        "\r\n"
+        "Hello\r\n"
+        "--XyZ\r\n"
+        "content-disposition: form-data; name=\"a\"; filename=\"a;b.wav\"\r\n"
+        "Content-Type: audio/wav\r\n"
+        "\r\n"
+        "RIFF\r\n--data\r\n"
+        "--XyZ--\r\n";
+
+    MultipartReader reader("multipart/form-data; boundary=\"XyZ\"", body);
+
+    auto field = reader.next();
+    REQUIRE(field);
+    REQUIRE(field->name == "title");
+    REQUIRE(field->data == "Hello");
+    REQUIRE(!field->isFile());
+
+    // Quoted parameters may hold ';', and data may hold a partial delimiter
+    auto file = reader.next();
+    REQUIRE(file);
+    REQUIRE(file->name == "a");
+    REQUIRE(file->filename == "a;b.wav");
+    REQUIRE(file->contentType == "audio/wav");
+    REQUIRE(file->data == "RIFF\r\n--data");
+    REQUIRE(file->isFile());
+
+    // Parts refer into the body
+    REQUIRE(file->data.data() >= body.data());
+    REQUIRE(file->data.data() < body.data() + body.size());
+
+    REQUIRE(!reader.next());
+    REQUIRE(!reader.next());
+    REQUIRE(reader.count() == 2);
+}
+
+TEST_CASE("MultipartReader rejects malformed bodies", "[MultipartReader]")
+{
+    SECTION("Not multipart")
+    {
+        REQUIRE_THROWS_AS(MultipartReader("text/plain", "--XyZ--"),
+            std::invalid_argument);
+    }
+
+    SECTION("Missing boundary")
+    {
+        REQUIRE_THROWS_AS(MultipartReader("multipart/form-data", "--XyZ--"),
+            std::invalid_argument);
+    }
+
+    SECTION("Truncated part")
+    {
+        MultipartReader reader("multipart/form-data; boundary=XyZ",
+            "--XyZ\r\nContent-Disposition: form-data; name=\"x\"\r\n\r\nabc");
+        REQUIRE_THROWS_AS(reader.next(), std::invalid_argument);
+    }
+
+    SECTION("Part without Content-Disposition")
+    {
+        MultipartReader reader("multipart/form-data; boundary=XyZ",
+            "--XyZ\r\nContent-Type: text/plain\r\n\r\nabc\r\n--XyZ--");
+        REQUIRE_THROWS_AS(reader.next(), std::invalid_argument);
+    }
+}
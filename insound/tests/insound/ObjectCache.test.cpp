@@ -0,0 +1,350 @@
+#include <insound/tests/test.h>
+#include <insound/core/ObjectCache.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+/**
+ * In-memory store counting its fetches
+ */
+struct FakeStore
+{
+    std::mutex mutex;
+    std::map<std::string, std::pair<std::string, std::string>> objects;
+    std::atomic<int> fetches{0};
+    std::atomic<int> conditionalFetches{0};
+    std::chrono::milliseconds delay{0};
+    std::atomic<bool> failing{false};
+
+    void put(const std::string &key, std::string data)
+    {
+        std::lock_guard lock(mutex);
+        auto version = objects.count(key) ?
+            std::stoi(objects[key].second) + 1 : 1;
+        objects[key] = {std::move(data), std::to_string(version)};
+    }
+
+    ObjectCache::Fetch fetcher()
+    {
+        return [this](std::string_view key, std::string_view etag)
+            -> std::optional<ObjectCache::Fetched> {
+            ++fetches;
+            if (!etag.empty())
+                ++conditionalFetches;
+            std::this_thread::sleep_for(delay);
+            if (failing)
+                throw std::runtime_error("Store is unreachable");
+
+            std::lock_guard lock(mutex);
+            auto it = objects.find(std::string(key));
+            if (it == objects.end())
+                return {};
+            if (!etag.empty() && it->second.second == etag)
+                return ObjectCache::Fetched{{}, std::string(etag), false};
+            return ObjectCache::Fetched{it->second.first, it->second.second};
+        };
+    }
+};
+
+TEST_CASE("ObjectCache serves repeated gets from memory", "[ObjectCache]")
+{
+    FakeStore store;
+    store.put("a", "apple");
+    ObjectCache cache(store.fetcher());
+
+    SECTION("Misses fetch once, then hit")
+    {
+        auto first = cache.get("a");
+        REQUIRE(first);
+        REQUIRE(first->data() == "apple");
+        REQUIRE(first->etag() == "1");
+
+        auto second = cache.get("a");
+        REQUIRE(second == first);
+        REQUIRE(store.fetches == 1);
+
+        auto stats = cache.stats();
+        REQUIRE(stats.hits == 1);
+        REQUIRE(stats.misses == 1);
+        REQUIRE(stats.memoryBytes == 5);
+        REQUIRE(stats.memoryObjects == 1);
+    }
+
+    SECTION("Peeks never fetch")
+    {
+        REQUIRE(!cache.peek("a"));
+        REQUIRE(store.fetches == 0);
+
+        auto first = cache.get("a");
+        REQUIRE(cache.peek("a") == first);
+        REQUIRE(store.fetches == 1);
+        REQUIRE(cache.stats().hits == 1);
+    }
+
+    SECTION("Missing objects are not cached")
+    {
+        REQUIRE(!cache.get("missing"));
+        REQUIRE(!cache.get("missing"));
+        REQUIRE(store.fetches == 2);
+    }
+
+    SECTION("Concurrent misses share one fetch")
+    {
+        store.delay = 100ms;
+
+        std::vector<std::thread> threads;
+        std::vector<ObjectCache::Ptr> results(8);
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            threads.emplace_back([&cache, &results, i]() {
+                results[i] = cache.get("a");
+            });
+        }
+        for (auto &thread : threads)
+            thread.join();
+
+        REQUIRE(store.fetches == 1);
+        for (auto &result : results)
+            REQUIRE(result == results[0]);
+    }
+
+    SECTION("Erased objects are fetched again, and held copies survive")
+    {
+        auto held = cache.get("a");
+        cache.erase("a");
+        REQUIRE(cache.stats().memoryObjects == 0);
+        REQUIRE(held->data() == "apple");
+
+        REQUIRE(cache.get("a") != held);
+        REQUIRE(store.fetches == 2);
+    }
+}
+
+TEST_CASE("ObjectCache revalidates by etag", "[ObjectCache]")
+{
+    FakeStore store;
+    store.put("a", "apple");
+    ObjectCache cache(store.fetcher(), {.revalidateAfter = 0ms});
+
+    auto first = cache.get("a");
+
+    SECTION("Unchanged objects are kept")
+    {
+        REQUIRE(cache.get("a") == first);
+        REQUIRE(store.conditionalFetches == 1);
+        REQUIRE(cache.stats().revalidations == 1);
+    }
+
+    SECTION("Changed objects are replaced")
+    {
+        store.put("a", "apricot");
+        auto second = cache.get("a");
+        REQUIRE(second->data() == "apricot");
+        REQUIRE(second->etag() == "2");
+        REQUIRE(cache.stats().memoryBytes == 7);
+    }
+
+    SECTION("Deleted objects are dropped")
+    {
+        store.objects.clear();
+        REQUIRE(!cache.get("a"));
+        REQUIRE(cache.stats().memoryObjects == 0);
+    }
+
+    SECTION("Cached objects are served while the store fails")
+    {
+        store.failing = true;
+        REQUIRE(cache.get("a") == first);
+        REQUIRE(cache.get("a") == first);
+        REQUIRE(cache.stats().memoryObjects == 1);
+
+        // Still due for revalidation
+        store.failing = false;
+        REQUIRE(cache.get("a") == first);
+        REQUIRE(store.fetches == 4);
+        REQUIRE(cache.stats().revalidations == 1);
+    }
+
+    SECTION("Misses fail along with the store")
+    {
+        store.failing = true;
+        REQUIRE_THROWS_AS(cache.get("b"), std::runtime_error);
+    }
+}
+
+TEST_CASE("ObjectCache keeps popular objects within its budget",
+    "[ObjectCache]")
+{
+    FakeStore store;
+    for (int i = 0; i < 4; ++i)
+        store.put(sf("small-{}", i), std::string(100, 'a' + i));
+    store.put("large", std::string(300, 'z'));
+    store.put("huge", std::string(1000, 'z'));
+
+    ObjectCache cache(store.fetcher(), {
+        .memoryBytes = 400,
+        .maxObjectBytes = 400,
+    });
+
+    // Make the small objects popular
+    for (int round = 0; round < 3; ++round)
+    {
+        for (int i = 0; i < 4; ++i)
+            REQUIRE(cache.get(sf("small-{}", i)));
+    }
+    REQUIRE(cache.stats().memoryBytes == 400);
+
+    SECTION("A one-off object does not displace popular ones")
+    {
+        REQUIRE(cache.get("large")->size() == 300);
+        auto stats = cache.stats();
+        REQUIRE(stats.rejected == 1);
+        REQUIRE(stats.memoryObjects == 4);
+    }
+
+    SECTION("An object that becomes popular displaces the least used")
+    {
+        for (int i = 0; i < 5; ++i)
+            (void)cache.get("large");
+
+        auto stats = cache.stats();
+        REQUIRE(stats.memoryBytes <= 400);
+        REQUIRE(stats.memoryObjects == 2);
+
+        // Now served from memory
+        auto fetches = store.fetches.load();
+        (void)cache.get("large");
+        REQUIRE(store.fetches == fetches);
+    }
+
+    SECTION("Objects over the size limit are never held")
+    {
+        REQUIRE(cache.holds(400));
+        REQUIRE(!cache.holds(1000));
+
+        REQUIRE(cache.get("huge")->size() == 1000);
+        REQUIRE(cache.get("huge"));
+        REQUIRE(cache.stats().rejected == 2);
+        REQUIRE(cache.stats().memoryBytes == 400);
+    }
+}
+
+TEST_CASE("ObjectCache serves objects turned away from memory from disk",
+    "[ObjectCache]")
+{
+    auto directory = std::filesystem::temp_directory_path() /
+        "insound-object-cache-test";
+
+    FakeStore store;
+    store.put("small", std::string(100, 's'));
+    store.put("huge", std::string(1000, 'h'));
+
+    {
+        ObjectCache cache(store.fetcher(), {
+            .memoryBytes = 400,
+            .maxObjectBytes = 400,
+            .diskDirectory = directory.string(),
+            .diskBytes = 1500,
+        });
+
+        REQUIRE(cache.holds(1000));
+        REQUIRE(!cache.holds(2000));
+
+        auto huge = cache.get("huge");
+        REQUIRE(!huge->mapped());
+        REQUIRE(cache.stats().diskObjects == 1);
+        REQUIRE(cache.stats().diskBytes == 1000);
+
+        auto mapped = cache.get("huge");
+        REQUIRE(mapped->mapped());
+        REQUIRE(mapped->data() == huge->data());
+        REQUIRE(mapped->etag() == "1");
+        REQUIRE(store.fetches == 1);
+
+        // Small objects stay in memory
+        REQUIRE(!cache.get("small")->mapped());
+        REQUIRE(cache.stats().diskObjects == 1);
+
+        // Mapped data stays valid after its file is removed
+        cache.erase("huge");
+        REQUIRE(mapped->data() == std::string(1000, 'h'));
+    }
+
+    // Files are removed along with the cache
+    REQUIRE(std::filesystem::is_empty(directory));
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("ObjectCache only clears its own files from the disk directory",
+    "[ObjectCache]")
+{
+    auto directory = std::filesystem::temp_directory_path() /
+        "insound-object-cache-shared-test";
+    std::filesystem::create_directories(directory);
+
+    auto write = [&directory](const std::string &name) {
+        std::ofstream(directory / name) << "data";
+    };
+    auto leftover = std::string(43, 'A') + "-7";
+    write("unrelated.txt");
+    write(leftover);
+    write(leftover + ".tmp");
+
+    FakeStore store;
+    {
+        ObjectCache cache(store.fetcher(), {
+            .diskDirectory = directory.string(),
+        });
+    }
+
+    REQUIRE(std::filesystem::exists(directory / "unrelated.txt"));
+    REQUIRE(!std::filesystem::exists(directory / leftover));
+    REQUIRE(!std::filesystem::exists(directory / (leftover + ".tmp")));
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("ObjectCache revalidates demoted objects on schedule",
+    "[ObjectCache]")
+{
+    auto directory = std::filesystem::temp_directory_path() /
+        "insound-object-cache-demote-test";
+
+    FakeStore store;
+    store.put("old", std::string(300, 'o'));
+
+    {
+        ObjectCache cache(store.fetcher(), {
+            .memoryBytes = 400,
+            .maxObjectBytes = 400,
+            .revalidateAfter = 300ms,
+            .diskDirectory = directory.string(),
+        });
+
+        REQUIRE(cache.get("old"));
+        std::this_thread::sleep_for(200ms);
+
+        // Requested more often than "old", so it takes its place in memory
+        for (int i = 0; i < 3; ++i)
+            REQUIRE(!cache.get("new"));
+        store.put("new", std::string(300, 'n'));
+        REQUIRE(cache.get("new"));
+        REQUIRE(cache.stats().diskObjects == 1);
+
+        // Due since it was fetched, not since it was demoted
+        std::this_thread::sleep_for(200ms);
+        REQUIRE(cache.get("old")->data() == std::string(300, 'o'));
+        REQUIRE(store.conditionalFetches == 1);
+    }
+
+    std::filesystem::remove_all(directory);
+}
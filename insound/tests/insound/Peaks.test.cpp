@@ -0,0 +1,162 @@
+#include <insound/core/BankBuilder.h>
+#include <insound/core/Peaks.h>
+#include <insound/tests/definitions.h>
+#include <insound/tests/test.h>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+/**
+ * Reads the headers and bins of an overview
+ */
+struct PeaksReader
+{
+    std::string_view file;
+    Peaks::FileHeader header;
+
+    explicit PeaksReader(std::string_view file) : file(file), header()
+    {
+        REQUIRE(file.size() >= sizeof(header));
+        std::memcpy(&header, file.data(), sizeof(header));
+    }
+
+    Peaks::LevelHeader level(uint32_t index) const
+    {
+        Peaks::LevelHeader level;
+        std::memcpy(&level, file.data() + sizeof(header) +
+            index * sizeof(level), sizeof(level));
+        return level;
+    }
+
+    Peaks::Bin bin(uint32_t levelIndex, uint32_t bin, uint32_t channel) const
+    {
+        auto offset = level(levelIndex).offset +
+            ((size_t)bin * header.channels + channel) * sizeof(Peaks::Bin);
+        REQUIRE(offset + sizeof(Peaks::Bin) <= file.size());
+
+        Peaks::Bin result;
+        std::memcpy(&result, file.data() + offset, sizeof(result));
+        return result;
+    }
+};
+
+static Pcm noise(unsigned channels, size_t frames)
+{
+    std::mt19937 rng(frames);
+    Pcm pcm;
+    pcm.channels = channels;
+    pcm.sampleRate = 48000;
+    pcm.samples.resize(frames * channels);
+    for (auto &sample : pcm.samples)
+        sample = (int16_t)(rng() & 0xffff);
+    return pcm;
+}
+
+TEST_CASE("Peaks::compute summarizes every bin", "[Peaks]")
+{
+    auto channels = GENERATE(1u, 2u, 3u);
+    auto frames = GENERATE(0ul, 1ul, 255ul, 1000ul, 70000ul);
+
+    auto pcm = noise(channels, frames);
+    if (frames > 10)
+    {
+        // Extremes are kept exactly
+        pcm.samples[3 * channels] = INT16_MIN;
+        pcm.samples[9 * channels] = INT16_MAX;
+    }
+
+    auto file = Peaks::compute(pcm, {.binSize = 256, .minBins = 64});
+    PeaksReader peaks(file);
+
+    REQUIRE(std::memcmp(peaks.header.magic, Peaks::Magic, 4) == 0);
+    REQUIRE(peaks.header.version == Peaks::Version);
+    REQUIRE(peaks.header.channels == channels);
+    REQUIRE(peaks.header.sampleRate == 48000);
+    REQUIRE(peaks.header.frames == frames);
+    REQUIRE(peaks.header.levelCount >= 1);
+
+    // Only the coarsest level is within the minimum
+    REQUIRE(peaks.level(peaks.header.levelCount - 1).bins <= 64);
+
+    for (uint32_t l = 0; l < peaks.header.levelCount; ++l)
+    {
+        auto level = peaks.level(l);
+        REQUIRE(level.samplesPerBin == 256u << l);
+        REQUIRE(level.bins == (frames + level.samplesPerBin - 1) /
+            level.samplesPerBin);
+
+        for (uint32_t b = 0; b < level.bins; ++b)
+        {
+            auto start = (size_t)b * level.samplesPerBin;
+            auto end = std::min(start + level.samplesPerBin, (size_t)frames);
+
+            for (uint32_t c = 0; c < channels; ++c)
+            {
+                int min = INT16_MAX, max = INT16_MIN;
+                double squares = 0;
+                for (auto i = start; i < end; ++i)
+                {
+                    int sample = pcm.samples[i * channels + c];
+                    min = std::min(min, sample);
+                    max = std::max(max, sample);
+                    squares += (double)sample * sample;
+                }
+
+                auto bin = peaks.bin(l, b, c);
+                REQUIRE(bin.min == min);
+                REQUIRE(bin.max == max);
+                REQUIRE(bin.rms ==
+                    std::lround(std::sqrt(squares / (end - start))));
+            }
+        }
+    }
+}
+
+TEST_CASE("Peaks::compute stores the coarsest level first", "[Peaks]")
+{
+    auto file = Peaks::compute(noise(2, 44100 * 60));
+    PeaksReader peaks(file);
+
+    auto coarsest = peaks.level(peaks.header.levelCount - 1);
+    REQUIRE(coarsest.offset == sizeof(Peaks::FileHeader) +
+        peaks.header.levelCount * sizeof(Peaks::LevelHeader));
+
+    // A first paint fits in a few kilobytes
+    REQUIRE(coarsest.offset + coarsest.bins * 2 * sizeof(Peaks::Bin) < 8192);
+    REQUIRE(peaks.level(0).offset + peaks.level(0).bins * 2 *
+        sizeof(Peaks::Bin) == file.size());
+}
+
+TEST_CASE("Peaks::fromFile decodes stems", "[Peaks]")
+{
+    REQUIRE(BankBuilder::initLibrary() == BankBuilder::OK);
+
+    for (auto path : {STATIC_DIR "/audio/test.mp3", STATIC_DIR "/audio/test.ogg",
+        STATIC_DIR "/audio/test.wav"})
+    {
+        auto file = Peaks::fromFile(readFile(path));
+        PeaksReader peaks(file);
+        REQUIRE(peaks.header.channels >= 1);
+        REQUIRE(peaks.header.sampleRate > 0);
+        REQUIRE(peaks.header.frames > 0);
+        REQUIRE(peaks.bin(0, 0, 0).max > 0);
+    }
+
+    REQUIRE_THROWS(Peaks::fromFile("not audio"));
+}
+
+TEST_CASE("Peaks::compute benchmark", "[Peaks][!benchmark]")
+{
+    // Three minute stereo stem
+    auto pcm = noise(2, 44100 * 180);
+
+    BENCHMARK("compute")
+    {
+        return Peaks::compute(pcm);
+    };
+}
@@ -0,0 +1,79 @@
+#include <insound/tests/test.h>
+#include <insound/core/PipelineStage.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+TEST_CASE("PipelineStage bounds the items in flight", "[PipelineStage]")
+{
+    ThreadPool pool("test", 8);
+    PipelineStage stage(pool, 2);
+
+    std::atomic<int> running{0}, peak{0}, done{0};
+    for (int i = 0; i < 16; ++i)
+    {
+        REQUIRE(stage.push([&]() {
+            auto now = ++running;
+            for (auto last = peak.load(); now > last &&
+                !peak.compare_exchange_weak(last, now);) { }
+
+            std::this_thread::sleep_for(5ms);
+            --running;
+            ++done;
+        }));
+    }
+
+    stage.wait();
+    REQUIRE(done == 16);
+    REQUIRE(peak <= 2);
+    REQUIRE(!stage.failed());
+}
+
+TEST_CASE("PipelineStage stops after an item throws", "[PipelineStage]")
+{
+    ThreadPool pool("test", 1);
+    PipelineStage stage(pool, 1);
+
+    REQUIRE(stage.push([]() { throw std::runtime_error("error"); }));
+
+    // Refused once the failure is seen, which happens by the next push
+    // since the stage holds one item
+    std::atomic<int> ran{0};
+    REQUIRE(!stage.push([&ran]() { ++ran; }));
+
+    REQUIRE(stage.failed());
+    REQUIRE_THROWS_AS(stage.wait(), std::runtime_error);
+    REQUIRE(ran == 0);
+}
+
+TEST_CASE("PipelineStage skips queued items once cancelled",
+    "[PipelineStage]")
+{
+    ThreadPool pool("test", 1);
+    std::atomic<int> ran{0};
+    std::atomic<bool> started{false};
+
+    {
+        PipelineStage stage(pool, 4);
+        REQUIRE(stage.push([&ran, &started]() {
+            started = true;
+            std::this_thread::sleep_for(20ms);
+            ++ran;
+        }));
+        for (int i = 0; i < 3; ++i)
+            REQUIRE(stage.push([&ran]() { ++ran; }));
+
+        while (!started)
+            std::this_thread::yield();
+        stage.cancel();
+        REQUIRE(!stage.push([&ran]() { ++ran; }));
+        REQUIRE_NOTHROW(stage.wait());
+    }
+
+    // Only the item already running finished
+    REQUIRE(ran == 1);
+}
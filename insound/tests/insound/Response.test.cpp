@@ -0,0 +1,94 @@
+#include <insound/tests/test.h>
+#include <insound/core/Response.h>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+// Count heap allocations made by the current thread while enabled
+static thread_local bool sCounting;
+static thread_local size_t sAllocations;
+
+void *operator new(size_t size)
+{
+    if (sCounting)
+        ++sAllocations;
+    if (auto ptr = std::malloc(size == 0 ? 1 : size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+template <typename F>
+static size_t countAllocations(F &&func)
+{
+    sAllocations = 0;
+    sCounting = true;
+    func();
+    sCounting = false;
+    return sAllocations;
+}
+
+struct ResponseTestBody {
+    std::string name;
+    std::vector<int> values;
+
+    IN_JSON_LOCAL_META(ResponseTestBody, name, values);
+};
+
+TEST_CASE("Response::json allocations", "[Response]")
+{
+    ResponseTestBody obj {
+        .name = "a name long enough to not fit small string buffers",
+        .values = {1, 2, 3, 4, 5, 6, 7, 8},
+    };
+
+    // Cost of the response and its Content-Type header alone
+    auto headerAllocs = countAllocations([]() {
+        Response res;
+        res.set_header("Content-Type",
+            std::string(ContentType::Application::JSON));
+    });
+
+    SECTION("Serialized bodies allocate once")
+    {
+        // Warm up this thread's size hint
+        Response::json(obj);
+
+        Response res;
+        auto allocs = countAllocations([&]() {
+            res = Response::json(obj);
+        });
+
+        REQUIRE(res.body == JSON::stringify(obj));
+        REQUIRE(allocs == headerAllocs + 1);
+    }
+
+    SECTION("Constant bodies are precomputed")
+    {
+        Response res;
+        auto allocs = countAllocations([&]() {
+            res = Response::json<"Success">(HttpStatus::Created);
+        });
+
+        REQUIRE(res.code == (int)HttpStatus::Created);
+        REQUIRE(res.body == "\"Success\"");
+        REQUIRE(allocs == headerAllocs);
+    }
+
+    BENCHMARK("Response::json(obj)")
+    {
+        return Response::json(obj);
+    };
+
+    BENCHMARK("Response::json<\"Success\">()")
+    {
+        return Response::json<"Success">();
+    };
+}
@@ -0,0 +1,66 @@
+#include <insound/tests/test.h>
+#include <insound/core/ByteBudget.h>
+#include <insound/core/RouteLimits.h>
+
+#include <chrono>
+
+using namespace std::chrono_literals;
+
+TEST_CASE("RouteLimits matches registered routes", "[RouteLimits]")
+{
+    RouteLimits::clear();
+    RouteLimits::set("api/test//make-fsb", {.maxBodySize = 100});
+    RouteLimits::set("/api/track/<string>/peaks/<string>", {.maxBodySize = 50});
+    RouteLimits::set("/static/<path>", {.maxBodySize = 25});
+
+    SECTION("Exact routes are normalized")
+    {
+        auto limit = RouteLimits::find("/api/test/make-fsb/");
+        REQUIRE(limit);
+        REQUIRE(limit->maxBodySize == 100);
+    }
+
+    SECTION("Parameters match a single segment")
+    {
+        auto limit = RouteLimits::find("/api/track/abc/peaks/def");
+        REQUIRE(limit);
+        REQUIRE(limit->maxBodySize == 50);
+
+        REQUIRE(!RouteLimits::find("/api/track/abc/peaks"));
+        REQUIRE(!RouteLimits::find("/api/track/abc/peaks/def/ghi"));
+    }
+
+    SECTION("Path parameters match the rest of the url")
+    {
+        auto limit = RouteLimits::find("/static/a/b/c");
+        REQUIRE(limit);
+        REQUIRE(limit->maxBodySize == 25);
+    }
+
+    SECTION("Unregistered routes have no limit")
+    {
+        REQUIRE(!RouteLimits::find("/api/auth/login/email"));
+    }
+
+    RouteLimits::clear();
+}
+
+TEST_CASE("ByteBudget reserves and releases bytes", "[ByteBudget]")
+{
+    ByteBudget budget(100);
+
+    auto first = budget.acquire(60, 0ms);
+    REQUIRE(first);
+    REQUIRE(budget.used() == 60);
+
+    // Not enough room left
+    REQUIRE(!budget.acquire(60, 0ms));
+
+    first.release();
+    REQUIRE(budget.used() == 0);
+
+    // Requests larger than the capacity are clamped
+    auto large = budget.acquire(1000, 0ms);
+    REQUIRE(large);
+    REQUIRE(large.bytes() == 100);
+}
@@ -0,0 +1,96 @@
+#include <insound/tests/test.h>
+#include <insound/core/SingleFlight.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+/**
+ * Wait until a call for a key is running
+ */
+template <typename Key, typename Value>
+static void waitForRunning(const SingleFlight<Key, Value> &flights,
+    const Key &key)
+{
+    auto deadline = std::chrono::steady_clock::now() + 10s;
+    while (!flights.running(key) &&
+        std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(1ms);
+    REQUIRE(flights.running(key));
+}
+
+TEST_CASE("SingleFlight shares one call between concurrent callers",
+    "[SingleFlight]")
+{
+    SingleFlight<std::string, std::shared_ptr<const std::string>> flights;
+    std::atomic<int> calls{0};
+    std::promise<void> release;
+    auto released = release.get_future().share();
+
+    auto call = [&]() {
+        ++calls;
+        released.wait();
+        return std::make_shared<const std::string>("bank");
+    };
+
+    // The first caller runs the call, blocking until released
+    auto first = std::async(std::launch::async, [&]() {
+        return flights.run("a", call).get();
+    });
+    waitForRunning(flights, std::string("a"));
+
+    // Later callers join it without calling
+    std::vector<std::shared_future<std::shared_ptr<const std::string>>> joined;
+    for (int i = 0; i < 8; ++i)
+        joined.emplace_back(flights.run("a", call));
+
+    // Other keys run on their own
+    auto other = flights.run("b", []() {
+        return std::make_shared<const std::string>("other");
+    }).get();
+    REQUIRE(*other == "other");
+
+    release.set_value();
+    auto result = first.get();
+    REQUIRE(*result == "bank");
+    for (auto &future : joined)
+        REQUIRE(future.get() == result);
+    REQUIRE(calls == 1);
+
+    // Results are not kept once the call finishes
+    REQUIRE(!flights.running("a"));
+    REQUIRE(flights.run("a", call).get() != result);
+    REQUIRE(calls == 2);
+}
+
+TEST_CASE("SingleFlight rethrows a failed call to every caller",
+    "[SingleFlight]")
+{
+    SingleFlight<int, int> flights;
+    std::promise<void> release;
+    auto released = release.get_future().share();
+
+    auto first = std::async(std::launch::async, [&]() {
+        return flights.run(1, [&]() -> int {
+            released.wait();
+            throw std::runtime_error("Build failed");
+        });
+    });
+    waitForRunning(flights, 1);
+
+    auto joined = flights.run(1, []() { return 0; });
+
+    release.set_value();
+    REQUIRE_THROWS_AS(first.get().get(), std::runtime_error);
+    REQUIRE_THROWS_AS(joined.get(), std::runtime_error);
+
+    // A later call runs again
+    REQUIRE(flights.run(1, []() { return 2; }).get() == 2);
+}
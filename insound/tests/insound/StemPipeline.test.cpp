@@ -0,0 +1,175 @@
+#include <insound/core/BankBuilder.h>
+#include <insound/core/BankJobs.h>
+#include <insound/core/MultipartReader.h>
+#include <insound/core/Peaks.h>
+#include <insound/core/s3.h>
+#include <insound/core/StemPipeline.h>
+#include <insound/tests/definitions.h>
+#include <insound/tests/test.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static const auto ContentType = "multipart/form-data; boundary=XyZ";
+
+/**
+ * Build a multipart body with a text field and a part for each file
+ */
+static std::string multipartBody(const std::vector<std::string> &files)
+{
+    std::string body =
+        "--XyZ\r\n"
+        "Content-Disposition: form-data; name=\"title\"\r\n"
+        "\r\n"
+        "Stems\r\n";
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        body += sf("--XyZ\r\n"
+            "Content-Disposition: form-data; name=\"stem{0}\"; "
+            "filename=\"stem{0}\"\r\n"
+            "\r\n", i);
+        body += files[i];
+        body += "\r\n";
+    }
+    body += "--XyZ--\r\n";
+    return body;
+}
+
+static std::vector<std::string> testFiles()
+{
+    return {
+        readFile(STATIC_DIR "/audio/test.mp3"),
+        readFile(STATIC_DIR "/audio/test.ogg"),
+        readFile(STATIC_DIR "/audio/test.wav"),
+    };
+}
+
+/**
+ * Options storing stems under a folder of their own
+ */
+static StemPipeline::Opts testOpts(const std::string &folder)
+{
+    return {
+        .stemKey = [folder](size_t index) {
+            return sf("stem-pipeline/{}/{}", folder, index);
+        },
+    };
+}
+
+TEST_CASE("StemPipeline stores stems and their bank", "[StemPipeline]")
+{
+    // S3 is set up by the listener in s3.test.cpp
+    REQUIRE(BankBuilder::initLibrary() == BankBuilder::OK);
+
+    auto files = testFiles();
+    auto body = multipartBody(files);
+
+    MultipartReader reader(ContentType, body);
+    auto result = StemPipeline::run(reader, testOpts("stored"));
+
+    REQUIRE(result.stems.size() == files.size());
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        auto &stem = result.stems[i];
+        REQUIRE(stem.name == sf("stem{}", i));
+        REQUIRE(stem.key == sf("stem-pipeline/stored/{}", i));
+        REQUIRE(stem.hash == BankBuilder::hashFile(files[i]));
+        REQUIRE(S3::downloadFile(stem.key) == files[i]);
+        REQUIRE(S3::fileExists(Peaks::key(stem.key)));
+    }
+
+    REQUIRE(result.bankKey == BankJobs::bankKey(result.buildKey));
+    REQUIRE(result.bank.substr(0, 4) == "FSB5");
+    REQUIRE(S3::downloadFile(result.bankKey) == result.bank);
+
+    SECTION("A bank stored under the same build key is reused")
+    {
+        // Replaced, so a bank that was encoded again would not match
+        REQUIRE(S3::uploadFile(result.bankKey, "stored bank"));
+
+        MultipartReader again(ContentType, body);
+        auto reused = StemPipeline::run(again, testOpts("reused"));
+
+        REQUIRE(reused.buildKey == result.buildKey);
+        REQUIRE(reused.bankKey == result.bankKey);
+        REQUIRE(reused.bank == "stored bank");
+        REQUIRE(S3::downloadFile(result.bankKey) == "stored bank");
+        REQUIRE(S3::deleteFolder("stem-pipeline/reused"));
+    }
+
+    REQUIRE(S3::deleteFolder("stem-pipeline/stored"));
+    REQUIRE(S3::deleteFile(result.bankKey));
+}
+
+TEST_CASE("StemPipeline rejects batches it can't build", "[StemPipeline]")
+{
+    // S3 is set up by the listener in s3.test.cpp
+    REQUIRE(BankBuilder::initLibrary() == BankBuilder::OK);
+
+    // The stems route answers Rejected with 415 Unsupported Media Type, and
+    // other failures with 400 or 500, so each case must throw Rejected
+    auto files = testFiles();
+
+    SECTION("Too few files")
+    {
+        auto body = multipartBody(files);
+        MultipartReader reader(ContentType, body);
+        auto opts = testOpts("few");
+        opts.minStems = files.size() + 1;
+
+        REQUIRE_THROWS_AS(StemPipeline::run(reader, opts),
+            StemPipeline::Rejected);
+    }
+
+    SECTION("Too many files")
+    {
+        auto body = multipartBody(files);
+        MultipartReader reader(ContentType, body);
+        auto opts = testOpts("many");
+        opts.maxStems = files.size() - 1;
+
+        REQUIRE_THROWS_AS(StemPipeline::run(reader, opts),
+            StemPipeline::Rejected);
+    }
+
+    SECTION("A file that is too large")
+    {
+        auto body = multipartBody(files);
+        MultipartReader reader(ContentType, body);
+        auto opts = testOpts("large");
+        opts.maxStemBytes = files[2].size() - 1;
+
+        REQUIRE_THROWS_AS(StemPipeline::run(reader, opts),
+            StemPipeline::Rejected);
+    }
+
+    SECTION("A file that is not audio")
+    {
+        files.insert(files.begin() + 2, "not audio");
+        auto body = multipartBody(files);
+        MultipartReader reader(ContentType, body);
+
+        REQUIRE_THROWS_AS(StemPipeline::run(reader, testOpts("corrupt")),
+            StemPipeline::Rejected);
+    }
+
+    // Stems stored before the batch failed are deleted again, along with
+    // their overviews
+    REQUIRE(S3::listObjects("stem-pipeline/").empty());
+}
+
+TEST_CASE("StemPipeline rejects bodies without files", "[StemPipeline]")
+{
+    std::string body =
+        "--XyZ\r\n"
+        "Content-Disposition: form-data; name=\"title\"\r\n"
+        "\r\n"
+        "Stems\r\n"
+        "--XyZ--\r\n";
+    MultipartReader reader(ContentType, body);
+
+    // Not Rejected, so it is answered with 400 instead of 415
+    REQUIRE_THROWS_AS(StemPipeline::run(reader, testOpts("empty")),
+        std::invalid_argument);
+}
@@ -0,0 +1,61 @@
+#include <insound/tests/test.h>
+#include <insound/core/ThreadPool.h>
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+TEST_CASE("ThreadPool runs tasks and returns results", "[ThreadPool]")
+{
+    ThreadPool pool("test", 4);
+    REQUIRE(pool.size() == 4);
+
+    SECTION("Results are returned via future")
+    {
+        std::vector<std::future<int>> futures;
+        for (int i = 0; i < 100; ++i)
+            futures.emplace_back(pool.submit([i]() { return i * 2; }));
+
+        for (int i = 0; i < 100; ++i)
+            REQUIRE(futures[i].get() == i * 2);
+    }
+
+    SECTION("Exceptions are passed through the future")
+    {
+        auto future = pool.submit([]() -> int {
+            throw std::runtime_error("error");
+        });
+
+        REQUIRE_THROWS_AS(future.get(), std::runtime_error);
+    }
+
+    SECTION("Stats count completed tasks")
+    {
+        pool.submit([]() {}).get();
+
+        // The future is ready before the worker counts the task
+        auto deadline = std::chrono::steady_clock::now() + 1s;
+        while (pool.stats().completed == 0 &&
+            std::chrono::steady_clock::now() < deadline)
+            std::this_thread::yield();
+
+        auto stats = pool.stats();
+        REQUIRE(stats.name == "test");
+        REQUIRE(stats.threads == 4);
+        REQUIRE(stats.completed >= 1);
+    }
+}
+
+TEST_CASE("ThreadPool drains queued tasks on shutdown", "[ThreadPool]")
+{
+    ThreadPool pool("test", 1);
+    std::atomic<int> count = 0;
+    for (int i = 0; i < 10; ++i)
+        pool.submit([&count]() { ++count; });
+
+    pool.shutdown(true);
+    REQUIRE(count == 10);
+    REQUIRE_THROWS(pool.submit([]() {}));
+}
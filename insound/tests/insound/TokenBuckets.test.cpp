@@ -0,0 +1,62 @@
+#include <insound/tests/test.h>
+#include <insound/core/TokenBuckets.h>
+
+#include <chrono>
+
+using namespace std::chrono_literals;
+
+TEST_CASE("TokenBuckets limits bursts and refills", "[TokenBuckets]")
+{
+    TokenBuckets buckets;
+    auto now = TokenBuckets::Clock::now();
+    RateLimit limit{.capacity = 3, .refillPerSecond = 1};
+
+    SECTION("Disabled limits always allow")
+    {
+        for (int i = 0; i < 100; ++i)
+            REQUIRE(buckets.take("a", RateLimit{}, now).allowed);
+        REQUIRE(buckets.size() == 0);
+    }
+
+    SECTION("Burst up to capacity, then reject with retry time")
+    {
+        for (int i = 0; i < 3; ++i)
+            REQUIRE(buckets.take("a", limit, now).allowed);
+
+        auto result = buckets.take("a", limit, now);
+        REQUIRE(!result.allowed);
+        REQUIRE(result.retryAfter == 1);
+
+        // Other clients are unaffected
+        REQUIRE(buckets.take("b", limit, now).allowed);
+    }
+
+    SECTION("Tokens refill over time")
+    {
+        for (int i = 0; i < 3; ++i)
+            REQUIRE(buckets.take("a", limit, now).allowed);
+        REQUIRE(!buckets.take("a", limit, now + 500ms).allowed);
+        REQUIRE(buckets.take("a", limit, now + 1s).allowed);
+        REQUIRE(!buckets.take("a", limit, now + 1s).allowed);
+    }
+
+    SECTION("Costs drain the bucket faster")
+    {
+        RateLimit costly = limit;
+        costly.cost = 2;
+        REQUIRE(buckets.take("a", costly, now).allowed);
+        auto result = buckets.take("a", costly, now);
+        REQUIRE(!result.allowed);
+        REQUIRE(result.retryAfter == 1);
+    }
+
+    SECTION("Compaction drops refilled buckets only")
+    {
+        REQUIRE(buckets.take("a", limit, now).allowed);
+        REQUIRE(buckets.take("b", limit, now + 900ms).allowed);
+        REQUIRE(buckets.size() == 2);
+
+        REQUIRE(buckets.compact(now + 1s) == 1);
+        REQUIRE(buckets.size() == 1);
+    }
+}
@@ -0,0 +1,122 @@
+#include <insound/tests/test.h>
+#include <insound/core/UrlEncoded.h>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <stdexcept>
+#include <string>
+
+TEST_CASE("UrlEncoded::decode", "[UrlEncoded]")
+{
+    REQUIRE(UrlEncoded::decode("bob%40mail.com") == "bob@mail.com");
+    REQUIRE(UrlEncoded::decode("a+b%2B%2b") == "a b++");
+    REQUIRE(UrlEncoded::decode("a=b&c") == "a=b&c");
+    REQUIRE(UrlEncoded::decode("").empty());
+
+    REQUIRE_THROWS_AS(UrlEncoded::decode("%4"), std::invalid_argument);
+    REQUIRE_THROWS_AS(UrlEncoded::decode("%zz"), std::invalid_argument);
+}
+
+TEST_CASE("UrlEncoded::parse", "[UrlEncoded]")
+{
+    SECTION("Splits before decoding")
+    {
+        std::string body = "email=bob%40mail.com&name=a+b%26c%3Dd&x=1=2";
+        auto fields = UrlEncoded::parse(body);
+
+        REQUIRE(fields.size() == 3);
+        REQUIRE(fields[0].key == "email");
+        REQUIRE(fields[0].value == "bob@mail.com");
+        REQUIRE(fields[1].key == "name");
+        REQUIRE(fields[1].value == "a b&c=d");
+        REQUIRE(fields[2].key == "x");
+        REQUIRE(fields[2].value == "1=2");
+    }
+
+    SECTION("Views point into the body")
+    {
+        std::string body = "plain=value";
+        auto fields = UrlEncoded::parse(body);
+
+        REQUIRE(fields.size() == 1);
+        REQUIRE(fields[0].value.data() == body.data() + 6);
+        REQUIRE(body == "plain=value");
+    }
+
+    SECTION("Keys without values and empty pairs")
+    {
+        std::string body = "&flag&&a=&=b&";
+        auto fields = UrlEncoded::parse(body);
+
+        REQUIRE(fields.size() == 3);
+        REQUIRE(fields[0].key == "flag");
+        REQUIRE(fields[0].value.empty());
+        REQUIRE(fields[1].key == "a");
+        REQUIRE(fields[1].value.empty());
+        REQUIRE(fields[2].key.empty());
+        REQUIRE(fields[2].value == "b");
+    }
+
+    SECTION("Long components are scanned in chunks")
+    {
+        std::string plain(100, 'a');
+        std::string body = plain + "=" + plain + "%21" + plain;
+        auto fields = UrlEncoded::parse(body);
+
+        REQUIRE(fields.size() == 1);
+        REQUIRE(fields[0].key == plain);
+        REQUIRE(fields[0].value == plain + "!" + plain);
+    }
+
+    SECTION("Malformed escapes throw")
+    {
+        std::string body = "a=1&b=%2";
+        REQUIRE_THROWS_AS(UrlEncoded::parse(body), std::invalid_argument);
+    }
+}
+
+TEST_CASE("UrlEncoded::findSpecial", "[UrlEncoded]")
+{
+    std::string str(64, 'a');
+    REQUIRE(UrlEncoded::findSpecial(str.data(), str.size()) == str.size());
+
+    for (auto c : {'%', '+', '&', '='})
+    {
+        for (size_t i : {0, 15, 16, 17, 63})
+        {
+            auto copy = str;
+            copy[i] = c;
+            REQUIRE(UrlEncoded::findSpecial(copy.data(), copy.size()) == i);
+        }
+    }
+}
+
+TEST_CASE("UrlEncoded benchmarks", "[UrlEncoded][!benchmark]")
+{
+    // 1000 fields of mostly plain text, and 1000 fields full of escapes
+    std::string plain, escaped;
+    for (int i = 0; i < 1000; ++i)
+    {
+        plain += sf("{}field_{}=some+plain+value+number+{}", i ? "&" : "",
+            i, i);
+        escaped += sf("{}f%5B{}%5D=%E3%81%82%E3%81%84+%26+%3D+{}",
+            i ? "&" : "", i, i);
+    }
+
+    BENCHMARK("Parse large plain form")
+    {
+        auto body = plain;
+        return UrlEncoded::parse(body).size();
+    };
+
+    BENCHMARK("Parse large escaped form")
+    {
+        auto body = escaped;
+        return UrlEncoded::parse(body).size();
+    };
+
+    BENCHMARK("Decode large string")
+    {
+        return UrlEncoded::decode(escaped).size();
+    };
+}
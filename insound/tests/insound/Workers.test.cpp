@@ -0,0 +1,41 @@
+#include <insound/tests/test.h>
+#include <insound/core/Workers.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+TEST_CASE("Workers::shutdown drains tasks that look up pools", "[Workers]")
+{
+    Workers::configure({{"workers-test-a", 1}, {"workers-test-b", 1}});
+
+    std::promise<void> started;
+    std::atomic<bool> finished{false};
+    (void)Workers::get("workers-test-a").submit([&]() {
+        started.set_value();
+
+        // Still running once shutdown has begun
+        std::this_thread::sleep_for(50ms);
+        (void)Workers::get("workers-test-b");
+        finished = true;
+    });
+    started.get_future().wait();
+
+    // Used to deadlock, joining the task while it waited on the pool lock
+    std::promise<void> done;
+    auto shutdown = done.get_future();
+    std::thread([done = std::move(done)]() mutable {
+        Workers::shutdown(true);
+        done.set_value();
+    }).detach();
+    REQUIRE(shutdown.wait_for(5s) == std::future_status::ready);
+    REQUIRE(finished);
+
+    // Pools start anew after shutdown
+    REQUIRE(Workers::get("workers-test-a").submit([]() {
+        return 1;
+    }).get() == 1);
+}
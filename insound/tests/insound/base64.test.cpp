@@ -0,0 +1,115 @@
+#include <insound/tests/test.h>
+#include <insound/core/base64.h>
+
+#include <string>
+
+// Bit-by-bit encoder to check the fast paths against
+static std::string referenceEncode(std::string_view data)
+{
+    static constexpr std::string_view Alphabet =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+    std::string res;
+    uint32_t bits = 0;
+    int count = 0;
+    for (unsigned char c : data)
+    {
+        bits = bits << 8 | c;
+        count += 8;
+        while (count >= 6)
+        {
+            count -= 6;
+            res += Alphabet[bits >> count & 0x3f];
+        }
+    }
+
+    if (count)
+        res += Alphabet[bits << (6 - count) & 0x3f];
+    return res;
+}
+
+TEST_CASE("Base64Url::encode", "[base64]")
+{
+    SECTION("RFC 4648 test vectors, without padding")
+    {
+        REQUIRE(Base64Url::encode("").empty());
+        REQUIRE(Base64Url::encode("f") == "Zg");
+        REQUIRE(Base64Url::encode("fo") == "Zm8");
+        REQUIRE(Base64Url::encode("foo") == "Zm9v");
+        REQUIRE(Base64Url::encode("foob") == "Zm9vYg");
+        REQUIRE(Base64Url::encode("fooba") == "Zm9vYmE");
+        REQUIRE(Base64Url::encode("foobar") == "Zm9vYmFy");
+    }
+
+    SECTION("Uses the url-safe alphabet")
+    {
+        REQUIRE(Base64Url::encode("\xfb\xff\xbf") == "-_-_");
+    }
+
+    SECTION("Matches the reference for every length and byte value")
+    {
+        // Long enough to run the vectorized loops and all of their tails
+        std::string data(300, '\0');
+        for (size_t i = 0; i < data.size(); ++i)
+            data[i] = (char)(i * 97 + 13);
+
+        for (size_t size = 0; size <= data.size(); ++size)
+        {
+            auto in = std::string_view(data).substr(0, size);
+            auto encoded = Base64Url::encode(in);
+            REQUIRE(encoded.size() == Base64Url::encodedSize(size));
+            REQUIRE(encoded == referenceEncode(in));
+        }
+    }
+}
+
+TEST_CASE("Base64Url::decode", "[base64]")
+{
+    std::string out;
+
+    SECTION("RFC 4648 test vectors, without padding")
+    {
+        REQUIRE((Base64Url::decode("", out) && out.empty()));
+        REQUIRE((Base64Url::decode("Zg", out) && out == "f"));
+        REQUIRE((Base64Url::decode("Zm8", out) && out == "fo"));
+        REQUIRE((Base64Url::decode("Zm9v", out) && out == "foo"));
+        REQUIRE((Base64Url::decode("Zm9vYmFy", out) && out == "foobar"));
+        REQUIRE((Base64Url::decode("-_-_", out) && out == "\xfb\xff\xbf"));
+    }
+
+    SECTION("Rejects invalid input")
+    {
+        REQUIRE(!Base64Url::decode("Z", out));     // impossible length
+        REQUIRE(!Base64Url::decode("Zg==", out));  // padding
+        REQUIRE(!Base64Url::decode("+/+/", out));  // standard alphabet
+        REQUIRE(!Base64Url::decode("Zh", out));    // non-zero trailing bits
+        REQUIRE(!Base64Url::decode("Zm+", out));
+    }
+
+    SECTION("Round trips every length, rejecting any corrupted character")
+    {
+        std::string data(300, '\0');
+        for (size_t i = 0; i < data.size(); ++i)
+            data[i] = (char)(i * 131 + 7);
+
+        for (size_t size = 0; size <= data.size(); ++size)
+        {
+            auto in = std::string_view(data).substr(0, size);
+            auto encoded = Base64Url::encode(in);
+
+            REQUIRE(Base64Url::decode(encoded, out));
+            REQUIRE(out == in);
+
+            // Covers positions in the vectorized blocks and in the tail
+            if (!encoded.empty())
+            {
+                for (char bad : {'=', '+', '/', '.', ' ', '\x80', '\xff'})
+                {
+                    auto corrupt = encoded;
+                    corrupt[size * 7 % corrupt.size()] = bad;
+                    REQUIRE(!Base64Url::decode(corrupt, out));
+                }
+            }
+        }
+    }
+}
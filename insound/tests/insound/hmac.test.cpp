@@ -0,0 +1,57 @@
+#include <insound/tests/test.h>
+#include <insound/core/hmac.h>
+
+#include <string>
+
+static std::string hex(const HmacSha256::Digest &digest)
+{
+    std::string res;
+    for (auto byte : digest)
+        res += sf("{:02x}", byte);
+    return res;
+}
+
+TEST_CASE("HmacSha256 matches RFC 4231 test vectors", "[hmac]")
+{
+    SECTION("Test case 1")
+    {
+        HmacSha256 key(std::string(20, '\x0b'));
+        REQUIRE(hex(key.sign("Hi There")) ==
+            "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7");
+    }
+
+    SECTION("Test case 2: key shorter than the output")
+    {
+        HmacSha256 key("Jefe");
+        REQUIRE(hex(key.sign("what do ya want for nothing?")) ==
+            "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+    }
+
+    SECTION("Test case 6: key longer than a block")
+    {
+        HmacSha256 key(std::string(131, '\xaa'));
+        REQUIRE(hex(key.sign(
+            "Test Using Larger Than Block-Size Key - Hash Key First")) ==
+            "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+    }
+
+    SECTION("Signing is repeatable")
+    {
+        HmacSha256 key("secret");
+        REQUIRE(key.sign("message") == key.sign("message"));
+        REQUIRE(key.sign("message") != key.sign("messagf"));
+    }
+}
+
+TEST_CASE("HmacSha256::verify", "[hmac]")
+{
+    HmacSha256 key("secret");
+    auto signature = key.sign("message");
+
+    REQUIRE(key.verify("message", signature.data(), signature.size()));
+    REQUIRE(!key.verify("messagf", signature.data(), signature.size()));
+    REQUIRE(!key.verify("message", signature.data(), signature.size() - 1));
+
+    signature.back() ^= 1;
+    REQUIRE(!key.verify("message", signature.data(), signature.size()));
+}
@@ -33,3 +33,19 @@ TEST_CASE("Check auto-serializing in newer Glaze versions")
 
     REQUIRE(JSON::stringify(param) == expected);
 }
+
+TEST_CASE("Compile-time JSON literals match glaze output")
+{
+    REQUIRE(JSON::literal<"Success"> == JSON::stringify("Success"));
+    REQUIRE(JSON::literal<""> == "\"\"");
+    REQUIRE(JSON::literal<"quote\" slash\\ newline\n"> ==
+        JSON::stringify("quote\" slash\\ newline\n"));
+    REQUIRE(JSON::literal<"ctrl\x01"> == R"("ctrl\u0001")");
+}
+
+TEST_CASE("Stringify into a reused buffer")
+{
+    std::string buffer = "previous contents";
+    JSON::stringify(std::vector<int>{1, 2, 3}, buffer);
+    REQUIRE(buffer == "[1,2,3]");
+}
@@ -1,8 +1,11 @@
 #include <insound/tests/test.h>
 #include <insound/tests/env.h>
 
+#include <insound/core/base64.h>
 #include <insound/core/jwt.h>
 
+#include <catch2/benchmark/catch_benchmark.hpp>
+
 
 // Use insound's chrono literals
 #include <insound/core/chrono.h>
@@ -57,3 +60,136 @@ TEST_CASE ("JWT serialize & deserialize", "[Jwt]")
     }
 
 }
+
+TEST_CASE ("JWT signing writes a standard HS256 token", "[Jwt]")
+{
+    Insound::configureEnv(ENV_FILEPATH);
+
+    SECTION("header is the standard HS256 header")
+    {
+        auto jwt = Insound::Jwt::sign(person{"Joe", 42}, 1_min);
+
+        REQUIRE(jwt.starts_with(
+            Insound::Base64Url::encode(R"({"alg":"HS256","typ":"JWT"})") + "."));
+
+        // header.payload.signature, with a 32-byte signature
+        auto lastDot = jwt.rfind('.');
+        REQUIRE(jwt.find('.') < lastDot);
+        REQUIRE(jwt.size() - lastDot - 1 ==
+            Insound::Base64Url::encodedSize(32));
+    }
+
+    SECTION("payload string receives the claims")
+    {
+        std::string jwt;
+        REQUIRE_NOTHROW(jwt = Insound::Jwt::sign(
+            std::string_view(R"( {"name":"Ann","age":7} )"), 1_min));
+
+        person res;
+        REQUIRE_NOTHROW(res = Insound::Jwt::verify<person>(jwt));
+        REQUIRE(res.name == "Ann");
+        REQUIRE(res.age == 7);
+    }
+
+    SECTION("empty object payload")
+    {
+        std::string jwt;
+        REQUIRE_NOTHROW(jwt = Insound::Jwt::sign(std::string_view("{}"),
+            1_min));
+        REQUIRE_NOTHROW(Insound::Jwt::verify(jwt));
+    }
+
+    SECTION("non-object payload throws")
+    {
+        REQUIRE_THROWS_AS(Insound::Jwt::sign(std::string_view("[1,2]"), 1_min),
+            Insound::Jwt::Error);
+        REQUIRE_THROWS_AS(Insound::Jwt::sign(std::string_view(""), 1_min),
+            Insound::Jwt::Error);
+    }
+}
+
+TEST_CASE ("JWT verification rejects bad tokens", "[Jwt]")
+{
+    Insound::configureEnv(ENV_FILEPATH);
+
+    auto jwt = Insound::Jwt::sign(person{"Joe", 42}, 1_min);
+    std::string payload;
+
+    SECTION("valid token")
+    {
+        REQUIRE(Insound::Jwt::verify(jwt, payload) ==
+            Insound::Jwt::Error::Code::OK);
+        REQUIRE(payload.find(R"("name":"Joe")") != std::string::npos);
+    }
+
+    SECTION("tampered payload")
+    {
+        auto dot = jwt.find('.');
+        auto forged = jwt.substr(0, dot + 1) +
+            Insound::Base64Url::encode(R"({"name":"Eve","age":42,"exp":9999999999})") +
+            jwt.substr(jwt.rfind('.'));
+
+        REQUIRE(Insound::Jwt::verify(forged, payload) ==
+            Insound::Jwt::Error::Code::VerificationFailure);
+    }
+
+    SECTION("tampered signature")
+    {
+        auto forged = jwt;
+        forged[forged.rfind('.') + 1] ^= 1;
+        REQUIRE(Insound::Jwt::verify(forged, payload) !=
+            Insound::Jwt::Error::Code::OK);
+    }
+
+    SECTION("other algorithm")
+    {
+        auto forged = Insound::Base64Url::encode(R"({"alg":"none"})") +
+            jwt.substr(jwt.find('.'));
+        REQUIRE(Insound::Jwt::verify(forged, payload) ==
+            Insound::Jwt::Error::Code::VerificationFailure);
+    }
+
+    SECTION("malformed")
+    {
+        REQUIRE(Insound::Jwt::verify("", payload) ==
+            Insound::Jwt::Error::Code::BadTokenFormat);
+        REQUIRE(Insound::Jwt::verify("abc.def", payload) ==
+            Insound::Jwt::Error::Code::BadTokenFormat);
+    }
+
+    SECTION("expired token reports expiry")
+    {
+        auto expired = Insound::Jwt::sign(person{"Joe", 42}, -1_s);
+        REQUIRE(Insound::Jwt::verify(expired, payload) ==
+            Insound::Jwt::Error::Code::TokenExpired);
+    }
+}
+
+TEST_CASE ("JWT benchmarks", "[Jwt][!benchmark]")
+{
+    Insound::configureEnv(ENV_FILEPATH);
+
+    person p {
+        .name = "Joe",
+        .age = 42,
+    };
+
+    BENCHMARK("Jwt::sign<T>")
+    {
+        return Insound::Jwt::sign(p, 14_d);
+    };
+
+    auto jwt = Insound::Jwt::sign(p, 14_d);
+    BENCHMARK("Jwt::verify<T>")
+    {
+        return Insound::Jwt::verify<person>(jwt);
+    };
+
+    auto forged = jwt;
+    forged.back() = forged.back() == 'A' ? 'B' : 'A';
+    BENCHMARK("Jwt::verify rejecting a forged signature")
+    {
+        std::string payload;
+        return Insound::Jwt::verify(forged, payload);
+    };
+}
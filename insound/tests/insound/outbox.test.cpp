@@ -0,0 +1,112 @@
+#include <insound/tests/test.h>
+#include <insound/core/mongo.h>
+#include <insound/core/outbox.h>
+
+#include <insound/tests/env.h>
+
+#include <bsoncxx/builder/basic/document.hpp>
+#include <crow/app.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+// Wait for a condition, checking every few milliseconds
+template <typename F>
+static bool waitFor(F &&condition, std::chrono::milliseconds timeout)
+{
+    auto end = std::chrono::steady_clock::now() + timeout;
+    while (!condition())
+    {
+        if (std::chrono::steady_clock::now() > end)
+            return false;
+        std::this_thread::sleep_for(10ms);
+    }
+
+    return true;
+}
+
+TEST_CASE("Email outbox sends queued emails in the background", "[outbox]")
+{
+    configureEnv(ENV_FILEPATH);
+    REQUIRE(Mongo::connect());
+    Mongo::db().collection("OutboxEmail").delete_many(
+        bsoncxx::builder::basic::make_document());
+
+    // Stub email provider. Fails the first single email request, and batch
+    // requests while `failBatch` is set.
+    std::atomic<int> singleCalls{0}, batchCalls{0};
+    std::atomic<bool> failBatch{false};
+    crow::SimpleApp stub;
+    CROW_ROUTE(stub, "/send").methods("POST"_method)(
+        [&](const crow::request &req) {
+            return crow::response(++singleCalls == 1 ? 500 : 200);
+        });
+    CROW_ROUTE(stub, "/batch").methods("POST"_method)(
+        [&](const crow::request &req) {
+            ++batchCalls;
+            return crow::response(failBatch ? 500 : 200);
+        });
+
+    auto running = stub.bindaddr("127.0.0.1").port(18025).concurrency(1)
+        .signal_clear().loglevel(crow::LogLevel::Warning).run_async();
+    stub.wait_for_server_start();
+
+    Email::OutboxOpts opts {
+        .workers = 1,
+        .batchSize = 10,
+        .baseBackoff = 20ms,
+        .pollInterval = 20ms,
+    };
+
+    SECTION("Single emails are retried until sent")
+    {
+        Email::Outbox::start(opts);
+        REQUIRE(Email::Outbox::enqueue(Email::SendEmail()
+            .to("a@insound.test").subject("Test").text("Test")));
+
+        REQUIRE(waitFor([]() { return Email::Outbox::pending() == 0; }, 5s));
+        REQUIRE(singleCalls == 2);
+    }
+
+    SECTION("Several pending emails go to the batch endpoint")
+    {
+        opts.batchEndpoint = "http://127.0.0.1:18025/batch";
+
+        // Queue before starting, so one dispatcher claims them together
+        for (int i = 0; i < 3; ++i)
+        {
+            REQUIRE(Email::Outbox::enqueue(Email::SendEmail()
+                .to(sf("{}@insound.test", i)).subject("Test").text("Test")));
+        }
+        Email::Outbox::start(opts);
+
+        REQUIRE(waitFor([]() { return Email::Outbox::pending() == 0; }, 5s));
+        REQUIRE(batchCalls == 1);
+        REQUIRE(singleCalls == 0);
+    }
+
+    SECTION("Emails of a failed batch are sent one at a time")
+    {
+        opts.batchEndpoint = "http://127.0.0.1:18025/batch";
+        failBatch = true;
+
+        for (int i = 0; i < 3; ++i)
+        {
+            REQUIRE(Email::Outbox::enqueue(Email::SendEmail()
+                .to(sf("{}@insound.test", i)).subject("Test").text("Test")));
+        }
+        Email::Outbox::start(opts);
+
+        // Only the email whose single request failed is retried
+        REQUIRE(waitFor([]() { return Email::Outbox::pending() == 0; }, 5s));
+        REQUIRE(batchCalls == 1);
+        REQUIRE(singleCalls == 4);
+    }
+
+    Email::Outbox::stop();
+    stub.stop();
+    running.wait();
+}
@@ -2,6 +2,16 @@
 #include <insound/core/request.h>
 
 #include <insound/core/thirdparty/glaze.hpp>
+#include <crow/app.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
 
 // ===== JSON Schemas =========================================================
 
@@ -60,3 +70,115 @@ TEST_CASE ("Request throws when data does not meet expected type")
     REQUIRE_THROWS(body = Insound::request<person_response>("https://httpbin.org/post",
         Insound::HttpMethod::Post, &p));
 }
+
+TEST_CASE ("Request sends async requests concurrently")
+{
+    // Local stub with a slow route, so overlap is measurable
+    crow::SimpleApp stub;
+    CROW_ROUTE(stub, "/slow")([]() {
+        std::this_thread::sleep_for(200ms);
+        return "done";
+    });
+
+    auto running = stub.bindaddr("127.0.0.1").port(18026).concurrency(8)
+        .signal_clear().loglevel(crow::LogLevel::Warning).run_async();
+    stub.wait_for_server_start();
+
+    constexpr int Count = 8;
+    std::vector<Insound::MakeRequest> requests;
+    std::vector<std::future<std::string>> responses;
+    requests.reserve(Count);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < Count; ++i)
+    {
+        auto &req = requests.emplace_back("http://127.0.0.1:18026/slow",
+            "GET");
+        responses.emplace_back(req.sendAsync());
+    }
+
+    for (auto &res : responses)
+        REQUIRE(res.get() == "done");
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    for (auto &req : requests)
+        REQUIRE(req.getCode() == 200);
+
+    // Sent one after another these would take Count * 200ms
+    REQUIRE(elapsed < Count * 200ms / 2);
+
+    SECTION("Errors are delivered through the future")
+    {
+        Insound::MakeRequest req("http://127.0.0.1:1/unreachable", "GET");
+        auto res = req.sendAsync();
+        REQUIRE_THROWS(res.get());
+    }
+
+    stub.stop();
+    running.wait();
+}
+
+TEST_CASE ("Request receives bodies larger than one chunk")
+{
+    // Larger than curl's write buffer, so it arrives in many chunks
+    std::string large(1024 * 1024 + 17, '\0');
+    for (size_t i = 0; i < large.size(); ++i)
+        large[i] = (char)('a' + i % 26);
+
+    crow::SimpleApp stub;
+    CROW_ROUTE(stub, "/large")([&]() {
+        return large;
+    });
+
+    auto running = stub.bindaddr("127.0.0.1").port(18027).concurrency(2)
+        .signal_clear().loglevel(crow::LogLevel::Warning).run_async();
+    stub.wait_for_server_start();
+
+    Insound::MakeRequest req("http://127.0.0.1:18027/large", "GET");
+
+    SECTION("Into a string")
+    {
+        auto body = req.send();
+        REQUIRE(body.size() == large.size());
+        REQUIRE(body == large);
+    }
+
+    SECTION("Into a sink")
+    {
+        std::string body;
+        size_t chunks = 0;
+        auto bytes = req.send([&](std::string_view chunk) {
+            body.append(chunk);
+            ++chunks;
+            return true;
+        });
+
+        REQUIRE(bytes == large.size());
+        REQUIRE(chunks > 1);
+        REQUIRE(body == large);
+    }
+
+    SECTION("Sink may abort the transfer")
+    {
+        REQUIRE_THROWS(req.send([](std::string_view) { return false; }));
+    }
+
+    SECTION("Into a file")
+    {
+        auto path = std::filesystem::temp_directory_path() /
+            "insound-request-test.bin";
+        auto bytes = req.download(path);
+        REQUIRE(bytes == large.size());
+        REQUIRE(std::filesystem::file_size(path) == large.size());
+
+        std::ifstream file(path, std::ios::binary);
+        std::string body{std::istreambuf_iterator<char>(file), {}};
+        REQUIRE(body == large);
+
+        file.close();
+        std::filesystem::remove(path);
+    }
+
+    stub.stop();
+    running.wait();
+}
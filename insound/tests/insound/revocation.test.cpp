@@ -0,0 +1,93 @@
+#include <insound/tests/test.h>
+#include <insound/core/jwt.h>
+#include <insound/core/mongo.h>
+#include <insound/core/revocation.h>
+
+#include <insound/tests/env.h>
+
+#include <bsoncxx/builder/basic/document.hpp>
+#include <bsoncxx/builder/basic/kvp.hpp>
+#include <bsoncxx/types.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <insound/core/chrono.h>
+using namespace Insound::ChronoLiterals;
+
+#include <chrono>
+
+using bsoncxx::builder::basic::kvp;
+using bsoncxx::builder::basic::make_document;
+
+struct RevocationTestToken {
+    std::string name;
+    IN_JSON_LOCAL_META(RevocationTestToken, name);
+};
+
+TEST_CASE("Revoked tokens fail verification", "[revocation]")
+{
+    configureEnv(ENV_FILEPATH);
+    REQUIRE(Mongo::connect());
+    Mongo::db().collection("RevokedToken").delete_many(make_document());
+
+    Revocation::start();
+
+    auto jwt = Jwt::sign(RevocationTestToken{"Joe"}, 1_min);
+    std::string payload;
+    REQUIRE(Jwt::verify(jwt, payload) == Jwt::Error::Code::OK);
+
+    SECTION("Revoking on this instance applies immediately")
+    {
+        REQUIRE(Jwt::revoke(jwt));
+        REQUIRE(Jwt::verify(jwt, payload) == Jwt::Error::Code::TokenRevoked);
+
+        // Other tokens are unaffected
+        auto other = Jwt::sign(RevocationTestToken{"Ann"}, 1_min);
+        REQUIRE(Jwt::verify(other, payload) == Jwt::Error::Code::OK);
+    }
+
+    SECTION("Revocations by other instances apply after a refresh")
+    {
+        REQUIRE(Jwt::verify(jwt, payload) == Jwt::Error::Code::OK);
+        auto jti = payload.substr(payload.find(R"("jti":")") + 7, 22);
+
+        // As another instance would write it
+        auto now = std::chrono::system_clock::now();
+        Mongo::db().collection("RevokedToken").insert_one(make_document(
+            kvp("_id", jti),
+            kvp("expiresAt", bsoncxx::types::b_date{now + std::chrono::minutes(1)}),
+            kvp("revokedAt", (int64_t)std::chrono::duration_cast<
+                std::chrono::milliseconds>(now.time_since_epoch()).count())));
+
+        Revocation::refresh();
+        REQUIRE(Jwt::verify(jwt, payload) == Jwt::Error::Code::TokenRevoked);
+    }
+
+    SECTION("Revocations survive a restart")
+    {
+        REQUIRE(Jwt::revoke(jwt));
+        Revocation::stop();
+        Revocation::start();
+        REQUIRE(Jwt::verify(jwt, payload) == Jwt::Error::Code::TokenRevoked);
+    }
+
+    SECTION("Invalid tokens can't be revoked")
+    {
+        REQUIRE(!Jwt::revoke("not.a.token"));
+    }
+
+    Revocation::stop();
+}
+
+TEST_CASE("Revocation check benchmark", "[revocation][!benchmark]")
+{
+    configureEnv(ENV_FILEPATH);
+    REQUIRE(Mongo::connect());
+    Revocation::start();
+
+    BENCHMARK("Revocation::isRevoked for a live token")
+    {
+        return Revocation::isRevoked("GPBId1G_QQu5EtqHLdjtEw");
+    };
+
+    Revocation::stop();
+}
@@ -1,7 +1,10 @@
 #include <insound/tests/env.h>
 #include <insound/tests/test.h>
+#include <insound/core/request.h>
 #include <insound/core/s3.h>
 
+#include <chrono>
+
 class S3Tests : public Catch::EventListenerBase
 {
 public:
@@ -86,3 +89,54 @@ TEST_CASE("S3::zipFolder works")
 
     // TODO create ZipReader to check the contents of the binary
 }
+
+TEST_CASE("S3 presigned urls reach storage directly")
+{
+    using namespace std::chrono_literals;
+
+    SECTION("Upload, then download")
+    {
+        auto upload = S3::presignUpload("presigned", 60s);
+        REQUIRE(upload.method == "PUT");
+        REQUIRE(upload.expiresIn == 60);
+
+        MakeRequest put(upload.url, upload.method);
+        put.body(FileContent);
+        put.send();
+        REQUIRE(put.getCode() == 200);
+
+        auto info = S3::fileInfo("presigned");
+        REQUIRE(info);
+        REQUIRE(info->size == std::string_view(FileContent).size());
+        REQUIRE(!info->etag.empty());
+
+        auto download = S3::presignDownload("presigned", 60s);
+        MakeRequest get(download.url);
+        REQUIRE(get.send() == FileContent);
+        REQUIRE(get.getCode() == 200);
+
+        REQUIRE(S3::deleteFile("presigned"));
+        REQUIRE(!S3::fileInfo("presigned"));
+    }
+
+    SECTION("Signed headers are enforced")
+    {
+        auto upload = S3::presignUpload("presigned-typed", 60s, "audio/wav");
+        REQUIRE(upload.headers.at("Content-Type") == "audio/wav");
+
+        MakeRequest wrongType(upload.url, upload.method);
+        wrongType.header("Content-Type", "text/plain").body(FileContent);
+        wrongType.send();
+        REQUIRE(wrongType.getCode() == 403);
+
+        MakeRequest put(upload.url, upload.method);
+        for (auto &[name, value] : upload.headers)
+            put.header(name, value);
+        put.body(FileContent);
+        put.send();
+        REQUIRE(put.getCode() == 200);
+        REQUIRE(S3::fileInfo("presigned-typed")->contentType == "audio/wav");
+
+        REQUIRE(S3::deleteFile("presigned-typed"));
+    }
+}
@@ -0,0 +1,98 @@
+#include <insound/tests/test.h>
+#include <insound/core/regex.h>
+#include <insound/core/validate.h>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_get_random_seed.hpp>
+
+#include <random>
+#include <string>
+#include <vector>
+
+static const std::vector<std::string> sEmailCorpus = {
+    // valid
+    "hi@hello.com", "1@1.com", "h-i@h-ello.com", "h.i@h.ello.com",
+    "a!#$%&'*+/=?^_`{|}~-@x.io", "\"quoted\"@mail.com", "\"\"@mail.com",
+    "\"a@b\\\"c\"@mail.com", "x@[127.0.0.1]", "x@[255.249.199.001]",
+    "x@[1.2.3.ipv6:1\\ 2]", "x@[1.2.3.tag:]]", "x@a1.b-2.c3",
+    // invalid
+    "", ".", ".com", "hi.com", "@.com", "@hello.com", "hi@.com", "hi@com",
+    "Hi@hello.com", "hi@Hello.com", "a..b@c.com", ".a@c.com", "a.@c.com",
+    "hi@-a.com", "hi@a-.com", "hi@a..com", "\"unterminated@mail.com",
+    "\"a\"b@mail.com", "\"tab\t\"@mail.com", "x@[256.0.0.1]",
+    "x@[1.2.3]", "x@[1.2.3.4", "x@[1.2.3.tag:a b]", "x@[1.2.3.-:a]",
+    "x@[1.2.3.tag:]", "hi@hello.com ", "h i@hello.com",
+};
+
+TEST_CASE("Validate::email agrees with Regex::email", "[validate]")
+{
+    SECTION("Corpus")
+    {
+        for (auto &str : sEmailCorpus)
+        {
+            INFO(str);
+            REQUIRE(Validate::email(str) ==
+                std::regex_match(str, Regex::email));
+        }
+    }
+
+    SECTION("Fuzz")
+    {
+        std::mt19937 rng(Catch::getSeed());
+        const std::string alphabet = "ab09-.@\"\\[]:_+Z \t\x01\x7f\n\x80!125";
+
+        for (int i = 0; i < 20000; ++i)
+        {
+            // Mutate corpus entries, or generate noise
+            std::string str;
+            if (i % 2)
+            {
+                str = sEmailCorpus[rng() % sEmailCorpus.size()];
+                for (auto edits = rng() % 4; edits > 0; --edits)
+                {
+                    auto c = alphabet[rng() % alphabet.size()];
+                    auto pos = rng() % (str.size() + 1);
+                    switch(rng() % 3)
+                    {
+                        case 0: str.insert(str.begin() + pos, c); break;
+                        case 1: if (pos < str.size()) str.erase(pos, 1); break;
+                        default: if (pos < str.size()) str[pos] = c; break;
+                    }
+                }
+            }
+            else
+            {
+                for (auto length = rng() % 16; length > 0; --length)
+                    str += alphabet[rng() % alphabet.size()];
+            }
+
+            INFO(str);
+            REQUIRE(Validate::email(str) ==
+                std::regex_match(str, Regex::email));
+        }
+    }
+}
+
+TEST_CASE("Validate::email handles adversarial input", "[validate]")
+{
+    // Long inputs that make a backtracking regex recurse deeply
+    REQUIRE(Validate::email(std::string(100000, 'a') + "@mail.com"));
+    REQUIRE(!Validate::email(std::string(100000, 'a') + "@"));
+    REQUIRE(!Validate::email("x@" + std::string(100000, 'a')));
+    REQUIRE(!Validate::email("\"" + std::string(100000, '\\')));
+}
+
+TEST_CASE("Validate::email benchmarks", "[validate][!benchmark]")
+{
+    const std::string email = "first.last+tag@mail.example.com";
+
+    BENCHMARK("Validate::email")
+    {
+        return Validate::email(email);
+    };
+
+    BENCHMARK("std::regex_match with Regex::email")
+    {
+        return std::regex_match(email, Regex::email);
+    };
+}
@@ -6,4 +6,29 @@
 #include <catch2/reporters/catch_reporter_event_listener.hpp>
 #include <catch2/reporters/catch_reporter_registrars.hpp>
 
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
 using namespace Insound;
+
+/**
+ * Read a whole binary file, such as one of the test audio files, into a
+ * string
+ *
+ * @param  path - path to the file
+ *
+ * @returns     the file data
+ *
+ * @throws std::runtime_error if the file could not be opened
+ */
+inline std::string readFile(std::string_view path)
+{
+    std::ifstream file{std::string(path), std::ios::binary};
+    if (!file.is_open())
+        throw std::runtime_error(sf("Failed to open file at path {}", path));
+
+    return {std::istreambuf_iterator<char>(file), {}};
+}